@@ -0,0 +1,198 @@
+/*
+ * Hash DAG binary adjacency list
+ *
+ * NOTE: The header uses host order.
+ *
+ * The binary adjacency list consists of a header (struct hdag_bin_header),
+ * followed by node records. Each node record consists of the raw node hash,
+ * the number of its targets encoded as an unsigned LEB128 varint, and the
+ * raw target hashes. All hashes have the length specified in the header.
+ */
+
+#ifndef _HDAG_BIN_H
+#define _HDAG_BIN_H
+
+#include <hdag/node_seq.h>
+#include <hdag/misc.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+
+/** The starting signature of the binary adjacency list */
+#define HDAG_BIN_SIGNATURE (uint32_t)('H' | 'D' << 8 | 'A' << 16 | 'L'<< 24 )
+
+/** The binary adjacency list header */
+struct hdag_bin_header {
+    /** The initial signature (must be HDAG_BIN_SIGNATURE) */
+    uint32_t    signature;
+    /** The major and the minor version numbers */
+    struct {
+        uint8_t major;
+        uint8_t minor;
+    } version;
+    /** Hash length, bytes, must be divisible by four */
+    uint16_t    hash_len;
+};
+
+HDAG_ASSERT_STRUCT_MEMBERS_PACKED(
+    hdag_bin_header,
+    signature,
+    version.major,
+    version.minor,
+    hash_len
+);
+
+/**
+ * Check that a binary adjacency list header is valid.
+ *
+ * @param header    The header to check.
+ *
+ * @return True if the header is valid, false otherwise.
+ */
+static inline bool
+hdag_bin_header_is_valid(const struct hdag_bin_header *header)
+{
+    return header != NULL &&
+        header->signature == HDAG_BIN_SIGNATURE &&
+        header->version.major == 0 &&
+        header->version.minor == 0 &&
+        hdag_hash_len_is_valid(header->hash_len);
+}
+
+/** The maximum length of an encoded varint, bytes */
+#define HDAG_BIN_VARINT_MAX_LEN 10
+
+/**
+ * Encode an unsigned integer as an LEB128 varint.
+ *
+ * @param buf   The buffer to write the varint to. Must be at least
+ *              HDAG_BIN_VARINT_MAX_LEN bytes long.
+ * @param value The value to encode.
+ *
+ * @return The length of the encoded varint, bytes.
+ */
+static inline size_t
+hdag_bin_varint_encode(uint8_t *buf, uint64_t value)
+{
+    size_t len = 0;
+    assert(buf != NULL);
+    for (; value >= 0x80; value >>= 7) {
+        buf[len++] = (value & 0x7f) | 0x80;
+    }
+    buf[len++] = value;
+    return len;
+}
+
+/**
+ * Decode an LEB128 varint into an unsigned integer.
+ *
+ * @param ppos      Location of the pointer to the varint to decode.
+ *                  Moved past the varint on success.
+ * @param end       The end of the buffer containing the varint.
+ * @param pvalue    Location for the decoded value.
+ *
+ * @return True if the varint was decoded, false if it was truncated, or
+ *         didn't fit into 64 bits.
+ */
+static inline bool
+hdag_bin_varint_decode(const uint8_t **ppos, const uint8_t *end,
+                       uint64_t *pvalue)
+{
+    const uint8_t *pos;
+    uint64_t value = 0;
+    unsigned int shift = 0;
+    uint8_t byte;
+
+    assert(ppos != NULL);
+    assert(*ppos != NULL);
+    assert(end != NULL);
+    assert(*ppos <= end);
+    assert(pvalue != NULL);
+
+    for (pos = *ppos; pos < end; shift += 7) {
+        byte = *pos++;
+        if (shift == 63 && byte > 1) {
+            return false;
+        }
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *ppos = pos;
+            *pvalue = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+/** The maximum number of nodes returned in a batch by a binary sequence */
+#define HDAG_BIN_NODE_SEQ_BATCH_LEN 256
+
+/** A (resettable) node sequence over a binary adjacency list in memory */
+struct hdag_bin_node_seq {
+    /** The base abstract node sequence */
+    struct hdag_node_seq    base;
+    /** The first node record */
+    const uint8_t          *start;
+    /** The end of the node records */
+    const uint8_t          *end;
+    /** The next node record to return */
+    const uint8_t          *pos;
+    /** The next target hash of the returned node */
+    const uint8_t          *target_hash;
+    /** The number of the returned node's target hashes left to return */
+    size_t                  target_hash_num;
+    /** The returned node's target hash sequence */
+    struct hdag_hash_seq    target_hash_seq;
+    /** The last returned batch of nodes */
+    struct hdag_node_seq_item batch[HDAG_BIN_NODE_SEQ_BATCH_LEN];
+};
+
+/** A next-node retrieval function for a binary node sequence */
+[[nodiscard]]
+extern hdag_res hdag_bin_node_seq_next(
+                            struct hdag_node_seq *base_seq,
+                            const uint8_t **phash,
+                            struct hdag_hash_seq **ptarget_hash_seq);
+
+/** A next-batch retrieval function for a binary node sequence */
+[[nodiscard]]
+extern hdag_res hdag_bin_node_seq_next_batch(
+                            struct hdag_node_seq *base_seq,
+                            const struct hdag_node_seq_item **pitems,
+                            size_t *pnum);
+
+/** A reset function for a binary node sequence */
+extern void hdag_bin_node_seq_reset(struct hdag_node_seq *base_seq);
+
+/**
+ * Initialize a node sequence over a binary adjacency list in memory.
+ * The returned hashes point directly into the memory, without copying.
+ *
+ * @param pseq  Location for the node sequence.
+ *              Will not be modified on failure.
+ * @param ptr   The pointer to the binary adjacency list, starting with the
+ *              header. Must stay unchanged while the sequence is used.
+ * @param len   The length of the binary adjacency list, bytes.
+ *
+ * @return A void universal result, including HDAG_RES_INVALID_FORMAT,
+ *         if the header is invalid. The node records are only validated
+ *         when traversed.
+ */
+[[nodiscard]]
+extern hdag_res hdag_bin_node_seq_init(struct hdag_bin_node_seq *pseq,
+                                       const void *ptr, size_t len);
+
+/**
+ * Write a node sequence as a binary adjacency list to a stream.
+ *
+ * @param stream    The stream to write the binary adjacency list to.
+ * @param node_seq  The node sequence to write.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+extern hdag_res hdag_bin_from_node_seq(FILE *stream,
+                                       struct hdag_node_seq *node_seq);
+
+#endif /* _HDAG_BIN_H */
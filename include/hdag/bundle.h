@@ -6,8 +6,11 @@
 #define _HDAG_BUNDLE_H
 
 #include <hdag/edge.h>
+#include <hdag/interval.h>
+#include <hdag/mention.h>
 #include <hdag/node.h>
 #include <hdag/nodes.h>
+#include <hdag/hash_ops.h>
 #include <hdag/node_seq.h>
 #include <hdag/darr.h>
 #include <hdag/fanout.h>
@@ -26,6 +29,9 @@ struct hdag_bundle {
      */
     uint16_t            hash_len;
 
+    /** The hash operations for the hash length, from hdag_hash_ops_get() */
+    const struct hdag_hash_ops *hash_ops;
+
     /**
      * Nodes.
      * Before compacting, their targets are either unknown, or are indirect
@@ -47,6 +53,16 @@ struct hdag_bundle {
      */
     uint32_t            nodes_fanout[256];
 
+    /**
+     * An optional array of HDAG_FANOUT16_LEN uint32_t node numbers, where
+     * each element stores the number of nodes with the first two bytes of
+     * their hash (as a big-endian number) equal to or less than the index of
+     * the element. Narrows node lookups down much further than
+     * "nodes_fanout", for large bundles. Either empty, or complete and
+     * matching the nodes, in which case "nodes_fanout" must be filled in.
+     */
+    struct hdag_darr    nodes_fanout16;
+
     /**
      * Target hashes.
      * Must be empty if extra_edges is not.
@@ -67,6 +83,14 @@ struct hdag_bundle {
      * If non-empty, the indirect indices in node's targets are pointing here.
      */
     struct hdag_darr    extra_edges;
+
+    /**
+     * An optional array of reachability intervals of the nodes, one slot
+     * of one or more struct hdag_interval per node, in the node order.
+     * Lets reachability checks reject most unreachable nodes right away.
+     * Either empty, or filled in for all the nodes.
+     */
+    struct hdag_darr    node_intervals;
 };
 
 /**
@@ -76,11 +100,14 @@ struct hdag_bundle {
  */
 #define HDAG_BUNDLE_EMPTY(_hash_len) (struct hdag_bundle){ \
     .hash_len = (_hash_len) ? hdag_hash_len_validate(_hash_len) : 0,    \
+    .hash_ops = hdag_hash_ops_get(_hash_len),                           \
     .nodes = HDAG_DARR_EMPTY(hdag_node_size(_hash_len), 64),            \
     .nodes_fanout = HDAG_FANOUT_EMPTY,                                  \
+    .nodes_fanout16 = HDAG_DARR_EMPTY(sizeof(uint32_t), 0),             \
     .target_hashes = HDAG_DARR_EMPTY(_hash_len, 64),                    \
     .unknown_hashes = HDAG_DARR_EMPTY(_hash_len, 16),                   \
     .extra_edges = HDAG_DARR_EMPTY(sizeof(struct hdag_edge), 64),       \
+    .node_intervals = HDAG_DARR_EMPTY(sizeof(struct hdag_interval), 0), \
 }
 
 /**
@@ -195,9 +222,11 @@ hdag_bundle_is_empty(const struct hdag_bundle *bundle)
     assert(hdag_bundle_is_valid(bundle));
     return
         hdag_darr_is_empty(&bundle->nodes) &&
+        hdag_darr_is_empty(&bundle->nodes_fanout16) &&
         hdag_darr_is_empty(&bundle->target_hashes) &&
         hdag_darr_is_empty(&bundle->unknown_hashes) &&
-        hdag_darr_is_empty(&bundle->extra_edges);
+        hdag_darr_is_empty(&bundle->extra_edges) &&
+        hdag_darr_is_empty(&bundle->node_intervals);
 }
 
 /**
@@ -213,9 +242,11 @@ hdag_bundle_is_clean(const struct hdag_bundle *bundle)
     assert(hdag_bundle_is_valid(bundle));
     return
         hdag_darr_is_clean(&bundle->nodes) &&
+        hdag_darr_is_clean(&bundle->nodes_fanout16) &&
         hdag_darr_is_clean(&bundle->target_hashes) &&
         hdag_darr_is_clean(&bundle->unknown_hashes) &&
-        hdag_darr_is_clean(&bundle->extra_edges);
+        hdag_darr_is_clean(&bundle->extra_edges) &&
+        hdag_darr_is_clean(&bundle->node_intervals);
 }
 
 /**
@@ -243,6 +274,65 @@ extern void hdag_bundle_empty(struct hdag_bundle *bundle);
  */
 extern void hdag_bundle_cleanup(struct hdag_bundle *bundle);
 
+/**
+ * Make sure an unorganized bundle has memory allocated for adding the nodes
+ * of a node sequence with hdag_bundle_add_node_seq(), according to the
+ * sequence's size hints. Nothing is allocated for unknown hints.
+ *
+ * @param bundle    The bundle to reserve the memory in. Must be
+ *                  unorganized.
+ * @param node_seq  The node sequence to reserve the memory for.
+ * @param mem_size  The maximum size of the memory to reserve for the
+ *                  nodes and the target hashes each, bytes.
+ *                  Zero for no limit.
+ * @param dedup_targets The dedup_targets argument which is going to be
+ *                      given to hdag_bundle_add_node_seq().
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+extern hdag_res hdag_bundle_reserve_node_seq(
+                                    struct hdag_bundle *bundle,
+                                    const struct hdag_node_seq *node_seq,
+                                    size_t mem_size,
+                                    bool dedup_targets);
+
+/**
+ * Add nodes from a node sequence (adjacency list) to an unorganized bundle,
+ * along with a placeholder node with unknown targets for each of their
+ * target hashes, but don't do any optimization or validation. Retrieves
+ * the nodes (and the target hashes) in batches, if the sequences support
+ * that, and one at a time otherwise.
+ *
+ * If requested, tracks the hashes seen in the sequence in a hash table,
+ * and only adds placeholder nodes for the target hashes which weren't
+ * seen as nodes, after all the nodes. That produces the same organized
+ * bundle, but can halve the number of nodes to sort and deduplicate.
+ *
+ * @param bundle    The bundle to add the nodes to. Must be unorganized.
+ * @param node_seq  The sequence of nodes (and optionally their targets)
+ *                  to add. Must have the same hash length as the bundle.
+ * @param mem_size  The size of the bundle's nodes and target hashes
+ *                  (and the seen hash table), bytes, to stop adding at,
+ *                  after a complete node or batch. The placeholder nodes
+ *                  for unseen targets are added after that.
+ *                  Zero to add all the nodes in the sequence.
+ * @param dedup_targets True to only add placeholder nodes for target
+ *                      hashes not seen as nodes (or other targets),
+ *                      false to add one for every target hash.
+ *
+ * @return  Zero (HDAG_RES_OK) if adding stopped at the memory size, and
+ *          the sequence might have more nodes.
+ *          A positive number if there were no more nodes.
+ *          A negative number (a failure result) if adding has failed.
+ *          The bundle is valid, but can be partially added to on failure.
+ */
+[[nodiscard]]
+extern hdag_res hdag_bundle_add_node_seq(struct hdag_bundle *bundle,
+                                         struct hdag_node_seq *node_seq,
+                                         size_t mem_size,
+                                         bool dedup_targets);
+
 /**
  * Create a bundle from a node sequence (adjacency list), but don't do any
  * optimization or validation.
@@ -271,7 +361,8 @@ extern hdag_res hdag_bundle_from_node_seq(struct hdag_bundle *pbundle,
  *                  hash followed by hashes of its targets, if any. Each hash is
  *                  represented by a hexadecimal number, separated by
  *                  (non-linebreak) whitespace. Hashes are assumed to be
- *                  right-aligned.
+ *                  right-aligned. The stream is memory-mapped, if it's a
+ *                  regular file, or read in large blocks otherwise.
  * @param hash_len  The length of hashes expected to be contained in the
  *                  stream. Must be a valid hash length.
  *
@@ -283,6 +374,99 @@ extern hdag_res hdag_bundle_from_node_seq(struct hdag_bundle *pbundle,
 extern hdag_res hdag_bundle_from_txt(struct hdag_bundle *pbundle,
                                      FILE *stream, uint16_t hash_len);
 
+/**
+ * Add the nodes from an adjacency list text file to an unorganized bundle
+ * using multiple threads, but don't do any optimization or validation.
+ * The first chunk of the text is parsed directly into the bundle, and the
+ * others are parsed into their own bundles and appended, producing the
+ * same result hdag_bundle_add_node_seq() would for the text, except the
+ * placeholder nodes for unseen targets are deduplicated per chunk.
+ *
+ * @param bundle        The bundle to add the nodes to. Must be unorganized.
+ *                      Can be partially added to on failure.
+ * @param stream        The FILE stream containing the text to parse and
+ *                      load, in the same format hdag_bundle_from_txt()
+ *                      accepts, with the bundle's hash length.
+ * @param thread_num    The maximum number of threads to use, or zero to use
+ *                      one per online CPU. Small texts use fewer threads.
+ * @param dedup_targets True to only add placeholder nodes for target
+ *                      hashes not seen as nodes, false to add one for
+ *                      every target hash.
+ *
+ * @return A void universal result, including HDAG_RES_INVALID_FORMAT,
+ *         if the file format is invalid, and HDAG_RES_ERRNO's in case of
+ *         libc errors.
+ */
+[[nodiscard]]
+extern hdag_res hdag_bundle_add_txt_parallel(struct hdag_bundle *bundle,
+                                             FILE *stream,
+                                             unsigned int thread_num,
+                                             bool dedup_targets);
+
+/**
+ * Add the nodes from an adjacency list text file to an unorganized bundle
+ * using multiple threads, and sort it, but don't do any other optimization
+ * or validation. Same as hdag_bundle_add_txt_parallel(), except each thread
+ * partitions its chunk of nodes into the 256 node fanout buckets as soon as
+ * it's parsed, the other chunks' buckets are copied next to the first
+ * chunk's in the bundle itself, and then the threads sort a range of
+ * buckets each, so the sorted buckets end up one after another, without
+ * merging. The bundle's existing nodes are partitioned and sorted together
+ * with the first chunk.
+ *
+ * @param bundle        The bundle to add the nodes to. Must be unorganized.
+ *                      Can be partially added to on failure.
+ * @param stream        The FILE stream containing the text to parse and
+ *                      load, in the same format hdag_bundle_from_txt()
+ *                      accepts, with the bundle's hash length.
+ * @param thread_num    The maximum number of threads to use, or zero to use
+ *                      one per online CPU. Small texts use fewer threads.
+ * @param dedup_targets True to only add placeholder nodes for target
+ *                      hashes not seen as nodes, false to add one for
+ *                      every target hash.
+ * @param profile       True to time and report the parsing of each chunk,
+ *                      and the gathering, to stderr, false to not.
+ *
+ * @return A void universal result, including HDAG_RES_INVALID_FORMAT,
+ *         if the file format is invalid, and HDAG_RES_ERRNO's in case of
+ *         libc errors. The bundle is sorted on success.
+ */
+[[nodiscard]]
+extern hdag_res hdag_bundle_add_txt_sorted(struct hdag_bundle *bundle,
+                                           FILE *stream,
+                                           unsigned int thread_num,
+                                           bool dedup_targets,
+                                           bool profile);
+
+/**
+ * Create a bundle from an adjacency list text file using multiple threads,
+ * but don't do any optimization or validation. The whole text is loaded
+ * into memory, split into chunks at line boundaries, and each chunk is
+ * parsed into its own bundle by a separate thread. The chunk bundles are
+ * then concatenated in order, producing the same bundle as
+ * hdag_bundle_from_txt() would.
+ *
+ * @param pbundle       The location for the bundle created from the text
+ *                      file. Can be NULL to have the bundle discarded after
+ *                      creating. Will not be modified on failure.
+ * @param stream        The FILE stream containing the text to parse and
+ *                      load, in the same format hdag_bundle_from_txt()
+ *                      accepts.
+ * @param hash_len      The length of hashes expected to be contained in the
+ *                      stream. Must be a valid hash length.
+ * @param thread_num    The maximum number of threads to use, or zero to use
+ *                      one per online CPU. Small texts use fewer threads.
+ *
+ * @return A void universal result, including HDAG_RES_INVALID_FORMAT,
+ *         if the file format is invalid, and HDAG_RES_ERRNO's in case of
+ *         libc errors.
+ */
+[[nodiscard]]
+extern hdag_res hdag_bundle_from_txt_parallel(struct hdag_bundle *pbundle,
+                                              FILE *stream,
+                                              uint16_t hash_len,
+                                              unsigned int thread_num);
+
 /**
  * Output the hash DAG of a bundle into an adjacency list text file.
  *
@@ -328,6 +512,19 @@ hdag_bundle_fanout_is_empty(const struct hdag_bundle *bundle)
                                 HDAG_ARR_LEN(bundle->nodes_fanout));
 }
 
+/**
+ * Fill in the optional 16-bit nodes fanout array (nodes_fanout16) for a
+ * bundle. Node lookups use it automatically afterwards.
+ *
+ * @param bundle    The bundle to fill in the 16-bit nodes fanout array for.
+ *                  Must be valid, have hashes, have the nodes fanout filled
+ *                  in, and have the 16-bit nodes fanout empty.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+extern hdag_res hdag_bundle_fanout16_fill(struct hdag_bundle *bundle);
+
 /**
  * Remove duplicate node entries from a bundle, preferring known ones, as well
  * as duplicate edges. Fill in "unknown_hashes". Assume nodes are sorted by
@@ -361,6 +558,23 @@ extern hdag_res hdag_bundle_dedup(struct hdag_bundle *bundle,
 [[nodiscard]]
 extern hdag_res hdag_bundle_compact(struct hdag_bundle *bundle);
 
+/**
+ * Compact a bundle like hdag_bundle_compact(), but using multiple threads,
+ * each collecting, resolving, and compacting the targets of a slice of
+ * nodes. The extra edges of each slice are placed according to the counts
+ * of the preceding ones, so the result is the same as for a single thread.
+ *
+ * @param bundle        The bundle to compact edges in.
+ *                      Must be valid, and have hashes.
+ * @param thread_num    The maximum number of threads to use, or zero to
+ *                      use one per online CPU.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+extern hdag_res hdag_bundle_compact_parallel(struct hdag_bundle *bundle,
+                                             unsigned int thread_num);
+
 /**
  * Invert the graph in a bundle: create a new graph with edge directions
  * changed to the opposite, and generations reset.
@@ -657,7 +871,20 @@ hdag_bundle_find_node_idx(const struct hdag_bundle *bundle,
     assert(hdag_bundle_is_valid(bundle));
     assert(hdag_darr_occupied_slots(&bundle->nodes) == 0 ||
            !hdag_bundle_fanout_is_empty(bundle));
-    return hdag_nodes_slice_find(
+
+    if (!hdag_darr_is_empty(&bundle->nodes_fanout16)) {
+        const uint32_t *fanout16 = bundle->nodes_fanout16.slots;
+        size_t pos = hdag_fanout16_pos(hash_ptr);
+        return bundle->hash_ops->nodes_slice_find(
+            bundle->nodes.slots,
+            (pos == 0 ? 0 : fanout16[pos - 1]),
+            fanout16[pos],
+            bundle->hash_len,
+            hash_ptr
+        );
+    }
+
+    return bundle->hash_ops->nodes_slice_find(
         bundle->nodes.slots,
         (*hash_ptr == 0 ? 0 : bundle->nodes_fanout[*hash_ptr - 1]),
         bundle->nodes_fanout[*hash_ptr],
@@ -666,6 +893,45 @@ hdag_bundle_find_node_idx(const struct hdag_bundle *bundle,
     );
 }
 
+/**
+ * Lookup the indexes of nodes within a bundle, using a batch of their
+ * hashes, overlapping the memory accesses of the lookups.
+ * Much faster than looking them up one by one, for large batches.
+ *
+ * @param bundle    The bundle to look up the nodes in.
+ *                  Must have the nodes fanout filled in.
+ * @param hashes    The array of hashes to look up.
+ *                  The hash length must match the bundle hash length.
+ * @param hash_num  The number of hashes to look up.
+ * @param node_idxs Location for the array of hash_num indexes of found
+ *                  nodes (< INT32_MAX), or INT32_MAX for the hashes not
+ *                  found, in the order of the hashes.
+ */
+static inline void
+hdag_bundle_find_node_idx_batch(const struct hdag_bundle *bundle,
+                                const uint8_t *hashes, size_t hash_num,
+                                uint32_t *node_idxs)
+{
+    assert(hdag_bundle_is_valid(bundle));
+    assert(!hdag_bundle_is_hashless(bundle));
+    assert(hdag_darr_occupied_slots(&bundle->nodes) == 0 ||
+           !hdag_bundle_fanout_is_empty(bundle));
+
+    if (!hdag_darr_is_empty(&bundle->nodes_fanout16)) {
+        hdag_nodes_find_batch(
+            bundle->nodes.slots, hdag_darr_occupied_slots(&bundle->nodes),
+            bundle->nodes_fanout16.slots, 16,
+            bundle->hash_len, hashes, hash_num, node_idxs
+        );
+    } else {
+        hdag_nodes_find_batch(
+            bundle->nodes.slots, hdag_darr_occupied_slots(&bundle->nodes),
+            bundle->nodes_fanout, 8,
+            bundle->hash_len, hashes, hash_num, node_idxs
+        );
+    }
+}
+
 /**
  * Lookup a node within a bundle, using its hash.
  *
@@ -754,6 +1020,29 @@ extern bool hdag_bundle_is_unorganized(const struct hdag_bundle *bundle);
 extern hdag_res hdag_bundle_organize(struct hdag_bundle *bundle,
                                      const struct hdag_ctx *ctx);
 
+/**
+ * Organize a bundle - prepare it for becoming a file - like
+ * hdag_bundle_organize(), but sort, dedup, and compact the nodes using
+ * multiple threads, each processing a slice of nodes.
+ *
+ * @param bundle        The bundle to organize. Must be completely
+ *                      unorganized.
+ * @param ctx           The context of this bundle (the abstract
+ *                      supergraph) to check if nodes are duplicates. Can
+ *                      be NULL, which is interpreted as an empty context.
+ * @param thread_num    The maximum number of threads to use, or zero to
+ *                      use one per online CPU.
+ * @param profile       True to time and report each organizing stage to
+ *                      stderr, false to not.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+extern hdag_res hdag_bundle_organize_parallel(struct hdag_bundle *bundle,
+                                              const struct hdag_ctx *ctx,
+                                              unsigned int thread_num,
+                                              bool profile);
+
 /**
  * Check if a bundle is fully organized, that is ready to become a file.
  *
@@ -886,4 +1175,264 @@ extern struct hdag_hash_seq *hdag_bundle_node_hash_seq_init(
 extern hdag_res hdag_bundle_node_forget(struct hdag_bundle *bundle,
                                         uint32_t node_idx);
 
+/**
+ * Fill in the optional reachability intervals of the nodes
+ * (node_intervals) for a bundle, one per each of the specified number of
+ * randomized depth-first traversals. Reachability checks use them
+ * automatically afterwards. More intervals reject more unreachable nodes,
+ * but take more time to fill in, and more memory.
+ *
+ * @param bundle        The bundle to fill in the intervals for.
+ *                      Must be compacted, enumerated, and have the
+ *                      intervals empty.
+ * @param interval_num  The number of intervals per node.
+ *                      Must be greater than zero.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+extern hdag_res hdag_bundle_intervals_fill(struct hdag_bundle *bundle,
+                                           uint32_t interval_num);
+
+/**
+ * Check if a node is reachable from another node in a bundle, that is if
+ * it is the same node, or its ancestor: the target of a path of edges
+ * starting at the other node. Answer right away if the nodes' components,
+ * generations, or reachability intervals (if filled in) rule that out, and
+ * otherwise walk the nodes in the order of descending generation, never
+ * going below the generation of the checked node, nor to the nodes whose
+ * intervals rule it out.
+ *
+ * @param bundle    The bundle containing the nodes.
+ *                  Must be compacted and enumerated.
+ * @param from_idx  The index of the node to start the walk from.
+ * @param to_idx    The index of the node to check the reachability of.
+ *
+ * @return A universal result: one if the "to" node is reachable from the
+ *         "from" node, zero if not, or a failure.
+ */
+[[nodiscard]]
+extern hdag_res hdag_bundle_is_ancestor_idx(const struct hdag_bundle *bundle,
+                                            uint32_t from_idx,
+                                            uint32_t to_idx);
+
+/**
+ * Check if a node is reachable from another node in a bundle, same as
+ * hdag_bundle_is_ancestor_idx(), but looking the nodes up by hashes.
+ *
+ * @param bundle    The bundle containing the nodes.
+ *                  Must be compacted, enumerated, and have the nodes
+ *                  fanout filled in.
+ * @param from_hash The hash of the node to start the walk from.
+ * @param to_hash   The hash of the node to check the reachability of.
+ *
+ * @return A universal result: one if the "to" node is reachable from the
+ *         "from" node, zero if not, or a failure. An errno failure with
+ *         ENOENT, if any of the hashes were not found.
+ */
+[[nodiscard]]
+extern hdag_res hdag_bundle_is_ancestor(const struct hdag_bundle *bundle,
+                                        const uint8_t *from_hash,
+                                        const uint8_t *to_hash);
+
+/**
+ * Find the best common ancestors (merge bases) of one or more nodes
+ * (heads) in a bundle: the nodes reachable from all the heads, which are
+ * not reachable from any other such node. The heads themselves count as
+ * reachable from themselves. Walk the nodes reachable from all the heads
+ * at once, in the order of descending generation, stopping as soon as only
+ * the nodes reachable from the bases found so far remain.
+ *
+ * @param bundle    The bundle containing the nodes.
+ *                  Must be compacted and enumerated.
+ * @param node_idxs The array of indexes of the head nodes.
+ * @param node_num  The number of head nodes. Must be greater than zero.
+ * @param bases     The dynamic array of uint32_t to append the indexes of
+ *                  the found bases to, in the order of descending
+ *                  generation.
+ *
+ * @return A universal result: the number of the bases found and appended
+ *         (zero if the heads have no common ancestors), or a failure.
+ */
+[[nodiscard]]
+extern hdag_res hdag_bundle_merge_bases_idx(const struct hdag_bundle *bundle,
+                                            const uint32_t *node_idxs,
+                                            size_t node_num,
+                                            struct hdag_darr *bases);
+
+/**
+ * Find the best common ancestors (merge bases) of one or more nodes in a
+ * bundle, same as hdag_bundle_merge_bases_idx(), but looking the head
+ * nodes up by hashes.
+ *
+ * @param bundle    The bundle containing the nodes.
+ *                  Must be compacted, enumerated, and have the nodes
+ *                  fanout filled in.
+ * @param hashes    The array of hashes of the head nodes.
+ * @param hash_num  The number of hashes in the array.
+ *                  Must be greater than zero.
+ * @param bases     The dynamic array of uint32_t to append the indexes of
+ *                  the found bases to, in the order of descending
+ *                  generation.
+ *
+ * @return A universal result: the number of the bases found and appended
+ *         (zero if the heads have no common ancestors), or a failure.
+ *         An errno failure with ENOENT, if any of the hashes were not
+ *         found.
+ */
+[[nodiscard]]
+extern hdag_res hdag_bundle_merge_bases(const struct hdag_bundle *bundle,
+                                        const uint8_t *hashes,
+                                        size_t hash_num,
+                                        struct hdag_darr *bases);
+
+/**
+ * Bundle's (resettable) sequence of ancestors of a set of nodes, in the
+ * order of descending generation. Yields the nodes reachable from any of
+ * the "included" start nodes (including themselves), but not from any of
+ * the "excluded" ones (same as "git rev-list A ^B"). Each node is queued
+ * at most once, so the queue never holds more nodes than the bundle, and
+ * neither the queue, nor the bitmaps of queued and excluded nodes are
+ * reallocated once grown, so the walk doesn't allocate memory per step.
+ * Walking a file is possible via a bundle from hdag_file_to_bundle().
+ */
+struct hdag_bundle_ancestor_seq {
+    /** The base abstract node sequence */
+    struct hdag_node_seq                    base;
+    /** The bundle being walked */
+    const struct hdag_bundle               *bundle;
+    /**
+     * The indexes (uint32_t) of the start nodes: the included ones,
+     * followed by the excluded ones
+     */
+    struct hdag_darr                        starts;
+    /** The number of the included start nodes */
+    size_t                                  include_num;
+    /**
+     * The bitmap of the queued nodes, followed by the bitmap of the
+     * excluded nodes, as uint64_t words
+     */
+    struct hdag_darr                        marks;
+    /** The queue of the nodes to visit, as a heap of generation keys */
+    struct hdag_darr                        heap;
+    /** The number of queued nodes which are not excluded */
+    size_t                                  include_queued_num;
+    /** The returned node's target hash sequence */
+    struct hdag_bundle_targets_hash_seq     targets_hash_seq;
+};
+
+/** A next-node retrieval function for bundle's ancestor sequence */
+extern hdag_res hdag_bundle_ancestor_seq_next(
+                            struct hdag_node_seq *base_seq,
+                            const uint8_t **phash,
+                            struct hdag_hash_seq **ptarget_hash_seq);
+
+/** A reset function for bundle's ancestor sequence */
+extern void hdag_bundle_ancestor_seq_reset(struct hdag_node_seq *base_seq);
+
+/**
+ * Initialize an empty sequence of ancestors of nodes in a bundle. Start it
+ * with hdag_bundle_ancestor_seq_start(), and cleanup with
+ * hdag_bundle_ancestor_seq_cleanup() afterwards.
+ *
+ * @param pseq      Location for the ancestor sequence.
+ * @param bundle    The bundle to walk. Must be compacted and enumerated.
+ *
+ * @return The pointer to the abstract node sequence ("&pseq->base").
+ */
+extern struct hdag_node_seq *hdag_bundle_ancestor_seq_init(
+                                struct hdag_bundle_ancestor_seq *pseq,
+                                const struct hdag_bundle *bundle);
+
+/**
+ * (Re)start a sequence of ancestors of nodes in a bundle from a new set of
+ * nodes, reusing the memory allocated for the previous walks.
+ *
+ * @param seq           The ancestor sequence to start.
+ * @param include_idxs  The array of indexes of the nodes to walk the
+ *                      ancestors of. Can be NULL, if include_num is zero.
+ * @param include_num   The number of nodes to walk the ancestors of.
+ * @param exclude_idxs  The array of indexes of the nodes, which ancestors
+ *                      (and themselves) to exclude from the walk.
+ *                      Can be NULL, if exclude_num is zero.
+ * @param exclude_num   The number of nodes to exclude the ancestors of.
+ *
+ * @return A void universal result. The sequence is left empty in case
+ *         of failure.
+ */
+[[nodiscard]]
+extern hdag_res hdag_bundle_ancestor_seq_start(
+                                struct hdag_bundle_ancestor_seq *seq,
+                                const uint32_t *include_idxs,
+                                size_t include_num,
+                                const uint32_t *exclude_idxs,
+                                size_t exclude_num);
+
+/**
+ * Release the memory allocated by a sequence of ancestors of nodes in a
+ * bundle.
+ *
+ * @param seq   The ancestor sequence to cleanup.
+ */
+extern void hdag_bundle_ancestor_seq_cleanup(
+                                struct hdag_bundle_ancestor_seq *seq);
+
+/**
+ * Deduce the status of an issue's fix at one or more nodes in a bundle,
+ * from the mentions of the issue at the nodes and their closest mentioned
+ * ancestors. If a node has a mention itself, the issue is definitely
+ * fixed, or not fixed, there. Otherwise, the issue is not fixed if a
+ * closest mention has it present, and is not an ancestor of a closest
+ * mention having it absent (it is "visible" from the node). If all the
+ * closest mentions having the issue present are "masked" like that, or
+ * there are none, the issue is likely fixed. Walk the ancestors of all
+ * the nodes at once, in the order of descending generation, stopping at
+ * mentions, and then walk the ancestors of the closest mentions having
+ * the issue absent, down to the closest ones having it present.
+ *
+ * @param bundle    The bundle containing the nodes.
+ *                  Must be compacted and enumerated.
+ * @param mentions  The array of mentions of the issue (enum hdag_mention)
+ *                  at every node of the bundle, indexed by node index.
+ * @param node_idxs The array of indexes of the nodes to deduce the fix
+ *                  status at.
+ * @param node_num  The number of the nodes to deduce the fix status at.
+ * @param fixes     The array to output the fix status for each of the
+ *                  nodes to. Left unspecified in case of failure.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+extern hdag_res hdag_bundle_issue_fixes_idx(const struct hdag_bundle *bundle,
+                                            const uint8_t *mentions,
+                                            const uint32_t *node_idxs,
+                                            size_t node_num,
+                                            enum hdag_fix *fixes);
+
+/**
+ * Deduce the status of an issue's fix at one or more nodes in a bundle,
+ * same as hdag_bundle_issue_fixes_idx(), but looking the nodes up by
+ * hashes.
+ *
+ * @param bundle    The bundle containing the nodes.
+ *                  Must be compacted, enumerated, and have the nodes
+ *                  fanout filled in.
+ * @param mentions  The array of mentions of the issue (enum hdag_mention)
+ *                  at every node of the bundle, indexed by node index.
+ * @param hashes    The array of hashes of the nodes to deduce the fix
+ *                  status at.
+ * @param hash_num  The number of hashes in the array.
+ * @param fixes     The array to output the fix status for each of the
+ *                  nodes to. Left unspecified in case of failure.
+ *
+ * @return A void universal result. An errno failure with ENOENT, if any
+ *         of the hashes were not found.
+ */
+[[nodiscard]]
+extern hdag_res hdag_bundle_issue_fixes(const struct hdag_bundle *bundle,
+                                        const uint8_t *mentions,
+                                        const uint8_t *hashes,
+                                        size_t hash_num,
+                                        enum hdag_fix *fixes);
+
 #endif /* _HDAG_BUNDLE_H */
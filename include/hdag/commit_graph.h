@@ -0,0 +1,190 @@
+/*
+ * Hash DAG git commit-graph reader
+ *
+ * Reads commits and their parents directly from git's commit-graph files
+ * (see gitformat-commit-graph(5)), either a single
+ * "objects/info/commit-graph" file, or a chain of split commit-graph files
+ * listed in "objects/info/commit-graphs/commit-graph-chain". Both SHA-1
+ * (20-byte) and SHA-256 (32-byte) object IDs are supported.
+ *
+ * NOTE: The commit-graph files use network (big-endian) byte order.
+ */
+
+#ifndef _HDAG_COMMIT_GRAPH_H
+#define _HDAG_COMMIT_GRAPH_H
+
+#include <hdag/node_seq.h>
+#include <hdag/darr.h>
+#include <hdag/res.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+
+/** The starting signature of a commit-graph file */
+#define HDAG_COMMIT_GRAPH_SIGNATURE \
+    (uint32_t)('C' << 24 | 'G' << 16 | 'P' << 8 | 'H')
+
+/** A single commit-graph file (a layer of a split commit-graph chain) */
+struct hdag_commit_graph_layer {
+    /** The memory-mapped file, or NULL if the layer is not mapped */
+    void           *map;
+    /** The size of the mapping, bytes */
+    size_t          map_size;
+    /** The OID Lookup chunk: sorted commit OIDs */
+    const uint8_t  *oids;
+    /** The Commit Data chunk: tree OIDs, parents, generations and dates */
+    const uint8_t  *data;
+    /** The Extra Edge List chunk, NULL if absent */
+    const uint8_t  *edges;
+    /** Number of entries in the Extra Edge List chunk */
+    uint32_t        edge_num;
+    /** Number of commits in the layer */
+    uint32_t        commit_num;
+    /** Number of commits in all the base layers */
+    uint32_t        base_commit_num;
+};
+
+/** A (possibly split) commit-graph */
+struct hdag_commit_graph {
+    /** The length of the object IDs, bytes, zero if no layers loaded */
+    uint16_t            hash_len;
+    /** The layers (struct hdag_commit_graph_layer), the base first */
+    struct hdag_darr    layers;
+};
+
+/** An initializer for an empty commit-graph */
+#define HDAG_COMMIT_GRAPH_EMPTY (struct hdag_commit_graph){ \
+    .layers = HDAG_DARR_EMPTY(sizeof(struct hdag_commit_graph_layer), 4), \
+}
+
+/**
+ * Check if a commit-graph is valid.
+ *
+ * @param graph The commit-graph to check.
+ *
+ * @return True if the commit-graph is valid, false otherwise.
+ */
+static inline bool
+hdag_commit_graph_is_valid(const struct hdag_commit_graph *graph)
+{
+    return graph != NULL &&
+        hdag_darr_is_valid(&graph->layers) &&
+        graph->layers.slot_size == sizeof(struct hdag_commit_graph_layer) &&
+        (graph->layers.slots_occupied == 0
+            ? graph->hash_len == 0
+            : hdag_hash_len_is_valid(graph->hash_len));
+}
+
+/**
+ * Add a commit-graph file contents as the next layer of a commit-graph.
+ * The contents is validated, except for the commit parent positions,
+ * which are validated when traversed.
+ *
+ * @param graph The commit-graph to add the layer to.
+ * @param ptr   The pointer to the commit-graph file contents.
+ *              Must stay unchanged while the commit-graph is used.
+ * @param len   The length of the commit-graph file contents, bytes.
+ *
+ * @return A void universal result, including HDAG_RES_INVALID_FORMAT, if
+ *         the contents is invalid, uses a different hash length than the
+ *         previous layers, or a different number of base layers than the
+ *         commit-graph has.
+ */
+[[nodiscard]]
+extern hdag_res hdag_commit_graph_add_mem(struct hdag_commit_graph *graph,
+                                          const void *ptr, size_t len);
+
+/**
+ * Open the commit-graph of a git object database: a single commit-graph
+ * file, if it exists, or the split commit-graph chain otherwise. The
+ * files are memory-mapped.
+ *
+ * @param pgraph        Location for the opened commit-graph.
+ *                      Not modified in case of failure.
+ * @param objects_dir   The path to the git objects directory
+ *                      (e.g. ".git/objects").
+ *
+ * @return A void universal result, including HDAG_RES_INVALID_FORMAT, if
+ *         a commit-graph file, or the chain file is invalid.
+ *         If there's no commit-graph, the result is an HDAG_RES_ERRNO,
+ *         with errno set to ENOENT.
+ */
+[[nodiscard]]
+extern hdag_res hdag_commit_graph_open(struct hdag_commit_graph *pgraph,
+                                       const char *objects_dir);
+
+/**
+ * Get the commit OID at a commit-graph position (across all the layers).
+ *
+ * @param graph The commit-graph to get the OID from.
+ * @param pos   The position of the commit.
+ *
+ * @return The pointer to the commit OID, or NULL if the position is
+ *         out of range.
+ */
+extern const uint8_t *hdag_commit_graph_oid(
+                                const struct hdag_commit_graph *graph,
+                                uint32_t pos);
+
+/**
+ * Close a commit-graph, unmapping and freeing everything.
+ *
+ * @param graph The commit-graph to close. Can be closed already.
+ */
+extern void hdag_commit_graph_close(struct hdag_commit_graph *graph);
+
+/** A (resettable) node sequence of commits in a commit-graph */
+struct hdag_commit_graph_node_seq {
+    /** The base abstract node sequence */
+    struct hdag_node_seq                    base;
+    /** The commit-graph being traversed */
+    const struct hdag_commit_graph         *graph;
+    /** The index of the layer of the next commit to return */
+    size_t                                  layer_idx;
+    /** The index of the next commit to return within its layer */
+    uint32_t                                commit_idx;
+    /** The layer of the returned commit */
+    const struct hdag_commit_graph_layer   *layer;
+    /** The Commit Data of the returned commit */
+    const uint8_t                          *data;
+    /**
+     * The state of the returned commit's parent traversal:
+     * 0 - the first parent is next,
+     * 1 - the second parent is next,
+     * 2 - the next parent is in the Extra Edge List,
+     * 3 - no more parents.
+     */
+    unsigned int                            parent_state;
+    /** The index of the next parent in the Extra Edge List */
+    uint32_t                                edge_idx;
+    /** The returned commit's parent OID sequence */
+    struct hdag_hash_seq                    target_hash_seq;
+};
+
+/** A next-node retrieval function for a commit-graph node sequence */
+[[nodiscard]]
+extern hdag_res hdag_commit_graph_node_seq_next(
+                            struct hdag_node_seq *base_seq,
+                            const uint8_t **phash,
+                            struct hdag_hash_seq **ptarget_hash_seq);
+
+/** A reset function for a commit-graph node sequence */
+extern void hdag_commit_graph_node_seq_reset(struct hdag_node_seq *base_seq);
+
+/**
+ * Initialize a node sequence over the commits of a commit-graph, with
+ * their parents as targets. The returned hashes point directly into the
+ * commit-graph, without copying.
+ *
+ * @param pseq  Location for the node sequence.
+ * @param graph The commit-graph to traverse. Must have at least one layer.
+ *              Must stay open while the sequence is used.
+ *
+ * @return The initialized base node sequence. Its traversal can return
+ *         HDAG_RES_INVALID_FORMAT, if the commit parents are invalid.
+ */
+extern struct hdag_node_seq *hdag_commit_graph_node_seq_init(
+                            struct hdag_commit_graph_node_seq *pseq,
+                            const struct hdag_commit_graph *graph);
+
+#endif /* _HDAG_COMMIT_GRAPH_H */
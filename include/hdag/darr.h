@@ -11,6 +11,31 @@
 #include <stdbool.h>
 #include <assert.h>
 
+/* Forward declaration of the dynamic array slot allocator */
+struct hdag_darr_allocator;
+
+/**
+ * The prototype for a function allocating, reallocating, or freeing the
+ * memory of dynamic array slots, with realloc(3) semantics.
+ *
+ * @param allocator The allocator to use.
+ * @param ptr       The memory previously allocated by the allocator, or
+ *                  NULL to allocate anew.
+ * @param size      The new size of the memory, bytes. Zero to free it.
+ *
+ * @return The pointer to the (re)allocated memory, or NULL if the size
+ *         was zero, or if allocation failed (in which case errno is set,
+ *         and the original memory is left intact).
+ */
+typedef void *(*hdag_darr_realloc_fn)(struct hdag_darr_allocator *allocator,
+                                      void *ptr, size_t size);
+
+/** An allocator of dynamic array slots, used instead of the heap */
+struct hdag_darr_allocator {
+    /** The function (re)allocating and freeing the memory */
+    hdag_darr_realloc_fn    realloc_fn;
+};
+
 /** A dynamic array */
 struct hdag_darr {
     /**
@@ -33,6 +58,8 @@ struct hdag_darr {
     size_t slots_allocated;
     /** Number of occupied element slots */
     size_t slots_occupied;
+    /** The allocator of the slots, or NULL to use the heap */
+    struct hdag_darr_allocator *allocator;
 };
 
 /**
@@ -475,13 +502,13 @@ hdag_darr_uinsert(struct hdag_darr *darr, size_t start, size_t num)
     assert(hdag_darr_is_mutable(darr));
     assert(start <= darr->slots_occupied);
     size_t new_slots_occupied = darr->slots_occupied + num;
-    if (num == 0 || hdag_darr_alloc(darr, new_slots_occupied) == NULL) {
+    if (num == 0 || hdag_darr_alloc(darr, num) == NULL) {
         return NULL;
     }
     void *start_slot = hdag_darr_slot(darr, start);
     assert(!hdag_darr_is_void(darr));
-    memmove(start_slot,
-            hdag_darr_slot(darr, start + num),
+    memmove(hdag_darr_slot(darr, start + num),
+            start_slot,
             (darr->slots_occupied - start) * darr->slot_size);
     darr->slots_occupied = new_slots_occupied;
     return start_slot;
@@ -666,6 +693,23 @@ hdag_darr_cappend_one(struct hdag_darr *darr)
     return hdag_darr_cappend(darr, 1);
 }
 
+/**
+ * Make sure a dynamic array has slots allocated for the specified number of
+ * elements beyond the occupied ones, allocating exactly as many as needed,
+ * if not. Unlike the other allocating functions, doesn't round the number
+ * of allocated slots up, so the array can be sized from an estimate
+ * without overshooting it.
+ *
+ * @param darr  The dynamic array to reserve slots in.
+ *              Cannot be void unless num is zero.
+ * @param num   The number of elements to reserve slots for.
+ *
+ * @return True if reserving succeeded, false if memory allocation failed
+ *         (in which case errno is set).
+ */
+[[nodiscard]]
+extern bool hdag_darr_reserve(struct hdag_darr *darr, size_t num);
+
 /**
  * Free all empty element slots in a dynamic array ("deflate").
  *
@@ -716,7 +760,12 @@ hdag_darr_cleanup(struct hdag_darr *darr)
 {
     assert(hdag_darr_is_valid(darr));
     if (hdag_darr_is_mutable(darr)) {
-        free(darr->slots);
+        if (darr->allocator == NULL) {
+            free(darr->slots);
+        } else if (darr->slots != NULL) {
+            (void)darr->allocator->realloc_fn(darr->allocator,
+                                              darr->slots, 0);
+        }
     }
     darr->slots = NULL;
     darr->slots_occupied = 0;
@@ -879,6 +928,75 @@ hdag_darr_qsort_all(struct hdag_darr *darr, hdag_darr_cmp_fn cmp, void *data)
     hdag_darr_qsort(darr, 0, darr->slots_occupied, cmp, data);
 }
 
+/**
+ * Sort a slice of a dynamic array by a byte-string key at a fixed offset in
+ * each element, lexicographically, in place, with an MSD radix sort.
+ * Scatters the elements into 256 buckets by their first key byte, and then
+ * recursively by the following bytes, switching to an insertion sort for
+ * small buckets. Much faster than qsort for uniformly-distributed keys,
+ * such as cryptographic hashes. The sort is not stable.
+ *
+ * @param darr      The dynamic array containing the slice to sort.
+ *                  Cannot be void unless both start and end are zero.
+ * @param start     The index of the first element of the slice to sort.
+ * @param end       The index of the first element *after* the slice to
+ *                  sort.
+ * @param key_off   The offset of the key in each element, bytes.
+ * @param key_len   The length of the key, bytes. The key must fit into
+ *                  the element.
+ */
+extern void hdag_darr_radix_sort(struct hdag_darr *darr,
+                                 size_t start, size_t end,
+                                 size_t key_off, size_t key_len);
+
+/**
+ * Sort a slice of a dynamic array by a byte-string key at a fixed offset in
+ * each element, lexicographically, in place, like hdag_darr_radix_sort(),
+ * but moving large elements fewer times. Scatter the elements into buckets
+ * by the leading key bytes only until the buckets are small enough to fit
+ * the cache. Then sort each bucket's compact keys (the next eight key
+ * bytes and the element index), comparing the complete keys only where
+ * those are equal, and move each element into place once, via a small
+ * scratch buffer. Falls back to hdag_darr_radix_sort(), if the elements
+ * are no larger than the compact keys, or the buffers can't be allocated.
+ *
+ * @param darr      The dynamic array containing the slice to sort.
+ *                  Cannot be void unless both start and end are zero.
+ * @param start     The index of the first element of the slice to sort.
+ * @param end       The index of the first element *after* the slice to
+ *                  sort.
+ * @param key_off   The offset of the key in each element, bytes.
+ * @param key_len   The length of the key, bytes. The key must fit into
+ *                  the element.
+ */
+extern void hdag_darr_key_sort(struct hdag_darr *darr,
+                               size_t start, size_t end,
+                               size_t key_off, size_t key_len);
+
+/**
+ * Partition a slice of a dynamic array into 256 buckets by the value of a
+ * byte at a fixed offset in each element, in place, in linear time. The
+ * elements within each bucket are left in no particular order. The first
+ * pass of hdag_darr_radix_sort(), for splitting the sort between threads.
+ *
+ * @param darr          The dynamic array containing the slice to
+ *                      partition. Cannot be void unless both start and
+ *                      end are zero.
+ * @param start         The index of the first element of the slice to
+ *                      partition.
+ * @param end           The index of the first element *after* the slice
+ *                      to partition.
+ * @param byte_off      The offset of the byte to partition by, in each
+ *                      element.
+ * @param bucket_ends   Location for the index of the element after the
+ *                      end of each bucket (the bucket of elements with
+ *                      the byte equal to the location's index).
+ */
+extern void hdag_darr_radix_partition(struct hdag_darr *darr,
+                                      size_t start, size_t end,
+                                      size_t byte_off,
+                                      size_t bucket_ends[256]);
+
 /**
  * Return the index corresponding to an array slot pointer.
  *
@@ -919,6 +1037,8 @@ hdag_darr_copy(struct hdag_darr *pdst, const struct hdag_darr *src)
     size_t size_occupied = src->slots_occupied * src->slot_size;
     struct hdag_darr dst = *src;
 
+    /* The copy is always on the heap */
+    dst.allocator = NULL;
     if (size_occupied != 0) {
         dst.slots = malloc(size_occupied);
         if (dst.slots == NULL) {
@@ -5,6 +5,12 @@
 #ifndef _HDAG_FANOUT_H
 #define _HDAG_FANOUT_H
 
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <assert.h>
+
 /**
  * Check if a fanout array is valid.
  *
@@ -26,6 +32,26 @@ hdag_fanout_is_valid(const uint32_t *fanout_ptr, size_t fanout_len)
     return i >= fanout_len;
 }
 
+/**
+ * The length of a 16-bit fanout array: one indexed by the first two bytes
+ * of the hash, rather than by the first one.
+ */
+#define HDAG_FANOUT16_LEN   65536
+
+/**
+ * Get the position of a hash in a 16-bit fanout array.
+ *
+ * @param hash  The hash to get the position of. Must be at least two bytes.
+ *
+ * @return The first two bytes of the hash, as a big-endian number.
+ */
+static inline size_t
+hdag_fanout16_pos(const uint8_t *hash)
+{
+    assert(hash != NULL);
+    return (size_t)hash[0] << 8 | hash[1];
+}
+
 /** An initializer for an empty fanout array */
 #define HDAG_FANOUT_EMPTY   {}
 
@@ -9,6 +9,7 @@
 
 #include <hdag/bundle.h>
 #include <hdag/misc.h>
+#include <endian.h>
 #include <fcntl.h>
 #include <linux/limits.h>
 #include <sys/mman.h>
@@ -85,6 +86,176 @@ hdag_file_header_is_valid(const struct hdag_file_header *header)
          header->unknown_hash_num < header->node_num);
 }
 
+/**
+ * The header of an optional file section. Any number of sections can follow
+ * the unknown hashes at the end of the file, one after another, each
+ * starting with this header, followed by the section contents. Sections of
+ * unknown types are ignored when opening a file.
+ */
+struct hdag_file_section {
+    /** The section type signature (HDAG_FILE_SECTION_*) */
+    uint32_t    type;
+    /** The size of the section contents, bytes, divisible by four */
+    uint32_t    size;
+};
+
+HDAG_ASSERT_STRUCT_MEMBERS_PACKED(
+    hdag_file_section,
+    type,
+    size
+);
+
+/**
+ * The type signature of the node lookup index section.
+ *
+ * The section contains two uint32_t arrays of (node_num + 1) elements
+ * each. The first one contains the first four bytes of each node's hash,
+ * as a big-endian number, laid out in the Eytzinger (breadth-first binary
+ * tree) order, starting with element one. The second one contains the
+ * index of the node each prefix was taken from, in the same order.
+ * The zeroth element of both arrays contains the number of nodes.
+ */
+#define HDAG_FILE_SECTION_INDEX \
+    (uint32_t)('I' | 'D' << 8 | 'X' << 16 | '0' << 24)
+
+/**
+ * The type signature of the 16-bit node fanout section.
+ *
+ * The section contains a uint32_t array of HDAG_FANOUT16_LEN elements,
+ * where each element stores the number of nodes with the first two bytes
+ * of their hash (as a big-endian number) equal to or less than the index
+ * of the element.
+ */
+#define HDAG_FILE_SECTION_FANOUT16 \
+    (uint32_t)('F' | 'O' << 8 | '1' << 16 | '6' << 24)
+
+/**
+ * The type signature of the Bloom filter section.
+ *
+ * The section contains a blocked Bloom filter of the node hashes: a
+ * struct hdag_file_bloom header, followed by padding, and then by the
+ * filter blocks, each HDAG_FILE_BLOOM_BLOCK_WORDS uint32_t words long, and
+ * aligned to its size in the file, so it fits a single cache line.
+ * See hdag_file_bloom_may_contain() for the way hashes map to the bits.
+ */
+#define HDAG_FILE_SECTION_BLOOM \
+    (uint32_t)('B' | 'L' << 8 | 'M' << 16 | '0' << 24)
+
+/** The number of uint32_t words in a Bloom filter block */
+#define HDAG_FILE_BLOOM_BLOCK_WORDS 8
+
+/** The size of a Bloom filter block, bytes */
+#define HDAG_FILE_BLOOM_BLOCK_SIZE \
+    (sizeof(uint32_t) * HDAG_FILE_BLOOM_BLOCK_WORDS)
+
+/** The header of the Bloom filter section contents */
+struct hdag_file_bloom {
+    /** The number of filter blocks, greater than zero */
+    uint32_t    block_num;
+    /** The offset of the blocks from the start of this header, bytes */
+    uint32_t    block_off;
+};
+
+HDAG_ASSERT_STRUCT_MEMBERS_PACKED(
+    hdag_file_bloom,
+    block_num,
+    block_off
+);
+
+/**
+ * Mix a hash into a 64-bit number for the Bloom filter. The high half
+ * selects the block, and the low half selects the bits within it.
+ *
+ * @param hash      The hash to mix.
+ * @param hash_len  The length of the hash.
+ *
+ * @return The mixed hash.
+ */
+static inline uint64_t
+hdag_file_bloom_mix(const uint8_t *hash, uint16_t hash_len)
+{
+    uint64_t mix = 0;
+    uint32_t word;
+    size_t off;
+    assert(hash != NULL);
+    assert(hdag_hash_len_is_valid(hash_len));
+    for (off = 0; off < hash_len; off += sizeof(word)) {
+        memcpy(&word, hash + off, sizeof(word));
+        mix = (mix ^ word) * 0x9e3779b97f4a7c15ULL;
+    }
+    return mix ^ (mix >> 32);
+}
+
+/**
+ * Get the bit of a Bloom filter block word a mixed hash sets.
+ *
+ * @param mix   The mixed hash, see hdag_file_bloom_mix().
+ * @param word  The index of the word in the block.
+ *
+ * @return The word with just the bit set.
+ */
+static inline uint32_t
+hdag_file_bloom_bit(uint64_t mix, size_t word)
+{
+    /* Odd multipliers spreading the bits between the words */
+    static const uint32_t salts[HDAG_FILE_BLOOM_BLOCK_WORDS] = {
+        0x47b6137b, 0x44974d91, 0x8824ad5b, 0xa2b7289d,
+        0x705495c7, 0x2df1424b, 0x9efc4947, 0x5c6bfb31,
+    };
+    assert(word < HDAG_FILE_BLOOM_BLOCK_WORDS);
+    return (uint32_t)1 << (((uint32_t)mix * salts[word]) >> 27);
+}
+
+/**
+ * The type signature of the reachability intervals section.
+ *
+ * The section contains a struct hdag_file_intervals header, followed by
+ * the reachability intervals of the nodes: interval_num struct
+ * hdag_interval per node, in the node order.
+ */
+#define HDAG_FILE_SECTION_INTERVALS \
+    (uint32_t)('I' | 'V' << 8 | 'L' << 16 | '0' << 24)
+
+/** The header of the reachability intervals section contents */
+struct hdag_file_intervals {
+    /** The number of intervals per node, greater than zero */
+    uint32_t    interval_num;
+};
+
+HDAG_ASSERT_STRUCT_MEMBERS_PACKED(
+    hdag_file_intervals,
+    interval_num
+);
+
+/**
+ * Calculate the size of the node lookup index section contents.
+ *
+ * @param node_num  The number of nodes in the file.
+ *
+ * @return The size of the section contents, bytes.
+ */
+static inline size_t
+hdag_file_index_size(uint32_t node_num)
+{
+    return sizeof(uint32_t) * 2 * ((size_t)node_num + 1);
+}
+
+/**
+ * Convert a hash to its node lookup index prefix.
+ *
+ * @param hash  The hash to convert.
+ *
+ * @return The first four bytes of the hash as a big-endian number.
+ */
+static inline uint32_t
+hdag_file_index_prefix(const uint8_t *hash)
+{
+    uint32_t prefix;
+    assert(hash != NULL);
+    memcpy(&prefix, hash, sizeof(prefix));
+    return be32toh(prefix);
+}
+
 /**
  * The file state.
  * Considered closed if initialized to zeroes.
@@ -102,6 +273,9 @@ struct hdag_file {
     /** The file header */
     struct hdag_file_header    *header;
 
+    /** The hash operations for the file's hash length */
+    const struct hdag_hash_ops *hash_ops;
+
     /**
      * The node array.
      *
@@ -115,6 +289,38 @@ struct hdag_file {
 
     /** The array of hashes of unknown nodes (duplicating "nodes" info) */
     uint8_t                    *unknown_hashes;
+
+    /*
+     * Pointers to the contents of optional sections, only valid, if
+     * contents != NULL, and NULL, if the file doesn't have the section.
+     */
+
+    /**
+     * The node hash prefixes of the lookup index, in the Eytzinger order,
+     * see HDAG_FILE_SECTION_INDEX.
+     */
+    uint32_t                   *index_prefixes;
+
+    /** The node indexes of the lookup index, in the Eytzinger order */
+    uint32_t                   *index_node_idxs;
+
+    /** The 16-bit node fanout, see HDAG_FILE_SECTION_FANOUT16 */
+    uint32_t                   *fanout16;
+
+    /** The Bloom filter header, see HDAG_FILE_SECTION_BLOOM */
+    struct hdag_file_bloom     *bloom;
+
+    /** The Bloom filter blocks */
+    uint32_t                   *bloom_blocks;
+
+    /**
+     * The reachability intervals header,
+     * see HDAG_FILE_SECTION_INTERVALS
+     */
+    struct hdag_file_intervals *intervals;
+
+    /** The reachability intervals of the nodes */
+    struct hdag_interval       *node_intervals;
 };
 
 /** An initializer for a closed file */
@@ -222,6 +428,57 @@ extern hdag_res hdag_file_from_node_seq(struct hdag_file *pfile,
                                         mode_t open_mode,
                                         struct hdag_node_seq *node_seq);
 
+/**
+ * Create and open a hash DAG file with specified parameters and a node
+ * sequence (adjacency list), keeping the memory used for collecting the
+ * nodes within a budget.
+ *
+ * Whenever the collected nodes and target hashes exceed the budget, they
+ * are sorted, deduplicated, and spilled into a temporary "run" file. The
+ * runs are then merged into a single sorted and deduplicated run, which is
+ * streamed into the created file, and the edges are resolved against the
+ * nodes already in the file. The result is identical to the one produced
+ * by hdag_file_from_node_seq().
+ *
+ * NOTE: Enumerating generations and components still needs working memory
+ *       proportional to the number of nodes and edges (without hashes).
+ *
+ * @param pfile             Location for the state of the opened file.
+ *                          Not modified in case of failure.
+ *                          Can be NULL to have the file closed after
+ *                          creation.
+ * @param pathname          The file's pathname (template), or NULL to
+ *                          open an in-memory file.
+ * @param template_sfxlen   The (non-negative) number of suffix characters
+ *                          following the "XXXXXX" at the end of "pathname",
+ *                          if it contains the template for a temporary file
+ *                          to be created. Or a negative number to treat
+ *                          "pathname" literally. Ignored, if "pathname" is
+ *                          NULL.
+ * @param open_mode         The mode bitmap to supply to open(2).
+ *                          Ignored, if pathname is NULL.
+ * @param node_seq          The sequence of nodes (and optionally their
+ *                          targets, constituting an adjacency list) to store
+ *                          in the created file. Specifies the node hash
+ *                          length.
+ * @param mem_size          The (approximate) maximum size of the collected
+ *                          nodes and target hashes to keep in memory, bytes.
+ *                          Zero for no limit.
+ * @param profile           True to time and report the stages of building
+ *                          the file to stderr, false to not.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+extern hdag_res hdag_file_from_node_seq_bounded(
+                                        struct hdag_file *pfile,
+                                        const char *pathname,
+                                        int template_sfxlen,
+                                        mode_t open_mode,
+                                        struct hdag_node_seq *node_seq,
+                                        size_t mem_size,
+                                        bool profile);
+
 /**
  * Create and open a hash DAG file with specified parameters and a text
  * adjacency list file stream.
@@ -249,6 +506,11 @@ extern hdag_res hdag_file_from_node_seq(struct hdag_file *pfile,
  *                          right-aligned.
  * @param hash_len          The length of hashes expected to be contained in
  *                          the stream. Must be a valid hash length.
+ * @param thread_num        The maximum number of threads to parse the text
+ *                          and to organize the nodes with, or zero to use
+ *                          one per online CPU.
+ * @param profile           True to time and report the stages of building
+ *                          the file to stderr, false to not.
  *
  * @return A void universal result.
  */
@@ -258,7 +520,49 @@ extern hdag_res hdag_file_from_txt(struct hdag_file *pfile,
                                    int template_sfxlen,
                                    mode_t open_mode,
                                    FILE *stream,
-                                   uint16_t hash_len);
+                                   uint16_t hash_len,
+                                   unsigned int thread_num,
+                                   bool profile);
+
+/**
+ * Create and open a hash DAG file from a binary adjacency list stream.
+ *
+ * @param pfile             Location for the state of the opened file.
+ *                          Not modified in case of failure.
+ *                          Can be NULL to have the file closed after
+ *                          creation.
+ * @param pathname          The file's pathname (template), or NULL to
+ *                          open an in-memory file.
+ * @param template_sfxlen   The (non-negative) number of suffix characters
+ *                          following the "XXXXXX" at the end of "pathname",
+ *                          if it contains the template for a temporary file
+ *                          to be created. Or a negative number to treat
+ *                          "pathname" literally. Ignored, if "pathname" is
+ *                          NULL.
+ * @param open_mode         The mode bitmap to supply to open(2).
+ *                          Ignored, if pathname is NULL.
+ * @param stream            The FILE stream containing the binary adjacency
+ *                          list (see hdag/bin.h), specifying the hash
+ *                          length. Memory-mapped, if it's a regular file,
+ *                          and read into memory completely otherwise.
+ * @param mem_size          The (approximate) maximum size of the collected
+ *                          nodes and target hashes to keep in memory, bytes,
+ *                          or zero for no limit. See
+ *                          hdag_file_from_node_seq_bounded().
+ * @param profile           True to time and report the stages of building
+ *                          the file to stderr, false to not.
+ *
+ * @return A void universal result, including HDAG_RES_INVALID_FORMAT,
+ *         if the binary adjacency list is invalid.
+ */
+[[nodiscard]]
+extern hdag_res hdag_file_from_bin(struct hdag_file *pfile,
+                                   const char *pathname,
+                                   int template_sfxlen,
+                                   mode_t open_mode,
+                                   FILE *stream,
+                                   size_t mem_size,
+                                   bool profile);
 
 /**
  * Write the contents of a file to an adjacency list text stream.
@@ -301,11 +605,17 @@ hdag_file_is_valid(const struct hdag_file *file)
         (file->contents == NULL) == (file->nodes == NULL) &&
         (file->contents == NULL) == (file->extra_edges == NULL) &&
         (file->contents == NULL) == (file->unknown_hashes == NULL) &&
+        (file->contents == NULL) == (file->hash_ops == NULL) &&
         (
             file->contents == NULL ||
             (
                 hdag_file_header_is_valid(file->header) &&
-                file->size == hdag_file_size(
+                (file->index_prefixes == NULL) ==
+                    (file->index_node_idxs == NULL) &&
+                (file->bloom == NULL) == (file->bloom_blocks == NULL) &&
+                (file->intervals == NULL) ==
+                    (file->node_intervals == NULL) &&
+                file->size >= hdag_file_size(
                     file->header->hash_len,
                     file->header->node_num,
                     file->header->extra_edge_num,
@@ -315,6 +625,70 @@ hdag_file_is_valid(const struct hdag_file *file)
         );
 }
 
+/**
+ * Add the node lookup index section (HDAG_FILE_SECTION_INDEX) to an open
+ * file, extending it, unless the file has one already. Once the index is
+ * there, hdag_file_find_node_idx() uses it automatically, instead of
+ * binary-searching the node array.
+ *
+ * @param file  The file to add the section to. Must be open.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+extern hdag_res hdag_file_add_index(struct hdag_file *file);
+
+/**
+ * Add the 16-bit node fanout section (HDAG_FILE_SECTION_FANOUT16) to an
+ * open file, extending it, unless the file has one already. Once the
+ * section is there, hdag_file_find_node_idx() uses it automatically, to
+ * narrow the binary search down to the nodes sharing the first two bytes
+ * of the hash, rather than just one.
+ *
+ * @param file  The file to add the section to. Must be open.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+extern hdag_res hdag_file_add_fanout16(struct hdag_file *file);
+
+/**
+ * Add the Bloom filter section (HDAG_FILE_SECTION_BLOOM) of the node hashes
+ * to an open file, extending it, unless the file has one already. Once the
+ * filter is there, hdag_file_find_node_idx() and (for many unknown
+ * hashes) hdag_file_has_unknown_hash() check it first, and reject most
+ * absent hashes with a single cache miss, instead of searching.
+ *
+ * @param file          The file to add the section to. Must be open.
+ * @param bits_per_hash The number of filter bits to allocate per node
+ *                      hash. Must be greater than zero. E.g. ten bits
+ *                      give about one percent of false positives, and
+ *                      sixteen bits - about a tenth of a percent.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+extern hdag_res hdag_file_add_bloom(struct hdag_file *file,
+                                    unsigned int bits_per_hash);
+
+/**
+ * Add the reachability intervals section (HDAG_FILE_SECTION_INTERVALS) to
+ * an open file, extending it, unless the file has one already. Once the
+ * intervals are there, hdag_file_is_ancestor() and
+ * hdag_file_is_ancestor_idx() reject most unreachable nodes right away,
+ * and prune the rest of their traversals with them.
+ *
+ * @param file          The file to add the section to. Must be open.
+ * @param interval_num  The number of intervals (randomized depth-first
+ *                      traversals) per node. Must be greater than zero.
+ *                      Each one takes eight bytes per node.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+extern hdag_res hdag_file_add_intervals(struct hdag_file *file,
+                                        uint32_t interval_num);
+
 /**
  * Check if a file is open.
  *
@@ -377,6 +751,136 @@ hdag_file_sync(struct hdag_file *file)
 [[nodiscard]]
 extern hdag_res hdag_file_close(struct hdag_file *pfile);
 
+/**
+ * Lookup the index of a node within a file, using its hash, and the node
+ * lookup index section. Descend the Eytzinger-ordered tree of hash prefixes,
+ * prefetching the (adjacent) descendants four levels down, to find the
+ * first node with the prefix not less than the hash's, and then compare the
+ * complete hashes of the nodes with the same prefix.
+ *
+ * @param file      The file to look up the node in. Must have the index.
+ * @param hash_ptr  The hash the node must have.
+ *                  The hash length must match the file's hash length.
+ *
+ * @return The index of the found node (< INT32_MAX),
+ *         or INT32_MAX, if not found.
+ */
+static inline uint32_t
+hdag_file_index_find_node_idx(const struct hdag_file *file,
+                              const uint8_t *hash_ptr)
+{
+    const uint32_t *prefixes = file->index_prefixes;
+    uint16_t hash_len = file->header->hash_len;
+    size_t node_num = prefixes[0];
+    uint32_t prefix = hdag_file_index_prefix(hash_ptr);
+    const struct hdag_node *node;
+    size_t k;
+    size_t idx;
+    int relation;
+
+    assert(hdag_file_is_valid(file));
+    assert(hdag_file_is_open(file));
+    assert(file->index_prefixes != NULL);
+    assert(hash_ptr != NULL);
+
+    /* Find the first prefix not less than ours */
+    for (k = 1; k <= node_num; k = 2 * k + (prefixes[k] < prefix)) {
+        /* Only point within the array, even if not dereferencing */
+        if (16 * k <= node_num) {
+            __builtin_prefetch(prefixes + 16 * k);
+        }
+    }
+    /* Cancel the right turns after it, and the last left turn */
+    k >>= __builtin_ffsll(~(unsigned long long)k);
+
+    /* Compare the nodes with the same prefix, starting with the found one */
+    for (idx = file->index_node_idxs[k]; idx < node_num; idx++) {
+        node = hdag_node_off_const(file->nodes, hash_len, idx);
+        relation = file->hash_ops->cmp(node->hash, hash_ptr, hash_len);
+        if (relation == 0) {
+            return idx;
+        }
+        if (relation > 0 ||
+            hdag_file_index_prefix(node->hash) != prefix) {
+            break;
+        }
+    }
+    return INT32_MAX;
+}
+
+/**
+ * Check if a file's node hashes may contain a hash, according to the
+ * file's Bloom filter section. Never reports a present hash as absent.
+ *
+ * @param file      The file to check. Must have the Bloom filter.
+ * @param hash_ptr  The hash to check.
+ *                  The hash length must match the file's hash length.
+ *
+ * @return True if the hash may be among the file's node hashes,
+ *         false if it definitely isn't.
+ */
+static inline bool
+hdag_file_bloom_may_contain(const struct hdag_file *file,
+                            const uint8_t *hash_ptr)
+{
+    uint64_t mix;
+    const uint32_t *block;
+    size_t word;
+    bool contains = true;
+
+    assert(hdag_file_is_valid(file));
+    assert(hdag_file_is_open(file));
+    assert(file->bloom != NULL);
+    assert(hash_ptr != NULL);
+
+    mix = hdag_file_bloom_mix(hash_ptr, file->header->hash_len);
+    block = file->bloom_blocks + HDAG_FILE_BLOOM_BLOCK_WORDS *
+        (((mix >> 32) * file->bloom->block_num) >> 32);
+    for (word = 0; word < HDAG_FILE_BLOOM_BLOCK_WORDS; word++) {
+        contains &= (block[word] & hdag_file_bloom_bit(mix, word)) != 0;
+    }
+    return contains;
+}
+
+/**
+ * The minimum size of a file's unknown hashes array, bytes, for checking
+ * the Bloom filter before searching it. Smaller arrays stay in the cache,
+ * and are searched faster than the filter is checked.
+ */
+#define HDAG_FILE_BLOOM_UNKNOWN_HASHES_SIZE_MIN (64 * 1024)
+
+/**
+ * Check if a hash belongs to an unknown node of a file, rejecting most of
+ * the other hashes with the file's Bloom filter first, if it has one, and
+ * there are many unknown hashes.
+ *
+ * @param file      The file to check.
+ * @param hash_ptr  The hash to check.
+ *                  The hash length must match the file's hash length.
+ *
+ * @return True if the file has the hash among its unknown hashes,
+ *         false otherwise.
+ */
+static inline bool
+hdag_file_has_unknown_hash(const struct hdag_file *file,
+                           const uint8_t *hash_ptr)
+{
+    assert(hdag_file_is_valid(file));
+    assert(hdag_file_is_open(file));
+    assert(hash_ptr != NULL);
+
+    if (file->bloom != NULL &&
+        (size_t)file->header->unknown_hash_num * file->header->hash_len >=
+            HDAG_FILE_BLOOM_UNKNOWN_HASHES_SIZE_MIN &&
+        !hdag_file_bloom_may_contain(file, hash_ptr)) {
+        return false;
+    }
+    return file->hash_ops->hashes_slice_find(
+        file->unknown_hashes, file->header->hash_len,
+        0, file->header->unknown_hash_num, hash_ptr, NULL
+    );
+}
+
 /**
  * Lookup the index of a node within a file, using its hash.
  *
@@ -396,8 +900,26 @@ hdag_file_find_node_idx(const struct hdag_file *file,
     assert(hash_ptr != NULL);
 
     const uint32_t *fanout = file->header->node_fanout;
+    size_t pos;
+
+    if (file->bloom != NULL && !hdag_file_bloom_may_contain(file, hash_ptr)) {
+        return INT32_MAX;
+    }
+    if (file->fanout16 != NULL) {
+        pos = hdag_fanout16_pos(hash_ptr);
+        return file->hash_ops->nodes_slice_find(
+            file->nodes,
+            (pos == 0 ? 0 : file->fanout16[pos - 1]),
+            file->fanout16[pos],
+            file->header->hash_len,
+            hash_ptr
+        );
+    }
+    if (file->index_prefixes != NULL) {
+        return hdag_file_index_find_node_idx(file, hash_ptr);
+    }
 
-    return hdag_nodes_slice_find(
+    return file->hash_ops->nodes_slice_find(
         file->nodes,
         (*hash_ptr == 0 ? 0 : fanout[*hash_ptr - 1]),
         fanout[*hash_ptr],
@@ -406,4 +928,171 @@ hdag_file_find_node_idx(const struct hdag_file *file,
     );
 }
 
+/**
+ * Lookup the indexes of nodes within a file, using a batch of their
+ * hashes, overlapping the memory accesses of the lookups.
+ * Much faster than looking them up one by one, for large batches.
+ *
+ * @param file      The file to look up the nodes in.
+ * @param hashes    The array of hashes to look up.
+ *                  The hash length must match the file's hash length.
+ * @param hash_num  The number of hashes to look up.
+ * @param node_idxs Location for the array of hash_num indexes of found
+ *                  nodes (< INT32_MAX), or INT32_MAX for the hashes not
+ *                  found, in the order of the hashes.
+ */
+static inline void
+hdag_file_find_node_idx_batch(const struct hdag_file *file,
+                              const uint8_t *hashes, size_t hash_num,
+                              uint32_t *node_idxs)
+{
+    assert(hdag_file_is_valid(file));
+    assert(hdag_file_is_open(file));
+
+    if (file->fanout16 != NULL) {
+        hdag_nodes_find_batch(
+            file->nodes, file->header->node_num, file->fanout16, 16,
+            file->header->hash_len, hashes, hash_num, node_idxs
+        );
+    } else {
+        hdag_nodes_find_batch(
+            file->nodes, file->header->node_num,
+            file->header->node_fanout, 8,
+            file->header->hash_len, hashes, hash_num, node_idxs
+        );
+    }
+}
+
+/**
+ * Check if a node is reachable from another node in a file, that is if it
+ * is the same node, or its ancestor. Answer right away if the nodes'
+ * components, generations, or reachability intervals (if the file has
+ * them) rule that out, and otherwise walk the nodes in the order of
+ * descending generation, never going below the generation of the checked
+ * node, nor to the nodes whose intervals rule it out.
+ *
+ * @param file      The file containing the nodes.
+ * @param from_idx  The index of the node to start the walk from.
+ * @param to_idx    The index of the node to check the reachability of.
+ *
+ * @return A universal result: one if the "to" node is reachable from the
+ *         "from" node, zero if not, or a failure.
+ */
+[[nodiscard]]
+extern hdag_res hdag_file_is_ancestor_idx(const struct hdag_file *file,
+                                          uint32_t from_idx,
+                                          uint32_t to_idx);
+
+/**
+ * Check if a node is reachable from another node in a file, same as
+ * hdag_file_is_ancestor_idx(), but looking the nodes up by hashes.
+ *
+ * @param file      The file containing the nodes.
+ * @param from_hash The hash of the node to start the walk from.
+ * @param to_hash   The hash of the node to check the reachability of.
+ *
+ * @return A universal result: one if the "to" node is reachable from the
+ *         "from" node, zero if not, or a failure. An errno failure with
+ *         ENOENT, if any of the hashes were not found.
+ */
+[[nodiscard]]
+extern hdag_res hdag_file_is_ancestor(const struct hdag_file *file,
+                                      const uint8_t *from_hash,
+                                      const uint8_t *to_hash);
+
+/**
+ * Find the best common ancestors (merge bases) of one or more nodes
+ * (heads) in a file: the nodes reachable from all the heads, which are
+ * not reachable from any other such node. The heads themselves count as
+ * reachable from themselves. Walk the nodes reachable from all the heads
+ * at once, in the order of descending generation, stopping as soon as only
+ * the nodes reachable from the bases found so far remain.
+ *
+ * @param file      The file containing the nodes.
+ * @param node_idxs The array of indexes of the head nodes.
+ * @param node_num  The number of head nodes. Must be greater than zero.
+ * @param bases     The dynamic array of uint32_t to append the indexes of
+ *                  the found bases to, in the order of descending
+ *                  generation.
+ *
+ * @return A universal result: the number of the bases found and appended
+ *         (zero if the heads have no common ancestors), or a failure.
+ */
+[[nodiscard]]
+extern hdag_res hdag_file_merge_bases_idx(const struct hdag_file *file,
+                                          const uint32_t *node_idxs,
+                                          size_t node_num,
+                                          struct hdag_darr *bases);
+
+/**
+ * Find the best common ancestors (merge bases) of one or more nodes in a
+ * file, same as hdag_file_merge_bases_idx(), but looking the head nodes up
+ * by hashes.
+ *
+ * @param file      The file containing the nodes.
+ * @param hashes    The array of hashes of the head nodes.
+ * @param hash_num  The number of hashes in the array.
+ *                  Must be greater than zero.
+ * @param bases     The dynamic array of uint32_t to append the indexes of
+ *                  the found bases to, in the order of descending
+ *                  generation.
+ *
+ * @return A universal result: the number of the bases found and appended
+ *         (zero if the heads have no common ancestors), or a failure.
+ *         An errno failure with ENOENT, if any of the hashes were not
+ *         found.
+ */
+[[nodiscard]]
+extern hdag_res hdag_file_merge_bases(const struct hdag_file *file,
+                                      const uint8_t *hashes,
+                                      size_t hash_num,
+                                      struct hdag_darr *bases);
+
+/**
+ * Deduce the status of an issue's fix at one or more nodes in a file,
+ * from the mentions of the issue at the nodes and their closest mentioned
+ * ancestors, same as hdag_bundle_issue_fixes_idx().
+ *
+ * @param file      The file containing the nodes.
+ * @param mentions  The array of mentions of the issue (enum hdag_mention)
+ *                  at every node of the file, indexed by node index.
+ * @param node_idxs The array of indexes of the nodes to deduce the fix
+ *                  status at.
+ * @param node_num  The number of the nodes to deduce the fix status at.
+ * @param fixes     The array to output the fix status for each of the
+ *                  nodes to. Left unspecified in case of failure.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+extern hdag_res hdag_file_issue_fixes_idx(const struct hdag_file *file,
+                                          const uint8_t *mentions,
+                                          const uint32_t *node_idxs,
+                                          size_t node_num,
+                                          enum hdag_fix *fixes);
+
+/**
+ * Deduce the status of an issue's fix at one or more nodes in a file,
+ * same as hdag_file_issue_fixes_idx(), but looking the nodes up by
+ * hashes.
+ *
+ * @param file      The file containing the nodes.
+ * @param mentions  The array of mentions of the issue (enum hdag_mention)
+ *                  at every node of the file, indexed by node index.
+ * @param hashes    The array of hashes of the nodes to deduce the fix
+ *                  status at.
+ * @param hash_num  The number of hashes in the array.
+ * @param fixes     The array to output the fix status for each of the
+ *                  nodes to. Left unspecified in case of failure.
+ *
+ * @return A void universal result. An errno failure with ENOENT, if any
+ *         of the hashes were not found.
+ */
+[[nodiscard]]
+extern hdag_res hdag_file_issue_fixes(const struct hdag_file *file,
+                                      const uint8_t *mentions,
+                                      const uint8_t *hashes,
+                                      size_t hash_num,
+                                      enum hdag_fix *fixes);
+
 #endif /* _HDAG_FILE_H */
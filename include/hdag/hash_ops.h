@@ -0,0 +1,115 @@
+/*
+ * Hash DAG hash operations specialized for hash lengths
+ */
+
+#ifndef _HDAG_HASH_OPS_H
+#define _HDAG_HASH_OPS_H
+
+#include <hdag/node.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Hash operations (kernels), specialized for a particular hash length, or
+ * generic. Retrieved once for a bundle or a file with hdag_hash_ops_get(),
+ * to avoid the generic memcmp(3) calls in the hot loops.
+ */
+struct hdag_hash_ops {
+    /**
+     * The hash length the operations are specialized for, or zero, if
+     * they're generic.
+     */
+    uint16_t    hash_len;
+
+    /**
+     * Compare two hashes lexicographically.
+     *
+     * @param a         The first hash to compare.
+     * @param b         The second hash to compare.
+     * @param hash_len  The length of the hashes.
+     *
+     * @return Less than zero, if a < b,
+     *         zero, if a == b,
+     *         greater than zero, if a > b.
+     */
+    int         (*cmp)(const uint8_t *a, const uint8_t *b,
+                       uint16_t hash_len);
+
+    /**
+     * Find a node in a slice of node array, by hash.
+     * See hdag_nodes_slice_find() for details.
+     */
+    uint32_t    (*nodes_slice_find)(const struct hdag_node *nodes,
+                                    size_t start_idx, size_t end_idx,
+                                    uint16_t hash_len,
+                                    const uint8_t *hash_ptr);
+
+    /**
+     * Find a node in a slice of node array, by hash, with the
+     * interpolation search.
+     * See hdag_nodes_slice_interp_find() for details.
+     */
+    uint32_t    (*nodes_slice_interp_find)(const struct hdag_node *nodes,
+                                           size_t start_idx,
+                                           size_t end_idx,
+                                           uint16_t hash_len,
+                                           const uint8_t *hash_ptr,
+                                           unsigned int common_bits);
+
+    /**
+     * Find nodes in a node array, by a batch of hashes, advancing the
+     * binary searches for groups of hashes in lockstep, and prefetching
+     * their nodes. See hdag_nodes_find_batch() for details.
+     */
+    void        (*nodes_find_batch)(const struct hdag_node *nodes,
+                                    const uint32_t *fanout,
+                                    unsigned int fanout_bits,
+                                    uint16_t hash_len,
+                                    const uint8_t *hashes,
+                                    size_t hash_num,
+                                    uint32_t *node_idxs);
+
+    /**
+     * Find a hash in a slice of a hash array.
+     * See hdag_hashes_slice_find() for details.
+     */
+    bool        (*hashes_slice_find)(const uint8_t *hashes,
+                                     uint16_t hash_len,
+                                     size_t start_idx, size_t end_idx,
+                                     const uint8_t *hash_ptr,
+                                     size_t *phash_idx);
+};
+
+/**
+ * Check if hash operations are valid.
+ *
+ * @param ops   The hash operations to check.
+ *
+ * @return True if the operations are valid, false otherwise.
+ */
+static inline bool
+hdag_hash_ops_is_valid(const struct hdag_hash_ops *ops)
+{
+    return ops != NULL &&
+        (ops->hash_len == 0 || hdag_hash_len_is_valid(ops->hash_len)) &&
+        ops->cmp != NULL &&
+        ops->nodes_slice_find != NULL &&
+        ops->nodes_slice_interp_find != NULL &&
+        ops->nodes_find_batch != NULL &&
+        ops->hashes_slice_find != NULL;
+}
+
+/**
+ * Get the hash operations for a hash length: specialized ones, if there
+ * are any for the length, or the generic ones.
+ *
+ * @param hash_len  The length of the hashes to get the operations for.
+ *                  Must be valid according to hdag_hash_len_is_valid(),
+ *                  or zero.
+ *
+ * @return The hash operations.
+ */
+extern const struct hdag_hash_ops *hdag_hash_ops_get(uint16_t hash_len);
+
+#endif /* _HDAG_HASH_OPS_H */
@@ -34,17 +34,42 @@ typedef void (*hdag_hash_seq_reset_fn)(struct hdag_hash_seq *hash_seq);
 typedef hdag_res (*hdag_hash_seq_next_fn)(struct hdag_hash_seq *hash_seq,
                                           const uint8_t **phash);
 
+/**
+ * The prototype for a function returning the next batch of hashes from a
+ * sequence.
+ *
+ * @param hash_seq  Hash sequence being traversed.
+ * @param phashes   Location for the pointer to the retrieved hashes, laid
+ *                  out back-to-back. Only valid until the next call.
+ * @param pnum      Location for the number of retrieved hashes.
+ *                  Always non-zero, if retrieved successfully.
+ *
+ * @return  Zero (HDAG_RES_OK) if the hashes were retrieved successfully.
+ *          A positive number if there were no more hashes.
+ *          A negative number (a failure result) if hash retrieval has failed.
+ */
+typedef hdag_res (*hdag_hash_seq_next_batch_fn)(
+                                    struct hdag_hash_seq *hash_seq,
+                                    const uint8_t **phashes,
+                                    size_t *pnum);
+
 /** A hash sequence */
 struct hdag_hash_seq {
     /** The length of returned hashes, bytes */
-    uint16_t                hash_len;
+    uint16_t                    hash_len;
     /**
      * The function resetting the sequence to the first element.
      * If NULL, the sequence is single-pass only.
      */
-    hdag_hash_seq_reset_fn  reset_fn;
+    hdag_hash_seq_reset_fn      reset_fn;
     /** The function retrieving the next hash from the sequence */
-    hdag_hash_seq_next_fn   next_fn;
+    hdag_hash_seq_next_fn       next_fn;
+    /**
+     * The function retrieving the next batch of hashes from the sequence,
+     * advancing the same position as next_fn. If NULL, hashes can only be
+     * retrieved one at a time.
+     */
+    hdag_hash_seq_next_batch_fn next_batch_fn;
 };
 
 /**
@@ -111,6 +136,35 @@ hdag_hash_seq_next(struct hdag_hash_seq *hash_seq,
     return hash_seq->next_fn(hash_seq, phash ? phash : &hash);
 }
 
+/**
+ * Get the next batch of hashes out of a sequence, if possible.
+ * Retrieves a single hash, if the sequence doesn't support batches.
+ *
+ * @param hash_seq  The sequence to retrieve the next hashes from.
+ * @param phashes   Location for the pointer to the retrieved hashes, laid
+ *                  out back-to-back. Only valid until the next call.
+ * @param pnum      Location for the number of retrieved hashes.
+ *                  Always non-zero, if retrieved successfully.
+ *
+ * @return  Zero (HDAG_RES_OK) if the hashes were retrieved successfully.
+ *          A positive number if there were no more hashes.
+ *          A negative number (a failure result) if hash retrieval has failed.
+ */
+static inline hdag_res
+hdag_hash_seq_next_batch(struct hdag_hash_seq *hash_seq,
+                         const uint8_t **phashes,
+                         size_t *pnum)
+{
+    assert(hdag_hash_seq_is_valid(hash_seq));
+    assert(phashes != NULL);
+    assert(pnum != NULL);
+    if (hash_seq->next_batch_fn != NULL) {
+        return hash_seq->next_batch_fn(hash_seq, phashes, pnum);
+    }
+    *pnum = 1;
+    return hash_seq->next_fn(hash_seq, phashes);
+}
+
 /** A next-hash retrieval function which never returns hashes */
 [[nodiscard]]
 extern hdag_res hdag_hash_seq_empty_next(
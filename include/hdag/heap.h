@@ -0,0 +1,132 @@
+/*
+ * Hash DAG max-heap of 64-bit keys
+ */
+
+#ifndef _HDAG_HEAP_H
+#define _HDAG_HEAP_H
+
+#include <hdag/darr.h>
+
+/**
+ * An empty heap: a dynamic array of uint64_t keys, ordered as a binary
+ * max-heap, with the largest key in the first slot.
+ */
+#define HDAG_HEAP_EMPTY HDAG_DARR_EMPTY(sizeof(uint64_t), 64)
+
+/**
+ * Make a heap key out of a node's generation and index, so the nodes
+ * with higher generations come out of the heap first, and the same node
+ * added multiple times comes out in a row.
+ *
+ * @param generation    The generation of the node.
+ * @param node_idx      The index of the node.
+ *
+ * @return The heap key.
+ */
+static inline uint64_t
+hdag_heap_key(uint32_t generation, uint32_t node_idx)
+{
+    return (uint64_t)generation << 32 | node_idx;
+}
+
+/**
+ * Extract the node index from a heap key.
+ *
+ * @param key   The heap key to extract the node index from.
+ *
+ * @return The node index.
+ */
+static inline uint32_t
+hdag_heap_key_node_idx(uint64_t key)
+{
+    return (uint32_t)key;
+}
+
+/**
+ * Extract the node generation from a heap key.
+ *
+ * @param key   The heap key to extract the generation from.
+ *
+ * @return The generation.
+ */
+static inline uint32_t
+hdag_heap_key_generation(uint64_t key)
+{
+    return (uint32_t)(key >> 32);
+}
+
+/**
+ * Add a key to a heap.
+ *
+ * @param heap  The heap to add the key to.
+ * @param key   The key to add.
+ *
+ * @return True if the key was added, false if memory allocation failed,
+ *         and errno was set.
+ */
+static inline bool
+hdag_heap_push(struct hdag_darr *heap, uint64_t key)
+{
+    uint64_t   *keys;
+    size_t      idx;
+    size_t      parent_idx;
+
+    assert(hdag_darr_is_mutable(heap));
+    assert(heap->slot_size == sizeof(uint64_t));
+
+    if (hdag_darr_uappend(heap, 1) == NULL) {
+        return false;
+    }
+    keys = heap->slots;
+    /* Sift the key up from the last slot */
+    for (idx = heap->slots_occupied - 1; idx > 0; idx = parent_idx) {
+        parent_idx = (idx - 1) / 2;
+        if (keys[parent_idx] >= key) {
+            break;
+        }
+        keys[idx] = keys[parent_idx];
+    }
+    keys[idx] = key;
+    return true;
+}
+
+/**
+ * Remove the largest key from a non-empty heap.
+ *
+ * @param heap  The heap to remove the key from. Must not be empty.
+ *
+ * @return The removed key.
+ */
+static inline uint64_t
+hdag_heap_pop(struct hdag_darr *heap)
+{
+    uint64_t   *keys;
+    uint64_t    top;
+    uint64_t    last;
+    size_t      num;
+    size_t      idx;
+    size_t      child_idx;
+
+    assert(hdag_darr_is_mutable(heap));
+    assert(heap->slot_size == sizeof(uint64_t));
+    assert(!hdag_darr_is_empty(heap));
+
+    keys = heap->slots;
+    top = keys[0];
+    num = --heap->slots_occupied;
+    last = keys[num];
+    /* Sift the last key down from the first slot */
+    for (idx = 0; (child_idx = idx * 2 + 1) < num; idx = child_idx) {
+        if (child_idx + 1 < num && keys[child_idx + 1] > keys[child_idx]) {
+            child_idx++;
+        }
+        if (keys[child_idx] <= last) {
+            break;
+        }
+        keys[idx] = keys[child_idx];
+    }
+    keys[idx] = last;
+    return top;
+}
+
+#endif /* _HDAG_HEAP_H */
@@ -0,0 +1,56 @@
+/*
+ * Hash DAG reachability interval
+ */
+
+#ifndef _HDAG_INTERVAL_H
+#define _HDAG_INTERVAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <assert.h>
+
+/**
+ * A reachability interval label of a node: the range of the post-order
+ * ranks of the nodes reachable from it, assigned by one randomized
+ * depth-first traversal of the graph. If a node is reachable from another
+ * node, its interval is contained in the other node's interval, for every
+ * traversal.
+ */
+struct hdag_interval {
+    /** The minimum post-order rank of the reachable nodes */
+    uint32_t    min;
+    /** The post-order rank of the node itself, also the maximum */
+    uint32_t    max;
+};
+
+/**
+ * Check if the intervals of one node contain the intervals of another,
+ * that is, if the second node can be reachable from the first one.
+ *
+ * @param outer The intervals of the node to start from.
+ * @param inner The intervals of the node to check the reachability of.
+ * @param num   The number of intervals each node has.
+ *
+ * @return False if the "inner" node is definitely not reachable from the
+ *         "outer" node, true if it may be.
+ */
+static inline bool
+hdag_intervals_contain(const struct hdag_interval *outer,
+                       const struct hdag_interval *inner,
+                       size_t num)
+{
+    bool contain = true;
+    size_t idx;
+
+    assert(outer != NULL);
+    assert(inner != NULL);
+
+    for (idx = 0; idx < num; idx++) {
+        contain &= outer[idx].min <= inner[idx].min &&
+                   inner[idx].max <= outer[idx].max;
+    }
+    return contain;
+}
+
+#endif /* _HDAG_INTERVAL_H */
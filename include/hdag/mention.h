@@ -0,0 +1,74 @@
+/*
+ * Hash DAG issue mentions and fixes
+ */
+
+#ifndef _HDAG_MENTION_H
+#define _HDAG_MENTION_H
+
+#include <stdbool.h>
+
+/** A mention of an issue at a node: the outcome of testing it for one */
+enum hdag_mention {
+    /** The node wasn't tested for the issue */
+    HDAG_MENTION_NONE = 0,
+    /** The issue was found absent at the node */
+    HDAG_MENTION_ABSENT,
+    /** The issue was found present at the node */
+    HDAG_MENTION_PRESENT,
+    /** The number of known mentions (not a mention itself) */
+    HDAG_MENTION_NUM
+};
+
+/**
+ * Check if a mention is valid.
+ *
+ * @param mention   The mention to check.
+ *
+ * @return True if the mention is valid, false otherwise.
+ */
+static inline bool
+hdag_mention_is_valid(enum hdag_mention mention)
+{
+    return mention >= 0 && mention < HDAG_MENTION_NUM;
+}
+
+/**
+ * The status of an issue's fix at a node, deduced from the closest
+ * mentions of the issue: the mentions at the node itself, or at its
+ * ancestors, reachable without passing other mentions.
+ */
+enum hdag_fix {
+    /** No mentions of the issue are reachable from the node */
+    HDAG_FIX_UNKNOWN = 0,
+    /**
+     * The issue is not fixed: it was found present at the node, or at a
+     * closest mention, which is not an ancestor of a closest mention
+     * with the issue absent
+     */
+    HDAG_FIX_NOT,
+    /**
+     * The issue is likely fixed: all the closest mentions with the issue
+     * present are ancestors of the closest ones with the issue absent,
+     * or there are none
+     */
+    HDAG_FIX_LIKELY,
+    /** The issue is definitely fixed: it was found absent at the node */
+    HDAG_FIX_DEFINITE,
+    /** The number of known fix statuses (not a status itself) */
+    HDAG_FIX_NUM
+};
+
+/**
+ * Check if a fix status is valid.
+ *
+ * @param fix   The fix status to check.
+ *
+ * @return True if the fix status is valid, false otherwise.
+ */
+static inline bool
+hdag_fix_is_valid(enum hdag_fix fix)
+{
+    return fix >= 0 && fix < HDAG_FIX_NUM;
+}
+
+#endif /* _HDAG_MENTION_H */
@@ -6,6 +6,7 @@
 #define _HDAG_MISC_H
 
 #include <stdlib.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 #include <time.h>
@@ -174,6 +175,23 @@ extern char *hdag_bytes_to_hex(char *hex_ptr,
                                const void *bytes_ptr,
                                size_t bytes_num);
 
+/**
+ * Convert a hexadecimal string to bytes, validating the digits.
+ * Accepts both lower- and upper-case digits.
+ *
+ * @param bytes_ptr The buffer to write the bytes to.
+ *                  Must be at least bytes_num long.
+ *                  Can be modified even on failure.
+ * @param hex_ptr   The hexadecimal digits to convert, doesn't need to be
+ *                  zero-terminated. Must be at least bytes_num * 2 long.
+ * @param bytes_num The number of bytes to output.
+ *
+ * @return True if all the digits were valid, false otherwise.
+ */
+extern bool hdag_hex_to_bytes(void *bytes_ptr,
+                              const char *hex_ptr,
+                              size_t bytes_num);
+
 /**
  * Subtract one timespec from another.
  *
@@ -214,6 +232,43 @@ extern char *hdag_bytes_to_hex(char *hex_ptr,
                 _elapsed.tv_sec, _elapsed.tv_nsec);     \
     } while (0)
 
+/**
+ * Report the duration and the throughput of a processing stage to stderr.
+ *
+ * @param action    The action gerund describing the stage.
+ * @param num       The number of items processed.
+ * @param unit      The (plural) name of the items processed.
+ * @param before    The time the stage started at (CLOCK_MONOTONIC).
+ */
+extern void hdag_profile_report(const char *action,
+                                size_t num, const char *unit,
+                                struct timespec before);
+
+/**
+ * Time the execution of a processing stage, and report its duration and
+ * throughput to stderr, if requested.
+ *
+ * @param _profile      True if the stage should be timed and reported,
+ *                      false if the statement should only be executed.
+ * @param _action       The string with the action gerund.
+ * @param _num          The number of items processed by the stage,
+ *                      evaluated after executing the statement.
+ * @param _unit         The string with the (plural) name of the items.
+ * @param _statement    The statement to execute and time.
+ */
+#define HDAG_PROFILE_STAGE(_profile, _action, _num, _unit, _statement) \
+    do {                                                        \
+        bool _do_profile = (_profile);                          \
+        struct timespec _before = {0, 0};                       \
+        if (_do_profile) {                                      \
+            clock_gettime(CLOCK_MONOTONIC, &_before);           \
+        }                                                       \
+        _statement;                                             \
+        if (_do_profile) {                                      \
+            hdag_profile_report(_action, _num, _unit, _before); \
+        }                                                       \
+    } while (0)
+
 /**
  * Get the length of an array (number of elements).
  *
@@ -43,14 +43,58 @@ typedef hdag_res (*hdag_node_seq_next_fn)(
     struct hdag_hash_seq  **ptarget_hash_seq
 );
 
+/** A node retrieved from a node sequence as a part of a batch */
+struct hdag_node_seq_item {
+    /** The node's hash */
+    const uint8_t  *hash;
+    /** The node's target hashes, laid out back-to-back */
+    const uint8_t  *target_hashes;
+    /** The number of the node's target hashes */
+    size_t          target_hash_num;
+};
+
+/**
+ * The prototype for a function returning the next batch of nodes in a
+ * sequence.
+ *
+ * @param node_seq  The node sequence being traversed.
+ * @param pitems    Location for the pointer to the array of retrieved
+ *                  nodes. Only valid until the next call to this, or the
+ *                  next-node function.
+ * @param pnum      Location for the number of retrieved nodes.
+ *                  Always non-zero, if retrieved successfully.
+ *
+ * @return  Zero (HDAG_RES_OK) if the nodes were retrieved successfully.
+ *          A positive number if there were no more nodes.
+ *          A negative number (a failure result) if node retrieval has failed.
+ */
+typedef hdag_res (*hdag_node_seq_next_batch_fn)(
+    struct hdag_node_seq               *node_seq,
+    const struct hdag_node_seq_item   **pitems,
+    size_t                             *pnum
+);
+
 /** A node sequence */
 struct hdag_node_seq {
     /** The length of the node hashes in the sequence, bytes */
-    uint16_t                hash_len;
+    uint16_t                    hash_len;
     /** The function resetting the sequence to the start */
-    hdag_node_seq_reset_fn  reset_fn;
+    hdag_node_seq_reset_fn      reset_fn;
     /** The function retrieving the next node from the sequence */
-    hdag_node_seq_next_fn   next_fn;
+    hdag_node_seq_next_fn       next_fn;
+    /**
+     * The function retrieving the next batch of nodes from the sequence,
+     * advancing the same position as next_fn. If NULL, nodes can only be
+     * retrieved one at a time.
+     */
+    hdag_node_seq_next_batch_fn next_batch_fn;
+    /** The estimated number of nodes in the sequence, zero if unknown */
+    size_t                      node_num_hint;
+    /**
+     * The estimated number of target hashes of all the nodes in the
+     * sequence, zero if unknown
+     */
+    size_t                      target_hash_num_hint;
 };
 
 /**
@@ -128,6 +172,46 @@ hdag_node_seq_next(struct hdag_node_seq *node_seq,
     );
 }
 
+/**
+ * Check if a node sequence supports retrieving nodes in batches.
+ *
+ * @param node_seq  The node sequence to check.
+ *
+ * @return True if the sequence supports batches, false if nodes can only
+ *         be retrieved one at a time.
+ */
+static inline bool
+hdag_node_seq_is_batched(const struct hdag_node_seq *node_seq)
+{
+    assert(hdag_node_seq_is_valid(node_seq));
+    return node_seq->next_batch_fn != NULL;
+}
+
+/**
+ * Retrieve the next batch of nodes from a node sequence.
+ *
+ * @param node_seq  The node sequence to retrieve the next nodes from.
+ *                  Must support batches.
+ * @param pitems    Location for the pointer to the array of retrieved
+ *                  nodes. Only valid until the next retrieval.
+ * @param pnum      Location for the number of retrieved nodes.
+ *                  Always non-zero, if retrieved successfully.
+ *
+ * @return  Zero (HDAG_RES_OK) if the nodes were retrieved successfully.
+ *          A positive number if there were no more nodes.
+ *          A negative number (a failure result) if node retrieval has failed.
+ */
+static inline hdag_res
+hdag_node_seq_next_batch(struct hdag_node_seq *node_seq,
+                         const struct hdag_node_seq_item **pitems,
+                         size_t *pnum)
+{
+    assert(hdag_node_seq_is_batched(node_seq));
+    assert(pitems != NULL);
+    assert(pnum != NULL);
+    return node_seq->next_batch_fn(node_seq, pitems, pnum);
+}
+
 /** A node sequence resetting function which does nothing */
 extern void hdag_node_seq_empty_reset(struct hdag_node_seq *node_seq);
 
@@ -30,6 +30,39 @@ extern uint32_t hdag_nodes_slice_find(const struct hdag_node *nodes,
                                       uint16_t hash_len,
                                       const uint8_t *hash_ptr);
 
+/**
+ * Find a node in a slice of node array, by hash, with the interpolation
+ * search: probe the position the hash would have, if the hashes were
+ * evenly spread over the slice, judging by their first eight bytes, and
+ * narrow the slice down around it. Fall back to the binary search after a
+ * few probes, if the hashes turn out unevenly spread. Takes just a few
+ * probes for (uniformly-distributed) cryptographic hashes.
+ *
+ * @param nodes         The node array to search.
+ *                      Must be sorted lexicographically by node hashes.
+ * @param start_idx     The start index of the nodes array slice to search
+ *                      in. Must be less than INT32_MAX.
+ * @param end_idx       The end index of the nodes array slice to search in
+ *                      (pointing right after the last node of the slice).
+ *                      Must be greater than or equal to start_idx.
+ *                      Must be less than INT32_MAX.
+ * @param hash_len      The length of the node hash.
+ *                      Must be valid according to hdag_hash_len_is_valid().
+ * @param hash_ptr      Pointer to the hash to find in the array.
+ * @param common_bits   The number of leading bits of the hash, which all
+ *                      the hashes in the slice are known to share with it,
+ *                      e.g. 8, if the slice is a fanout array bucket.
+ *                      Must be 64 or less.
+ *
+ * @return The array index of the found node (< INT32_MAX),
+ *         or INT32_MAX, if not found.
+ */
+extern uint32_t hdag_nodes_slice_interp_find(const struct hdag_node *nodes,
+                                             size_t start_idx,
+                                             size_t end_idx,
+                                             uint16_t hash_len,
+                                             const uint8_t *hash_ptr,
+                                             unsigned int common_bits);
 
 /**
  * Find a node in a node array, by hash.
@@ -51,6 +84,57 @@ hdag_nodes_find(const struct hdag_node *nodes, size_t nodes_num,
     return hdag_nodes_slice_find(nodes, 0, nodes_num, hash_len, hash_ptr);
 }
 
+/**
+ * Find nodes in a node array, by a batch of hashes. Advance the binary
+ * searches for groups of hashes in lockstep, prefetching the nodes each of
+ * them is going to compare to next, before comparing any, so their cache
+ * misses overlap, instead of stalling one after another.
+ *
+ * @param nodes         The node array to search.
+ *                      Must be sorted lexicographically by node hashes.
+ * @param nodes_num     Number of nodes in the array.
+ *                      Must be less than INT32_MAX.
+ * @param fanout        The fanout array of the node array, either
+ *                      256 elements long, indexed by the first byte of the
+ *                      hash, or HDAG_FANOUT16_LEN elements long, indexed
+ *                      by the first two bytes.
+ * @param fanout_bits   The number of hash bits indexing the fanout array:
+ *                      8, or 16.
+ * @param hash_len      The length of the node hash.
+ *                      Must be valid according to hdag_hash_len_is_valid().
+ * @param hashes        The array of hashes to find.
+ * @param hash_num      The number of hashes to find.
+ * @param node_idxs     Location for the array of hash_num found node
+ *                      indexes (< INT32_MAX), or INT32_MAX for the hashes
+ *                      not found, in the order of the hashes.
+ */
+extern void hdag_nodes_find_batch(const struct hdag_node *nodes,
+                                  size_t nodes_num,
+                                  const uint32_t *fanout,
+                                  unsigned int fanout_bits,
+                                  uint16_t hash_len,
+                                  const uint8_t *hashes,
+                                  size_t hash_num,
+                                  uint32_t *node_idxs);
+
+/**
+ * Fill in a 16-bit fanout array for a node array: store the number of nodes
+ * with the first two bytes of their hash (as a big-endian number) equal to
+ * or less than the index of each element.
+ *
+ * @param fanout16  The 16-bit fanout array to fill in,
+ *                  HDAG_FANOUT16_LEN elements long.
+ * @param nodes     The node array to fill in the fanout array for.
+ *                  Must be sorted lexicographically by node hashes.
+ * @param nodes_num Number of nodes in the array. Must be less than INT32_MAX.
+ * @param hash_len  The length of the node hash.
+ *                  Must be valid according to hdag_hash_len_is_valid().
+ */
+extern void hdag_nodes_fanout16_fill(uint32_t *fanout16,
+                                     const struct hdag_node *nodes,
+                                     size_t nodes_num,
+                                     uint16_t hash_len);
+
 /**
  * Get a const node from a const node array by its index.
  *
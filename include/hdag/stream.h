@@ -0,0 +1,69 @@
+/*
+ * Hash DAG stream contents in memory
+ */
+
+#ifndef _HDAG_STREAM_H
+#define _HDAG_STREAM_H
+
+#include <hdag/res.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/** The initial size of the buffer for reading a whole stream */
+#define HDAG_STREAM_BUF_SIZE    (64 * 1024)
+
+/**
+ * Map the contents of a stream into memory, if it's a regular file with
+ * some contents after the current position.
+ *
+ * @param stream    The FILE stream to map.
+ * @param pmap      Location for the pointer to the mapping of the whole
+ *                  file. Not modified, if the stream can't be mapped.
+ * @param psize     Location for the size of the mapping, bytes.
+ *                  Not modified, if the stream can't be mapped.
+ * @param poffset   Location for the current position of the stream in the
+ *                  mapping, bytes. Not modified, if the stream can't be
+ *                  mapped.
+ *
+ * @return True if the stream was mapped, false if not, and it has to be
+ *         read instead.
+ */
+extern bool hdag_stream_map(FILE *stream,
+                            char **pmap, size_t *psize, size_t *poffset);
+
+/**
+ * Unmap the contents of a stream mapped with hdag_stream_map(), and
+ * position the stream after the processed contents.
+ *
+ * @param stream    The mapped FILE stream.
+ * @param pmap      Location of the pointer to the mapping. Set to NULL,
+ *                  even on failure. Nothing is done, if already NULL.
+ * @param size      The size of the mapping, bytes.
+ * @param offset    The position to leave the stream at, bytes.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+extern hdag_res hdag_stream_unmap(FILE *stream, char **pmap,
+                                  size_t size, size_t offset);
+
+/**
+ * Read the rest of a stream into a buffer, growing it as needed.
+ *
+ * @param stream    The FILE stream to read.
+ * @param pbuf      Location of the pointer to the (malloc'ed) buffer to
+ *                  read into, or to NULL to allocate one. Updated, if the
+ *                  buffer is grown, even on failure.
+ * @param psize     Location of the size of the buffer, bytes.
+ *                  Updated, if the buffer is grown, even on failure.
+ * @param plen      Location of the number of bytes already in the buffer.
+ *                  Updated with the bytes read, even on failure.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+extern hdag_res hdag_stream_read_all(FILE *stream, char **pbuf,
+                                     size_t *psize, size_t *plen);
+
+#endif /* _HDAG_STREAM_H */
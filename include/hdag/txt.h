@@ -0,0 +1,173 @@
+/*
+ * Hash DAG adjacency list text reader
+ */
+
+#ifndef _HDAG_TXT_H
+#define _HDAG_TXT_H
+
+#include <hdag/hash.h>
+#include <hdag/res.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+
+/** The minimum size of the block buffer used for non-mappable streams */
+#define HDAG_TXT_BUF_SIZE   (64 * 1024)
+
+/**
+ * An adjacency list text reader.
+ *
+ * Reads the text in large blocks (or maps the whole text into memory, if
+ * the stream is a regular file), and extracts hashes from the in-memory
+ * text, without going through stdio for every character.
+ */
+struct hdag_txt {
+    /** The stream being read, NULL if reading a memory block */
+    FILE       *stream;
+    /**
+     * The block buffer, if reading the stream in blocks,
+     * NULL if the stream is memory-mapped, or reading a memory block
+     */
+    char       *buf;
+    /** The size of the block buffer, bytes */
+    size_t      buf_size;
+    /** The memory-mapped stream contents, NULL if not mapped */
+    char       *map;
+    /** The size of the mapping, bytes */
+    size_t      map_size;
+    /** The pointer to the next unprocessed character, NULL if closed */
+    const char *pos;
+    /** The pointer to the end of the available characters */
+    const char *end;
+    /** True if there are no more characters beyond "end" */
+    bool        eof;
+};
+
+/** An initializer for a closed reader */
+#define HDAG_TXT_CLOSED (struct hdag_txt){0, }
+
+/**
+ * Check if a text reader is valid.
+ *
+ * @param txt   The text reader to check.
+ *
+ * @return True if the reader is valid, false otherwise.
+ */
+static inline bool
+hdag_txt_is_valid(const struct hdag_txt *txt)
+{
+    return txt != NULL &&
+        (txt->pos == NULL
+            ? txt->stream == NULL && txt->buf == NULL && txt->map == NULL
+            : txt->pos <= txt->end &&
+              (txt->stream == NULL
+                ? txt->buf == NULL && txt->map == NULL && txt->eof
+                : (txt->buf == NULL) != (txt->map == NULL)));
+}
+
+/**
+ * Check if a text reader is open.
+ *
+ * @param txt   The text reader to check.
+ *
+ * @return True if the reader is open, false otherwise.
+ */
+static inline bool
+hdag_txt_is_open(const struct hdag_txt *txt)
+{
+    assert(hdag_txt_is_valid(txt));
+    return txt->pos != NULL;
+}
+
+/**
+ * Open a text reader for a stream.
+ *
+ * @param ptxt      The location for the opened reader.
+ *                  Will not be modified on failure.
+ * @param stream    The FILE stream containing the text to read. The stream
+ *                  is read from its current position. The position is
+ *                  unspecified while the reader is open.
+ * @param hash_len  The maximum length of the hashes to be read, bytes.
+ *                  Must be a valid hash length.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+extern hdag_res hdag_txt_open(struct hdag_txt *ptxt,
+                              FILE *stream, uint16_t hash_len);
+
+/**
+ * Open a text reader for a memory block.
+ *
+ * @param ptxt      The location for the opened reader.
+ * @param ptr       The pointer to the text to read. Must not be NULL.
+ *                  Must stay unchanged while the reader is open.
+ * @param len       The length of the text, bytes.
+ */
+extern void hdag_txt_open_mem(struct hdag_txt *ptxt,
+                              const char *ptr, size_t len);
+
+/**
+ * Make all the remaining text of an open reader available in memory,
+ * between its "pos" and "end" pointers. Nothing is done, if the stream is
+ * memory-mapped, or the reader is reading a memory block.
+ *
+ * @param txt   The (open) text reader to fill.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+extern hdag_res hdag_txt_fill(struct hdag_txt *txt);
+
+/**
+ * Estimate the number of hashes remaining in an open text reader, from the
+ * size of the text, assuming full-length hashes separated by single
+ * characters. The size of a stream is only known, if it's a regular file.
+ *
+ * @param txt       The (open) text reader to estimate the hashes of.
+ * @param hash_len  The length of the hashes in the text, bytes.
+ *
+ * @return The estimated number of remaining hashes, zero if unknown.
+ */
+extern size_t hdag_txt_hash_num_estimate(const struct hdag_txt *txt,
+                                         uint16_t hash_len);
+
+/**
+ * Skip initial whitespace and read a hash of specified length from a text.
+ *
+ * @param txt               The (open) text reader to read the hash from.
+ * @param hash_buf          The buffer for the read hash (right-aligned).
+ *                          Can be modified even on failure.
+ * @param hash_len          The length of the hash to read,
+ *                          as well as of its buffer, bytes. Must not be
+ *                          longer than the one specified when opening.
+ * @param skip_linebreaks   Include linebreaks into skipped initial
+ *                          whitespace, if true. Assume there's no hash, if
+ *                          false and an initial linebreak is encountered.
+ *
+ * @return  A non-negative number specifying how many hash bytes have been
+ *          unfilled in the buffer, on success, or hash_len, if there was no
+ *          hash.
+ *          A negative number (a failure result) if hash retrieval has failed,
+ *          including HDAG_RES_INVALID_FORMAT, if the text format is invalid,
+ *          and HDAG_RES_ERRNO's in case of libc errors.
+ */
+[[nodiscard]]
+extern hdag_res hdag_txt_read_hash(struct hdag_txt *txt,
+                                   uint8_t *hash_buf, uint16_t hash_len,
+                                   bool skip_linebreaks);
+
+/**
+ * Close a text reader, releasing its resources. If the stream was
+ * memory-mapped, position it right after the last processed character,
+ * otherwise leave the position unspecified.
+ *
+ * @param txt   The text reader to close. Can be closed already.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+extern hdag_res hdag_txt_close(struct hdag_txt *txt);
+
+#endif /* _HDAG_TXT_H */
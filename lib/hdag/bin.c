@@ -0,0 +1,293 @@
+/*
+ * Hash DAG binary adjacency list
+ */
+
+#include <hdag/bin.h>
+#include <hdag/darr.h>
+#include <string.h>
+
+/**
+ * Return the next target hash from a binary adjacency list node.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_bin_node_seq_target_hash_seq_next(struct hdag_hash_seq *hash_seq,
+                                       const uint8_t **phash)
+{
+    struct hdag_bin_node_seq *seq = HDAG_CONTAINER_OF(
+        struct hdag_bin_node_seq, target_hash_seq, hash_seq
+    );
+
+    assert(hdag_hash_seq_is_valid(hash_seq));
+    assert(phash != NULL);
+
+    if (seq->target_hash_num == 0) {
+        return 1;
+    }
+    *phash = seq->target_hash;
+    seq->target_hash += hash_seq->hash_len;
+    seq->target_hash_num--;
+    return HDAG_RES_OK;
+}
+
+/**
+ * Return the next target hashes from a binary adjacency list node,
+ * all at once.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_bin_node_seq_target_hash_seq_next_batch(struct hdag_hash_seq *hash_seq,
+                                             const uint8_t **phashes,
+                                             size_t *pnum)
+{
+    struct hdag_bin_node_seq *seq = HDAG_CONTAINER_OF(
+        struct hdag_bin_node_seq, target_hash_seq, hash_seq
+    );
+
+    assert(hdag_hash_seq_is_valid(hash_seq));
+    assert(phashes != NULL);
+    assert(pnum != NULL);
+
+    if (seq->target_hash_num == 0) {
+        return 1;
+    }
+    *phashes = seq->target_hash;
+    *pnum = seq->target_hash_num;
+    seq->target_hash += seq->target_hash_num * hash_seq->hash_len;
+    seq->target_hash_num = 0;
+    return HDAG_RES_OK;
+}
+
+/**
+ * Parse the next node record of a binary adjacency list, if any.
+ *
+ * @param seq   The binary node sequence to parse the next record of.
+ * @param item  Location for the parsed node.
+ *
+ * @return  Zero (HDAG_RES_OK) if the node was parsed successfully.
+ *          A positive number if there were no more nodes.
+ *          HDAG_RES_INVALID_FORMAT if the record was invalid.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_bin_node_seq_parse(struct hdag_bin_node_seq *seq,
+                        struct hdag_node_seq_item *item)
+{
+    uint16_t        hash_len = seq->base.hash_len;
+    const uint8_t  *pos = seq->pos;
+    const uint8_t  *hash;
+    uint64_t        target_hash_num;
+
+    assert(seq->start <= seq->pos && seq->pos <= seq->end);
+    assert(item != NULL);
+
+    /* If there are no more nodes */
+    if (pos == seq->end) {
+        return 1;
+    }
+
+    /* Read the node hash and the number of targets */
+    if ((size_t)(seq->end - pos) < hash_len) {
+        return HDAG_RES_INVALID_FORMAT;
+    }
+    hash = pos;
+    pos += hash_len;
+    if (!hdag_bin_varint_decode(&pos, seq->end, &target_hash_num) ||
+        target_hash_num > (size_t)(seq->end - pos) / hash_len) {
+        return HDAG_RES_INVALID_FORMAT;
+    }
+
+    /* Output the node, and skip its targets */
+    item->hash = hash;
+    item->target_hashes = pos;
+    item->target_hash_num = target_hash_num;
+    seq->pos = pos + target_hash_num * hash_len;
+    return HDAG_RES_OK;
+}
+
+hdag_res
+hdag_bin_node_seq_next(struct hdag_node_seq *base_seq,
+                       const uint8_t **phash,
+                       struct hdag_hash_seq **ptarget_hash_seq)
+{
+    hdag_res                    res;
+    struct hdag_node_seq_item   item;
+    struct hdag_bin_node_seq   *seq = HDAG_CONTAINER_OF(
+        struct hdag_bin_node_seq, base, base_seq
+    );
+
+    assert(hdag_node_seq_is_valid(base_seq));
+    assert(phash != NULL);
+    assert(ptarget_hash_seq != NULL);
+
+    res = hdag_bin_node_seq_parse(seq, &item);
+    if (res != HDAG_RES_OK) {
+        return res;
+    }
+
+    /* Point the target hash sequence at the targets */
+    seq->target_hash = item.target_hashes;
+    seq->target_hash_num = item.target_hash_num;
+
+    *phash = item.hash;
+    *ptarget_hash_seq = &seq->target_hash_seq;
+    return HDAG_RES_OK;
+}
+
+hdag_res
+hdag_bin_node_seq_next_batch(struct hdag_node_seq *base_seq,
+                             const struct hdag_node_seq_item **pitems,
+                             size_t *pnum)
+{
+    hdag_res                    res = HDAG_RES_OK;
+    struct hdag_bin_node_seq   *seq = HDAG_CONTAINER_OF(
+        struct hdag_bin_node_seq, base, base_seq
+    );
+    size_t                      num;
+
+    assert(hdag_node_seq_is_valid(base_seq));
+    assert(pitems != NULL);
+    assert(pnum != NULL);
+
+    /* Forget the targets of the node returned one at a time, if any */
+    seq->target_hash = NULL;
+    seq->target_hash_num = 0;
+
+    /* Parse as many nodes as fit, stopping before an invalid record */
+    for (num = 0; num < HDAG_ARR_LEN(seq->batch); num++) {
+        res = hdag_bin_node_seq_parse(seq, &seq->batch[num]);
+        if (res != HDAG_RES_OK) {
+            break;
+        }
+    }
+
+    /* Report the parsed nodes first, and the failure/end on the next call */
+    if (num == 0) {
+        return res;
+    }
+    *pitems = seq->batch;
+    *pnum = num;
+    return HDAG_RES_OK;
+}
+
+void
+hdag_bin_node_seq_reset(struct hdag_node_seq *base_seq)
+{
+    struct hdag_bin_node_seq *seq = HDAG_CONTAINER_OF(
+        struct hdag_bin_node_seq, base, base_seq
+    );
+    assert(hdag_node_seq_is_valid(base_seq));
+    seq->pos = seq->start;
+    seq->target_hash = NULL;
+    seq->target_hash_num = 0;
+}
+
+hdag_res
+hdag_bin_node_seq_init(struct hdag_bin_node_seq *pseq,
+                       const void *ptr, size_t len)
+{
+    struct hdag_bin_header header;
+
+    assert(pseq != NULL);
+    assert(ptr != NULL || len == 0);
+
+    if (len < sizeof(header)) {
+        return HDAG_RES_INVALID_FORMAT;
+    }
+    memcpy(&header, ptr, sizeof(header));
+    if (!hdag_bin_header_is_valid(&header)) {
+        return HDAG_RES_INVALID_FORMAT;
+    }
+
+    /*
+     * Estimate the nodes assuming one target each, but bound the total
+     * number of hashes by the size, so the bundle nodes fit it
+     */
+    size_t hash_num = (len - sizeof(header)) / header.hash_len;
+    size_t node_num = (len - sizeof(header)) / (header.hash_len * 2 + 1);
+
+    *pseq = (struct hdag_bin_node_seq){
+        .base = {
+            .hash_len = header.hash_len,
+            .node_num_hint = node_num,
+            .target_hash_num_hint = hash_num - node_num,
+            .reset_fn = hdag_bin_node_seq_reset,
+            .next_fn = hdag_bin_node_seq_next,
+            .next_batch_fn = hdag_bin_node_seq_next_batch,
+        },
+        .start = (const uint8_t *)ptr + sizeof(header),
+        .end = (const uint8_t *)ptr + len,
+        .pos = (const uint8_t *)ptr + sizeof(header),
+        .target_hash_seq = {
+            .hash_len = header.hash_len,
+            .next_fn = hdag_bin_node_seq_target_hash_seq_next,
+            .next_batch_fn = hdag_bin_node_seq_target_hash_seq_next_batch,
+        },
+    };
+
+    assert(hdag_node_seq_is_valid(&pseq->base));
+    assert(hdag_hash_seq_is_valid(&pseq->target_hash_seq));
+    return HDAG_RES_OK;
+}
+
+hdag_res
+hdag_bin_from_node_seq(FILE *stream, struct hdag_node_seq *node_seq)
+{
+    hdag_res                res = HDAG_RES_INVALID;
+    uint16_t                hash_len;
+    struct hdag_darr        target_hashes;
+    const uint8_t          *hash;
+    const uint8_t          *target_hash;
+    size_t                  target_hash_num;
+    struct hdag_hash_seq   *target_hash_seq;
+    uint8_t                 varint[HDAG_BIN_VARINT_MAX_LEN];
+    size_t                  varint_len;
+
+    assert(stream != NULL);
+    assert(hdag_node_seq_is_valid(node_seq));
+
+    hash_len = node_seq->hash_len;
+    target_hashes = HDAG_DARR_EMPTY(hash_len, 16);
+
+    struct hdag_bin_header header = {
+        .signature = HDAG_BIN_SIGNATURE,
+        .version = {0, 0},
+        .hash_len = hash_len,
+    };
+
+    if (fwrite(&header, sizeof(header), 1, stream) != 1) {
+        goto cleanup;
+    }
+
+    /* Write each node, collecting its targets first, to count them */
+    while (!HDAG_RES_TRY(
+        hdag_node_seq_next(node_seq, &hash, &target_hash_seq)
+    )) {
+        hdag_darr_empty(&target_hashes);
+        while (!HDAG_RES_TRY(
+            hdag_hash_seq_next_batch(target_hash_seq,
+                                     &target_hash, &target_hash_num)
+        )) {
+            if (hdag_darr_append(&target_hashes,
+                                 target_hash, target_hash_num) == NULL) {
+                goto cleanup;
+            }
+        }
+        varint_len = hdag_bin_varint_encode(
+            varint, hdag_darr_occupied_slots(&target_hashes)
+        );
+        if (fwrite(hash, hash_len, 1, stream) != 1 ||
+            fwrite(varint, varint_len, 1, stream) != 1 ||
+            (hdag_darr_occupied_slots(&target_hashes) != 0 &&
+             fwrite(target_hashes.slots,
+                    hdag_darr_occupied_size(&target_hashes),
+                    1, stream) != 1)) {
+            goto cleanup;
+        }
+    }
+
+    res = HDAG_RES_OK;
+cleanup:
+    hdag_darr_cleanup(&target_hashes);
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
@@ -5,11 +5,15 @@
 #include <hdag/bundle.h>
 #include <hdag/nodes.h>
 #include <hdag/hashes.h>
+#include <hdag/heap.h>
 #include <hdag/misc.h>
 #include <hdag/res.h>
+#include <hdag/txt.h>
 #include <cgraph.h>
+#include <sys/param.h>
+#include <pthread.h>
+#include <unistd.h>
 #include <string.h>
-#include <ctype.h>
 
 hdag_res
 hdag_bundle_targets_hash_seq_next(struct hdag_hash_seq *base_seq,
@@ -87,6 +91,7 @@ hdag_bundle_is_valid(const struct hdag_bundle *bundle)
 {
     return bundle != NULL &&
         (bundle->hash_len == 0 || hdag_hash_len_is_valid(bundle->hash_len)) &&
+        bundle->hash_ops == hdag_hash_ops_get(bundle->hash_len) &&
         hdag_darr_is_valid(&bundle->nodes) &&
         bundle->nodes.slot_size == hdag_node_size(bundle->hash_len) &&
         hdag_darr_occupied_slots(&bundle->nodes) < INT32_MAX &&
@@ -99,6 +104,15 @@ hdag_bundle_is_valid(const struct hdag_bundle *bundle)
         (bundle->hash_len != 0 ||
          hdag_fanout_is_empty(bundle->nodes_fanout,
                               HDAG_ARR_LEN(bundle->nodes_fanout))) &&
+        hdag_darr_is_valid(&bundle->nodes_fanout16) &&
+        bundle->nodes_fanout16.slot_size == sizeof(uint32_t) &&
+        (hdag_darr_is_empty(&bundle->nodes_fanout16) ||
+         (hdag_darr_occupied_slots(&bundle->nodes_fanout16) ==
+            HDAG_FANOUT16_LEN &&
+          ((const uint32_t *)bundle->nodes_fanout16.slots)
+            [HDAG_FANOUT16_LEN - 1] == bundle->nodes_fanout[255] &&
+          !hdag_fanout_is_empty(bundle->nodes_fanout,
+                                HDAG_ARR_LEN(bundle->nodes_fanout)))) &&
         hdag_darr_is_valid(&bundle->target_hashes) &&
         bundle->target_hashes.slot_size == bundle->hash_len &&
         hdag_darr_occupied_slots(&bundle->target_hashes) < INT32_MAX &&
@@ -113,7 +127,13 @@ hdag_bundle_is_valid(const struct hdag_bundle *bundle)
         hdag_darr_occupied_slots(&bundle->extra_edges) < INT32_MAX &&
         (bundle->hash_len != 0 || hdag_darr_is_empty(&bundle->target_hashes)) &&
         (hdag_darr_is_empty(&bundle->target_hashes) ||
-         hdag_darr_is_empty(&bundle->extra_edges));
+         hdag_darr_is_empty(&bundle->extra_edges)) &&
+        hdag_darr_is_valid(&bundle->node_intervals) &&
+        bundle->node_intervals.slot_size != 0 &&
+        bundle->node_intervals.slot_size % sizeof(struct hdag_interval) == 0 &&
+        (hdag_darr_is_empty(&bundle->node_intervals) ||
+         hdag_darr_occupied_slots(&bundle->node_intervals) ==
+            hdag_darr_occupied_slots(&bundle->nodes));
 }
 
 bool
@@ -388,9 +408,11 @@ hdag_bundle_cleanup(struct hdag_bundle *bundle)
     hdag_darr_cleanup(&bundle->nodes);
     hdag_fanout_empty(bundle->nodes_fanout,
                       HDAG_ARR_LEN(bundle->nodes_fanout));
+    hdag_darr_cleanup(&bundle->nodes_fanout16);
     hdag_darr_cleanup(&bundle->target_hashes);
     hdag_darr_cleanup(&bundle->unknown_hashes);
     hdag_darr_cleanup(&bundle->extra_edges);
+    hdag_darr_cleanup(&bundle->node_intervals);
     assert(hdag_bundle_is_valid(bundle));
     assert(hdag_bundle_is_clean(bundle));
 }
@@ -402,9 +424,11 @@ hdag_bundle_empty(struct hdag_bundle *bundle)
     hdag_darr_empty(&bundle->nodes);
     hdag_fanout_empty(bundle->nodes_fanout,
                       HDAG_ARR_LEN(bundle->nodes_fanout));
+    hdag_darr_empty(&bundle->nodes_fanout16);
     hdag_darr_empty(&bundle->target_hashes);
     hdag_darr_empty(&bundle->unknown_hashes);
     hdag_darr_empty(&bundle->extra_edges);
+    hdag_darr_empty(&bundle->node_intervals);
     assert(hdag_bundle_is_valid(bundle));
     assert(hdag_bundle_is_empty(bundle));
 }
@@ -421,29 +445,47 @@ hdag_bundle_deflate(struct hdag_bundle *bundle)
     return HDAG_RES_ERRNO;
 }
 
-void
-hdag_bundle_sort(struct hdag_bundle *bundle)
+/**
+ * Sort a range of nodes in a bundle by hash lexicographically, along with
+ * the target hashes of each of them. Doesn't touch anything outside the
+ * range (and its nodes' target hashes), so can run in parallel with other
+ * ranges.
+ *
+ * @param bundle    The bundle containing the nodes to sort.
+ *                  Must use target_hashes.
+ * @param start     The index of the first node to sort.
+ * @param end       The index of the node after the last one to sort.
+ */
+static void
+hdag_bundle_sort_range(struct hdag_bundle *bundle, size_t start, size_t end)
 {
     /* Currently traversed node */
-    struct hdag_node *node;
+    const struct hdag_node *node;
     /* The index of the currently-traversed node */
-    ssize_t idx;
+    size_t idx;
 
-    assert(hdag_bundle_is_valid(bundle));
-    assert(!hdag_bundle_has_index_targets(bundle));
-    assert(hdag_bundle_is_mutable(bundle));
     /* Sort the nodes by hash lexicographically */
-    hdag_darr_qsort_all(&bundle->nodes, hdag_node_cmp, &bundle->hash_len);
+    hdag_darr_key_sort(&bundle->nodes, start, end,
+                       offsetof(struct hdag_node, hash), bundle->hash_len);
     /* Sort the target hashes for each node lexicographically */
-    HDAG_DARR_ITER_FORWARD(&bundle->nodes, idx, node, (void)0, (void)0) {
+    for (idx = start; idx < end; idx++) {
+        node = hdag_darr_element_const(&bundle->nodes, idx);
         if (hdag_targets_are_indirect(&node->targets)) {
-            hdag_darr_qsort(&bundle->target_hashes,
-                            hdag_node_get_first_ind_idx(node),
-                            hdag_node_get_last_ind_idx(node) + 1,
-                            hdag_hash_cmp, &bundle->hash_len);
+            hdag_darr_radix_sort(&bundle->target_hashes,
+                                 hdag_node_get_first_ind_idx(node),
+                                 hdag_node_get_last_ind_idx(node) + 1,
+                                 0, bundle->hash_len);
         }
     }
+}
 
+void
+hdag_bundle_sort(struct hdag_bundle *bundle)
+{
+    assert(hdag_bundle_is_valid(bundle));
+    assert(!hdag_bundle_has_index_targets(bundle));
+    assert(hdag_bundle_is_mutable(bundle));
+    hdag_bundle_sort_range(bundle, 0, bundle->nodes.slots_occupied);
     assert(hdag_bundle_is_valid(bundle));
     assert(hdag_bundle_is_sorted(bundle));
 }
@@ -478,6 +520,28 @@ hdag_bundle_fanout_fill(struct hdag_bundle *bundle)
     assert(idx == 0 || !hdag_bundle_fanout_is_empty(bundle));
 }
 
+hdag_res
+hdag_bundle_fanout16_fill(struct hdag_bundle *bundle)
+{
+    uint32_t *fanout16;
+
+    assert(hdag_bundle_is_valid(bundle));
+    assert(!hdag_bundle_is_hashless(bundle));
+    assert(!hdag_bundle_fanout_is_empty(bundle));
+    assert(hdag_darr_is_empty(&bundle->nodes_fanout16));
+
+    fanout16 = hdag_darr_uappend(&bundle->nodes_fanout16, HDAG_FANOUT16_LEN);
+    if (fanout16 == NULL) {
+        return HDAG_RES_ERRNO;
+    }
+    hdag_nodes_fanout16_fill(fanout16, bundle->nodes.slots,
+                             hdag_darr_occupied_slots(&bundle->nodes),
+                             bundle->hash_len);
+
+    assert(hdag_bundle_is_valid(bundle));
+    return HDAG_RES_OK;
+}
+
 /*
  * Check if both the nodes and targets of a bundle are sorted according to
  * a specified range of comparison results.
@@ -509,7 +573,8 @@ hdag_bundle_is_sorted_as(const struct hdag_bundle *bundle,
     HDAG_DARR_ITER_FORWARD(&bundle->nodes, node_idx, node,
                            prev_node = NULL, prev_node=node) {
         if (prev_node != NULL) {
-            rel = memcmp(prev_node->hash, node->hash, bundle->hash_len);
+            rel = bundle->hash_ops->cmp(prev_node->hash, node->hash,
+                                        bundle->hash_len);
             if (rel < rel_min || rel > rel_max) {
                 return false;
             }
@@ -531,14 +596,14 @@ hdag_bundle_is_sorted_as(const struct hdag_bundle *bundle,
                         struct hdag_edge, target_idx
                     )->node_idx);
             } else {
-                rel = memcmp(
+                rel = bundle->hash_ops->cmp(
                     hdag_darr_element_const(
                         &bundle->target_hashes, target_idx - 1
                     ),
                     hdag_darr_element_const(
                         &bundle->target_hashes, target_idx
                     ),
-                    bundle->target_hashes.slot_size
+                    bundle->hash_len
                 );
             }
             if (rel < rel_min || rel > rel_max) {
@@ -565,40 +630,29 @@ hdag_bundle_is_sorted_and_deduped(const struct hdag_bundle *bundle)
 }
 
 /**
- * Find duplicate edges in a bundle, and either discard them, or raise an
- * error, depending on the specified context.
+ * Remove duplicate target hashes of a range of sorted nodes in a bundle.
+ * Doesn't touch anything outside the range (and its nodes' target hashes),
+ * so can run in parallel with other ranges.
  *
- * @param bundle    The bundle to find duplicate edges in.
+ * @param bundle    The bundle containing the nodes to dedup the edges of.
  *                  Must be sorted, and use target_hashes.
- * @param ctx       The context of this bundle (the abstract supergraph).
- *                  Can be NULL, which is interpreted as an empty context.
- *
- * @return A void universal result.
+ * @param start     The index of the first node to dedup the edges of.
+ * @param end       The index of the node after the last one to dedup the
+ *                  edges of.
  */
-[[nodiscard]]
-static hdag_res
-hdag_bundle_dedup_edges(struct hdag_bundle *bundle,
-                        const struct hdag_ctx *ctx)
+static void
+hdag_bundle_dedup_edges_range(struct hdag_bundle *bundle,
+                              size_t start, size_t end)
 {
-    assert(hdag_bundle_is_valid(bundle));
-    assert(hdag_bundle_is_mutable(bundle));
-    assert(!hdag_bundle_is_hashless(bundle));
-    assert(hdag_bundle_is_sorted(bundle));
-    assert(!hdag_bundle_has_index_targets(bundle));
-    assert(hdag_darr_occupied_slots(&bundle->extra_edges) == 0);
-    assert(ctx == NULL || hdag_ctx_is_valid(ctx));
-
-    if (ctx == NULL) {
-        ctx = &HDAG_CTX_EMPTY(bundle->hash_len);
-    }
-
     /* Currently traversed node index */
-    ssize_t idx;
+    size_t idx;
     /* Currently traversed node */
     struct hdag_node *node;
 
     /* The size of each target_hash */
     const size_t hash_size = bundle->target_hashes.slot_size;
+    /* The hash operations */
+    const struct hdag_hash_ops *ops = bundle->hash_ops;
     /* Location of the node's original last hash */
     uint8_t *last_hash;
     /* Currently-traversed hash */
@@ -609,7 +663,8 @@ hdag_bundle_dedup_edges(struct hdag_bundle *bundle,
     uint8_t *out_hash;
 
     /* For each (potentially duplicate) node */
-    HDAG_DARR_ITER_FORWARD(&bundle->nodes, idx, node, (void)0, (void)0) {
+    for (idx = start; idx < end; idx++) {
+        node = hdag_darr_element(&bundle->nodes, idx);
         /* If the node doesn't have indirect targets */
         if (!hdag_targets_are_indirect(&node->targets)) {
             continue;
@@ -627,7 +682,7 @@ hdag_bundle_dedup_edges(struct hdag_bundle *bundle,
             prev_hash = hash, hash += hash_size
         ) {
             /* If the current hash is different from the previous one */
-            if (memcmp(hash, prev_hash, hash_size) != 0) {
+            if (ops->cmp(hash, prev_hash, bundle->hash_len) != 0) {
                 /* If the output pointer is less than the current hash */
                 if (out_hash < hash) {
                     /* Copy the current hash to the output pointer */
@@ -643,42 +698,74 @@ hdag_bundle_dedup_edges(struct hdag_bundle *bundle,
                                   out_hash - hash_size)
         );
     }
-    assert(hdag_bundle_is_valid(bundle));
-    return HDAG_RES_OK;
 }
 
 /**
- * Find duplicate nodes in a bundle, and either discard them, or raise an
+ * Find duplicate edges in a bundle, and either discard them, or raise an
  * error, depending on the specified context.
  *
- * @param bundle    The bundle to find duplicate nodes in.
+ * @param bundle    The bundle to find duplicate edges in.
  *                  Must be sorted, and use target_hashes.
  * @param ctx       The context of this bundle (the abstract supergraph).
  *                  Can be NULL, which is interpreted as an empty context.
  *
- * @return A void universal result. Including:
- *         * HDAG_RES_NODE_CONFLICT, if nodes with matching hashes but
- *           different targets were found.
+ * @return A void universal result.
  */
 [[nodiscard]]
 static hdag_res
-hdag_bundle_dedup_nodes(struct hdag_bundle *bundle,
+hdag_bundle_dedup_edges(struct hdag_bundle *bundle,
                         const struct hdag_ctx *ctx)
 {
-    hdag_res res = HDAG_RES_INVALID;
     assert(hdag_bundle_is_valid(bundle));
     assert(hdag_bundle_is_mutable(bundle));
     assert(!hdag_bundle_is_hashless(bundle));
     assert(hdag_bundle_is_sorted(bundle));
     assert(!hdag_bundle_has_index_targets(bundle));
+    assert(hdag_darr_occupied_slots(&bundle->extra_edges) == 0);
     assert(ctx == NULL || hdag_ctx_is_valid(ctx));
 
     if (ctx == NULL) {
         ctx = &HDAG_CTX_EMPTY(bundle->hash_len);
     }
 
+    hdag_bundle_dedup_edges_range(bundle, 0, bundle->nodes.slots_occupied);
+    assert(hdag_bundle_is_valid(bundle));
+    return HDAG_RES_OK;
+}
+
+/**
+ * Remove duplicate nodes from a range of sorted nodes in a bundle, with
+ * deduplicated edges, packing the remaining nodes at the start of the
+ * range. Doesn't touch any nodes outside the range, so can run in
+ * parallel with other ranges not sharing hashes with it.
+ *
+ * @param bundle            The bundle containing the nodes to dedup.
+ *                          Must be sorted, and use target_hashes.
+ * @param start             The index of the first node to dedup.
+ * @param end               The index of the node after the last one to
+ *                          dedup.
+ * @param unknown_hashes    The array to append the hashes of the unknown
+ *                          nodes in the range to, in order.
+ * @param pnum              Location for the number of the nodes remaining
+ *                          in the range.
+ *
+ * @return A void universal result. Including:
+ *         * HDAG_RES_NODE_CONFLICT, if nodes with matching hashes but
+ *           different targets were found.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_bundle_dedup_nodes_range(struct hdag_bundle *bundle,
+                              size_t start, size_t end,
+                              struct hdag_darr *unknown_hashes,
+                              size_t *pnum)
+{
+    hdag_res res = HDAG_RES_INVALID;
+
     /* The size of each node */
     const size_t node_size = bundle->nodes.slot_size;
+    /* The hash operations */
+    const struct hdag_hash_ops *ops = bundle->hash_ops;
     /* Previously traversed node */
     struct hdag_node *prev_node;
     /* Currently traversed node */
@@ -687,17 +774,18 @@ hdag_bundle_dedup_nodes(struct hdag_bundle *bundle,
     struct hdag_node *out_node;
     /* The node to keep out of all the nodes in the run */
     struct hdag_node *keep_node;
-    /* Number of nodes */
-    size_t node_num = bundle->nodes.slots_occupied;
-    /* The end node of the node array */
-    const struct hdag_node *end_node =
-        hdag_darr_slot(&bundle->nodes, node_num);
+    /* The end node of the range */
+    const struct hdag_node *end_node;
 
-    /* Empty the unknown hashes, as we'll refill them */
-    hdag_darr_empty(&bundle->unknown_hashes);
+    if (start == end) {
+        *pnum = 0;
+        return HDAG_RES_OK;
+    }
 
     prev_node = NULL;
-    node = bundle->nodes.slots;
+    node = hdag_darr_element(&bundle->nodes, start);
+    end_node = (struct hdag_node *)((uint8_t *)node +
+                                    (end - start) * node_size);
     out_node = node;
     keep_node = NULL;
     /* For each node, plus one slot after */
@@ -708,14 +796,14 @@ hdag_bundle_dedup_nodes(struct hdag_bundle *bundle,
          */
         if (prev_node != NULL &&
             (node >= end_node ||
-             memcmp(node->hash, prev_node->hash, bundle->hash_len) != 0)) {
+             ops->cmp(node->hash, prev_node->hash, bundle->hash_len) != 0)) {
             /* Our run has ended */
             /* If we found no known nodes */
             if (keep_node == NULL) {
                 /* Keep the last unknown node */
                 keep_node = prev_node;
                 /* Add the node hash to unknown hashes */
-                if (hdag_darr_append_one(&bundle->unknown_hashes,
+                if (hdag_darr_append_one(unknown_hashes,
                                          keep_node->hash) == NULL) {
                     goto cleanup;
                 }
@@ -761,10 +849,55 @@ hdag_bundle_dedup_nodes(struct hdag_bundle *bundle,
         prev_node = node;
         node = (struct hdag_node *)((uint8_t *)node + node_size);
     }
+    *pnum = ((uint8_t *)out_node -
+             (uint8_t *)hdag_darr_element(&bundle->nodes, start)) /
+            node_size;
+
+    res = HDAG_RES_OK;
+cleanup:
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
+/**
+ * Find duplicate nodes in a bundle, and either discard them, or raise an
+ * error, depending on the specified context.
+ *
+ * @param bundle    The bundle to find duplicate nodes in.
+ *                  Must be sorted, and use target_hashes.
+ * @param ctx       The context of this bundle (the abstract supergraph).
+ *                  Can be NULL, which is interpreted as an empty context.
+ *
+ * @return A void universal result. Including:
+ *         * HDAG_RES_NODE_CONFLICT, if nodes with matching hashes but
+ *           different targets were found.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_bundle_dedup_nodes(struct hdag_bundle *bundle,
+                        const struct hdag_ctx *ctx)
+{
+    hdag_res res = HDAG_RES_INVALID;
+    size_t node_num;
+
+    assert(hdag_bundle_is_valid(bundle));
+    assert(hdag_bundle_is_mutable(bundle));
+    assert(!hdag_bundle_is_hashless(bundle));
+    assert(hdag_bundle_is_sorted(bundle));
+    assert(!hdag_bundle_has_index_targets(bundle));
+    assert(ctx == NULL || hdag_ctx_is_valid(ctx));
+
+    if (ctx == NULL) {
+        ctx = &HDAG_CTX_EMPTY(bundle->hash_len);
+    }
+
+    /* Empty the unknown hashes, as we'll refill them */
+    hdag_darr_empty(&bundle->unknown_hashes);
+
+    HDAG_RES_TRY(hdag_bundle_dedup_nodes_range(
+        bundle, 0, bundle->nodes.slots_occupied,
+        &bundle->unknown_hashes, &node_num
+    ));
     /* Truncate the nodes */
-    end_node = out_node;
-    node_num = ((uint8_t *)end_node - (uint8_t *)bundle->nodes.slots) /
-               node_size;
     bundle->nodes.slots_occupied = node_num;
 
     assert(hdag_bundle_is_valid(bundle));
@@ -797,34 +930,174 @@ cleanup:
     return HDAG_RES_ERRNO_IF_INVALID(res);
 }
 
-hdag_res
-hdag_bundle_compact(struct hdag_bundle *bundle)
+/**
+ * The minimum number of nodes in a bundle slice compacted by a separate
+ * thread. Smaller bundles are split into fewer slices.
+ */
+#define HDAG_BUNDLE_COMPACT_SLICE_MIN_NODES  (16 * 1024)
+
+/** A reference to a target hash, resolved to a node when compacting */
+struct hdag_bundle_target_ref {
+    /** The index of the hash in the bundle's target_hashes array */
+    uint32_t    hash_idx;
+    /** The target hash */
+    uint8_t     hash[];
+};
+
+/**
+ * A slice of a bundle being compacted by a separate thread: a range of
+ * nodes to collect target references from, and to compact the targets of,
+ * and a range of target references to resolve.
+ */
+struct hdag_bundle_compact_slice {
+    /** The thread processing the slice */
+    pthread_t               thread;
+    /** True if the thread was started, false if it wasn't (yet) */
+    bool                    started;
+    /** The bundle being compacted */
+    struct hdag_bundle     *bundle;
+    /** The index of the first node of the slice */
+    size_t                  node_start;
+    /** The index of the node after the last one of the slice */
+    size_t                  node_end;
+    /** The index of the first extra edge of the slice's nodes */
+    size_t                  edge_start;
+    /** The index of the first target reference of the slice */
+    size_t                  ref_start;
+    /** The index of the reference after the last one of the slice */
+    size_t                  ref_end;
+    /** True if the references should be sorted before resolving */
+    bool                    sort;
+    /** The target references of all the slices */
+    struct hdag_darr       *refs;
+    /** The node indices of the target hashes, in target_hashes order */
+    uint32_t               *node_idxs;
+    /** The extra edges of all the slices */
+    struct hdag_darr       *extra_edges;
+};
+
+/**
+ * Collect the references to the target hashes of a bundle slice's nodes.
+ *
+ * @param arg   The slice to process (struct hdag_bundle_compact_slice *).
+ *
+ * @return NULL, always.
+ */
+static void *
+hdag_bundle_compact_slice_collect(void *arg)
 {
-    hdag_res res = HDAG_RES_INVALID;
-    /* The index of the currently-traversed node */
-    ssize_t idx;
-    /* A hash index */
+    struct hdag_bundle_compact_slice *slice = arg;
+    const struct hdag_bundle *bundle = slice->bundle;
+    uint16_t hash_len = bundle->hash_len;
+    const struct hdag_node *node;
+    struct hdag_bundle_target_ref *ref;
+    size_t node_idx;
     size_t hash_idx;
-    /* The index of a found node */
-    size_t found_idx;
-    /* Currently traversed node */
+
+    if (slice->ref_start == slice->ref_end) {
+        return NULL;
+    }
+    ref = hdag_darr_element_sized(slice->refs, slice->refs->slot_size,
+                                  slice->ref_start);
+    for (node_idx = slice->node_start; node_idx < slice->node_end;
+         node_idx++) {
+        node = hdag_darr_element_const(&bundle->nodes, node_idx);
+        if (!hdag_target_is_ind_idx(node->targets.first)) {
+            continue;
+        }
+        for (hash_idx = hdag_target_to_ind_idx(node->targets.first);
+             hash_idx <= hdag_target_to_ind_idx(node->targets.last);
+             hash_idx++) {
+            ref->hash_idx = hash_idx;
+            memcpy(ref->hash,
+                   hdag_darr_element_const(&bundle->target_hashes, hash_idx),
+                   hash_len);
+            ref = (struct hdag_bundle_target_ref *)
+                ((uint8_t *)ref + slice->refs->slot_size);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Sort (if requested) a bundle slice's target references by hash, and
+ * resolve them into node indices by merge-joining them with the (sorted)
+ * nodes, instead of searching for each hash.
+ *
+ * @param arg   The slice to process (struct hdag_bundle_compact_slice *).
+ *
+ * @return NULL, always.
+ */
+static void *
+hdag_bundle_compact_slice_resolve(void *arg)
+{
+    struct hdag_bundle_compact_slice *slice = arg;
+    const struct hdag_bundle *bundle = slice->bundle;
+    const struct hdag_hash_ops *ops = bundle->hash_ops;
+    uint16_t hash_len = bundle->hash_len;
+    size_t node_num = bundle->nodes.slots_occupied;
+    const struct hdag_bundle_target_ref *ref;
+    const struct hdag_node *node;
+    size_t node_idx;
+    size_t ref_idx;
+    int relation;
+
+    if (slice->ref_start == slice->ref_end) {
+        return NULL;
+    }
+    if (slice->sort) {
+        hdag_darr_key_sort(slice->refs, slice->ref_start, slice->ref_end,
+                           offsetof(struct hdag_bundle_target_ref, hash),
+                           hash_len);
+    }
+
+    /* Start joining at the node of the first reference */
+    ref = hdag_darr_element_const(slice->refs, slice->ref_start);
+    node_idx = ops->nodes_slice_find(bundle->nodes.slots, 0, node_num,
+                                     hash_len, ref->hash);
+    /* All hashes must be locatable */
+    assert(node_idx < INT32_MAX);
+
+    for (ref_idx = slice->ref_start; ref_idx < slice->ref_end; ref_idx++) {
+        ref = hdag_darr_element_const(slice->refs, ref_idx);
+        for (relation = -1; node_idx < node_num; node_idx++) {
+            node = hdag_darr_element_const(&bundle->nodes, node_idx);
+            relation = ops->cmp(node->hash, ref->hash, hash_len);
+            if (relation >= 0) {
+                break;
+            }
+        }
+        /* All hashes must be locatable */
+        assert(relation == 0);
+        slice->node_idxs[ref->hash_idx] = node_idx;
+    }
+    return NULL;
+}
+
+/**
+ * Convert the target references of a bundle slice's nodes from hashes to
+ * indexes, storing up to two targets in the nodes themselves, and the
+ * rest in the slice's range of extra edges.
+ *
+ * @param arg   The slice to process (struct hdag_bundle_compact_slice *).
+ *
+ * @return NULL, always.
+ */
+static void *
+hdag_bundle_compact_slice_fill(void *arg)
+{
+    struct hdag_bundle_compact_slice *slice = arg;
+    struct hdag_bundle *bundle = slice->bundle;
+    const uint32_t *node_idxs = slice->node_idxs;
+    size_t edge_idx = slice->edge_start;
     struct hdag_node *node;
-    /* The new extra_edges array */
-    struct hdag_darr extra_edges =
-        HDAG_DARR_EMPTY(sizeof(struct hdag_edge), 64);
     struct hdag_edge *edge;
+    size_t node_idx;
+    size_t hash_idx;
 
-    assert(hdag_bundle_is_valid(bundle));
-    assert(hdag_bundle_is_mutable(bundle));
-    assert(!hdag_bundle_is_hashless(bundle));
-    assert(hdag_bundle_is_sorted_and_deduped(bundle));
-    assert(hdag_darr_occupied_slots(&bundle->nodes) == 0 ||
-           !hdag_bundle_fanout_is_empty(bundle));
-    assert(!hdag_bundle_has_index_targets(bundle));
-    assert(hdag_darr_occupied_slots(&bundle->extra_edges) == 0);
-
-    /* For each node, from start to end */
-    HDAG_DARR_ITER_FORWARD(&bundle->nodes, idx, node, (void)0, (void)0) {
+    for (node_idx = slice->node_start; node_idx < slice->node_end;
+         node_idx++) {
+        node = hdag_darr_element(&bundle->nodes, node_idx);
         assert(hdag_node_is_valid(node));
         /* If the node's targets are unknown or are both absent */
         if (hdag_targets_are_unknown(&node->targets) ||
@@ -833,48 +1106,33 @@ hdag_bundle_compact(struct hdag_bundle *bundle)
         }
         /* If there's more than two targets */
         if (node->targets.last - node->targets.first > 1) {
-            size_t first_extra_edge_idx = extra_edges.slots_occupied;
+            size_t first_extra_edge_idx = edge_idx;
 
             /* Convert all target hashes to extra edges */
             for (hash_idx = hdag_target_to_ind_idx(node->targets.first);
                  hash_idx <= hdag_target_to_ind_idx(node->targets.last);
                  hash_idx++) {
-                found_idx = hdag_bundle_find_node_idx(
-                    bundle,
-                    hdag_darr_element(&bundle->target_hashes, hash_idx)
-                );
-                /* All hashes must be locatable */
-                assert(found_idx < INT32_MAX);
                 /* Hash indices must be valid */
-                assert(found_idx < bundle->nodes.slots_occupied);
+                assert(node_idxs[hash_idx] < bundle->nodes.slots_occupied);
                 /* Store the edge */
-                edge = hdag_darr_cappend_one(&extra_edges);
-                if (edge == NULL) {
-                    goto cleanup;
-                }
-                edge->node_idx = found_idx;
+                edge = hdag_darr_element(slice->extra_edges, edge_idx++);
+                edge->node_idx = node_idxs[hash_idx];
             }
 
             /* Store the extra edge indices */
             node->targets.first =
                 hdag_target_from_ind_idx(first_extra_edge_idx);
-            node->targets.last =
-                hdag_target_from_ind_idx(extra_edges.slots_occupied - 1);
+            node->targets.last = hdag_target_from_ind_idx(edge_idx - 1);
         } else {
             /* If there are two targets */
             if (node->targets.last > node->targets.first) {
                 /* Store the second target inside the node */
                 hash_idx = hdag_target_to_ind_idx(node->targets.last);
-                found_idx = hdag_bundle_find_node_idx(
-                    bundle,
-                    hdag_darr_element(&bundle->target_hashes, hash_idx)
-                );
-                /* All hashes must be locatable */
-                assert(found_idx < INT32_MAX);
                 /* Hash indices must be valid */
-                assert(found_idx < bundle->nodes.slots_occupied);
+                assert(node_idxs[hash_idx] < bundle->nodes.slots_occupied);
                 /* Store the last target */
-                node->targets.last = hdag_target_from_dir_idx(found_idx);
+                node->targets.last =
+                    hdag_target_from_dir_idx(node_idxs[hash_idx]);
             } else {
                 /* Mark second target absent */
                 node->targets.last = HDAG_TARGET_ABSENT;
@@ -882,19 +1140,167 @@ hdag_bundle_compact(struct hdag_bundle *bundle)
 
             /* Store first target inside the node */
             hash_idx = hdag_target_to_ind_idx(node->targets.first);
-            found_idx = hdag_bundle_find_node_idx(
-                bundle,
-                hdag_darr_element(&bundle->target_hashes, hash_idx)
-            );
-            /* All hashes must be locatable */
-            assert(found_idx < INT32_MAX);
             /* Hash indices must be valid */
-            assert(found_idx < bundle->nodes.slots_occupied);
+            assert(node_idxs[hash_idx] < bundle->nodes.slots_occupied);
             /* Store the first target */
-            node->targets.first = hdag_target_from_dir_idx(found_idx);
+            node->targets.first =
+                hdag_target_from_dir_idx(node_idxs[hash_idx]);
         }
         assert(hdag_node_is_valid(node));
     }
+    return NULL;
+}
+
+/**
+ * Process bundle compaction slices with a function, one thread per slice,
+ * in the current thread for the first slice, and for any slice a thread
+ * couldn't be started for.
+ *
+ * @param slices    The slices to process.
+ * @param slice_num The number of slices to process.
+ * @param fn        The function to process each slice with.
+ */
+static void
+hdag_bundle_compact_slices_run(struct hdag_bundle_compact_slice *slices,
+                               size_t slice_num,
+                               void *(*fn)(void *))
+{
+    size_t i;
+    int err;
+
+    for (i = 1; i < slice_num; i++) {
+        err = pthread_create(&slices[i].thread, NULL, fn, &slices[i]);
+        slices[i].started = (err == 0);
+    }
+    fn(&slices[0]);
+    for (i = 1; i < slice_num; i++) {
+        if (slices[i].started) {
+            pthread_join(slices[i].thread, NULL);
+            slices[i].started = false;
+        } else {
+            fn(&slices[i]);
+        }
+    }
+}
+
+hdag_res
+hdag_bundle_compact_parallel(struct hdag_bundle *bundle,
+                             unsigned int thread_num)
+{
+    hdag_res res = HDAG_RES_INVALID;
+    size_t node_num = bundle->nodes.slots_occupied;
+    size_t slice_num;
+    struct hdag_bundle_compact_slice *slices = NULL;
+    /* The target hash references, sorted and joined with the nodes */
+    struct hdag_darr refs = HDAG_DARR_EMPTY(
+        sizeof(struct hdag_bundle_target_ref) + bundle->hash_len, 0
+    );
+    /* The node indices of target hashes */
+    struct hdag_darr node_idxs = HDAG_DARR_EMPTY(sizeof(uint32_t), 0);
+    /* The new extra_edges array */
+    struct hdag_darr extra_edges =
+        HDAG_DARR_EMPTY(sizeof(struct hdag_edge), 64);
+    const struct hdag_node *node;
+    size_t bucket_ends[256];
+    size_t bucket;
+    size_t ref_num;
+    size_t edge_num;
+    size_t target_num;
+    size_t node_idx;
+    size_t i;
+
+    assert(hdag_bundle_is_valid(bundle));
+    assert(hdag_bundle_is_mutable(bundle));
+    assert(!hdag_bundle_is_hashless(bundle));
+    assert(hdag_bundle_is_sorted_and_deduped(bundle));
+    assert(hdag_darr_occupied_slots(&bundle->nodes) == 0 ||
+           !hdag_bundle_fanout_is_empty(bundle));
+    assert(!hdag_bundle_has_index_targets(bundle));
+    assert(hdag_darr_occupied_slots(&bundle->extra_edges) == 0);
+
+    if (thread_num == 0) {
+        long cpu_num = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_num = cpu_num > 0 ? (unsigned int)cpu_num : 1;
+    }
+
+    /* Use one slice per thread, but not too small */
+    slice_num = MAX(MIN((size_t)thread_num,
+                        node_num / HDAG_BUNDLE_COMPACT_SLICE_MIN_NODES), 1);
+    slices = calloc(slice_num, sizeof(*slices));
+    if (slices == NULL) {
+        goto cleanup;
+    }
+
+    /*
+     * Split the nodes into slices of equal size, and count their target
+     * references and extra edges, to place both without reallocating
+     */
+    for (ref_num = edge_num = 0, i = 0; i < slice_num; i++) {
+        slices[i].bundle = bundle;
+        slices[i].node_start = node_num * i / slice_num;
+        slices[i].node_end = node_num * (i + 1) / slice_num;
+        slices[i].ref_start = ref_num;
+        slices[i].edge_start = edge_num;
+        slices[i].refs = &refs;
+        slices[i].extra_edges = &extra_edges;
+        for (node_idx = slices[i].node_start;
+             node_idx < slices[i].node_end; node_idx++) {
+            node = hdag_darr_element_const(&bundle->nodes, node_idx);
+            if (hdag_target_is_ind_idx(node->targets.first)) {
+                target_num = hdag_target_to_ind_idx(node->targets.last) -
+                    hdag_target_to_ind_idx(node->targets.first) + 1;
+                ref_num += target_num;
+                if (target_num > 2) {
+                    edge_num += target_num;
+                }
+            }
+        }
+        slices[i].ref_end = ref_num;
+    }
+    if ((ref_num != 0 &&
+         (hdag_darr_uappend(&refs, ref_num) == NULL ||
+          hdag_darr_uappend(&node_idxs,
+                            bundle->target_hashes.slots_occupied) == NULL)) ||
+        (edge_num != 0 &&
+         hdag_darr_uappend(&extra_edges, edge_num) == NULL)) {
+        goto cleanup;
+    }
+    for (i = 0; i < slice_num; i++) {
+        slices[i].node_idxs = node_idxs.slots;
+    }
+
+    /* Collect the target hash references */
+    hdag_bundle_compact_slices_run(slices, slice_num,
+                                   hdag_bundle_compact_slice_collect);
+
+    /*
+     * Partition the references by the first hash byte, and split the
+     * partitions into slices of roughly equal size to sort and resolve
+     */
+    if (slice_num > 1) {
+        hdag_darr_radix_partition(&refs, 0, ref_num,
+                                  offsetof(struct hdag_bundle_target_ref,
+                                           hash),
+                                  bucket_ends);
+    }
+    for (bucket = 0, i = 0; i < slice_num; i++) {
+        while (i < slice_num - 1 && bucket < 255 &&
+               bucket_ends[bucket] < ref_num * (i + 1) / slice_num) {
+            bucket++;
+        }
+        slices[i].ref_start = (i == 0) ? 0 : slices[i - 1].ref_end;
+        slices[i].ref_end = (i == slice_num - 1) ? ref_num
+                                                 : bucket_ends[bucket];
+        slices[i].sort = true;
+    }
+
+    /* Resolve the target hashes into node indices */
+    hdag_bundle_compact_slices_run(slices, slice_num,
+                                   hdag_bundle_compact_slice_resolve);
+
+    /* Convert the targets into node indices and extra edges */
+    hdag_bundle_compact_slices_run(slices, slice_num,
+                                   hdag_bundle_compact_slice_fill);
 
     /* Remove target hashes */
     hdag_darr_cleanup(&bundle->target_hashes);
@@ -908,10 +1314,24 @@ hdag_bundle_compact(struct hdag_bundle *bundle)
     res = HDAG_RES_OK;
 
 cleanup:
-    hdag_darr_cleanup(&extra_edges);
+    if (slices != NULL) {
+        for (i = 0; i < slice_num; i++) {
+            assert(!slices[i].started);
+        }
+        free(slices);
+    }
+    hdag_darr_cleanup(&node_idxs);
+    hdag_darr_cleanup(&refs);
+    hdag_darr_cleanup(&extra_edges);
     return HDAG_RES_ERRNO_IF_INVALID(res);
 }
 
+hdag_res
+hdag_bundle_compact(struct hdag_bundle *bundle)
+{
+    return hdag_bundle_compact_parallel(bundle, 1);
+}
+
 hdag_res
 hdag_bundle_invert(struct hdag_bundle *pinverted,
                    const struct hdag_bundle *original,
@@ -1369,64 +1789,478 @@ cleanup:
     return HDAG_RES_ERRNO_IF_INVALID(res);
 }
 
-hdag_res
-hdag_bundle_from_node_seq(struct hdag_bundle *pbundle,
-                          struct hdag_node_seq *node_seq)
+/**
+ * A set of the hashes added to a bundle from a node sequence, used to avoid
+ * adding placeholder nodes for targets already seen. An open-addressing
+ * hash table with linear probing, storing the indices of the hashes in the
+ * bundle, rather than the hashes themselves.
+ */
+struct hdag_bundle_seen {
+    /**
+     * The slots: zero if empty, or one plus the index of the hash shifted
+     * left by one bit, with the lowest bit set if the index is of a node,
+     * and unset if it's of a target hash.
+     */
+    size_t *slots;
+    /** The number of slots minus one, a power of two minus one */
+    size_t  mask;
+    /** The number of occupied slots */
+    size_t  num;
+};
+
+/** An initializer for an empty set of seen hashes */
+#define HDAG_BUNDLE_SEEN_EMPTY (struct hdag_bundle_seen){.slots = NULL}
+
+/** The number of slots to allocate for a set of seen hashes at first */
+#define HDAG_BUNDLE_SEEN_MIN_SIZE 1024
+
+/**
+ * Make a set slot value for a hash index.
+ *
+ * @param idx       The index of the hash in the bundle.
+ * @param is_node   True if the index is of a node, false if of a target
+ *                  hash.
+ *
+ * @return The slot value.
+ */
+static inline size_t
+hdag_bundle_seen_slot(size_t idx, bool is_node)
 {
-    hdag_res                res = HDAG_RES_INVALID;
-    struct hdag_bundle      bundle = HDAG_BUNDLE_EMPTY(node_seq->hash_len);
-    const uint8_t          *node_hash;
-    const uint8_t          *target_hash;
-    struct hdag_hash_seq   *target_hash_seq;
-    size_t                  first_target_hash_idx;
+    return (idx << 1 | is_node) + 1;
+}
 
-    assert(hdag_node_seq_is_valid(node_seq));
+/**
+ * Check if a set slot value refers to a node.
+ *
+ * @param slot  The (non-empty) slot value to check.
+ *
+ * @return True if the slot refers to a node, false if to a target hash.
+ */
+static inline bool
+hdag_bundle_seen_slot_is_node(size_t slot)
+{
+    assert(slot != 0);
+    return (slot - 1) & 1;
+}
 
-    /* Add a new node */
-    #define ADD_NODE(_hash, _targets) \
-        do {                                                \
-            struct hdag_node *_node = (struct hdag_node *)  \
-                hdag_darr_cappend_one(&bundle.nodes);       \
-            if (_node == NULL) {                            \
-                goto cleanup;                               \
-            }                                               \
-            memcpy(_node->hash, _hash, bundle.hash_len);    \
-            _node->targets = _targets;                      \
-        } while (0)
-
-    /* Collect each node (and its targets) in the sequence */
-    while (!HDAG_RES_TRY(
-        hdag_node_seq_next(node_seq, &node_hash, &target_hash_seq)
-    )) {
-        first_target_hash_idx = bundle.target_hashes.slots_occupied;
-
-        /* Collect each target hash */
-        while (!HDAG_RES_TRY(
-            hdag_hash_seq_next(target_hash_seq, &target_hash)
-        )) {
-            /* Add a new target hash (and the corresponding node) */
-            if (hdag_darr_append_one(
-                    &bundle.target_hashes, target_hash) == NULL) {
-                goto cleanup;
+/**
+ * Get the hash a set slot value refers to.
+ *
+ * @param bundle    The bundle the hash belongs to.
+ * @param slot      The (non-empty) slot value to get the hash for.
+ *
+ * @return The pointer to the hash.
+ */
+static inline const uint8_t *
+hdag_bundle_seen_slot_hash(const struct hdag_bundle *bundle, size_t slot)
+{
+    size_t idx = (slot - 1) >> 1;
+    assert(slot != 0);
+    if (hdag_bundle_seen_slot_is_node(slot)) {
+        return ((const struct hdag_node *)
+                hdag_darr_element_const(&bundle->nodes, idx))->hash;
+    }
+    return hdag_darr_element_const(&bundle->target_hashes, idx);
+}
+
+/**
+ * Find the slot for a hash in a set of seen hashes: the one containing
+ * the hash, or the empty one it should be placed into.
+ *
+ * @param seen      The set to look up the hash in. Must be allocated.
+ * @param bundle    The bundle the seen hashes belong to.
+ * @param hash      The hash to look up.
+ *
+ * @return The pointer to the slot.
+ */
+static size_t *
+hdag_bundle_seen_find(const struct hdag_bundle_seen *seen,
+                      const struct hdag_bundle *bundle,
+                      const uint8_t *hash)
+{
+    uint16_t    hash_len = bundle->hash_len;
+    size_t      len = MIN(hash_len, sizeof(uint64_t));
+    uint64_t    head = 0;
+    uint64_t    tail = 0;
+    uint64_t    key;
+    size_t      pos;
+
+    assert(seen->slots != NULL);
+
+    /*
+     * Mix the first and the last bytes of the hash, so both cryptographic
+     * hashes and right-aligned small numbers spread out
+     */
+    memcpy(&head, hash, len);
+    memcpy(&tail, hash + hash_len - len, len);
+    key = (head ^ (tail << 32 | tail >> 32)) * UINT64_C(0x9e3779b97f4a7c15);
+    key ^= key >> 32;
+
+    for (pos = key & seen->mask;
+         seen->slots[pos] != 0 &&
+         bundle->hash_ops->cmp(
+            hdag_bundle_seen_slot_hash(bundle, seen->slots[pos]),
+            hash, hash_len
+         ) != 0;
+         pos = (pos + 1) & seen->mask);
+    return &seen->slots[pos];
+}
+
+/**
+ * Make sure a set of seen hashes has room for one more hash, keeping its
+ * load factor at or below 3/4.
+ *
+ * @param seen      The set to make room in.
+ * @param bundle    The bundle the seen hashes belong to.
+ *
+ * @return True if the room was made, false if memory allocation failed,
+ *         and errno was set.
+ */
+static bool
+hdag_bundle_seen_reserve(struct hdag_bundle_seen *seen,
+                         const struct hdag_bundle *bundle)
+{
+    struct hdag_bundle_seen new_seen;
+    size_t                  size = seen->slots == NULL ? 0 : seen->mask + 1;
+    size_t                  pos;
+
+    if ((seen->num + 1) * 4 <= size * 3) {
+        return true;
+    }
+    size = MAX(size * 2, HDAG_BUNDLE_SEEN_MIN_SIZE);
+    new_seen = (struct hdag_bundle_seen){
+        .slots = calloc(size, sizeof(*new_seen.slots)),
+        .mask = size - 1,
+        .num = seen->num,
+    };
+    if (new_seen.slots == NULL) {
+        return false;
+    }
+    if (seen->slots != NULL) {
+        for (pos = 0; pos <= seen->mask; pos++) {
+            if (seen->slots[pos] != 0) {
+                *hdag_bundle_seen_find(
+                    &new_seen, bundle,
+                    hdag_bundle_seen_slot_hash(bundle, seen->slots[pos])
+                ) = seen->slots[pos];
+            }
+        }
+    }
+    free(seen->slots);
+    *seen = new_seen;
+    return true;
+}
+
+/**
+ * Add a hash to a set of seen hashes. A node replaces a target hash with
+ * the same hash value, but a target hash doesn't replace anything.
+ *
+ * @param seen      The set to add the hash to.
+ * @param bundle    The bundle the hash belongs to.
+ * @param idx       The index of the hash in the bundle.
+ * @param is_node   True if the index is of a node, false if of a target
+ *                  hash.
+ *
+ * @return True if the hash was added, false if memory allocation failed,
+ *         and errno was set.
+ */
+static bool
+hdag_bundle_seen_add(struct hdag_bundle_seen *seen,
+                     const struct hdag_bundle *bundle,
+                     size_t idx, bool is_node)
+{
+    size_t slot = hdag_bundle_seen_slot(idx, is_node);
+    size_t *pslot;
+
+    if (!hdag_bundle_seen_reserve(seen, bundle)) {
+        return false;
+    }
+    pslot = hdag_bundle_seen_find(seen, bundle,
+                                  hdag_bundle_seen_slot_hash(bundle, slot));
+    if (*pslot == 0) {
+        *pslot = slot;
+        seen->num++;
+    } else if (is_node && !hdag_bundle_seen_slot_is_node(*pslot)) {
+        *pslot = slot;
+    }
+    return true;
+}
+
+/**
+ * Get the size of the memory allocated for a set of seen hashes.
+ *
+ * @param seen  The set to get the memory size of.
+ *
+ * @return The memory size, bytes.
+ */
+static inline size_t
+hdag_bundle_seen_size(const struct hdag_bundle_seen *seen)
+{
+    return seen->slots == NULL ? 0 : (seen->mask + 1) * sizeof(*seen->slots);
+}
+
+/**
+ * Free the memory allocated for a set of seen hashes, making it empty.
+ *
+ * @param seen  The set to cleanup.
+ */
+static void
+hdag_bundle_seen_cleanup(struct hdag_bundle_seen *seen)
+{
+    free(seen->slots);
+    *seen = HDAG_BUNDLE_SEEN_EMPTY;
+}
+
+/**
+ * Append placeholder nodes with unknown targets to an unorganized bundle,
+ * for every target hash in a set of seen hashes, which wasn't seen as a
+ * node.
+ *
+ * @param bundle    The bundle to append the placeholder nodes to.
+ * @param seen      The set of seen hashes of the bundle.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_bundle_add_unseen_nodes(struct hdag_bundle *bundle,
+                             const struct hdag_bundle_seen *seen)
+{
+    struct hdag_node   *node;
+    size_t              pos;
+
+    if (seen->slots == NULL) {
+        return HDAG_RES_OK;
+    }
+    for (pos = 0; pos <= seen->mask; pos++) {
+        if (seen->slots[pos] == 0 ||
+            hdag_bundle_seen_slot_is_node(seen->slots[pos])) {
+            continue;
+        }
+        node = hdag_darr_cappend_one(&bundle->nodes);
+        if (node == NULL) {
+            return HDAG_RES_ERRNO;
+        }
+        memcpy(node->hash,
+               hdag_bundle_seen_slot_hash(bundle, seen->slots[pos]),
+               bundle->hash_len);
+        node->targets = HDAG_TARGETS_UNKNOWN;
+    }
+    return HDAG_RES_OK;
+}
+
+/**
+ * Append target hashes to an unorganized bundle, along with a placeholder
+ * node with unknown targets for each of them, unless tracking seen hashes.
+ *
+ * @param bundle    The bundle to append the target hashes to.
+ * @param seen      The set of hashes seen so far, to add the target hashes
+ *                  to instead of appending placeholder nodes.
+ *                  NULL to append the placeholder nodes.
+ * @param hashes    The target hashes to append, laid out back-to-back.
+ * @param num       The number of target hashes to append.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_bundle_add_target_hashes(struct hdag_bundle *bundle,
+                              struct hdag_bundle_seen *seen,
+                              const uint8_t *hashes, size_t num)
+{
+    struct hdag_node   *node;
+    size_t              idx;
+    size_t              i;
+
+    if (num == 0) {
+        return HDAG_RES_OK;
+    }
+    idx = bundle->target_hashes.slots_occupied;
+    if (hdag_darr_append(&bundle->target_hashes, hashes, num) == NULL) {
+        return HDAG_RES_ERRNO;
+    }
+    if (seen != NULL) {
+        for (i = 0; i < num; i++) {
+            if (!hdag_bundle_seen_add(seen, bundle, idx + i, false)) {
+                return HDAG_RES_ERRNO;
             }
-            ADD_NODE(target_hash, HDAG_TARGETS_UNKNOWN);
         }
+        return HDAG_RES_OK;
+    }
+    node = hdag_darr_cappend(&bundle->nodes, num);
+    if (node == NULL) {
+        return HDAG_RES_ERRNO;
+    }
+    for (i = 0; i < num; i++) {
+        memcpy(node->hash, hashes, bundle->hash_len);
+        node->targets = HDAG_TARGETS_UNKNOWN;
+        hashes += bundle->hash_len;
+        node = (struct hdag_node *)
+            ((uint8_t *)node + bundle->nodes.slot_size);
+    }
+    return HDAG_RES_OK;
+}
+
+/**
+ * Append a node to an unorganized bundle, pointing to the target hashes
+ * appended since the specified index.
+ *
+ * @param bundle                The bundle to append the node to.
+ * @param seen                  The set of hashes seen so far, to add the
+ *                              node to, or NULL if not tracked.
+ * @param hash                  The hash of the node.
+ * @param first_target_hash_idx The index of the node's first target hash.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_bundle_add_node(struct hdag_bundle *bundle,
+                     struct hdag_bundle_seen *seen,
+                     const uint8_t *hash, size_t first_target_hash_idx)
+{
+    struct hdag_node *node = hdag_darr_cappend_one(&bundle->nodes);
+    if (node == NULL) {
+        return HDAG_RES_ERRNO;
+    }
+    memcpy(node->hash, hash, bundle->hash_len);
+    if (first_target_hash_idx == bundle->target_hashes.slots_occupied) {
+        node->targets = HDAG_TARGETS_ABSENT;
+    } else {
+        node->targets = HDAG_TARGETS_INDIRECT(
+            first_target_hash_idx,
+            bundle->target_hashes.slots_occupied - 1
+        );
+    }
+    if (seen != NULL &&
+        !hdag_bundle_seen_add(seen, bundle,
+                              bundle->nodes.slots_occupied - 1, true)) {
+        return HDAG_RES_ERRNO;
+    }
+    return HDAG_RES_OK;
+}
+
+hdag_res
+hdag_bundle_reserve_node_seq(struct hdag_bundle *bundle,
+                             const struct hdag_node_seq *node_seq,
+                             size_t mem_size, bool dedup_targets)
+{
+    /*
+     * Each target hash is accompanied by a placeholder node, unless they're
+     * deduplicated, and then most targets are expected to be nodes as well
+     */
+    size_t node_num = node_seq->node_num_hint +
+                      (dedup_targets ? 0 : node_seq->target_hash_num_hint);
+    size_t target_hash_num = node_seq->target_hash_num_hint;
+
+    assert(hdag_bundle_is_valid(bundle));
+    assert(hdag_bundle_is_mutable(bundle));
+    assert(hdag_bundle_is_unorganized(bundle));
+    assert(hdag_node_seq_is_valid(node_seq));
+    assert(node_seq->hash_len == bundle->hash_len);
+
+    if (mem_size != 0) {
+        node_num = MIN(node_num, mem_size / bundle->nodes.slot_size);
+        target_hash_num = MIN(target_hash_num,
+                              mem_size / bundle->target_hashes.slot_size);
+    }
+    if (!hdag_darr_reserve(&bundle->nodes, node_num) ||
+        !hdag_darr_reserve(&bundle->target_hashes, target_hash_num)) {
+        return HDAG_RES_ERRNO;
+    }
+    return HDAG_RES_OK;
+}
+
+hdag_res
+hdag_bundle_add_node_seq(struct hdag_bundle *bundle,
+                         struct hdag_node_seq *node_seq,
+                         size_t mem_size, bool dedup_targets)
+{
+    hdag_res                            res = HDAG_RES_INVALID;
+    struct hdag_bundle_seen             seen_storage = HDAG_BUNDLE_SEEN_EMPTY;
+    struct hdag_bundle_seen            *seen = dedup_targets ? &seen_storage
+                                                               : NULL;
+    const struct hdag_node_seq_item    *items;
+    size_t                              item_num;
+    const uint8_t                      *node_hash;
+    struct hdag_hash_seq               *target_hash_seq;
+    const uint8_t                      *target_hashes;
+    size_t                              target_hash_num;
+    size_t                              first_target_hash_idx;
+    size_t                              i;
+
+    assert(hdag_bundle_is_valid(bundle));
+    assert(hdag_bundle_is_mutable(bundle));
+    assert(hdag_bundle_is_unorganized(bundle));
+    assert(hdag_node_seq_is_valid(node_seq));
+    assert(node_seq->hash_len == bundle->hash_len);
 
-        /* Add the node */
-        if (first_target_hash_idx == bundle.target_hashes.slots_occupied) {
-            ADD_NODE(node_hash, HDAG_TARGETS_ABSENT);
+    do {
+        if (hdag_node_seq_is_batched(node_seq)) {
+            /* Add a batch of nodes, with all their targets at once */
+            res = HDAG_RES_TRY(
+                hdag_node_seq_next_batch(node_seq, &items, &item_num)
+            );
+            if (res != HDAG_RES_OK) {
+                break;
+            }
+            for (i = 0; i < item_num; i++) {
+                first_target_hash_idx = bundle->target_hashes.slots_occupied;
+                HDAG_RES_TRY(hdag_bundle_add_target_hashes(
+                    bundle, seen,
+                    items[i].target_hashes, items[i].target_hash_num
+                ));
+                HDAG_RES_TRY(hdag_bundle_add_node(
+                    bundle, seen, items[i].hash, first_target_hash_idx
+                ));
+            }
         } else {
-            ADD_NODE(
-                node_hash,
-                HDAG_TARGETS_INDIRECT(
-                    first_target_hash_idx,
-                    bundle.target_hashes.slots_occupied - 1
-                )
+            /* Add a node, with its targets a batch at a time */
+            res = HDAG_RES_TRY(
+                hdag_node_seq_next(node_seq, &node_hash, &target_hash_seq)
             );
+            if (res != HDAG_RES_OK) {
+                break;
+            }
+            first_target_hash_idx = bundle->target_hashes.slots_occupied;
+            while (!HDAG_RES_TRY(hdag_hash_seq_next_batch(
+                target_hash_seq, &target_hashes, &target_hash_num
+            ))) {
+                HDAG_RES_TRY(hdag_bundle_add_target_hashes(
+                    bundle, seen, target_hashes, target_hash_num
+                ));
+            }
+            HDAG_RES_TRY(hdag_bundle_add_node(
+                bundle, seen, node_hash, first_target_hash_idx
+            ));
+            res = HDAG_RES_OK;
         }
-    }
+    } while (mem_size == 0 ||
+             hdag_darr_occupied_size(&bundle->nodes) +
+             hdag_darr_occupied_size(&bundle->target_hashes) +
+             hdag_bundle_seen_size(&seen_storage) < mem_size);
+
+    /* Add the placeholders for the targets which never showed up as nodes */
+    HDAG_RES_TRY(hdag_bundle_add_unseen_nodes(bundle, &seen_storage));
+
+    assert(hdag_bundle_is_valid(bundle));
+cleanup:
+    hdag_bundle_seen_cleanup(&seen_storage);
+    return res;
+}
+
+hdag_res
+hdag_bundle_from_node_seq(struct hdag_bundle *pbundle,
+                          struct hdag_node_seq *node_seq)
+{
+    hdag_res                res = HDAG_RES_INVALID;
+    struct hdag_bundle      bundle = HDAG_BUNDLE_EMPTY(node_seq->hash_len);
 
-    #undef ADD_NODE
+    assert(hdag_node_seq_is_valid(node_seq));
+
+    /* Collect all the nodes (and their targets) in the sequence */
+    HDAG_RES_TRY(hdag_bundle_reserve_node_seq(&bundle, node_seq, 0, false));
+    HDAG_RES_TRY(hdag_bundle_add_node_seq(&bundle, node_seq, 0, false));
 
     assert(hdag_bundle_is_valid(&bundle));
 
@@ -1446,8 +2280,8 @@ cleanup:
 struct hdag_bundle_txt_node_seq {
     /** The base abstract node sequence */
     struct hdag_node_seq    base;
-    /** The FILE stream containing the text to parse and load */
-    FILE                   *stream;
+    /** The (open) reader of the text to parse and load */
+    struct hdag_txt        *txt;
     /** The buffer to use for node hashes */
     uint8_t                *hash_buf;
     /** The buffer to use for target hashes */
@@ -1456,99 +2290,6 @@ struct hdag_bundle_txt_node_seq {
     struct hdag_hash_seq    target_hash_seq;
 };
 
-/**
- * Skip initial whitespace and read a hash of specified length from a stream.
- *
- * @param stream            The stream to read the hash from.
- * @param hash_buf          The buffer for the read hash (right-aligned).
- *                          Can be modified even on failure.
- * @param hash_len          The length of the hash to read,
- *                          as well as of its buffer, bytes.
- * @param skip_linebreaks   Include linebreaks into skipped initial
- *                          whitespace, if true. Assume there's no hash, if
- *                          false and an initial linebreak is encountered.
- *
- * @return  A non-negative number specifying how many hash bytes have been
- *          unfilled in the buffer, on success, or hash_len, if there was no
- *          hash.
- *          A negative number (a failure result) if hash retrieval has failed,
- *          including HDAG_RES_INVALID_FORMAT, if the file format is invalid,
- *          and HDAG_RES_ERRNO's in case of libc errors.
- */
-[[nodiscard]]
-static hdag_res
-hdag_bundle_txt_read_hash(FILE *stream, uint8_t *hash_buf, uint16_t hash_len,
-                          bool skip_linebreaks)
-{
-    uint16_t                    rem_hash_len = hash_len;
-    uint8_t                    *hash_ptr = hash_buf;
-    int                         c;
-    bool                        high_nibble = true;
-    uint8_t                     nibble;
-
-    assert(stream != NULL);
-    assert(hash_buf != NULL);
-    assert(hdag_hash_len_is_valid(hash_len));
-
-    /* Skip whitespace */
-    do {
-        c = getc(stream);
-        if (c == EOF) {
-            if (ferror(stream)) {
-                return HDAG_RES_ERRNO;
-            }
-            goto output;
-        }
-        if (!skip_linebreaks && (c == '\r' || c == '\n')) {
-            goto output;
-        }
-    } while (isspace(c));
-
-    /* Read the node hash until whitespace */
-    do {
-        /* If this is an invalid character, or the hash is too long */
-        if (!isxdigit(c) || rem_hash_len == 0) {
-            return HDAG_RES_INVALID_FORMAT;
-        }
-        nibble = c >= 'A' ? ((c & ~0x20) - ('A' - 0xA)) : (c - '0');
-        if (high_nibble) {
-            *hash_ptr = nibble << 4;
-            high_nibble = false;
-        } else {
-            *hash_ptr |= nibble;
-            high_nibble = true;
-            rem_hash_len--;
-            hash_ptr++;
-        }
-        c = getc(stream);
-        if (c == EOF) {
-            if (ferror(stream)) {
-                return HDAG_RES_ERRNO;
-            }
-            break;
-        }
-    } while (!isspace(c));
-
-    /* If we didn't get a low nibble (got odd number of digits) */
-    if (!high_nibble) {
-        return HDAG_RES_INVALID_FORMAT;
-    }
-
-output:
-    /* Move the hash to the right */
-    memmove(hash_buf + rem_hash_len, hash_buf, hash_len - rem_hash_len);
-    /* Fill initial missing hash bytes with zeroes */
-    memset(hash_buf, 0, rem_hash_len);
-
-    /* Put back the terminating whitespace */
-    assert(c == EOF || isspace(c));
-    if (c != EOF && ungetc(c, stream) == EOF) {
-        return HDAG_RES_ERRNO;
-    }
-
-    return rem_hash_len;
-}
-
 /**
  * Return the next target hash from an adjacency list text file.
  */
@@ -1562,16 +2303,16 @@ hdag_bundle_txt_hash_seq_next(struct hdag_hash_seq *hash_seq,
     struct hdag_bundle_txt_node_seq    *txt_node_seq = HDAG_CONTAINER_OF(
         struct hdag_bundle_txt_node_seq, target_hash_seq, hash_seq
     );
-    FILE                       *stream = txt_node_seq->stream;
 
     assert(hdag_hash_seq_is_valid(hash_seq));
     assert(phash != NULL);
     assert(txt_node_seq->target_hash_buf != NULL);
-    assert(stream != NULL);
+    assert(hdag_txt_is_open(txt_node_seq->txt));
 
     /* Skip whitespace (excluding newlines) and read a hash */
-    res = hdag_bundle_txt_read_hash(stream, txt_node_seq->target_hash_buf,
-                                    hash_len, false);
+    res = hdag_txt_read_hash(txt_node_seq->txt,
+                             txt_node_seq->target_hash_buf,
+                             hash_len, false);
     /* If we failed reading */
     if (hdag_res_is_failure(res)) {
         return res;
@@ -1601,16 +2342,15 @@ hdag_bundle_txt_node_seq_next(struct hdag_node_seq     *base_seq,
     struct hdag_bundle_txt_node_seq    *seq = HDAG_CONTAINER_OF(
         struct hdag_bundle_txt_node_seq, base, base_seq
     );
-    FILE                               *stream = seq->stream;
 
     assert(hdag_node_seq_is_valid(base_seq));
-    assert(stream != NULL);
+    assert(hdag_txt_is_open(seq->txt));
     assert(seq->hash_buf != NULL);
     assert(phash != NULL);
     assert(ptarget_hash_seq != NULL);
 
     /* Skip whitespace (including newlines) and read a hash */
-    res = hdag_bundle_txt_read_hash(stream, seq->hash_buf, hash_len, true);
+    res = hdag_txt_read_hash(seq->txt, seq->hash_buf, hash_len, true);
     /* If we failed reading */
     if (hdag_res_is_failure(res)) {
         return res;
@@ -1628,21 +2368,43 @@ hdag_bundle_txt_node_seq_next(struct hdag_node_seq     *base_seq,
     return HDAG_RES_OK;
 }
 
-hdag_res
-hdag_bundle_from_txt(struct hdag_bundle *pbundle,
-                     FILE *stream, uint16_t hash_len)
+/**
+ * Add the nodes from an adjacency list text reader to an unorganized
+ * bundle, but don't do any optimization or validation.
+ *
+ * @param bundle    The bundle to add the nodes to. Must be unorganized.
+ *                  Can be partially added to on failure.
+ * @param txt       The (open) reader of the text to parse and load.
+ * @param dedup_targets True to only add placeholder nodes for target
+ *                      hashes not seen as nodes in the text, false to add
+ *                      one for every target hash.
+ *
+ * @return A void universal result, including HDAG_RES_INVALID_FORMAT,
+ *         if the text format is invalid, and HDAG_RES_ERRNO's in case of
+ *         libc errors.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_bundle_add_txt_reader(struct hdag_bundle *bundle, struct hdag_txt *txt,
+                           bool dedup_targets)
 {
     hdag_res res = HDAG_RES_INVALID;
+    uint16_t hash_len = bundle->hash_len;
 
-    assert(stream != NULL);
-    assert(hdag_hash_len_is_valid(hash_len));
+    assert(hdag_bundle_is_valid(bundle));
+    assert(hdag_bundle_is_unorganized(bundle));
+    assert(hdag_txt_is_open(txt));
 
+    /* Assume an average of one target per node */
+    size_t hash_num = hdag_txt_hash_num_estimate(txt, hash_len);
     struct hdag_bundle_txt_node_seq seq = {
         .base = {
             .hash_len = hash_len,
             .next_fn = hdag_bundle_txt_node_seq_next,
+            .node_num_hint = hash_num - hash_num / 2,
+            .target_hash_num_hint = hash_num / 2,
         },
-        .stream = stream,
+        .txt = txt,
         .hash_buf = malloc(hash_len),
         .target_hash_buf = malloc(hash_len),
         .target_hash_seq = {
@@ -1658,7 +2420,10 @@ hdag_bundle_from_txt(struct hdag_bundle *pbundle,
     assert(hdag_node_seq_is_valid(&seq.base));
     assert(hdag_hash_seq_is_valid(&seq.target_hash_seq));
 
-    HDAG_RES_TRY(hdag_bundle_from_node_seq(pbundle, &seq.base));
+    HDAG_RES_TRY(hdag_bundle_reserve_node_seq(bundle, &seq.base, 0,
+                                              dedup_targets));
+    HDAG_RES_TRY(hdag_bundle_add_node_seq(bundle, &seq.base, 0,
+                                          dedup_targets));
 
     res = HDAG_RES_OK;
 cleanup:
@@ -1668,13 +2433,572 @@ cleanup:
 }
 
 hdag_res
-hdag_bundle_to_txt(FILE *stream, const struct hdag_bundle *bundle)
+hdag_bundle_from_txt(struct hdag_bundle *pbundle,
+                     FILE *stream, uint16_t hash_len)
 {
+    hdag_res res = HDAG_RES_INVALID;
+    struct hdag_txt txt = HDAG_TXT_CLOSED;
+    struct hdag_bundle bundle = HDAG_BUNDLE_EMPTY(hash_len);
+
     assert(stream != NULL);
-    assert(hdag_bundle_is_valid(bundle));
-    assert(!hdag_bundle_is_hashless(bundle));
+    assert(hdag_hash_len_is_valid(hash_len));
 
-    hdag_res res = HDAG_RES_INVALID;
+    HDAG_RES_TRY(hdag_txt_open(&txt, stream, hash_len));
+    HDAG_RES_TRY(hdag_bundle_add_txt_reader(&bundle, &txt, false));
+    HDAG_RES_TRY(hdag_txt_close(&txt));
+
+    assert(hdag_bundle_is_valid(&bundle));
+    if (pbundle != NULL) {
+        *pbundle = bundle;
+        bundle = HDAG_BUNDLE_EMPTY(hash_len);
+    }
+
+    res = HDAG_RES_OK;
+cleanup:
+    (void)hdag_txt_close(&txt);
+    hdag_bundle_cleanup(&bundle);
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
+/**
+ * The minimum size of an adjacency list text chunk loaded by a separate
+ * thread, bytes. Smaller texts are split into fewer chunks.
+ */
+#define HDAG_BUNDLE_TXT_CHUNK_MIN_SIZE  (256 * 1024)
+
+/** A chunk of an adjacency list text, loaded by a separate thread */
+struct hdag_bundle_txt_chunk {
+    /** The thread loading the chunk */
+    pthread_t           thread;
+    /** True if the thread was started, false if it wasn't (yet) */
+    bool                started;
+    /** The reader of the chunk's text */
+    struct hdag_txt     txt;
+    /** The bundle to load the chunk into */
+    struct hdag_bundle  bundle;
+    /** True if placeholder nodes should be added for unseen targets only */
+    bool                dedup_targets;
+    /** True if the parsing should be timed and reported to stderr */
+    bool                profile;
+    /**
+     * True if the bundle's nodes should be partitioned into node fanout
+     * buckets after loading
+     */
+    bool                partition;
+    /**
+     * The index of the node after the end of each fanout bucket of the
+     * bundle, if partitioned
+     */
+    size_t              bucket_ends[256];
+    /** The index the chunk's target hashes start at in the output bundle */
+    size_t              hash_offset;
+    /** The result of loading the chunk */
+    hdag_res            res;
+};
+
+/**
+ * Load a bundle from an adjacency list text chunk, and partition its nodes
+ * into node fanout buckets, if requested.
+ *
+ * @param arg   The chunk to load (struct hdag_bundle_txt_chunk *).
+ *
+ * @return NULL, always. The result is stored in the chunk.
+ */
+static void *
+hdag_bundle_txt_chunk_load(void *arg)
+{
+    struct hdag_bundle_txt_chunk *chunk = arg;
+    size_t len = chunk->txt.end - chunk->txt.pos;
+    HDAG_PROFILE_STAGE(
+        chunk->profile, "Parsing a text chunk", len, "bytes",
+        chunk->res = hdag_bundle_add_txt_reader(&chunk->bundle, &chunk->txt,
+                                                chunk->dedup_targets)
+    );
+    if (chunk->partition && chunk->res == HDAG_RES_OK) {
+        hdag_darr_radix_partition(&chunk->bundle.nodes, 0,
+                                  chunk->bundle.nodes.slots_occupied,
+                                  offsetof(struct hdag_node, hash),
+                                  chunk->bucket_ends);
+    }
+    return NULL;
+}
+
+/**
+ * Append the nodes and target hashes of one unorganized bundle to another,
+ * rebasing the indirect target indices of the appended nodes.
+ *
+ * @param bundle    The bundle to append to. Must be unorganized.
+ * @param tail      The bundle to append. Must be unorganized, and have the
+ *                  same hash length.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_bundle_cat(struct hdag_bundle *bundle, const struct hdag_bundle *tail)
+{
+    size_t              hash_offset;
+    size_t              node_offset;
+    size_t              idx;
+    struct hdag_node   *node;
+
+    assert(hdag_bundle_is_valid(bundle));
+    assert(hdag_bundle_is_mutable(bundle));
+    assert(hdag_bundle_is_unorganized(bundle));
+    assert(hdag_bundle_is_valid(tail));
+    assert(hdag_bundle_is_unorganized(tail));
+    assert(bundle->hash_len == tail->hash_len);
+
+    hash_offset = bundle->target_hashes.slots_occupied;
+    node_offset = bundle->nodes.slots_occupied;
+
+    if (tail->target_hashes.slots_occupied != 0 &&
+        hdag_darr_append(&bundle->target_hashes,
+                         tail->target_hashes.slots,
+                         tail->target_hashes.slots_occupied) == NULL) {
+        return HDAG_RES_ERRNO;
+    }
+    if (tail->nodes.slots_occupied != 0 &&
+        hdag_darr_append(&bundle->nodes,
+                         tail->nodes.slots,
+                         tail->nodes.slots_occupied) == NULL) {
+        return HDAG_RES_ERRNO;
+    }
+
+    /* Rebase the appended nodes' target hash indices */
+    for (idx = node_offset; idx < bundle->nodes.slots_occupied; idx++) {
+        node = HDAG_BUNDLE_NODE(bundle, idx);
+        if (hdag_targets_are_indirect(&node->targets)) {
+            node->targets = HDAG_TARGETS_INDIRECT(
+                hdag_node_get_first_ind_idx(node) + hash_offset,
+                hdag_node_get_last_ind_idx(node) + hash_offset
+            );
+        }
+    }
+
+    assert(hdag_bundle_is_valid(bundle));
+    return HDAG_RES_OK;
+}
+
+/** A range of node fanout buckets, sorted by a separate thread */
+struct hdag_bundle_txt_buckets {
+    /** The thread sorting the buckets */
+    pthread_t           thread;
+    /** True if the thread was started, false if it wasn't (yet) */
+    bool                started;
+    /** The bundle containing the buckets */
+    struct hdag_bundle *bundle;
+    /** The index of the first node of each bucket in the bundle */
+    const size_t       *bucket_starts;
+    /** The first bucket of the range */
+    size_t              start;
+    /** The bucket after the last one of the range */
+    size_t              end;
+};
+
+/**
+ * Sort each of a range of node fanout buckets.
+ *
+ * @param arg   The buckets to sort (struct hdag_bundle_txt_buckets *).
+ *
+ * @return NULL, always.
+ */
+static void *
+hdag_bundle_txt_buckets_sort(void *arg)
+{
+    struct hdag_bundle_txt_buckets *buckets = arg;
+    size_t bucket;
+
+    for (bucket = buckets->start; bucket < buckets->end; bucket++) {
+        hdag_bundle_sort_range(buckets->bundle,
+                               buckets->bucket_starts[bucket],
+                               buckets->bucket_starts[bucket + 1]);
+    }
+    return NULL;
+}
+
+/**
+ * Gather the partitioned bundles of loaded adjacency list text chunks into
+ * the first chunk's bundle, sorting it. Move the first chunk's buckets
+ * into their places in its own node array, copy the other chunks' buckets
+ * next to them, freeing each chunk as soon as it's copied, and then have
+ * each thread sort its own range of buckets, so the sorted buckets simply
+ * follow each other, and need no merging.
+ *
+ * @param chunks    The loaded chunks to gather, with partitioned
+ *                  unorganized bundles.
+ * @param chunk_num The number of chunks to gather, and the number of
+ *                  threads to use. Must be greater than zero.
+ *
+ * @return A void universal result. The first chunk's bundle can be
+ *         partially added to on failure.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_bundle_txt_chunks_gather(struct hdag_bundle_txt_chunk *chunks,
+                              size_t chunk_num)
+{
+    hdag_res                        res = HDAG_RES_INVALID;
+    struct hdag_bundle             *bundle = &chunks[0].bundle;
+    struct hdag_bundle_txt_buckets *buckets = NULL;
+    size_t                          bucket_starts[257] = {0, };
+    /* The index of the node after the last one placed into each bucket */
+    size_t                          bucket_fills[256];
+    size_t                          node_num;
+    size_t                          target_hash_num;
+    size_t                          bucket;
+    size_t                          node_start;
+    size_t                          len;
+    size_t                          start;
+    size_t                          i;
+    size_t                          idx;
+    struct hdag_node               *node;
+    int                             err;
+
+    assert(chunk_num > 0);
+    assert(hdag_bundle_is_valid(bundle));
+    assert(hdag_bundle_is_mutable(bundle));
+    assert(hdag_bundle_is_unorganized(bundle));
+
+    /* Place the buckets one after another, each holding every chunk's */
+    target_hash_num = 0;
+    for (i = 0; i < chunk_num; i++) {
+        target_hash_num += chunks[i].bundle.target_hashes.slots_occupied;
+    }
+    for (bucket = 0; bucket < 256; bucket++) {
+        bucket_starts[bucket + 1] = bucket_starts[bucket];
+        for (i = 0; i < chunk_num; i++) {
+            bucket_starts[bucket + 1] +=
+                chunks[i].bucket_ends[bucket] -
+                (bucket == 0 ? 0 : chunks[i].bucket_ends[bucket - 1]);
+        }
+    }
+    node_num = bucket_starts[256];
+
+    /* Allocate everything first, so nothing is half-moved on failure */
+    buckets = calloc(chunk_num, sizeof(*buckets));
+    if (buckets == NULL ||
+        !hdag_darr_reserve(&bundle->nodes,
+                           node_num - bundle->nodes.slots_occupied) ||
+        !hdag_darr_reserve(&bundle->target_hashes,
+                           target_hash_num -
+                           bundle->target_hashes.slots_occupied)) {
+        goto cleanup;
+    }
+
+    /* Append the other chunks' target hashes, freeing them right away */
+    for (i = 1; i < chunk_num; i++) {
+        chunks[i].hash_offset = bundle->target_hashes.slots_occupied;
+        if (chunks[i].bundle.target_hashes.slots_occupied != 0 &&
+            hdag_darr_append(&bundle->target_hashes,
+                             chunks[i].bundle.target_hashes.slots,
+                             chunks[i].bundle.target_hashes.slots_occupied)
+            == NULL) {
+            goto cleanup;
+        }
+        hdag_darr_cleanup(&chunks[i].bundle.target_hashes);
+    }
+
+    /*
+     * Move the first chunk's buckets into their places, starting from the
+     * last one, as every bucket can only move up, past the ones before it
+     */
+    if (node_num > bundle->nodes.slots_occupied) {
+        node = hdag_darr_uappend(&bundle->nodes,
+                                 node_num - bundle->nodes.slots_occupied);
+        assert(node != NULL);
+    }
+    for (bucket = 256; bucket-- > 0;) {
+        node_start = bucket == 0 ? 0 : chunks[0].bucket_ends[bucket - 1];
+        len = chunks[0].bucket_ends[bucket] - node_start;
+        if (len != 0 && node_start != bucket_starts[bucket]) {
+            memmove(hdag_darr_element(&bundle->nodes, bucket_starts[bucket]),
+                    hdag_darr_element(&bundle->nodes, node_start),
+                    len * bundle->nodes.slot_size);
+        }
+        bucket_fills[bucket] = bucket_starts[bucket] + len;
+    }
+
+    /*
+     * Copy the other chunks' buckets after the first one's, rebasing their
+     * target hash indices, and freeing each chunk right away
+     */
+    for (i = 1; i < chunk_num; i++) {
+        for (bucket = 0; bucket < 256; bucket++) {
+            node_start = bucket == 0 ? 0 : chunks[i].bucket_ends[bucket - 1];
+            len = chunks[i].bucket_ends[bucket] - node_start;
+            if (len == 0) {
+                continue;
+            }
+            memcpy(hdag_darr_element(&bundle->nodes, bucket_fills[bucket]),
+                   hdag_darr_element_const(&chunks[i].bundle.nodes,
+                                           node_start),
+                   len * bundle->nodes.slot_size);
+            for (idx = bucket_fills[bucket];
+                 idx < bucket_fills[bucket] + len; idx++) {
+                node = hdag_darr_element(&bundle->nodes, idx);
+                if (hdag_targets_are_indirect(&node->targets)) {
+                    node->targets = HDAG_TARGETS_INDIRECT(
+                        hdag_node_get_first_ind_idx(node) +
+                            chunks[i].hash_offset,
+                        hdag_node_get_last_ind_idx(node) +
+                            chunks[i].hash_offset
+                    );
+                }
+            }
+            bucket_fills[bucket] += len;
+        }
+        hdag_bundle_cleanup(&chunks[i].bundle);
+    }
+
+    /* Split the buckets into ranges of roughly equal size */
+    for (start = 0, bucket = 0, i = 0; i < chunk_num; i++) {
+        while (bucket < 256 &&
+               bucket_starts[bucket] < node_num * (i + 1) / chunk_num) {
+            bucket++;
+        }
+        buckets[i] = (struct hdag_bundle_txt_buckets){
+            .bundle = bundle,
+            .bucket_starts = bucket_starts,
+            .start = start,
+            .end = (i == chunk_num - 1) ? 256 : bucket,
+        };
+        start = buckets[i].end;
+    }
+
+    /* Sort the buckets, in the current thread, if one can't be started */
+    for (i = 1; i < chunk_num; i++) {
+        err = pthread_create(&buckets[i].thread, NULL,
+                             hdag_bundle_txt_buckets_sort, &buckets[i]);
+        buckets[i].started = (err == 0);
+    }
+    hdag_bundle_txt_buckets_sort(&buckets[0]);
+    for (i = 1; i < chunk_num; i++) {
+        if (buckets[i].started) {
+            pthread_join(buckets[i].thread, NULL);
+            buckets[i].started = false;
+        } else {
+            hdag_bundle_txt_buckets_sort(&buckets[i]);
+        }
+    }
+
+    assert(hdag_bundle_is_valid(bundle));
+    assert(hdag_bundle_is_sorted(bundle));
+    res = HDAG_RES_OK;
+cleanup:
+    free(buckets);
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
+/**
+ * Add the nodes from an adjacency list text file to an unorganized bundle
+ * using multiple threads, but don't do any optimization or validation.
+ * The first chunk of the text is parsed directly into the bundle, and the
+ * others are parsed into their own bundles, then appended or gathered.
+ *
+ * @param bundle        The bundle to add the nodes to. Must be unorganized.
+ *                      Can be partially added to on failure.
+ * @param stream        The FILE stream containing the text to parse and
+ *                      load.
+ * @param thread_num    The maximum number of threads to use, or zero to use
+ *                      one per online CPU.
+ * @param dedup_targets True to only add placeholder nodes for target
+ *                      hashes not seen as nodes, false to add one for
+ *                      every target hash.
+ * @param sort          True to have each chunk partitioned into node
+ *                      fanout buckets by its thread right after parsing,
+ *                      together with the bundle's existing nodes for the
+ *                      first chunk, and the buckets gathered and sorted by
+ *                      separate threads, producing a sorted bundle. False
+ *                      to append the chunks in order.
+ * @param profile       True to time and report the loading stages to
+ *                      stderr, false to not.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_bundle_add_txt_chunks(struct hdag_bundle *bundle,
+                           FILE *stream, unsigned int thread_num,
+                           bool dedup_targets, bool sort, bool profile)
+{
+    hdag_res                        res = HDAG_RES_INVALID;
+    struct hdag_txt                 txt = HDAG_TXT_CLOSED;
+    struct hdag_bundle_txt_chunk   *chunks = NULL;
+    size_t                          chunk_num = 0;
+    size_t                          i;
+    size_t                          len;
+    size_t                          node_num;
+    size_t                          target_hash_num;
+    const char                     *start;
+    const char                     *end;
+    uint16_t                        hash_len = bundle->hash_len;
+    int                             err;
+
+    assert(hdag_bundle_is_valid(bundle));
+    assert(hdag_bundle_is_mutable(bundle));
+    assert(hdag_bundle_is_unorganized(bundle));
+    assert(stream != NULL);
+
+    if (thread_num == 0) {
+        long cpu_num = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_num = cpu_num > 0 ? (unsigned int)cpu_num : 1;
+    }
+
+    /* Get the whole text into memory */
+    HDAG_RES_TRY(hdag_txt_open(&txt, stream, hash_len));
+    HDAG_RES_TRY(hdag_txt_fill(&txt));
+    len = txt.end - txt.pos;
+
+    /* Allocate the chunks, one per thread, but not too small */
+    chunk_num = MAX(MIN((size_t)thread_num,
+                        len / HDAG_BUNDLE_TXT_CHUNK_MIN_SIZE), 1);
+    chunks = calloc(chunk_num, sizeof(*chunks));
+    if (chunks == NULL) {
+        goto cleanup;
+    }
+    /* Load the first chunk into the bundle itself, to avoid copying */
+    chunks[0].bundle = *bundle;
+    *bundle = HDAG_BUNDLE_EMPTY(hash_len);
+    for (i = 0; i < chunk_num; i++) {
+        if (i != 0) {
+            chunks[i].bundle = HDAG_BUNDLE_EMPTY(hash_len);
+        }
+        chunks[i].dedup_targets = dedup_targets;
+        chunks[i].partition = sort;
+        chunks[i].profile = profile;
+    }
+
+    /* Split the text into chunks at line boundaries */
+    for (start = txt.pos, i = 0; i < chunk_num; i++, start = end) {
+        if (i == chunk_num - 1) {
+            end = txt.end;
+        } else {
+            end = MAX(txt.pos + len * (i + 1) / chunk_num, start);
+            end = memchr(end, '\n', txt.end - end);
+            end = end == NULL ? txt.end : end + 1;
+        }
+        hdag_txt_open_mem(&chunks[i].txt, start, end - start);
+    }
+
+    /* Load the chunks, in the current thread, if one can't be started */
+    for (i = 1; i < chunk_num; i++) {
+        err = pthread_create(&chunks[i].thread, NULL,
+                             hdag_bundle_txt_chunk_load, &chunks[i]);
+        chunks[i].started = (err == 0);
+    }
+    hdag_bundle_txt_chunk_load(&chunks[0]);
+    for (i = 1; i < chunk_num; i++) {
+        if (chunks[i].started) {
+            pthread_join(chunks[i].thread, NULL);
+            chunks[i].started = false;
+        } else {
+            hdag_bundle_txt_chunk_load(&chunks[i]);
+        }
+    }
+
+    /* Combine the chunk bundles, allocating memory once */
+    node_num = target_hash_num = 0;
+    for (i = 0; i < chunk_num; i++) {
+        HDAG_RES_TRY(chunks[i].res);
+        node_num += chunks[i].bundle.nodes.slots_occupied;
+        target_hash_num += chunks[i].bundle.target_hashes.slots_occupied;
+    }
+    if (sort) {
+        HDAG_PROFILE_STAGE(
+            profile, "Gathering and sorting the node buckets",
+            node_num, "nodes",
+            HDAG_RES_TRY(hdag_bundle_txt_chunks_gather(chunks, chunk_num))
+        );
+    } else {
+        if (!hdag_darr_reserve(&chunks[0].bundle.nodes,
+                               node_num -
+                               chunks[0].bundle.nodes.slots_occupied) ||
+            !hdag_darr_reserve(
+                &chunks[0].bundle.target_hashes,
+                target_hash_num -
+                chunks[0].bundle.target_hashes.slots_occupied
+            )) {
+            goto cleanup;
+        }
+        for (i = 1; i < chunk_num; i++) {
+            HDAG_RES_TRY(hdag_bundle_cat(&chunks[0].bundle,
+                                         &chunks[i].bundle));
+            hdag_bundle_cleanup(&chunks[i].bundle);
+        }
+    }
+
+    /* Mark the whole text processed */
+    txt.pos = txt.end;
+    HDAG_RES_TRY(hdag_txt_close(&txt));
+
+    res = HDAG_RES_OK;
+cleanup:
+    if (chunks != NULL) {
+        /* Return the (possibly partially-added to) bundle */
+        *bundle = chunks[0].bundle;
+        for (i = 1; i < chunk_num; i++) {
+            assert(!chunks[i].started);
+            hdag_bundle_cleanup(&chunks[i].bundle);
+        }
+        free(chunks);
+    }
+    (void)hdag_txt_close(&txt);
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
+hdag_res
+hdag_bundle_add_txt_parallel(struct hdag_bundle *bundle,
+                             FILE *stream, unsigned int thread_num,
+                             bool dedup_targets)
+{
+    return hdag_bundle_add_txt_chunks(bundle, stream, thread_num,
+                                      dedup_targets, false, false);
+}
+
+hdag_res
+hdag_bundle_add_txt_sorted(struct hdag_bundle *bundle,
+                           FILE *stream, unsigned int thread_num,
+                           bool dedup_targets, bool profile)
+{
+    return hdag_bundle_add_txt_chunks(bundle, stream, thread_num,
+                                      dedup_targets, true, profile);
+}
+
+hdag_res
+hdag_bundle_from_txt_parallel(struct hdag_bundle *pbundle,
+                              FILE *stream, uint16_t hash_len,
+                              unsigned int thread_num)
+{
+    hdag_res res = HDAG_RES_INVALID;
+    struct hdag_bundle bundle = HDAG_BUNDLE_EMPTY(hash_len);
+
+    assert(stream != NULL);
+    assert(hdag_hash_len_is_valid(hash_len));
+
+    HDAG_RES_TRY(hdag_bundle_add_txt_parallel(&bundle, stream, thread_num,
+                                              false));
+
+    assert(hdag_bundle_is_valid(&bundle));
+    if (pbundle != NULL) {
+        *pbundle = bundle;
+        bundle = HDAG_BUNDLE_EMPTY(hash_len);
+    }
+
+    res = HDAG_RES_OK;
+cleanup:
+    hdag_bundle_cleanup(&bundle);
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
+hdag_res
+hdag_bundle_to_txt(FILE *stream, const struct hdag_bundle *bundle)
+{
+    assert(stream != NULL);
+    assert(hdag_bundle_is_valid(bundle));
+    assert(!hdag_bundle_is_hashless(bundle));
+
+    hdag_res res = HDAG_RES_INVALID;
     size_t hex_len = bundle->hash_len * 2;
     char *hex_buf = NULL;
     const struct hdag_node *node;
@@ -1736,47 +3060,256 @@ hdag_bundle_is_unorganized(const struct hdag_bundle *bundle)
            hdag_bundle_is_unenumerated(bundle);
 }
 
-hdag_res
-hdag_bundle_organize(struct hdag_bundle *bundle,
-                     const struct hdag_ctx *ctx)
+/**
+ * The minimum number of nodes in a bundle slice sorted and deduplicated by
+ * a separate thread. Smaller bundles are split into fewer slices.
+ */
+#define HDAG_BUNDLE_SLICE_MIN_NODES  (16 * 1024)
+
+/**
+ * A slice of a bundle's nodes, starting and ending at node fanout bucket
+ * boundaries, sorted and deduplicated by a separate thread.
+ */
+struct hdag_bundle_slice {
+    /** The thread processing the slice */
+    pthread_t           thread;
+    /** True if the thread was started, false if it wasn't (yet) */
+    bool                started;
+    /** The bundle containing the slice */
+    struct hdag_bundle *bundle;
+    /** The index of the first node of the slice */
+    size_t              start;
+    /** The index of the node after the last one of the slice */
+    size_t              end;
+    /** True if the slice should be sorted before deduplicating */
+    bool                sort;
+    /** The number of nodes remaining at the slice start after dedup */
+    size_t              node_num;
+    /** The hashes of the unknown nodes in the slice, in order */
+    struct hdag_darr    unknown_hashes;
+    /** The result of processing the slice */
+    hdag_res            res;
+};
+
+/**
+ * Sort (if requested) and deduplicate a bundle slice.
+ *
+ * @param arg   The slice to process (struct hdag_bundle_slice *).
+ *
+ * @return NULL, always. The result is stored in the slice.
+ */
+static void *
+hdag_bundle_slice_organize(void *arg)
 {
-    hdag_res            res      = HDAG_RES_INVALID;
+    struct hdag_bundle_slice *slice = arg;
+    if (slice->sort) {
+        hdag_bundle_sort_range(slice->bundle, slice->start, slice->end);
+    }
+    hdag_bundle_dedup_edges_range(slice->bundle, slice->start, slice->end);
+    slice->res = hdag_bundle_dedup_nodes_range(slice->bundle,
+                                               slice->start, slice->end,
+                                               &slice->unknown_hashes,
+                                               &slice->node_num);
+    return NULL;
+}
+
+/**
+ * Sort (unless already sorted) and deduplicate the nodes and edges of a
+ * bundle, using multiple threads. Partition the nodes by the first hash
+ * byte, have each thread sort and deduplicate a slice of whole partitions
+ * in place, and then pack the slices together.
+ *
+ * @param bundle        The bundle to sort and deduplicate.
+ *                      Must be completely unorganized.
+ * @param slice_num     The number of slices (threads) to split the nodes
+ *                      into. Must be greater than zero.
+ *
+ * @return A void universal result. Including:
+ *         * HDAG_RES_NODE_CONFLICT, if nodes with matching hashes but
+ *           different targets were found.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_bundle_sort_and_dedup_parallel(struct hdag_bundle *bundle,
+                                    size_t slice_num)
+{
+    hdag_res                    res = HDAG_RES_INVALID;
+    struct hdag_bundle_slice   *slices = NULL;
+    size_t                      bucket_ends[256];
+    size_t                      node_num = bundle->nodes.slots_occupied;
+    const struct hdag_node     *node;
+    bool                        sort;
+    size_t                      bucket;
+    size_t                      start;
+    size_t                      idx;
+    size_t                      i;
+    int                         err;
 
     assert(hdag_bundle_is_valid(bundle));
     assert(hdag_bundle_is_mutable(bundle));
-    assert(!hdag_bundle_is_hashless(bundle));
     assert(hdag_bundle_is_unorganized(bundle));
-    assert(ctx == NULL || hdag_ctx_is_valid(ctx));
+    assert(slice_num > 0);
 
-    /* Disable profiling */
-#undef HDAG_PROFILE_TIME
-#define HDAG_PROFILE_TIME(_action, _statement) _statement
+    slices = calloc(slice_num, sizeof(*slices));
+    if (slices == NULL) {
+        goto cleanup;
+    }
+    for (i = 0; i < slice_num; i++) {
+        slices[i].unknown_hashes = HDAG_DARR_EMPTY(bundle->hash_len, 16);
+    }
 
-    /* Sort the nodes and edges by hash lexicographically */
-    HDAG_PROFILE_TIME("Sorting the bundle",
-                      hdag_bundle_sort(bundle));
+    /* Partition the nodes by the first hash byte, unless sorted already */
+    sort = !hdag_bundle_is_sorted(bundle);
+    if (sort) {
+        hdag_darr_radix_partition(&bundle->nodes, 0, node_num,
+                                  offsetof(struct hdag_node, hash),
+                                  bucket_ends);
+    } else {
+        memset(bucket_ends, 0, sizeof(bucket_ends));
+        for (idx = 0; idx < node_num; idx++) {
+            node = hdag_darr_element_const(&bundle->nodes, idx);
+            bucket_ends[node->hash[0]]++;
+        }
+        for (bucket = 1; bucket < 256; bucket++) {
+            bucket_ends[bucket] += bucket_ends[bucket - 1];
+        }
+    }
 
-    /* Deduplicate the nodes and edges */
-    HDAG_PROFILE_TIME("Deduping the bundle",
-                      HDAG_RES_TRY(hdag_bundle_dedup(bundle, ctx)));
+    /* Split the partitions into slices of roughly equal size */
+    for (start = 0, bucket = 0, i = 0; i < slice_num; i++) {
+        while (bucket < 255 &&
+               bucket_ends[bucket] < node_num * (i + 1) / slice_num) {
+            bucket++;
+        }
+        slices[i].bundle = bundle;
+        slices[i].start = start;
+        slices[i].end = (i == slice_num - 1) ? node_num
+                                             : bucket_ends[bucket];
+        slices[i].sort = sort;
+        start = slices[i].end;
+    }
 
-    /* Fill in the fanout array */
-    HDAG_PROFILE_TIME("Filling in fanout array",
-                      hdag_bundle_fanout_fill(bundle));
+    /* Process the slices, in the current thread, if one can't be started */
+    for (i = 1; i < slice_num; i++) {
+        err = pthread_create(&slices[i].thread, NULL,
+                             hdag_bundle_slice_organize, &slices[i]);
+        slices[i].started = (err == 0);
+    }
+    hdag_bundle_slice_organize(&slices[0]);
+    for (i = 1; i < slice_num; i++) {
+        if (slices[i].started) {
+            pthread_join(slices[i].thread, NULL);
+            slices[i].started = false;
+        } else {
+            hdag_bundle_slice_organize(&slices[i]);
+        }
+    }
 
-    /* Compact the edges */
-    HDAG_PROFILE_TIME("Compacting the bundle",
-                      HDAG_RES_TRY(hdag_bundle_compact(bundle)));
+    /* Pack the remaining nodes and collect the unknown hashes, in order */
+    hdag_darr_empty(&bundle->unknown_hashes);
+    for (node_num = 0, i = 0; i < slice_num; i++) {
+        HDAG_RES_TRY(slices[i].res);
+        if (node_num != slices[i].start && slices[i].node_num != 0) {
+            memmove(hdag_darr_element(&bundle->nodes, node_num),
+                    hdag_darr_element(&bundle->nodes, slices[i].start),
+                    slices[i].node_num * bundle->nodes.slot_size);
+        }
+        node_num += slices[i].node_num;
+        if (hdag_darr_occupied_slots(&slices[i].unknown_hashes) != 0 &&
+            hdag_darr_append(
+                &bundle->unknown_hashes,
+                slices[i].unknown_hashes.slots,
+                hdag_darr_occupied_slots(&slices[i].unknown_hashes)
+            ) == NULL) {
+            goto cleanup;
+        }
+    }
+    bundle->nodes.slots_occupied = node_num;
 
-    /* Try to enumerate the bundle's components and generations */
-    HDAG_PROFILE_TIME("Enumerating the bundle",
-                      HDAG_RES_TRY(hdag_bundle_enumerate(bundle, ctx)));
+    assert(hdag_bundle_is_valid(bundle));
+    assert(hdag_bundle_is_sorted_and_deduped(bundle));
+    res = HDAG_RES_OK;
+cleanup:
+    if (slices != NULL) {
+        for (i = 0; i < slice_num; i++) {
+            assert(!slices[i].started);
+            hdag_darr_cleanup(&slices[i].unknown_hashes);
+        }
+        free(slices);
+    }
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
+hdag_res
+hdag_bundle_organize_parallel(struct hdag_bundle *bundle,
+                              const struct hdag_ctx *ctx,
+                              unsigned int thread_num,
+                              bool profile)
+{
+    hdag_res            res      = HDAG_RES_INVALID;
+    size_t              slice_num;
+
+    assert(hdag_bundle_is_valid(bundle));
+    assert(hdag_bundle_is_mutable(bundle));
+    assert(!hdag_bundle_is_hashless(bundle));
+    assert(hdag_bundle_is_unorganized(bundle));
+    assert(ctx == NULL || hdag_ctx_is_valid(ctx));
+
+    if (thread_num == 0) {
+        long cpu_num = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_num = cpu_num > 0 ? (unsigned int)cpu_num : 1;
+    }
+
+    /* Use one slice per thread, but not too small */
+    slice_num = MAX(MIN((size_t)thread_num,
+                        bundle->nodes.slots_occupied /
+                        HDAG_BUNDLE_SLICE_MIN_NODES), 1);
+
+    if (slice_num > 1) {
+        /* Sort and deduplicate the nodes and edges in parallel */
+        HDAG_PROFILE_STAGE(
+            profile, "Sorting and deduping the bundle",
+            bundle->nodes.slots_occupied, "nodes",
+            HDAG_RES_TRY(hdag_bundle_sort_and_dedup_parallel(bundle,
+                                                             slice_num))
+        );
+    } else {
+        /*
+         * Sort the nodes and edges by hash lexicographically,
+         * unless they were sorted while loading
+         */
+        if (!hdag_bundle_is_sorted(bundle)) {
+            HDAG_PROFILE_STAGE(profile, "Sorting the bundle",
+                               bundle->nodes.slots_occupied, "nodes",
+                               hdag_bundle_sort(bundle));
+        }
+
+        /* Deduplicate the nodes and edges */
+        HDAG_PROFILE_STAGE(profile, "Deduping the bundle",
+                           bundle->nodes.slots_occupied, "nodes",
+                           HDAG_RES_TRY(hdag_bundle_dedup(bundle, ctx)));
+    }
+
+    /* Fill in the fanout array */
+    HDAG_PROFILE_STAGE(profile, "Filling in fanout array",
+                       bundle->nodes.slots_occupied, "nodes",
+                       hdag_bundle_fanout_fill(bundle));
+
+    /* Compact the edges */
+    HDAG_PROFILE_STAGE(profile, "Compacting the bundle",
+                       bundle->nodes.slots_occupied, "nodes",
+                       HDAG_RES_TRY(hdag_bundle_compact_parallel(
+                           bundle, thread_num
+                       )));
+
+    /* Try to enumerate the bundle's components and generations */
+    HDAG_PROFILE_STAGE(profile, "Enumerating the bundle",
+                       bundle->nodes.slots_occupied, "nodes",
+                       HDAG_RES_TRY(hdag_bundle_enumerate(bundle, ctx)));
 
     /* Shrink the extra space allocated for the bundle */
     HDAG_RES_TRY(hdag_bundle_deflate(bundle));
 
-#undef HDAG_PROFILE_TIME
-
     assert(hdag_bundle_is_valid(bundle));
     assert(hdag_bundle_is_organized(bundle));
     res = HDAG_RES_OK;
@@ -1784,6 +3317,13 @@ cleanup:
     return HDAG_RES_ERRNO_IF_INVALID(res);
 }
 
+hdag_res
+hdag_bundle_organize(struct hdag_bundle *bundle,
+                     const struct hdag_ctx *ctx)
+{
+    return hdag_bundle_organize_parallel(bundle, ctx, 1, false);
+}
+
 bool
 hdag_bundle_is_organized(const struct hdag_bundle *bundle)
 {
@@ -1890,3 +3430,1244 @@ hdag_bundle_node_forget(struct hdag_bundle *bundle, uint32_t node_idx)
 
     return HDAG_RES_OK;
 }
+
+/**
+ * Return the next pseudo-random number of a SplitMix64 sequence.
+ *
+ * @param pstate    Location of the sequence state to advance.
+ *
+ * @return The next pseudo-random number.
+ */
+static inline uint64_t
+hdag_bundle_intervals_random(uint64_t *pstate)
+{
+    uint64_t z = (*pstate += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/** A node being traversed while assigning reachability intervals */
+struct hdag_bundle_intervals_frame {
+    /** The index of the node */
+    uint32_t    node_idx;
+    /** The number of the node's targets */
+    uint32_t    target_num;
+    /** The number of the node's targets traversed so far */
+    uint32_t    target_pos;
+    /** The index of the target to start the traversal with */
+    uint32_t    target_off;
+};
+
+hdag_res
+hdag_bundle_intervals_fill(struct hdag_bundle *bundle, uint32_t interval_num)
+{
+    hdag_res                            res = HDAG_RES_INVALID;
+    struct hdag_darr                    roots =
+        HDAG_DARR_EMPTY(sizeof(uint32_t), 64);
+    struct hdag_darr                    frames =
+        HDAG_DARR_EMPTY(sizeof(struct hdag_bundle_intervals_frame), 64);
+    struct hdag_bundle_intervals_frame *frame;
+    struct hdag_interval               *intervals;
+    struct hdag_interval               *interval;
+    struct hdag_interval               *target_interval;
+    uint32_t                           *root_idxs;
+    uint32_t                            root_num;
+    uint32_t                            node_num;
+    uint32_t                            node_idx;
+    uint32_t                            target_idx;
+    uint32_t                            target_node_idx;
+    uint32_t                            label;
+    uint32_t                            rank;
+    uint32_t                            swap;
+    size_t                              idx;
+    uint64_t                            state;
+
+    assert(hdag_bundle_is_valid(bundle));
+    assert(hdag_bundle_is_compacted(bundle));
+    assert(hdag_bundle_is_enumerated(bundle));
+    assert(hdag_darr_is_empty(&bundle->node_intervals));
+    assert(interval_num > 0);
+
+    node_num = hdag_darr_occupied_slots(&bundle->nodes);
+    hdag_darr_cleanup(&bundle->node_intervals);
+    bundle->node_intervals = HDAG_DARR_EMPTY(
+        sizeof(struct hdag_interval) * interval_num, 0
+    );
+    intervals = hdag_darr_cappend(&bundle->node_intervals, node_num);
+    if (intervals == NULL) {
+        goto cleanup;
+    }
+
+    /* Mark the nodes which are targets, to collect the rest as roots */
+    for (node_idx = 0; node_idx < node_num; node_idx++) {
+        for (target_idx = 0;
+             target_idx < hdag_bundle_targets_count(bundle, node_idx);
+             target_idx++) {
+            target_node_idx = hdag_bundle_targets_node_idx(bundle, node_idx,
+                                                           target_idx);
+            intervals[(size_t)target_node_idx * interval_num].max = 1;
+        }
+    }
+    for (node_idx = 0; node_idx < node_num; node_idx++) {
+        interval = &intervals[(size_t)node_idx * interval_num];
+        if (interval->max == 0 &&
+            hdag_darr_append_one(&roots, &node_idx) == NULL) {
+            goto cleanup;
+        }
+        interval->max = 0;
+    }
+    root_idxs = roots.slots;
+    root_num = hdag_darr_occupied_slots(&roots);
+
+    /* Assign each interval with its own randomized DFS */
+    state = 0;
+    for (label = 0; label < interval_num; label++) {
+        /* Shuffle the roots */
+        for (idx = root_num; idx > 1; idx--) {
+            node_idx = hdag_bundle_intervals_random(&state) % idx;
+            swap = root_idxs[idx - 1];
+            root_idxs[idx - 1] = root_idxs[node_idx];
+            root_idxs[node_idx] = swap;
+        }
+
+        /* Traverse from each root, ranking nodes in the post-order */
+        rank = 0;
+        for (idx = 0; idx < root_num; idx++) {
+            node_idx = root_idxs[idx];
+            /*
+             * The maximum of UINT32_MAX marks nodes being traversed,
+             * and zero marks nodes not reached yet
+             */
+            intervals[(size_t)node_idx * interval_num + label] =
+                (struct hdag_interval){UINT32_MAX, UINT32_MAX};
+            frame = hdag_darr_uappend(&frames, 1);
+            if (frame == NULL) {
+                goto cleanup;
+            }
+            *frame = (struct hdag_bundle_intervals_frame){
+                .node_idx = node_idx,
+                .target_num = hdag_bundle_targets_count(bundle, node_idx),
+            };
+            while (!hdag_darr_is_empty(&frames)) {
+                frame = hdag_darr_element(&frames, frames.slots_occupied - 1);
+                interval =
+                    &intervals[(size_t)frame->node_idx * interval_num + label];
+                /* If the node has no more targets */
+                if (frame->target_pos >= frame->target_num) {
+                    /* Rank it, and let its source know its minimum */
+                    rank++;
+                    interval->max = rank;
+                    interval->min = MIN(interval->min, rank);
+                    frames.slots_occupied--;
+                    if (!hdag_darr_is_empty(&frames)) {
+                        frame--;
+                        target_interval = interval;
+                        interval = &intervals[
+                            (size_t)frame->node_idx * interval_num + label
+                        ];
+                        interval->min = MIN(interval->min,
+                                            target_interval->min);
+                    }
+                    continue;
+                }
+                /* Take the next target, in a rotated order */
+                target_node_idx = hdag_bundle_targets_node_idx(
+                    bundle, frame->node_idx,
+                    (frame->target_off + frame->target_pos) %
+                    frame->target_num
+                );
+                frame->target_pos++;
+                target_interval =
+                    &intervals[(size_t)target_node_idx * interval_num + label];
+                /* If the target has been ranked already */
+                if (target_interval->max != 0) {
+                    assert(target_interval->max != UINT32_MAX);
+                    interval->min = MIN(interval->min, target_interval->min);
+                    continue;
+                }
+                /* Go down to the target */
+                *target_interval = (struct hdag_interval){
+                    UINT32_MAX, UINT32_MAX
+                };
+                frame = hdag_darr_uappend(&frames, 1);
+                if (frame == NULL) {
+                    goto cleanup;
+                }
+                *frame = (struct hdag_bundle_intervals_frame){
+                    .node_idx = target_node_idx,
+                    .target_num = hdag_bundle_targets_count(bundle,
+                                                            target_node_idx),
+                };
+                if (frame->target_num > 1) {
+                    frame->target_off = hdag_bundle_intervals_random(&state) %
+                        frame->target_num;
+                }
+            }
+        }
+        assert(rank == node_num);
+    }
+
+    assert(hdag_bundle_is_valid(bundle));
+    res = HDAG_RES_OK;
+cleanup:
+    if (res != HDAG_RES_OK) {
+        hdag_darr_cleanup(&bundle->node_intervals);
+    }
+    hdag_darr_cleanup(&frames);
+    hdag_darr_cleanup(&roots);
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
+/**
+ * A set of visited node indexes, numbering the nodes in the order they
+ * were added, so the visitors can keep their state in arrays.
+ */
+struct hdag_bundle_visited {
+    /**
+     * The slots: zero if empty, or one plus the node index in the lower
+     * half, and the node's number in the upper half.
+     */
+    uint64_t   *slots;
+    /** The number of slots minus one, a power of two minus one */
+    size_t      mask;
+    /** The number of occupied slots */
+    size_t      num;
+};
+
+/** An initializer for an empty set of visited node indexes */
+#define HDAG_BUNDLE_VISITED_EMPTY (struct hdag_bundle_visited){.slots = NULL}
+
+/** The number of slots to allocate for a set of visited nodes at first */
+#define HDAG_BUNDLE_VISITED_MIN_SIZE 256
+
+/**
+ * Find the slot for a node index in a set of visited nodes: the one
+ * containing the index, or the empty one it should be placed into.
+ *
+ * @param visited   The set to look up the index in. Must be allocated.
+ * @param node_idx  The node index to look up.
+ *
+ * @return The pointer to the slot.
+ */
+static inline uint64_t *
+hdag_bundle_visited_find(const struct hdag_bundle_visited *visited,
+                         uint32_t node_idx)
+{
+    size_t pos;
+
+    assert(visited->slots != NULL);
+
+    for (pos = (node_idx * UINT32_C(0x9e3779b1)) & visited->mask;
+         visited->slots[pos] != 0 &&
+         (uint32_t)visited->slots[pos] != node_idx + 1;
+         pos = (pos + 1) & visited->mask);
+    return &visited->slots[pos];
+}
+
+/**
+ * Add a node index to a set of visited nodes, unless it's already there,
+ * keeping the set's load factor at or below 1/2.
+ *
+ * @param visited   The set to add the index to.
+ * @param node_idx  The node index to add.
+ * @param pnum      Location for the number of the node in the set
+ *                  (the number of nodes added before it), or NULL.
+ *
+ * @return A universal result: zero if the index was added, one if it was
+ *         there already, or a failure.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_bundle_visited_add(struct hdag_bundle_visited *visited,
+                        uint32_t node_idx, uint32_t *pnum)
+{
+    struct hdag_bundle_visited  new_visited;
+    uint64_t                   *slot;
+    size_t                      size;
+    size_t                      pos;
+    bool                        found;
+
+    assert(node_idx < INT32_MAX);
+
+    /* Grow the set, if it would get too full */
+    if (visited->slots == NULL || (visited->num + 1) * 2 > visited->mask + 1) {
+        size = visited->slots == NULL ? HDAG_BUNDLE_VISITED_MIN_SIZE
+                                      : (visited->mask + 1) * 2;
+        new_visited = (struct hdag_bundle_visited){
+            .slots = calloc(size, sizeof(*new_visited.slots)),
+            .mask = size - 1,
+            .num = visited->num,
+        };
+        if (new_visited.slots == NULL) {
+            return HDAG_RES_ERRNO;
+        }
+        if (visited->slots != NULL) {
+            for (pos = 0; pos <= visited->mask; pos++) {
+                if (visited->slots[pos] != 0) {
+                    *hdag_bundle_visited_find(
+                        &new_visited, (uint32_t)visited->slots[pos] - 1
+                    ) = visited->slots[pos];
+                }
+            }
+        }
+        free(visited->slots);
+        *visited = new_visited;
+    }
+
+    slot = hdag_bundle_visited_find(visited, node_idx);
+    found = *slot != 0;
+    if (!found) {
+        *slot = (uint64_t)visited->num << 32 | (node_idx + 1);
+        visited->num++;
+    }
+    if (pnum != NULL) {
+        *pnum = *slot >> 32;
+    }
+    return found;
+}
+
+/**
+ * Check if a node is reachable from another node in a bundle, walking the
+ * nodes in the order of descending generation, never going below the
+ * generation of the checked node.
+ *
+ * @param bundle    The bundle containing the nodes.
+ * @param from_idx  The index of the node to start the walk from.
+ * @param to_idx    The index of the node to check the reachability of.
+ *                  Must have a lower generation than the "from" node.
+ *
+ * @return A universal result: one if the "to" node is reachable from the
+ *         "from" node, zero if not, or a failure.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_bundle_reaches_by_generation(const struct hdag_bundle *bundle,
+                                  uint32_t from_idx, uint32_t to_idx)
+{
+    hdag_res                res = HDAG_RES_INVALID;
+    struct hdag_darr        heap = HDAG_HEAP_EMPTY;
+    const struct hdag_node *node;
+    uint32_t                min_generation;
+    uint32_t                target_num;
+    uint32_t                target_idx;
+    uint32_t                target_node_idx;
+    uint64_t                key;
+    uint64_t                last_key = UINT64_MAX;
+
+    /*
+     * Never go down to the target's generation, except for the target
+     * itself. A node added more than once comes out of the heap in a row,
+     * so no "visited" set is needed.
+     */
+    min_generation = hdag_bundle_node_const(bundle, to_idx)->generation;
+    node = hdag_bundle_node_const(bundle, from_idx);
+    assert(node->generation > min_generation);
+    if (!hdag_heap_push(&heap, hdag_heap_key(node->generation, from_idx))) {
+        goto cleanup;
+    }
+    res = 0;
+    while (!hdag_darr_is_empty(&heap)) {
+        key = hdag_heap_pop(&heap);
+        if (key == last_key) {
+            continue;
+        }
+        last_key = key;
+        target_num = hdag_bundle_targets_count(
+            bundle, hdag_heap_key_node_idx(key)
+        );
+        for (target_idx = 0; target_idx < target_num; target_idx++) {
+            target_node_idx = hdag_bundle_targets_node_idx(
+                bundle, hdag_heap_key_node_idx(key), target_idx
+            );
+            if (target_node_idx == to_idx) {
+                res = 1;
+                goto cleanup;
+            }
+            node = hdag_bundle_node_const(bundle, target_node_idx);
+            if (node->generation > min_generation &&
+                !hdag_heap_push(&heap, hdag_heap_key(node->generation,
+                                                     target_node_idx))) {
+                res = HDAG_RES_INVALID;
+                goto cleanup;
+            }
+        }
+    }
+
+cleanup:
+    hdag_darr_cleanup(&heap);
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
+/**
+ * Check if a node is reachable from another node in a bundle with the
+ * reachability intervals filled in, walking the nodes depth-first, only
+ * through the nodes whose intervals contain the checked node's, and never
+ * going below the generation of the checked node. The intervals steer the
+ * walk towards the checked node, so it's usually found straight away,
+ * if it's reachable.
+ *
+ * @param bundle    The bundle containing the nodes.
+ *                  Must have the reachability intervals filled in.
+ * @param from_idx  The index of the node to start the walk from.
+ * @param to_idx    The index of the node to check the reachability of.
+ *                  Must have a lower generation than the "from" node.
+ *
+ * @return A universal result: one if the "to" node is reachable from the
+ *         "from" node, zero if not, or a failure.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_bundle_reaches_by_intervals(const struct hdag_bundle *bundle,
+                                 uint32_t from_idx, uint32_t to_idx)
+{
+    hdag_res                    res = HDAG_RES_INVALID;
+    struct hdag_darr            stack = HDAG_DARR_EMPTY(sizeof(uint32_t), 64);
+    struct hdag_bundle_visited  visited = HDAG_BUNDLE_VISITED_EMPTY;
+    const struct hdag_interval *to_intervals;
+    size_t                      interval_num;
+    uint32_t                    min_generation;
+    uint32_t                    node_idx;
+    uint32_t                    target_num;
+    uint32_t                    target_idx;
+    uint32_t                    target_node_idx;
+
+    assert(!hdag_darr_is_empty(&bundle->node_intervals));
+
+    interval_num = bundle->node_intervals.slot_size /
+        sizeof(struct hdag_interval);
+    to_intervals = hdag_darr_element_const(&bundle->node_intervals, to_idx);
+    min_generation = hdag_bundle_node_const(bundle, to_idx)->generation;
+    assert(hdag_bundle_node_const(bundle, from_idx)->generation >
+           min_generation);
+
+    if (hdag_darr_append_one(&stack, &from_idx) == NULL) {
+        goto cleanup;
+    }
+    res = 0;
+    while (!hdag_darr_is_empty(&stack)) {
+        node_idx = *(uint32_t *)hdag_darr_element(
+            &stack, stack.slots_occupied - 1
+        );
+        stack.slots_occupied--;
+        target_num = hdag_bundle_targets_count(bundle, node_idx);
+        for (target_idx = 0; target_idx < target_num; target_idx++) {
+            target_node_idx = hdag_bundle_targets_node_idx(
+                bundle, node_idx, target_idx
+            );
+            if (target_node_idx == to_idx) {
+                res = 1;
+                goto cleanup;
+            }
+            if (hdag_bundle_node_const(bundle, target_node_idx)->generation <=
+                    min_generation ||
+                !hdag_intervals_contain(
+                    hdag_darr_element_const(&bundle->node_intervals,
+                                            target_node_idx),
+                    to_intervals, interval_num
+                ) ||
+                HDAG_RES_TRY(hdag_bundle_visited_add(&visited,
+                                                     target_node_idx,
+                                                     NULL))) {
+                continue;
+            }
+            if (hdag_darr_append_one(&stack, &target_node_idx) == NULL) {
+                res = HDAG_RES_INVALID;
+                goto cleanup;
+            }
+        }
+    }
+
+cleanup:
+    free(visited.slots);
+    hdag_darr_cleanup(&stack);
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
+hdag_res
+hdag_bundle_is_ancestor_idx(const struct hdag_bundle *bundle,
+                            uint32_t from_idx, uint32_t to_idx)
+{
+    const struct hdag_node *from_node;
+    const struct hdag_node *to_node;
+
+    assert(hdag_bundle_is_valid(bundle));
+    assert(from_idx < hdag_darr_occupied_slots(&bundle->nodes));
+    assert(to_idx < hdag_darr_occupied_slots(&bundle->nodes));
+
+    from_node = hdag_bundle_node_const(bundle, from_idx);
+    to_node = hdag_bundle_node_const(bundle, to_idx);
+    assert(from_node->generation != 0 && to_node->generation != 0);
+
+    /* Answer right away if the components or generations rule it out */
+    if (from_idx == to_idx) {
+        return 1;
+    }
+    if (from_node->component != to_node->component ||
+        from_node->generation <= to_node->generation) {
+        return 0;
+    }
+    if (hdag_darr_is_empty(&bundle->node_intervals)) {
+        return hdag_bundle_reaches_by_generation(bundle, from_idx, to_idx);
+    }
+
+    /* Answer right away if the intervals rule it out */
+    if (!hdag_intervals_contain(
+            hdag_darr_element_const(&bundle->node_intervals, from_idx),
+            hdag_darr_element_const(&bundle->node_intervals, to_idx),
+            bundle->node_intervals.slot_size / sizeof(struct hdag_interval)
+        )) {
+        return 0;
+    }
+    return hdag_bundle_reaches_by_intervals(bundle, from_idx, to_idx);
+}
+
+hdag_res
+hdag_bundle_is_ancestor(const struct hdag_bundle *bundle,
+                        const uint8_t *from_hash, const uint8_t *to_hash)
+{
+    uint32_t from_idx;
+    uint32_t to_idx;
+
+    assert(hdag_bundle_is_valid(bundle));
+    assert(from_hash != NULL);
+    assert(to_hash != NULL);
+
+    from_idx = hdag_bundle_find_node_idx(bundle, from_hash);
+    to_idx = hdag_bundle_find_node_idx(bundle, to_hash);
+    if (from_idx >= INT32_MAX || to_idx >= INT32_MAX) {
+        return HDAG_RES_ERRNO_ARG(ENOENT);
+    }
+    return hdag_bundle_is_ancestor_idx(bundle, from_idx, to_idx);
+}
+
+/** The flag of a node reachable from a common ancestor of all the heads */
+#define HDAG_BUNDLE_MERGE_BASES_STALE 1
+
+hdag_res
+hdag_bundle_merge_bases_idx(const struct hdag_bundle *bundle,
+                            const uint32_t *node_idxs, size_t node_num,
+                            struct hdag_darr *bases)
+{
+    hdag_res                    res = HDAG_RES_INVALID;
+    struct hdag_darr            heap = HDAG_HEAP_EMPTY;
+    struct hdag_bundle_visited  visited = HDAG_BUNDLE_VISITED_EMPTY;
+    /*
+     * The states of visited nodes, in the order of visiting: the flags
+     * word, followed by the bitmap of the heads the node is reachable from
+     */
+    struct hdag_darr            states;
+    size_t                      word_num = (node_num + 63) / 64;
+    size_t                      base_num = 0;
+    /* The number of queued nodes not marked stale */
+    size_t                      nonstale_num = 0;
+    const struct hdag_node     *node;
+    uint64_t                   *state;
+    uint64_t                   *target_state;
+    uint32_t                    node_idx;
+    uint32_t                    state_idx;
+    uint32_t                    target_num;
+    uint32_t                    target_idx;
+    uint32_t                    target_node_idx;
+    uint32_t                    target_state_idx;
+    bool                        common;
+    size_t                      idx;
+
+    assert(hdag_bundle_is_valid(bundle));
+    assert(node_idxs != NULL);
+    assert(node_num > 0);
+    assert(hdag_darr_is_mutable(bases));
+    assert(bases->slot_size == sizeof(uint32_t));
+
+    states = HDAG_DARR_EMPTY(sizeof(uint64_t) * (1 + word_num), 64);
+
+    /* Answer right away if the heads are in different components */
+    for (idx = 0; idx < node_num; idx++) {
+        assert(node_idxs[idx] < hdag_darr_occupied_slots(&bundle->nodes));
+        if (hdag_bundle_node_const(bundle, node_idxs[idx])->component !=
+            hdag_bundle_node_const(bundle, node_idxs[0])->component) {
+            res = 0;
+            goto cleanup;
+        }
+    }
+
+    /* Queue the heads, marking each as reachable from itself */
+    for (idx = 0; idx < node_num; idx++) {
+        node_idx = node_idxs[idx];
+        if (!HDAG_RES_TRY(hdag_bundle_visited_add(&visited, node_idx,
+                                                  &state_idx))) {
+            node = hdag_bundle_node_const(bundle, node_idx);
+            if (hdag_darr_cappend_one(&states) == NULL ||
+                !hdag_heap_push(&heap, hdag_heap_key(node->generation,
+                                                     node_idx))) {
+                goto cleanup;
+            }
+            nonstale_num++;
+        }
+        state = hdag_darr_element(&states, state_idx);
+        state[1 + idx / 64] |= UINT64_C(1) << (idx % 64);
+    }
+
+    /*
+     * Walk the nodes in the order of descending generation, so each one
+     * comes out of the queue only after all the nodes it is reachable
+     * from, with its state complete. Stop once only the nodes reachable
+     * from the common ancestors found so far remain queued, as none of
+     * them can be a better one.
+     */
+    while (nonstale_num > 0) {
+        node_idx = hdag_heap_key_node_idx(hdag_heap_pop(&heap));
+        HDAG_RES_TRY(hdag_bundle_visited_add(&visited, node_idx,
+                                             &state_idx));
+        state = hdag_darr_element(&states, state_idx);
+
+        /* If the node is not reachable from an already found base */
+        if (!(state[0] & HDAG_BUNDLE_MERGE_BASES_STALE)) {
+            nonstale_num--;
+            /* If it's reachable from all heads, it's a base */
+            common = true;
+            for (idx = 0; idx < node_num && common; idx++) {
+                common = state[1 + idx / 64] >> (idx % 64) & 1;
+            }
+            if (common) {
+                if (hdag_darr_append_one(bases, &node_idx) == NULL) {
+                    goto cleanup;
+                }
+                base_num++;
+                state[0] |= HDAG_BUNDLE_MERGE_BASES_STALE;
+            }
+        }
+
+        /* Pass the heads and the staleness down to the targets */
+        target_num = hdag_bundle_targets_count(bundle, node_idx);
+        for (target_idx = 0; target_idx < target_num; target_idx++) {
+            target_node_idx = hdag_bundle_targets_node_idx(
+                bundle, node_idx, target_idx
+            );
+            if (!HDAG_RES_TRY(hdag_bundle_visited_add(&visited,
+                                                      target_node_idx,
+                                                      &target_state_idx))) {
+                node = hdag_bundle_node_const(bundle, target_node_idx);
+                if (hdag_darr_cappend_one(&states) == NULL ||
+                    !hdag_heap_push(&heap,
+                                    hdag_heap_key(node->generation,
+                                                  target_node_idx))) {
+                    goto cleanup;
+                }
+                nonstale_num++;
+                /* The states could have moved */
+                state = hdag_darr_element(&states, state_idx);
+            }
+            target_state = hdag_darr_element(&states, target_state_idx);
+            for (idx = 1; idx <= word_num; idx++) {
+                target_state[idx] |= state[idx];
+            }
+            if ((state[0] & HDAG_BUNDLE_MERGE_BASES_STALE) &&
+                !(target_state[0] & HDAG_BUNDLE_MERGE_BASES_STALE)) {
+                target_state[0] |= HDAG_BUNDLE_MERGE_BASES_STALE;
+                nonstale_num--;
+            }
+        }
+    }
+
+    res = base_num;
+cleanup:
+    free(visited.slots);
+    hdag_darr_cleanup(&states);
+    hdag_darr_cleanup(&heap);
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
+hdag_res
+hdag_bundle_merge_bases(const struct hdag_bundle *bundle,
+                        const uint8_t *hashes, size_t hash_num,
+                        struct hdag_darr *bases)
+{
+    hdag_res            res = HDAG_RES_INVALID;
+    struct hdag_darr    node_idxs = HDAG_DARR_EMPTY(sizeof(uint32_t), 0);
+    uint32_t           *node_idx;
+    size_t              idx;
+
+    assert(hdag_bundle_is_valid(bundle));
+    assert(hashes != NULL);
+    assert(hash_num > 0);
+
+    node_idx = hdag_darr_uappend(&node_idxs, hash_num);
+    if (node_idx == NULL) {
+        goto cleanup;
+    }
+    for (idx = 0; idx < hash_num; idx++, node_idx++) {
+        *node_idx = hdag_bundle_find_node_idx(
+            bundle, hashes + idx * bundle->hash_len
+        );
+        if (*node_idx >= INT32_MAX) {
+            res = HDAG_RES_ERRNO_ARG(ENOENT);
+            goto cleanup;
+        }
+    }
+    res = hdag_bundle_merge_bases_idx(bundle, node_idxs.slots, hash_num,
+                                      bases);
+cleanup:
+    hdag_darr_cleanup(&node_idxs);
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
+/**
+ * Check and set a node's bit in a bitmap of an ancestor sequence.
+ *
+ * @param bitmap    The bitmap words to check and set the bit in.
+ * @param node_idx  The index of the node to check and set the bit of.
+ *
+ * @return True if the bit was already set, false if it wasn't.
+ */
+static inline bool
+hdag_bundle_ancestor_seq_mark(uint64_t *bitmap, uint32_t node_idx)
+{
+    uint64_t *word = bitmap + node_idx / 64;
+    uint64_t bit = UINT64_C(1) << (node_idx % 64);
+    bool marked = *word & bit;
+    *word |= bit;
+    return marked;
+}
+
+/**
+ * Queue a node in an ancestor sequence, if not queued yet, and mark it
+ * excluded, if requested and not marked yet.
+ *
+ * @param seq       The ancestor sequence to queue the node in.
+ * @param node_idx  The index of the node to queue.
+ * @param exclude   True if the node should be marked excluded.
+ *
+ * @return True if the node was queued successfully, false if memory
+ *         allocation failed, and errno was set.
+ */
+static bool
+hdag_bundle_ancestor_seq_queue(struct hdag_bundle_ancestor_seq *seq,
+                               uint32_t node_idx, bool exclude)
+{
+    size_t word_num = seq->marks.slots_occupied / 2;
+    uint64_t *queued = seq->marks.slots;
+    uint64_t *excluded = queued + word_num;
+    bool was_queued;
+    bool was_excluded;
+
+    assert(node_idx < hdag_darr_occupied_slots(&seq->bundle->nodes));
+    assert(node_idx / 64 < word_num);
+
+    was_queued = hdag_bundle_ancestor_seq_mark(queued, node_idx);
+    was_excluded = exclude ? hdag_bundle_ancestor_seq_mark(excluded,
+                                                           node_idx)
+                           : excluded[node_idx / 64] >> (node_idx % 64) & 1;
+    if (!was_queued) {
+        if (!hdag_heap_push(&seq->heap, hdag_heap_key(
+                hdag_bundle_node_const(seq->bundle, node_idx)->generation,
+                node_idx
+            ))) {
+            return false;
+        }
+        seq->include_queued_num += !exclude;
+    } else if (exclude && !was_excluded) {
+        /*
+         * The node can't be dequeued yet, as all the nodes it is
+         * reachable from have higher generations
+         */
+        seq->include_queued_num--;
+    }
+    return true;
+}
+
+/**
+ * Queue the start nodes of an ancestor sequence, clearing its state left
+ * from the previous walk.
+ *
+ * @param seq   The ancestor sequence to queue the start nodes of.
+ *
+ * @return True if the nodes were queued successfully, false if memory
+ *         allocation failed, and errno was set.
+ */
+static bool
+hdag_bundle_ancestor_seq_queue_starts(struct hdag_bundle_ancestor_seq *seq)
+{
+    const uint32_t *start_idxs = seq->starts.slots;
+    size_t idx;
+
+    memset(seq->marks.slots, 0, hdag_darr_occupied_size(&seq->marks));
+    hdag_darr_empty(&seq->heap);
+    seq->include_queued_num = 0;
+    for (idx = 0; idx < seq->starts.slots_occupied; idx++) {
+        if (!hdag_bundle_ancestor_seq_queue(seq, start_idxs[idx],
+                                            idx >= seq->include_num)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+hdag_res
+hdag_bundle_ancestor_seq_next(struct hdag_node_seq *base_seq,
+                              const uint8_t **phash,
+                              struct hdag_hash_seq **ptarget_hash_seq)
+{
+    assert(hdag_node_seq_is_valid(base_seq));
+    assert(phash != NULL);
+    assert(ptarget_hash_seq != NULL);
+    struct hdag_bundle_ancestor_seq *seq = HDAG_CONTAINER_OF(
+        struct hdag_bundle_ancestor_seq, base, base_seq
+    );
+    const struct hdag_bundle *bundle = seq->bundle;
+    size_t word_num = seq->marks.slots_occupied / 2;
+    const uint64_t *excluded = (const uint64_t *)seq->marks.slots + word_num;
+    uint32_t node_idx;
+    uint32_t target_num;
+    uint32_t target_idx;
+    bool exclude;
+
+    assert(hdag_bundle_is_valid(bundle));
+    assert(base_seq->hash_len == bundle->hash_len);
+
+    /*
+     * Walk the nodes in the order of descending generation, so each one
+     * comes out of the queue only after all the nodes it is reachable
+     * from, and is known to be excluded, or not. Stop once only the
+     * excluded nodes remain queued.
+     */
+    while (seq->include_queued_num > 0) {
+        node_idx = hdag_heap_key_node_idx(hdag_heap_pop(&seq->heap));
+        exclude = excluded[node_idx / 64] >> (node_idx % 64) & 1;
+        seq->include_queued_num -= !exclude;
+
+        /* Queue the targets, passing the exclusion down */
+        target_num = hdag_bundle_targets_count(bundle, node_idx);
+        for (target_idx = 0; target_idx < target_num; target_idx++) {
+            if (!hdag_bundle_ancestor_seq_queue(
+                    seq,
+                    hdag_bundle_targets_node_idx(bundle, node_idx,
+                                                 target_idx),
+                    exclude
+                )) {
+                return HDAG_RES_ERRNO;
+            }
+        }
+
+        if (!exclude) {
+            *phash = HDAG_BUNDLE_NODE(bundle, node_idx)->hash;
+            *ptarget_hash_seq = hdag_bundle_targets_hash_seq_init(
+                &seq->targets_hash_seq, bundle, node_idx
+            );
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void
+hdag_bundle_ancestor_seq_reset(struct hdag_node_seq *base_seq)
+{
+    assert(hdag_node_seq_is_valid(base_seq));
+    struct hdag_bundle_ancestor_seq *seq = HDAG_CONTAINER_OF(
+        struct hdag_bundle_ancestor_seq, base, base_seq
+    );
+    assert(hdag_bundle_is_valid(seq->bundle));
+    assert(base_seq->hash_len == seq->bundle->hash_len);
+    /* Can't fail, as the heap has been grown to fit the start nodes */
+    bool queued = hdag_bundle_ancestor_seq_queue_starts(seq);
+    assert(queued);
+    (void)queued;
+}
+
+struct hdag_node_seq *
+hdag_bundle_ancestor_seq_init(struct hdag_bundle_ancestor_seq *pseq,
+                              const struct hdag_bundle *bundle)
+{
+    assert(pseq != NULL);
+    assert(hdag_bundle_is_valid(bundle));
+    assert(hdag_bundle_is_compacted(bundle));
+    assert(hdag_bundle_is_enumerated(bundle));
+
+    *pseq = (struct hdag_bundle_ancestor_seq){
+        .base = {
+            .hash_len = bundle->hash_len,
+            .reset_fn = hdag_bundle_ancestor_seq_reset,
+            .next_fn = hdag_bundle_ancestor_seq_next,
+        },
+        .bundle = bundle,
+        .starts = HDAG_DARR_EMPTY(sizeof(uint32_t), 16),
+        .marks = HDAG_DARR_EMPTY(sizeof(uint64_t), 0),
+        .heap = HDAG_HEAP_EMPTY,
+    };
+
+    assert(hdag_node_seq_is_valid(&pseq->base));
+    assert(hdag_node_seq_is_resettable(&pseq->base));
+    return &pseq->base;
+}
+
+hdag_res
+hdag_bundle_ancestor_seq_start(struct hdag_bundle_ancestor_seq *seq,
+                               const uint32_t *include_idxs,
+                               size_t include_num,
+                               const uint32_t *exclude_idxs,
+                               size_t exclude_num)
+{
+    hdag_res res = HDAG_RES_INVALID;
+    size_t word_num;
+
+    assert(seq != NULL);
+    assert(hdag_bundle_is_valid(seq->bundle));
+    assert(include_idxs != NULL || include_num == 0);
+    assert(exclude_idxs != NULL || exclude_num == 0);
+
+    word_num = (hdag_darr_occupied_slots(&seq->bundle->nodes) + 63) / 64;
+    hdag_darr_empty(&seq->starts);
+    if (hdag_darr_is_empty(&seq->marks) &&
+        hdag_darr_uappend(&seq->marks, word_num * 2) == NULL) {
+        goto cleanup;
+    }
+    if ((include_num != 0 &&
+         hdag_darr_append(&seq->starts, include_idxs, include_num) == NULL) ||
+        (exclude_num != 0 &&
+         hdag_darr_append(&seq->starts, exclude_idxs, exclude_num) == NULL)) {
+        goto cleanup;
+    }
+    seq->include_num = include_num;
+    if (!hdag_bundle_ancestor_seq_queue_starts(seq)) {
+        goto cleanup;
+    }
+    res = HDAG_RES_OK;
+cleanup:
+    if (res != HDAG_RES_OK) {
+        hdag_darr_empty(&seq->starts);
+        hdag_darr_empty(&seq->heap);
+        seq->include_num = 0;
+        seq->include_queued_num = 0;
+    }
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
+void
+hdag_bundle_ancestor_seq_cleanup(struct hdag_bundle_ancestor_seq *seq)
+{
+    assert(seq != NULL);
+    hdag_darr_cleanup(&seq->heap);
+    hdag_darr_cleanup(&seq->marks);
+    hdag_darr_cleanup(&seq->starts);
+    seq->include_num = 0;
+    seq->include_queued_num = 0;
+}
+
+/**
+ * Set the fix status of the nodes marked in a bitmap, unless it's set
+ * already.
+ *
+ * @param fixes     The array of fix statuses of the nodes.
+ * @param bitmap    The bitmap of the nodes to set the status of.
+ * @param word_num  The number of words in the bitmap.
+ * @param fix       The fix status to set.
+ */
+static void
+hdag_bundle_issue_fixes_set(enum hdag_fix *fixes, const uint64_t *bitmap,
+                            size_t word_num, enum hdag_fix fix)
+{
+    size_t      word_idx;
+    uint64_t    word;
+    size_t      idx;
+
+    for (word_idx = 0; word_idx < word_num; word_idx++) {
+        for (word = bitmap[word_idx]; word != 0; word &= word - 1) {
+            idx = word_idx * 64 + __builtin_ctzll(word);
+            if (fixes[idx] == HDAG_FIX_UNKNOWN) {
+                fixes[idx] = fix;
+            }
+        }
+    }
+}
+
+hdag_res
+hdag_bundle_issue_fixes_idx(const struct hdag_bundle *bundle,
+                            const uint8_t *mentions,
+                            const uint32_t *node_idxs, size_t node_num,
+                            enum hdag_fix *fixes)
+{
+    hdag_res                    res = HDAG_RES_INVALID;
+    struct hdag_darr            heap = HDAG_HEAP_EMPTY;
+    /* The ancestors of the nodes, down to the closest mentions */
+    struct hdag_bundle_visited  visited = HDAG_BUNDLE_VISITED_EMPTY;
+    /*
+     * The bitmaps of the nodes each visited node is reachable from,
+     * without passing mentions, in the order of visiting
+     */
+    struct hdag_darr            states;
+    /* The ancestors of the closest mentions having the issue absent */
+    struct hdag_bundle_visited  masked = HDAG_BUNDLE_VISITED_EMPTY;
+    /*
+     * The bitmaps of the nodes, which closest "absent" mentions each
+     * masked node is reachable from, in the order of masking
+     */
+    struct hdag_darr            masks;
+    /*
+     * The indexes of the closest mentions having the issue present,
+     * followed by the ones having it absent
+     */
+    struct hdag_darr            closest[2] = {
+        HDAG_DARR_EMPTY(sizeof(uint32_t), 16),
+        HDAG_DARR_EMPTY(sizeof(uint32_t), 16),
+    };
+    size_t                      word_num = (node_num + 63) / 64;
+    /* The number of the closest "present" mentions not yet masked */
+    size_t                      present_num;
+    /* The minimum generation of the closest "present" mentions */
+    uint32_t                    min_generation = UINT32_MAX;
+    const struct hdag_node     *node;
+    const uint64_t             *mask;
+    uint64_t                   *state;
+    uint64_t                   *target_state;
+    uint32_t                    node_idx;
+    uint32_t                    state_idx;
+    uint32_t                    target_num;
+    uint32_t                    target_idx;
+    uint32_t                    target_node_idx;
+    uint32_t                    target_state_idx;
+    size_t                      idx;
+    size_t                      word_idx;
+
+    assert(hdag_bundle_is_valid(bundle));
+    assert(mentions != NULL);
+    assert(node_idxs != NULL || node_num == 0);
+    assert(fixes != NULL || node_num == 0);
+
+    if (node_num == 0) {
+        return HDAG_RES_OK;
+    }
+    states = HDAG_DARR_EMPTY(sizeof(uint64_t) * word_num, 64);
+    masks = HDAG_DARR_EMPTY(sizeof(uint64_t) * word_num, 64);
+
+    /*
+     * Deduce the status at the mentioned nodes right away, and queue the
+     * rest, marking each as reachable from itself
+     */
+    for (idx = 0; idx < node_num; idx++) {
+        node_idx = node_idxs[idx];
+        assert(node_idx < hdag_darr_occupied_slots(&bundle->nodes));
+        assert(hdag_mention_is_valid(mentions[node_idx]));
+        fixes[idx] = HDAG_FIX_UNKNOWN;
+        if (mentions[node_idx] != HDAG_MENTION_NONE) {
+            fixes[idx] = mentions[node_idx] == HDAG_MENTION_ABSENT
+                ? HDAG_FIX_DEFINITE : HDAG_FIX_NOT;
+            continue;
+        }
+        if (!HDAG_RES_TRY(hdag_bundle_visited_add(&visited, node_idx,
+                                                  &state_idx))) {
+            node = hdag_bundle_node_const(bundle, node_idx);
+            if (hdag_darr_cappend_one(&states) == NULL ||
+                !hdag_heap_push(&heap, hdag_heap_key(node->generation,
+                                                     node_idx))) {
+                goto cleanup;
+            }
+        }
+        state = hdag_darr_element(&states, state_idx);
+        state[idx / 64] |= UINT64_C(1) << (idx % 64);
+    }
+
+    /*
+     * Walk the nodes in the order of descending generation, so each one
+     * comes out of the queue only after all the nodes it is reachable
+     * from, with its state complete. Stop at the mentions, as they're the
+     * closest ones for all the nodes they're reachable from.
+     */
+    while (!hdag_darr_is_empty(&heap)) {
+        node_idx = hdag_heap_key_node_idx(hdag_heap_pop(&heap));
+        HDAG_RES_TRY(hdag_bundle_visited_add(&visited, node_idx,
+                                             &state_idx));
+
+        if (mentions[node_idx] != HDAG_MENTION_NONE) {
+            assert(hdag_mention_is_valid(mentions[node_idx]));
+            if (hdag_darr_append_one(
+                    &closest[mentions[node_idx] == HDAG_MENTION_ABSENT],
+                    &node_idx
+                ) == NULL) {
+                goto cleanup;
+            }
+            if (mentions[node_idx] == HDAG_MENTION_PRESENT) {
+                min_generation = MIN(
+                    min_generation,
+                    hdag_bundle_node_const(bundle, node_idx)->generation
+                );
+            }
+            continue;
+        }
+
+        /* Pass the reaching nodes down to the targets */
+        target_num = hdag_bundle_targets_count(bundle, node_idx);
+        for (target_idx = 0; target_idx < target_num; target_idx++) {
+            target_node_idx = hdag_bundle_targets_node_idx(
+                bundle, node_idx, target_idx
+            );
+            if (!HDAG_RES_TRY(hdag_bundle_visited_add(&visited,
+                                                      target_node_idx,
+                                                      &target_state_idx))) {
+                node = hdag_bundle_node_const(bundle, target_node_idx);
+                if (hdag_darr_cappend_one(&states) == NULL ||
+                    !hdag_heap_push(&heap,
+                                    hdag_heap_key(node->generation,
+                                                  target_node_idx))) {
+                    goto cleanup;
+                }
+            }
+            /* The states could have moved */
+            state = hdag_darr_element(&states, state_idx);
+            target_state = hdag_darr_element(&states, target_state_idx);
+            for (word_idx = 0; word_idx < word_num; word_idx++) {
+                target_state[word_idx] |= state[word_idx];
+            }
+        }
+    }
+
+    /*
+     * Queue the closest "absent" mentions, marking each as masking the
+     * closest "present" mentions reachable from it, for the nodes it's
+     * closest to
+     */
+    present_num = hdag_darr_occupied_slots(&closest[0]);
+    for (idx = 0;
+         present_num > 0 && idx < hdag_darr_occupied_slots(&closest[1]);
+         idx++) {
+        node_idx = *(uint32_t *)hdag_darr_element(&closest[1], idx);
+        HDAG_RES_TRY(hdag_bundle_visited_add(&visited, node_idx,
+                                             &state_idx));
+        node = hdag_bundle_node_const(bundle, node_idx);
+        if (node->generation < min_generation) {
+            continue;
+        }
+        HDAG_RES_TRY(hdag_bundle_visited_add(&masked, node_idx,
+                                             &target_state_idx));
+        if (hdag_darr_append(&masks, hdag_darr_element(&states, state_idx),
+                             1) == NULL ||
+            !hdag_heap_push(&heap, hdag_heap_key(node->generation,
+                                                 node_idx))) {
+            goto cleanup;
+        }
+    }
+
+    /*
+     * Walk the ancestors of the closest "absent" mentions in the order of
+     * descending generation, passing the masks down, until all the
+     * closest "present" mentions are passed, or can't be reached anymore
+     */
+    while (present_num > 0 && !hdag_darr_is_empty(&heap)) {
+        node_idx = hdag_heap_key_node_idx(hdag_heap_pop(&heap));
+        HDAG_RES_TRY(hdag_bundle_visited_add(&masked, node_idx,
+                                             &state_idx));
+        if (mentions[node_idx] == HDAG_MENTION_PRESENT &&
+            *hdag_bundle_visited_find(&visited, node_idx) != 0) {
+            present_num--;
+        }
+
+        target_num = hdag_bundle_targets_count(bundle, node_idx);
+        for (target_idx = 0; target_idx < target_num; target_idx++) {
+            target_node_idx = hdag_bundle_targets_node_idx(
+                bundle, node_idx, target_idx
+            );
+            node = hdag_bundle_node_const(bundle, target_node_idx);
+            if (node->generation < min_generation) {
+                continue;
+            }
+            if (!HDAG_RES_TRY(hdag_bundle_visited_add(&masked,
+                                                      target_node_idx,
+                                                      &target_state_idx))) {
+                if (hdag_darr_cappend_one(&masks) == NULL ||
+                    !hdag_heap_push(&heap,
+                                    hdag_heap_key(node->generation,
+                                                  target_node_idx))) {
+                    goto cleanup;
+                }
+            }
+            /* The masks could have moved */
+            state = hdag_darr_element(&masks, state_idx);
+            target_state = hdag_darr_element(&masks, target_state_idx);
+            for (word_idx = 0; word_idx < word_num; word_idx++) {
+                target_state[word_idx] |= state[word_idx];
+            }
+        }
+    }
+
+    /*
+     * The issue is not fixed at the nodes, which have the closest
+     * "present" mentions not masked for them, ignoring the masked ones
+     */
+    for (idx = 0; idx < hdag_darr_occupied_slots(&closest[0]); idx++) {
+        node_idx = *(uint32_t *)hdag_darr_element(&closest[0], idx);
+        HDAG_RES_TRY(hdag_bundle_visited_add(&visited, node_idx,
+                                             &state_idx));
+        state = hdag_darr_element(&states, state_idx);
+        if (masked.slots != NULL &&
+            *hdag_bundle_visited_find(&masked, node_idx) != 0) {
+            HDAG_RES_TRY(hdag_bundle_visited_add(&masked, node_idx,
+                                                 &target_state_idx));
+            mask = hdag_darr_element(&masks, target_state_idx);
+            for (word_idx = 0; word_idx < word_num; word_idx++) {
+                state[word_idx] &= ~mask[word_idx];
+            }
+        }
+        hdag_bundle_issue_fixes_set(fixes, state, word_num, HDAG_FIX_NOT);
+    }
+
+    /*
+     * The issue is likely fixed at the rest of the nodes with closest
+     * "absent" mentions, as they mask all their "present" ones
+     */
+    for (idx = 0; idx < hdag_darr_occupied_slots(&closest[1]); idx++) {
+        node_idx = *(uint32_t *)hdag_darr_element(&closest[1], idx);
+        HDAG_RES_TRY(hdag_bundle_visited_add(&visited, node_idx,
+                                             &state_idx));
+        hdag_bundle_issue_fixes_set(fixes,
+                                    hdag_darr_element(&states, state_idx),
+                                    word_num, HDAG_FIX_LIKELY);
+    }
+
+    res = HDAG_RES_OK;
+cleanup:
+    free(masked.slots);
+    free(visited.slots);
+    hdag_darr_cleanup(&closest[1]);
+    hdag_darr_cleanup(&closest[0]);
+    hdag_darr_cleanup(&masks);
+    hdag_darr_cleanup(&states);
+    hdag_darr_cleanup(&heap);
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
+hdag_res
+hdag_bundle_issue_fixes(const struct hdag_bundle *bundle,
+                        const uint8_t *mentions,
+                        const uint8_t *hashes, size_t hash_num,
+                        enum hdag_fix *fixes)
+{
+    hdag_res            res = HDAG_RES_INVALID;
+    struct hdag_darr    node_idxs = HDAG_DARR_EMPTY(sizeof(uint32_t), 0);
+    uint32_t           *node_idx;
+    size_t              idx;
+
+    assert(hdag_bundle_is_valid(bundle));
+    assert(hashes != NULL || hash_num == 0);
+
+    if (hash_num == 0) {
+        return HDAG_RES_OK;
+    }
+    node_idx = hdag_darr_uappend(&node_idxs, hash_num);
+    if (node_idx == NULL) {
+        goto cleanup;
+    }
+    for (idx = 0; idx < hash_num; idx++, node_idx++) {
+        *node_idx = hdag_bundle_find_node_idx(
+            bundle, hashes + idx * bundle->hash_len
+        );
+        if (*node_idx >= INT32_MAX) {
+            res = HDAG_RES_ERRNO_ARG(ENOENT);
+            goto cleanup;
+        }
+    }
+    res = hdag_bundle_issue_fixes_idx(bundle, mentions, node_idxs.slots,
+                                      hash_num, fixes);
+cleanup:
+    hdag_darr_cleanup(&node_idxs);
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
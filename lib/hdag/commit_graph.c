@@ -0,0 +1,592 @@
+/*
+ * Hash DAG git commit-graph reader
+ */
+
+#include <hdag/commit_graph.h>
+#include <hdag/misc.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+/** The size of the commit-graph file header, bytes */
+#define HDAG_COMMIT_GRAPH_HEADER_SIZE       8
+/** The size of a chunk lookup table entry, bytes */
+#define HDAG_COMMIT_GRAPH_CHUNK_ENTRY_SIZE  12
+
+/** Chunk IDs */
+#define HDAG_COMMIT_GRAPH_CHUNK_OIDF    (uint32_t)0x4f494446
+#define HDAG_COMMIT_GRAPH_CHUNK_OIDL    (uint32_t)0x4f49444c
+#define HDAG_COMMIT_GRAPH_CHUNK_CDAT    (uint32_t)0x43444154
+#define HDAG_COMMIT_GRAPH_CHUNK_EDGE    (uint32_t)0x45444745
+
+/** The parent position signifying there's no parent */
+#define HDAG_COMMIT_GRAPH_PARENT_NONE   (uint32_t)0x70000000
+/** The second parent flag signifying the parents are in extra edges */
+#define HDAG_COMMIT_GRAPH_EXTRA_EDGES   (uint32_t)0x80000000
+/** The extra edge flag marking the last parent */
+#define HDAG_COMMIT_GRAPH_LAST_EDGE     (uint32_t)0x80000000
+/** The mask for the position/index part of a parent value */
+#define HDAG_COMMIT_GRAPH_POS_MASK      (uint32_t)0x7fffffff
+
+/**
+ * Read a big-endian 32-bit unsigned integer.
+ *
+ * @param ptr   The pointer to the integer to read.
+ *
+ * @return The read integer.
+ */
+static inline uint32_t
+hdag_commit_graph_be32(const uint8_t *ptr)
+{
+    return (uint32_t)ptr[0] << 24 | (uint32_t)ptr[1] << 16 |
+           (uint32_t)ptr[2] << 8 | (uint32_t)ptr[3];
+}
+
+/**
+ * Read a big-endian 64-bit unsigned integer.
+ *
+ * @param ptr   The pointer to the integer to read.
+ *
+ * @return The read integer.
+ */
+static inline uint64_t
+hdag_commit_graph_be64(const uint8_t *ptr)
+{
+    return (uint64_t)hdag_commit_graph_be32(ptr) << 32 |
+           hdag_commit_graph_be32(ptr + 4);
+}
+
+hdag_res
+hdag_commit_graph_add_mem(struct hdag_commit_graph *graph,
+                          const void *ptr, size_t len)
+{
+    const uint8_t *bytes = ptr;
+    const struct hdag_commit_graph_layer *base;
+    struct hdag_commit_graph_layer layer = {0, };
+    uint16_t hash_len;
+    unsigned int chunk_num;
+    const uint8_t *entry;
+    const uint8_t *fanout = NULL;
+    uint64_t offset;
+    uint64_t next_offset;
+    uint64_t size;
+    uint64_t oids_size = 0;
+    uint64_t data_size = 0;
+    uint64_t edges_size = 0;
+    uint64_t total_commit_num;
+    unsigned int i;
+
+    assert(hdag_commit_graph_is_valid(graph));
+    assert(ptr != NULL || len == 0);
+
+    /* Check the header */
+    if (len < HDAG_COMMIT_GRAPH_HEADER_SIZE ||
+        hdag_commit_graph_be32(bytes) != HDAG_COMMIT_GRAPH_SIGNATURE ||
+        bytes[4] != 1) {
+        return HDAG_RES_INVALID_FORMAT;
+    }
+    switch (bytes[5]) {
+    case 1:
+        hash_len = 20;
+        break;
+    case 2:
+        hash_len = 32;
+        break;
+    default:
+        return HDAG_RES_INVALID_FORMAT;
+    }
+    if ((graph->hash_len != 0 && hash_len != graph->hash_len) ||
+        bytes[7] != graph->layers.slots_occupied) {
+        return HDAG_RES_INVALID_FORMAT;
+    }
+    chunk_num = bytes[6];
+
+    /* Locate the chunks, using the lookup table */
+    if (len < HDAG_COMMIT_GRAPH_HEADER_SIZE +
+              (size_t)(chunk_num + 1) * HDAG_COMMIT_GRAPH_CHUNK_ENTRY_SIZE) {
+        return HDAG_RES_INVALID_FORMAT;
+    }
+    entry = bytes + HDAG_COMMIT_GRAPH_HEADER_SIZE;
+    for (i = 0; i < chunk_num; i++, entry += HDAG_COMMIT_GRAPH_CHUNK_ENTRY_SIZE) {
+        offset = hdag_commit_graph_be64(entry + 4);
+        next_offset = hdag_commit_graph_be64(
+            entry + HDAG_COMMIT_GRAPH_CHUNK_ENTRY_SIZE + 4
+        );
+        if (offset < HDAG_COMMIT_GRAPH_HEADER_SIZE +
+                     (chunk_num + 1) * HDAG_COMMIT_GRAPH_CHUNK_ENTRY_SIZE ||
+            offset > next_offset || next_offset > len) {
+            return HDAG_RES_INVALID_FORMAT;
+        }
+        size = next_offset - offset;
+        switch (hdag_commit_graph_be32(entry)) {
+        case HDAG_COMMIT_GRAPH_CHUNK_OIDF:
+            if (size != 256 * 4) {
+                return HDAG_RES_INVALID_FORMAT;
+            }
+            fanout = bytes + offset;
+            break;
+        case HDAG_COMMIT_GRAPH_CHUNK_OIDL:
+            layer.oids = bytes + offset;
+            oids_size = size;
+            break;
+        case HDAG_COMMIT_GRAPH_CHUNK_CDAT:
+            layer.data = bytes + offset;
+            data_size = size;
+            break;
+        case HDAG_COMMIT_GRAPH_CHUNK_EDGE:
+            layer.edges = bytes + offset;
+            edges_size = size;
+            break;
+        default:
+            /* Ignore the chunks we don't need */
+            break;
+        }
+    }
+    if (fanout == NULL || layer.oids == NULL || layer.data == NULL) {
+        return HDAG_RES_INVALID_FORMAT;
+    }
+
+    /* Check the fanout and the chunk sizes match */
+    for (i = 1; i < 256; i++) {
+        if (hdag_commit_graph_be32(fanout + i * 4) <
+            hdag_commit_graph_be32(fanout + (i - 1) * 4)) {
+            return HDAG_RES_INVALID_FORMAT;
+        }
+    }
+    layer.commit_num = hdag_commit_graph_be32(fanout + 255 * 4);
+    if (oids_size != (uint64_t)layer.commit_num * hash_len ||
+        data_size != (uint64_t)layer.commit_num * (hash_len + 16) ||
+        edges_size % 4 != 0) {
+        return HDAG_RES_INVALID_FORMAT;
+    }
+    layer.edge_num = edges_size / 4;
+
+    /* Place the layer on top of the base ones */
+    if (graph->layers.slots_occupied != 0) {
+        base = hdag_darr_element_const(&graph->layers,
+                                       graph->layers.slots_occupied - 1);
+        layer.base_commit_num = base->base_commit_num + base->commit_num;
+    }
+    total_commit_num = (uint64_t)layer.base_commit_num + layer.commit_num;
+    if (total_commit_num >= HDAG_COMMIT_GRAPH_PARENT_NONE) {
+        return HDAG_RES_INVALID_FORMAT;
+    }
+
+    if (hdag_darr_append_one(&graph->layers, &layer) == NULL) {
+        return HDAG_RES_ERRNO;
+    }
+    graph->hash_len = hash_len;
+    assert(hdag_commit_graph_is_valid(graph));
+    return HDAG_RES_OK;
+}
+
+/**
+ * Memory-map a commit-graph file and add it as the next layer of a
+ * commit-graph.
+ *
+ * @param graph     The commit-graph to add the layer to.
+ * @param pathname  The path to the commit-graph file.
+ *
+ * @return A void universal result, including HDAG_RES_INVALID_FORMAT, if
+ *         the file is invalid.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_commit_graph_add_file(struct hdag_commit_graph *graph,
+                           const char *pathname)
+{
+    hdag_res res = HDAG_RES_INVALID;
+    int orig_errno;
+    int fd = -1;
+    struct stat st;
+    void *map = MAP_FAILED;
+    size_t map_size = 0;
+    struct hdag_commit_graph_layer *layer;
+
+    assert(hdag_commit_graph_is_valid(graph));
+    assert(pathname != NULL);
+
+    fd = open(pathname, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        goto cleanup;
+    }
+    if ((uintmax_t)st.st_size > SIZE_MAX) {
+        errno = EFBIG;
+        goto cleanup;
+    }
+    map_size = st.st_size;
+    if (map_size < HDAG_COMMIT_GRAPH_HEADER_SIZE) {
+        res = HDAG_RES_INVALID_FORMAT;
+        goto cleanup;
+    }
+    map = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        goto cleanup;
+    }
+
+    HDAG_RES_TRY(hdag_commit_graph_add_mem(graph, map, map_size));
+    /* Hand the mapping over to the added layer */
+    layer = hdag_darr_element(&graph->layers,
+                              graph->layers.slots_occupied - 1);
+    layer->map = map;
+    layer->map_size = map_size;
+    map = MAP_FAILED;
+    res = HDAG_RES_OK;
+
+cleanup:
+    orig_errno = errno;
+    if (map != MAP_FAILED) {
+        munmap(map, map_size);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    errno = orig_errno;
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
+/**
+ * Add the layers listed in a split commit-graph chain file to a
+ * commit-graph.
+ *
+ * @param graph     The commit-graph to add the layers to.
+ * @param dir       The path to the directory containing the chain file,
+ *                  and the commit-graph files.
+ *
+ * @return A void universal result, including HDAG_RES_INVALID_FORMAT, if
+ *         the chain file, or a commit-graph file is invalid.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_commit_graph_add_chain(struct hdag_commit_graph *graph,
+                            const char *dir)
+{
+    hdag_res res = HDAG_RES_INVALID;
+    int orig_errno;
+    char *pathname = NULL;
+    FILE *chain = NULL;
+    char *line = NULL;
+    size_t line_size = 0;
+    ssize_t line_len;
+    ssize_t i;
+
+    assert(hdag_commit_graph_is_valid(graph));
+    assert(dir != NULL);
+
+    if (asprintf(&pathname, "%s/commit-graph-chain", dir) < 0) {
+        pathname = NULL;
+        goto cleanup;
+    }
+    chain = fopen(pathname, "r");
+    if (chain == NULL) {
+        goto cleanup;
+    }
+
+    /* For each commit-graph file hash, base first */
+    while ((line_len = getline(&line, &line_size, chain)) >= 0) {
+        if (line_len > 0 && line[line_len - 1] == '\n') {
+            line[--line_len] = '\0';
+        }
+        /* Check it's a SHA-1 or a SHA-256 hex hash */
+        if (line_len != 40 && line_len != 64) {
+            res = HDAG_RES_INVALID_FORMAT;
+            goto cleanup;
+        }
+        for (i = 0; i < line_len; i++) {
+            if (!((line[i] >= '0' && line[i] <= '9') ||
+                  (line[i] >= 'a' && line[i] <= 'f'))) {
+                res = HDAG_RES_INVALID_FORMAT;
+                goto cleanup;
+            }
+        }
+        free(pathname);
+        if (asprintf(&pathname, "%s/graph-%s.graph", dir, line) < 0) {
+            pathname = NULL;
+            goto cleanup;
+        }
+        HDAG_RES_TRY(hdag_commit_graph_add_file(graph, pathname));
+    }
+    if (ferror(chain)) {
+        goto cleanup;
+    }
+    if (graph->layers.slots_occupied == 0) {
+        res = HDAG_RES_INVALID_FORMAT;
+        goto cleanup;
+    }
+    res = HDAG_RES_OK;
+
+cleanup:
+    orig_errno = errno;
+    if (chain != NULL) {
+        fclose(chain);
+    }
+    free(line);
+    free(pathname);
+    errno = orig_errno;
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
+hdag_res
+hdag_commit_graph_open(struct hdag_commit_graph *pgraph,
+                       const char *objects_dir)
+{
+    hdag_res res = HDAG_RES_INVALID;
+    struct hdag_commit_graph graph = HDAG_COMMIT_GRAPH_EMPTY;
+    char *pathname = NULL;
+
+    assert(pgraph != NULL);
+    assert(objects_dir != NULL);
+
+    /* Try the single commit-graph file first, the way git does */
+    if (asprintf(&pathname, "%s/info/commit-graph", objects_dir) < 0) {
+        pathname = NULL;
+        goto cleanup;
+    }
+    res = hdag_commit_graph_add_file(&graph, pathname);
+    /* If there's none, try the split commit-graph chain */
+    if (res == HDAG_RES_ERRNO && errno == ENOENT) {
+        free(pathname);
+        if (asprintf(&pathname, "%s/info/commit-graphs", objects_dir) < 0) {
+            pathname = NULL;
+            res = HDAG_RES_INVALID;
+            goto cleanup;
+        }
+        res = hdag_commit_graph_add_chain(&graph, pathname);
+    }
+    HDAG_RES_TRY(res);
+
+    *pgraph = graph;
+    graph = HDAG_COMMIT_GRAPH_EMPTY;
+    res = HDAG_RES_OK;
+
+cleanup:
+    free(pathname);
+    hdag_commit_graph_close(&graph);
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
+/**
+ * Get the commit OID at a commit-graph position, looking only at the
+ * specified layer and its bases.
+ *
+ * @param graph     The commit-graph to get the OID from.
+ * @param layer_num The number of the layers to look at, from the base.
+ * @param pos       The position of the commit.
+ *
+ * @return The pointer to the commit OID, or NULL if the position is
+ *         out of range.
+ */
+static const uint8_t *
+hdag_commit_graph_layers_oid(const struct hdag_commit_graph *graph,
+                             size_t layer_num, uint32_t pos)
+{
+    const struct hdag_commit_graph_layer *layer;
+
+    assert(hdag_commit_graph_is_valid(graph));
+    assert(layer_num <= graph->layers.slots_occupied);
+
+    /* Parents are most often in the same layer, so start from the top */
+    while (layer_num-- > 0) {
+        layer = hdag_darr_element_const(&graph->layers, layer_num);
+        if (pos >= layer->base_commit_num) {
+            pos -= layer->base_commit_num;
+            return pos < layer->commit_num
+                ? layer->oids + (size_t)pos * graph->hash_len
+                : NULL;
+        }
+    }
+    return NULL;
+}
+
+const uint8_t *
+hdag_commit_graph_oid(const struct hdag_commit_graph *graph, uint32_t pos)
+{
+    assert(hdag_commit_graph_is_valid(graph));
+    return hdag_commit_graph_layers_oid(graph,
+                                        graph->layers.slots_occupied, pos);
+}
+
+void
+hdag_commit_graph_close(struct hdag_commit_graph *graph)
+{
+    struct hdag_commit_graph_layer *layer;
+    ssize_t idx;
+
+    assert(hdag_commit_graph_is_valid(graph));
+
+    HDAG_DARR_ITER_FORWARD(&graph->layers, idx, layer, (void)0, (void)0) {
+        if (layer->map != NULL) {
+            munmap(layer->map, layer->map_size);
+        }
+    }
+    hdag_darr_cleanup(&graph->layers);
+    graph->hash_len = 0;
+    assert(hdag_commit_graph_is_valid(graph));
+}
+
+/**
+ * Return the next parent OID of a commit from a commit-graph.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_commit_graph_node_seq_target_hash_seq_next(
+                                    struct hdag_hash_seq *hash_seq,
+                                    const uint8_t **phash)
+{
+    struct hdag_commit_graph_node_seq *seq = HDAG_CONTAINER_OF(
+        struct hdag_commit_graph_node_seq, target_hash_seq, hash_seq
+    );
+    /* The parent positions in the Commit Data */
+    const uint8_t *parents = seq->data + hash_seq->hash_len;
+    uint32_t pos;
+
+    assert(hdag_hash_seq_is_valid(hash_seq));
+    assert(phash != NULL);
+
+    switch (seq->parent_state) {
+    case 0:
+        /* Get the first parent, if any */
+        pos = hdag_commit_graph_be32(parents);
+        if (pos == HDAG_COMMIT_GRAPH_PARENT_NONE) {
+            seq->parent_state = 3;
+            return 1;
+        }
+        seq->parent_state = 1;
+        break;
+    case 1:
+        /* Get the second parent, if any, or start the extra edges */
+        pos = hdag_commit_graph_be32(parents + 4);
+        if (pos == HDAG_COMMIT_GRAPH_PARENT_NONE) {
+            seq->parent_state = 3;
+            return 1;
+        }
+        if (!(pos & HDAG_COMMIT_GRAPH_EXTRA_EDGES)) {
+            seq->parent_state = 3;
+            break;
+        }
+        seq->edge_idx = pos & HDAG_COMMIT_GRAPH_POS_MASK;
+        seq->parent_state = 2;
+        return hdag_commit_graph_node_seq_target_hash_seq_next(hash_seq,
+                                                               phash);
+    case 2:
+        /* Get the next parent from the extra edges */
+        if (seq->edge_idx >= seq->layer->edge_num) {
+            return HDAG_RES_INVALID_FORMAT;
+        }
+        pos = hdag_commit_graph_be32(seq->layer->edges +
+                                     (size_t)seq->edge_idx * 4);
+        seq->edge_idx++;
+        if (pos & HDAG_COMMIT_GRAPH_LAST_EDGE) {
+            seq->parent_state = 3;
+        }
+        pos &= HDAG_COMMIT_GRAPH_POS_MASK;
+        break;
+    default:
+        return 1;
+    }
+
+    /* Parents can only be in the commit's layer, or its bases */
+    *phash = hdag_commit_graph_layers_oid(seq->graph, seq->layer_idx + 1,
+                                          pos);
+    return *phash == NULL ? HDAG_RES_INVALID_FORMAT : HDAG_RES_OK;
+}
+
+hdag_res
+hdag_commit_graph_node_seq_next(struct hdag_node_seq *base_seq,
+                                const uint8_t **phash,
+                                struct hdag_hash_seq **ptarget_hash_seq)
+{
+    struct hdag_commit_graph_node_seq *seq = HDAG_CONTAINER_OF(
+        struct hdag_commit_graph_node_seq, base, base_seq
+    );
+    const struct hdag_commit_graph *graph = seq->graph;
+    const struct hdag_commit_graph_layer *layer;
+
+    assert(hdag_node_seq_is_valid(base_seq));
+    assert(phash != NULL);
+    assert(ptarget_hash_seq != NULL);
+
+    /* Find the layer with the next commit, if any */
+    while (true) {
+        if (seq->layer_idx >= graph->layers.slots_occupied) {
+            return 1;
+        }
+        layer = hdag_darr_element_const(&graph->layers, seq->layer_idx);
+        if (seq->commit_idx < layer->commit_num) {
+            break;
+        }
+        seq->layer_idx++;
+        seq->commit_idx = 0;
+    }
+
+    /* Start traversing the commit's parents */
+    seq->layer = layer;
+    seq->data = layer->data +
+                (size_t)seq->commit_idx * (graph->hash_len + 16);
+    seq->parent_state = 0;
+    seq->edge_idx = 0;
+
+    *phash = layer->oids + (size_t)seq->commit_idx * graph->hash_len;
+    *ptarget_hash_seq = &seq->target_hash_seq;
+    seq->commit_idx++;
+    return HDAG_RES_OK;
+}
+
+void
+hdag_commit_graph_node_seq_reset(struct hdag_node_seq *base_seq)
+{
+    struct hdag_commit_graph_node_seq *seq = HDAG_CONTAINER_OF(
+        struct hdag_commit_graph_node_seq, base, base_seq
+    );
+    assert(hdag_node_seq_is_valid(base_seq));
+    seq->layer_idx = 0;
+    seq->commit_idx = 0;
+    seq->layer = NULL;
+    seq->data = NULL;
+    seq->parent_state = 3;
+    seq->edge_idx = 0;
+}
+
+struct hdag_node_seq *
+hdag_commit_graph_node_seq_init(struct hdag_commit_graph_node_seq *pseq,
+                                const struct hdag_commit_graph *graph)
+{
+    const struct hdag_commit_graph_layer   *layer;
+    ssize_t                                 idx;
+    size_t                                  commit_num = 0;
+    size_t                                  edge_num = 0;
+
+    assert(pseq != NULL);
+    assert(hdag_commit_graph_is_valid(graph));
+    assert(graph->layers.slots_occupied != 0);
+
+    /* Count the commits, and estimate one parent each, plus extra edges */
+    HDAG_DARR_ITER_FORWARD(&graph->layers, idx, layer, (void)0, (void)0) {
+        commit_num += layer->commit_num;
+        edge_num += layer->edge_num;
+    }
+
+    *pseq = (struct hdag_commit_graph_node_seq){
+        .base = {
+            .hash_len = graph->hash_len,
+            .reset_fn = hdag_commit_graph_node_seq_reset,
+            .next_fn = hdag_commit_graph_node_seq_next,
+            .node_num_hint = commit_num,
+            .target_hash_num_hint = commit_num + edge_num,
+        },
+        .graph = graph,
+        .parent_state = 3,
+        .target_hash_seq = {
+            .hash_len = graph->hash_len,
+            .next_fn = hdag_commit_graph_node_seq_target_hash_seq_next,
+        },
+    };
+
+    assert(hdag_node_seq_is_valid(&pseq->base));
+    assert(hdag_hash_seq_is_valid(&pseq->target_hash_seq));
+    return &pseq->base;
+}
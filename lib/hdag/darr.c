@@ -3,6 +3,56 @@
  */
 
 #include <hdag/darr.h>
+#include <errno.h>
+#include <stddef.h>
+#include <endian.h>
+#include <sys/param.h>
+#include <string.h>
+
+/**
+ * Reallocate the slots of a mutable dynamic array, using its allocator, or
+ * the heap.
+ *
+ * @param darr  The dynamic array to reallocate the slots of.
+ * @param num   The new number of allocated slots. Zero to free them.
+ *
+ * @return True if reallocating succeeded, false if memory allocation
+ *         failed (in which case errno is set, and the array is unchanged).
+ */
+static bool
+hdag_darr_realloc(struct hdag_darr *darr, size_t num)
+{
+    void *new_slots = NULL;
+
+    assert(hdag_darr_is_valid(darr));
+    assert(hdag_darr_is_mutable(darr));
+
+    if (darr->slot_size == 0 || num == 0) {
+        if (darr->slots != NULL) {
+            if (darr->allocator == NULL) {
+                free(darr->slots);
+            } else {
+                (void)darr->allocator->realloc_fn(darr->allocator,
+                                                  darr->slots, 0);
+            }
+        }
+    } else if (num > SIZE_MAX / darr->slot_size) {
+        errno = ENOMEM;
+        return false;
+    } else {
+        new_slots = darr->allocator == NULL
+            ? realloc(darr->slots, num * darr->slot_size)
+            : darr->allocator->realloc_fn(darr->allocator, darr->slots,
+                                          num * darr->slot_size);
+        if (new_slots == NULL) {
+            return false;
+        }
+    }
+
+    darr->slots = new_slots;
+    darr->slots_allocated = num;
+    return true;
+}
 
 void *
 hdag_darr_alloc(struct hdag_darr *darr, size_t num)
@@ -27,58 +77,514 @@ hdag_darr_alloc(struct hdag_darr *darr, size_t num)
         }
     }
 
-    if (new_slots_allocated != darr->slots_allocated) {
-        void *new_slots;
-
-        if (darr->slot_size == 0 || new_slots_allocated == 0) {
-            if (darr->slots != NULL) {
-                free(darr->slots);
-            }
-            new_slots = NULL;
-        } else {
-            assert(!hdag_darr_is_void(darr));
-            new_slots = reallocarray(darr->slots, new_slots_allocated,
-                                     darr->slot_size);
-            if (new_slots == NULL) {
-                return NULL;
-            }
-        }
-
-        darr->slots_allocated = new_slots_allocated;
-        darr->slots = new_slots;
+    if (new_slots_allocated != darr->slots_allocated &&
+        !hdag_darr_realloc(darr, new_slots_allocated)) {
+        return NULL;
     }
 
     return hdag_darr_slot(darr, darr->slots_occupied);
 }
 
+bool
+hdag_darr_reserve(struct hdag_darr *darr, size_t num)
+{
+    assert(hdag_darr_is_valid(darr));
+    assert(hdag_darr_is_mutable(darr));
+
+    if (num <= darr->slots_allocated - darr->slots_occupied) {
+        return true;
+    }
+    assert(!hdag_darr_is_void(darr));
+    if (num > SIZE_MAX - darr->slots_occupied) {
+        errno = ENOMEM;
+        return false;
+    }
+    return hdag_darr_realloc(darr, darr->slots_occupied + num);
+}
+
 bool
 hdag_darr_deflate(struct hdag_darr *darr)
 {
     assert(hdag_darr_is_valid(darr));
-    const size_t new_slots_allocated = darr->slots_occupied;
 
     if (hdag_darr_is_immutable(darr)) {
         return true;
     }
 
-    if (new_slots_allocated != darr->slots_allocated) {
-        void *new_slots;
-        if (darr->slot_size == 0 || new_slots_allocated == 0) {
-            if (darr->slots != NULL) {
-                free(darr->slots);
+    return darr->slots_occupied == darr->slots_allocated ||
+           hdag_darr_realloc(darr, darr->slots_occupied);
+}
+
+/**
+ * The maximum number of elements in a radix sort bucket, to sort with an
+ * insertion sort, instead of scattering further.
+ */
+#define HDAG_DARR_RADIX_SORT_SMALL  32
+
+/**
+ * Swap two elements, using a temporary buffer.
+ *
+ * @param a     The first element to swap.
+ * @param b     The second element to swap.
+ * @param tmp   The temporary buffer of at least "size" bytes.
+ * @param size  The size of the elements, bytes.
+ */
+static inline void
+hdag_darr_swap(uint8_t *a, uint8_t *b, uint8_t *tmp, size_t size)
+{
+    memcpy(tmp, a, size);
+    memcpy(a, b, size);
+    memcpy(b, tmp, size);
+}
+
+/**
+ * Sort elements with an insertion sort, by a key, assuming the key bytes
+ * before the specified depth are equal.
+ *
+ * @param slots     The elements to sort.
+ * @param num       The number of elements to sort.
+ * @param size      The size of the elements, bytes.
+ * @param key_off   The offset of the key in each element, bytes.
+ * @param key_len   The length of the key, bytes.
+ * @param depth     The number of the (equal) key bytes to skip.
+ * @param tmp       The temporary buffer of at least "size" bytes.
+ */
+static void
+hdag_darr_insertion_sort(uint8_t *slots, size_t num, size_t size,
+                         size_t key_off, size_t key_len, size_t depth,
+                         uint8_t *tmp)
+{
+    size_t      i;
+    uint8_t    *slot;
+
+    key_off += depth;
+    key_len -= depth;
+    for (i = 1; i < num; i++) {
+        slot = slots + i * size;
+        if (memcmp(slot - size + key_off, slot + key_off, key_len) <= 0) {
+            continue;
+        }
+        memcpy(tmp, slot, size);
+        do {
+            memcpy(slot, slot - size, size);
+            slot -= size;
+        } while (slot > slots &&
+                 memcmp(slot - size + key_off, tmp + key_off, key_len) > 0);
+        memcpy(slot, tmp, size);
+    }
+}
+
+/**
+ * Move elements into 256 buckets by the value of a byte at a fixed offset,
+ * in place (one pass of an American flag sort).
+ *
+ * @param slots     The elements to scatter.
+ * @param num       The number of elements to scatter.
+ * @param size      The size of the elements, bytes.
+ * @param byte_off  The offset of the byte to scatter by, in each element.
+ * @param end       Location for the index of the element after the end of
+ *                  each bucket.
+ * @param tmp       The temporary buffer of at least "size" bytes.
+ */
+static void
+hdag_darr_radix_scatter(uint8_t *slots, size_t num, size_t size,
+                        size_t byte_off, size_t end[256], uint8_t *tmp)
+{
+    /* The index of the next unsorted element in each bucket */
+    size_t      next[256];
+    size_t      idx;
+    size_t      start;
+    unsigned    bucket;
+    unsigned    byte;
+
+    /* Count the elements in each bucket */
+    memset(end, 0, sizeof(*end) * 256);
+    for (idx = 0; idx < num; idx++) {
+        end[slots[idx * size + byte_off]]++;
+    }
+    /* Turn the counts into bucket boundaries */
+    for (start = 0, bucket = 0; bucket < 256; bucket++) {
+        next[bucket] = start;
+        start += end[bucket];
+        end[bucket] = start;
+    }
+
+    /* Move each element into its bucket, following the cycles */
+    for (bucket = 0; bucket < 256; bucket++) {
+        while (next[bucket] < end[bucket]) {
+            byte = slots[next[bucket] * size + byte_off];
+            if (byte == bucket) {
+                next[bucket]++;
+            } else {
+                hdag_darr_swap(slots + next[bucket] * size,
+                               slots + next[byte] * size,
+                               tmp, size);
+                next[byte]++;
+            }
+        }
+    }
+}
+
+/**
+ * Sort elements with an in-place MSD radix sort (an American flag sort),
+ * by a key, assuming the key bytes before the specified depth are equal.
+ *
+ * @param slots     The elements to sort.
+ * @param num       The number of elements to sort.
+ * @param size      The size of the elements, bytes.
+ * @param key_off   The offset of the key in each element, bytes.
+ * @param key_len   The length of the key, bytes.
+ * @param depth     The number of the (equal) key bytes to skip.
+ * @param tmp       The temporary buffer of at least "size" bytes.
+ */
+static void
+hdag_darr_radix_sort_slots(uint8_t *slots, size_t num, size_t size,
+                           size_t key_off, size_t key_len, size_t depth,
+                           uint8_t *tmp)
+{
+    /* The index of the element after the end of each bucket */
+    size_t      end[256];
+    size_t      start;
+    unsigned    bucket;
+
+    if (depth >= key_len) {
+        return;
+    }
+    if (num <= HDAG_DARR_RADIX_SORT_SMALL) {
+        hdag_darr_insertion_sort(slots, num, size,
+                                 key_off, key_len, depth, tmp);
+        return;
+    }
+
+    hdag_darr_radix_scatter(slots, num, size, key_off + depth, end, tmp);
+
+    /* Sort each bucket by the following bytes */
+    for (start = 0, bucket = 0; bucket < 256; start = end[bucket], bucket++) {
+        if (end[bucket] - start > 1) {
+            hdag_darr_radix_sort_slots(slots + start * size,
+                                       end[bucket] - start, size,
+                                       key_off, key_len, depth + 1, tmp);
+        }
+    }
+}
+
+void
+hdag_darr_radix_sort(struct hdag_darr *darr, size_t start, size_t end,
+                     size_t key_off, size_t key_len)
+{
+    assert(hdag_darr_is_valid(darr));
+    assert(hdag_darr_is_mutable(darr));
+    assert(start <= end);
+    assert(end <= darr->slots_occupied);
+    assert(key_off <= darr->slot_size);
+    assert(key_len <= darr->slot_size - key_off);
+
+    if (end - start > 1) {
+        uint8_t tmp[darr->slot_size];
+        assert(!hdag_darr_is_void(darr));
+        hdag_darr_radix_sort_slots(hdag_darr_slot(darr, start),
+                                   end - start, darr->slot_size,
+                                   key_off, key_len, 0, tmp);
+    }
+}
+
+void
+hdag_darr_radix_partition(struct hdag_darr *darr, size_t start, size_t end,
+                          size_t byte_off, size_t bucket_ends[256])
+{
+    unsigned bucket;
+
+    assert(hdag_darr_is_valid(darr));
+    assert(hdag_darr_is_mutable(darr));
+    assert(start <= end);
+    assert(end <= darr->slots_occupied);
+    assert(byte_off < darr->slot_size);
+    assert(bucket_ends != NULL);
+
+    if (end > start) {
+        uint8_t tmp[darr->slot_size];
+        assert(!hdag_darr_is_void(darr));
+        hdag_darr_radix_scatter(hdag_darr_slot(darr, start),
+                                end - start, darr->slot_size,
+                                byte_off, bucket_ends, tmp);
+    } else {
+        memset(bucket_ends, 0, sizeof(*bucket_ends) * 256);
+    }
+    for (bucket = 0; bucket < 256; bucket++) {
+        bucket_ends[bucket] += start;
+    }
+}
+
+/** A compact sort key: an element's key prefix and its original index */
+struct hdag_darr_sort_key {
+    /** The first (up to eight) bytes of the element's key, big-endian */
+    uint64_t    prefix;
+    /** The original index of the element, relative to the sorted slice */
+    size_t      idx;
+};
+
+/** The elements being sorted by their keys, for comparing the key tails */
+struct hdag_darr_sort_key_ctx {
+    /** The first element of the slice being sorted */
+    const uint8_t  *slots;
+    /** The size of the elements, bytes */
+    size_t          size;
+    /** The offset of the key tail (after the prefix) in each element */
+    size_t          tail_off;
+    /** The length of the key tail, bytes */
+    size_t          tail_len;
+};
+
+/**
+ * Compare the key tails (after the prefixes) of the elements referenced
+ * by two sort keys, for qsort_r(3).
+ */
+static int
+hdag_darr_sort_key_cmp(const void *a, const void *b, void *data)
+{
+    const struct hdag_darr_sort_key_ctx *ctx = data;
+    const struct hdag_darr_sort_key *key_a = a;
+    const struct hdag_darr_sort_key *key_b = b;
+    return memcmp(ctx->slots + key_a->idx * ctx->size + ctx->tail_off,
+                  ctx->slots + key_b->idx * ctx->size + ctx->tail_off,
+                  ctx->tail_len);
+}
+
+/**
+ * Sort compact keys by prefix with an in-place MSD radix sort, assuming
+ * the prefix bits above the specified shift plus eight are equal.
+ *
+ * @param keys  The keys to sort.
+ * @param num   The number of keys to sort.
+ * @param shift The shift of the prefix byte to scatter the keys by.
+ */
+static void
+hdag_darr_sort_keys(struct hdag_darr_sort_key *keys, size_t num,
+                    unsigned int shift)
+{
+    size_t                      next[256];
+    size_t                      end[256];
+    struct hdag_darr_sort_key   key;
+    size_t                      idx;
+    size_t                      start;
+    unsigned int                bucket;
+    unsigned int                byte;
+
+    if (num <= HDAG_DARR_RADIX_SORT_SMALL) {
+        for (idx = 1; idx < num; idx++) {
+            key = keys[idx];
+            for (start = idx;
+                 start > 0 && keys[start - 1].prefix > key.prefix;
+                 start--) {
+                keys[start] = keys[start - 1];
             }
-            new_slots = NULL;
-        } else {
-            assert(!hdag_darr_is_void(darr));
-            new_slots = reallocarray(darr->slots, new_slots_allocated,
-                                     darr->slot_size);
-            if (new_slots == NULL) {
-                return false;
+            keys[start] = key;
+        }
+        return;
+    }
+
+    /* Count the keys in each bucket, and turn counts into boundaries */
+    memset(end, 0, sizeof(end));
+    for (idx = 0; idx < num; idx++) {
+        end[(keys[idx].prefix >> shift) & 0xff]++;
+    }
+    for (start = 0, bucket = 0; bucket < 256; bucket++) {
+        next[bucket] = start;
+        start += end[bucket];
+        end[bucket] = start;
+    }
+
+    /* Move each key into its bucket, following the cycles */
+    for (bucket = 0; bucket < 256; bucket++) {
+        while (next[bucket] < end[bucket]) {
+            byte = (keys[next[bucket]].prefix >> shift) & 0xff;
+            if (byte == bucket) {
+                next[bucket]++;
+            } else {
+                key = keys[next[bucket]];
+                keys[next[bucket]] = keys[next[byte]];
+                keys[next[byte]++] = key;
             }
         }
-        darr->slots = new_slots;
-        darr->slots_allocated = new_slots_allocated;
     }
 
-    return true;
+    /* Sort each bucket by the following bytes */
+    if (shift == 0) {
+        return;
+    }
+    for (start = 0, bucket = 0; bucket < 256; start = end[bucket], bucket++) {
+        if (end[bucket] - start > 1) {
+            hdag_darr_sort_keys(keys + start, end[bucket] - start,
+                                shift - 8);
+        }
+    }
+}
+
+/**
+ * The maximum number of elements in a bucket to sort by compact keys, and
+ * to permute via a scratch buffer, instead of scattering further.
+ */
+#define HDAG_DARR_KEY_SORT_BLOCK    256
+
+/** The state of a compact-key sort */
+struct hdag_darr_key_sort {
+    /** The size of the elements, bytes */
+    size_t                      size;
+    /** The offset of the key in each element, bytes */
+    size_t                      key_off;
+    /** The length of the key, bytes */
+    size_t                      key_len;
+    /** The buffer for the keys of a block */
+    struct hdag_darr_sort_key  *keys;
+    /** The buffer for the permuted elements of a block */
+    uint8_t                    *scratch;
+};
+
+/**
+ * Sort a block of elements by compact keys, assuming the key bytes before
+ * the specified depth are equal, and permute them via the scratch buffer.
+ *
+ * @param sort      The sort state.
+ * @param slots     The elements to sort.
+ * @param num       The number of elements to sort, not more than
+ *                  HDAG_DARR_KEY_SORT_BLOCK.
+ * @param depth     The number of the (equal) key bytes to skip.
+ */
+static void
+hdag_darr_key_sort_block(const struct hdag_darr_key_sort *sort,
+                         uint8_t *slots, size_t num, size_t depth)
+{
+    const size_t size = sort->size;
+    const size_t key_off = sort->key_off + depth;
+    const size_t key_len = sort->key_len - depth;
+    const size_t prefix_len = MIN(key_len, sizeof(uint64_t));
+    struct hdag_darr_sort_key *keys = sort->keys;
+    struct hdag_darr_sort_key key;
+    struct hdag_darr_sort_key_ctx ctx;
+    uint8_t prefix[sizeof(uint64_t)] = {0, };
+    uint64_t prefix_value;
+    size_t run;
+    size_t i, j, k;
+
+    assert(num <= HDAG_DARR_KEY_SORT_BLOCK);
+
+    /* Extract the key prefixes along with the element indexes */
+    for (i = 0; i < num; i++) {
+        memcpy(prefix, slots + i * size + key_off, prefix_len);
+        memcpy(&prefix_value, prefix, sizeof(prefix_value));
+        keys[i].prefix = be64toh(prefix_value);
+        keys[i].idx = i;
+    }
+
+    /* Sort the keys by prefix */
+    hdag_darr_sort_keys(keys, num, 56);
+
+    /* Sort the runs of equal prefixes by the rest of the elements' keys */
+    if (key_len > prefix_len) {
+        ctx = (struct hdag_darr_sort_key_ctx){
+            .slots = slots,
+            .size = size,
+            .tail_off = key_off + prefix_len,
+            .tail_len = key_len - prefix_len,
+        };
+        for (i = 0; i < num; i += run) {
+            for (run = 1;
+                 i + run < num && keys[i + run].prefix == keys[i].prefix;
+                 run++);
+            if (run > HDAG_DARR_RADIX_SORT_SMALL) {
+                qsort_r(keys + i, run, sizeof(*keys),
+                        hdag_darr_sort_key_cmp, &ctx);
+                continue;
+            }
+            for (j = i + 1; j < i + run; j++) {
+                key = keys[j];
+                for (k = j;
+                     k > i &&
+                     hdag_darr_sort_key_cmp(&keys[k - 1], &key, &ctx) > 0;
+                     k--) {
+                    keys[k] = keys[k - 1];
+                }
+                keys[k] = key;
+            }
+        }
+    }
+
+    /* Gather the elements in order into the scratch buffer, and back */
+    for (i = 0; i < num; i++) {
+        memcpy(sort->scratch + i * size, slots + keys[i].idx * size, size);
+    }
+    memcpy(slots, sort->scratch, num * size);
+}
+
+/**
+ * Sort elements by scattering them into buckets by key bytes, until the
+ * buckets are small enough to be sorted by compact keys.
+ *
+ * @param sort      The sort state.
+ * @param slots     The elements to sort.
+ * @param num       The number of elements to sort.
+ * @param depth     The number of the (equal) key bytes to skip.
+ */
+static void
+hdag_darr_key_sort_slots(const struct hdag_darr_key_sort *sort,
+                         uint8_t *slots, size_t num, size_t depth)
+{
+    size_t      end[256];
+    size_t      start;
+    unsigned    bucket;
+
+    if (depth >= sort->key_len) {
+        return;
+    }
+    if (num <= HDAG_DARR_KEY_SORT_BLOCK) {
+        hdag_darr_key_sort_block(sort, slots, num, depth);
+        return;
+    }
+
+    hdag_darr_radix_scatter(slots, num, sort->size,
+                            sort->key_off + depth, end, sort->scratch);
+
+    for (start = 0, bucket = 0; bucket < 256; start = end[bucket], bucket++) {
+        if (end[bucket] - start > 1) {
+            hdag_darr_key_sort_slots(sort, slots + start * sort->size,
+                                     end[bucket] - start, depth + 1);
+        }
+    }
+}
+
+void
+hdag_darr_key_sort(struct hdag_darr *darr, size_t start, size_t end,
+                   size_t key_off, size_t key_len)
+{
+    const size_t block = MIN(end - start, HDAG_DARR_KEY_SORT_BLOCK);
+    struct hdag_darr_key_sort sort = {
+        .size = darr->slot_size,
+        .key_off = key_off,
+        .key_len = key_len,
+    };
+
+    assert(hdag_darr_is_valid(darr));
+    assert(hdag_darr_is_mutable(darr));
+    assert(start <= end);
+    assert(end <= darr->slots_occupied);
+    assert(key_off <= darr->slot_size);
+    assert(key_len <= darr->slot_size - key_off);
+
+    if (end - start < 2) {
+        return;
+    }
+
+    /* Fall back to sorting the elements, if keys don't help, or fit */
+    if (sort.size > sizeof(*sort.keys)) {
+        sort.keys = malloc(sizeof(*sort.keys) * block);
+        sort.scratch = malloc(sort.size * block);
+    }
+    if (sort.keys == NULL || sort.scratch == NULL) {
+        hdag_darr_radix_sort(darr, start, end, key_off, key_len);
+    } else {
+        hdag_darr_key_sort_slots(&sort, hdag_darr_slot(darr, start),
+                                 end - start, 0);
+    }
+    free(sort.scratch);
+    free(sort.keys);
 }
@@ -3,6 +3,8 @@
  */
 
 #include <hdag/file.h>
+#include <hdag/bin.h>
+#include <hdag/stream.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <errno.h>
@@ -25,27 +27,272 @@ hdag_file_mmap(int fd, size_t size)
                 fd, 0);
 }
 
-hdag_res
-hdag_file_from_bundle(struct hdag_file *pfile,
-                      const char *pathname,
-                      int template_sfxlen,
-                      mode_t open_mode,
-                      const struct hdag_bundle *bundle)
+/**
+ * Set the pointers to the pieces of a hash DAG file's contents, according
+ * to its header, and to the contents of its optional sections, if any.
+ *
+ * @param file  The file to set the pointers of, with the contents mapped,
+ *              and the header initialized.
+ *
+ * @return True if the sections were valid and fit the file, false if not.
+ */
+static bool
+hdag_file_set_pointers(struct hdag_file *file)
+{
+    struct hdag_file_section section;
+    uint32_t node_num;
+    const uint8_t *pos;
+    const uint8_t *end = (const uint8_t *)file->contents + file->size;
+
+    file->header = file->contents;
+    node_num = file->header->node_num;
+    file->hash_ops = hdag_hash_ops_get(file->header->hash_len);
+    file->nodes = (struct hdag_node *)(file->header + 1);
+    file->extra_edges = (struct hdag_edge *)(
+        (uint8_t *)file->nodes +
+        hdag_node_size(file->header->hash_len) * file->header->node_num
+    );
+    file->unknown_hashes =
+        (uint8_t *)file->extra_edges +
+        sizeof(struct hdag_edge) * file->header->extra_edge_num;
+    file->index_prefixes = NULL;
+    file->index_node_idxs = NULL;
+    file->fanout16 = NULL;
+    file->bloom = NULL;
+    file->bloom_blocks = NULL;
+    file->intervals = NULL;
+    file->node_intervals = NULL;
+
+    /* Find the sections we know */
+    pos = file->unknown_hashes +
+        file->header->hash_len * file->header->unknown_hash_num;
+    assert(pos <= end);
+    while (pos < end) {
+        if ((size_t)(end - pos) < sizeof(section)) {
+            return false;
+        }
+        memcpy(&section, pos, sizeof(section));
+        pos += sizeof(section);
+        if ((section.size & 3) != 0 || section.size > (size_t)(end - pos)) {
+            return false;
+        }
+        switch (section.type) {
+        case HDAG_FILE_SECTION_INDEX:
+            if (file->index_prefixes != NULL ||
+                section.size != hdag_file_index_size(node_num)) {
+                return false;
+            }
+            file->index_prefixes = (uint32_t *)pos;
+            file->index_node_idxs = file->index_prefixes + node_num + 1;
+            if (file->index_prefixes[0] != node_num ||
+                file->index_node_idxs[0] != node_num) {
+                return false;
+            }
+            break;
+        case HDAG_FILE_SECTION_FANOUT16:
+            if (file->fanout16 != NULL ||
+                section.size != sizeof(uint32_t) * HDAG_FANOUT16_LEN) {
+                return false;
+            }
+            file->fanout16 = (uint32_t *)pos;
+            if (file->fanout16[HDAG_FANOUT16_LEN - 1] != node_num ||
+                !hdag_fanout_is_valid(file->fanout16, HDAG_FANOUT16_LEN)) {
+                return false;
+            }
+            break;
+        case HDAG_FILE_SECTION_BLOOM:
+            if (file->bloom != NULL ||
+                section.size < sizeof(*file->bloom)) {
+                return false;
+            }
+            file->bloom = (struct hdag_file_bloom *)pos;
+            if (file->bloom->block_num == 0 ||
+                file->bloom->block_off < sizeof(*file->bloom) ||
+                file->bloom->block_off > section.size ||
+                section.size - file->bloom->block_off !=
+                    HDAG_FILE_BLOOM_BLOCK_SIZE *
+                    (size_t)file->bloom->block_num ||
+                (pos - (const uint8_t *)file->contents +
+                 file->bloom->block_off) % HDAG_FILE_BLOOM_BLOCK_SIZE != 0) {
+                return false;
+            }
+            file->bloom_blocks = (uint32_t *)(pos + file->bloom->block_off);
+            break;
+        case HDAG_FILE_SECTION_INTERVALS:
+            if (file->intervals != NULL ||
+                section.size < sizeof(*file->intervals)) {
+                return false;
+            }
+            file->intervals = (struct hdag_file_intervals *)pos;
+            if (file->intervals->interval_num == 0 ||
+                section.size - sizeof(*file->intervals) !=
+                    sizeof(struct hdag_interval) * (size_t)node_num *
+                    file->intervals->interval_num) {
+                return false;
+            }
+            file->node_intervals =
+                (struct hdag_interval *)(file->intervals + 1);
+            break;
+        default:
+            break;
+        }
+        pos += section.size;
+    }
+
+    return true;
+}
+
+/**
+ * Extend the contents of an open hash DAG file (and the file on disk, if
+ * any), filling the added space with zeroes. Only the contents and the size
+ * are updated, and the pointers to the pieces of the contents need setting
+ * once the added space is filled in.
+ *
+ * @param file  The file to extend. Must be open.
+ * @param size  The new size of the file contents, bytes. Must not be less
+ *              than the current size.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_file_extend(struct hdag_file *file, size_t size)
+{
+    hdag_res res = HDAG_RES_INVALID;
+    int orig_errno;
+    int fd = -1;
+    void *contents;
+
+    assert(hdag_file_is_valid(file));
+    assert(hdag_file_is_open(file));
+    assert(size >= file->size);
+
+    /* If backed by a file, extend it, and remap it */
+    if (file->pathname != NULL) {
+        fd = open(file->pathname, O_RDWR);
+        if (fd < 0 || ftruncate(fd, size) < 0) {
+            goto cleanup;
+        }
+        contents = mremap(file->contents, file->size, size, MREMAP_MAYMOVE);
+        if (contents == MAP_FAILED) {
+            orig_errno = errno;
+            (void)ftruncate(fd, file->size);
+            errno = orig_errno;
+            goto cleanup;
+        }
+    /* Else, move the contents to a bigger anonymous mapping */
+    } else {
+        contents = hdag_file_mmap(-1, size);
+        if (contents == MAP_FAILED) {
+            goto cleanup;
+        }
+        memcpy(contents, file->contents, file->size);
+        munmap(file->contents, file->size);
+    }
+
+    file->contents = contents;
+    file->header = contents;
+    file->size = size;
+    res = HDAG_RES_OK;
+
+cleanup:
+    orig_errno = errno;
+    if (fd >= 0) {
+        close(fd);
+    }
+    errno = orig_errno;
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
+/**
+ * Create a new file for a hash DAG file being built.
+ *
+ * @param pathname          The file's pathname (template). If it's a
+ *                          template, the "XXXXXX" in it is replaced with the
+ *                          characters making up the created file's name.
+ * @param template_sfxlen   The (non-negative) number of suffix characters
+ *                          following the "XXXXXX" at the end of "pathname",
+ *                          if it contains the template for a temporary file
+ *                          to be created. Or a negative number to treat
+ *                          "pathname" literally.
+ * @param open_mode         The mode bitmap to supply to open(2).
+ *
+ * @return The descriptor of the created file, or a negative number in case
+ *         of failure, with errno set.
+ */
+static int
+hdag_file_open_new(char *pathname, int template_sfxlen, mode_t open_mode)
+{
+    int fd;
+    int orig_errno;
+
+    assert(pathname != NULL);
+
+    /* If creating a "temporary" file */
+    if (template_sfxlen >= 0) {
+        const char template[] = "XXXXXX";
+        const char *ptemplate;
+        ptemplate = strstr(pathname, template);
+        assert(ptemplate != NULL);
+        assert(template_sfxlen <=
+               (int)strlen(pathname) - (int)strlen(template));
+        assert(ptemplate == pathname +
+               (strlen(pathname) -
+                strlen(template) -
+                template_sfxlen));
+        (void)ptemplate;
+
+        fd = mkstemps(pathname, template_sfxlen);
+        if (fd >= 0 && fchmod(fd, open_mode) < 0) {
+            orig_errno = errno;
+            close(fd);
+            unlink(pathname);
+            errno = orig_errno;
+            fd = -1;
+        }
+    /* Else, if creating a literal, "non-temporary" file */
+    } else {
+        fd = open(pathname, O_RDWR | O_CREAT | O_EXCL, open_mode);
+    }
+
+    return fd;
+}
+
+/**
+ * Create and open a hash DAG file sized according to a header, with the
+ * header written, and the rest of the contents zeroed.
+ *
+ * @param pfile             Location for the state of the opened file.
+ *                          Not modified in case of failure.
+ * @param pathname          The file's pathname (template), or NULL to
+ *                          open an in-memory file.
+ * @param template_sfxlen   The (non-negative) number of suffix characters
+ *                          following the "XXXXXX" at the end of "pathname",
+ *                          if it contains the template for a temporary file
+ *                          to be created. Or a negative number to treat
+ *                          "pathname" literally. Ignored, if "pathname" is
+ *                          NULL.
+ * @param open_mode         The mode bitmap to supply to open(2).
+ *                          Ignored, if pathname is NULL.
+ * @param header            The header of the file to create.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_file_create(struct hdag_file *pfile,
+                 const char *pathname,
+                 int template_sfxlen,
+                 mode_t open_mode,
+                 const struct hdag_file_header *header)
 {
     hdag_res res = HDAG_RES_INVALID;
     int orig_errno;
     int fd = -1;
     struct hdag_file file = HDAG_FILE_CLOSED;
-    struct hdag_file_header header = {
-        .signature = HDAG_FILE_SIGNATURE,
-        .version = {0, 0},
-        .hash_len = bundle->hash_len,
-        .extra_edge_num = bundle->extra_edges.slots_occupied,
-        .unknown_hash_num = bundle->unknown_hashes.slots_occupied,
-    };
 
-    assert(hdag_bundle_is_valid(bundle));
-    assert(hdag_bundle_is_organized(bundle));
+    assert(pfile != NULL);
+    assert(hdag_file_header_is_valid(header));
 
     if (pathname != NULL) {
         file.pathname = strdup(pathname);
@@ -54,50 +301,18 @@ hdag_file_from_bundle(struct hdag_file *pfile,
         }
     }
 
-    /* Copy the fanout (and thus node number) from the bundle */
-    memcpy(header.node_fanout, bundle->nodes_fanout,
-           sizeof(header.node_fanout));
-
     /* Calculate the file size */
-    file.size = hdag_file_size(header.hash_len,
-                               header.node_num,
-                               header.extra_edge_num,
-                               header.unknown_hash_num);
+    file.size = hdag_file_size(header->hash_len,
+                               header->node_num,
+                               header->extra_edge_num,
+                               header->unknown_hash_num);
 
-    /* If creating an anonymous mapping */
-    if (file.pathname == NULL) {
-        fd = -1;
-    /* Else, mapping a file */
-    } else {
-        /* If creating a "temporary" file */
-        if (template_sfxlen >= 0) {
-            const char template[] = "XXXXXX";
-            const char *ptemplate;
-            ptemplate = strstr(file.pathname, template);
-            assert(ptemplate != NULL);
-            assert(template_sfxlen <=
-                   (int)strlen(file.pathname) - (int)strlen(template));
-            assert(ptemplate == file.pathname +
-                   (strlen(file.pathname) -
-                    strlen(template) -
-                    template_sfxlen));
-            (void)ptemplate;
-
-            fd = mkstemps(file.pathname, template_sfxlen);
-            if (fd < 0) {
-                goto cleanup;
-            }
-            if (fchmod(fd, open_mode) < 0) {
-                goto cleanup;
-            }
-        /* Else, if creating a literal, "non-temporary" file */
-        } else {
-            fd = open(file.pathname, O_RDWR | O_CREAT | O_EXCL, open_mode);
-            if (fd < 0) {
-                goto cleanup;
-            }
+    /* If mapping a file, instead of creating an anonymous mapping */
+    if (file.pathname != NULL) {
+        fd = hdag_file_open_new(file.pathname, template_sfxlen, open_mode);
+        if (fd < 0) {
+            goto cleanup;
         }
-
         /* Expand the file to our size (filling it with zeros) */
         if (ftruncate(fd, file.size) < 0) {
             goto cleanup;
@@ -107,6 +322,7 @@ hdag_file_from_bundle(struct hdag_file *pfile,
     /* Memory-map the file */
     file.contents = hdag_file_mmap(fd, file.size);
     if (file.contents == MAP_FAILED) {
+        file.contents = NULL;
         goto cleanup;
     }
 
@@ -117,15 +333,350 @@ hdag_file_from_bundle(struct hdag_file *pfile,
     }
 
     /* Initialize the file */
-    *(file.header = file.contents) = header;
-    file.nodes = (struct hdag_node *)(file.header + 1);
-    file.extra_edges = (struct hdag_edge *)(
-        (uint8_t *)file.nodes +
-        hdag_node_size(file.header->hash_len) * file.header->node_num
+    *(struct hdag_file_header *)file.contents = *header;
+    hdag_file_set_pointers(&file);
+
+    /* The file state should be valid now */
+    assert(hdag_file_is_valid(&file));
+
+    /* Hand over the opened file */
+    *pfile = file;
+    file = HDAG_FILE_CLOSED;
+    res = HDAG_RES_OK;
+
+cleanup:
+    orig_errno = errno;
+    if (fd >= 0) {
+        close(fd);
+        unlink(file.pathname);
+    }
+    free(file.pathname);
+    errno = orig_errno;
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
+/**
+ * Discard a file being created: unmap it, and remove it from disk, if
+ * backed by a file.
+ *
+ * @param pfile The file to discard. Can be closed already.
+ */
+static void
+hdag_file_discard(struct hdag_file *pfile)
+{
+    assert(hdag_file_is_valid(pfile));
+    if (hdag_file_is_open(pfile)) {
+        if (pfile->pathname != NULL) {
+            unlink(pfile->pathname);
+        }
+        munmap(pfile->contents, pfile->size);
+        free(pfile->pathname);
+        *pfile = HDAG_FILE_CLOSED;
+    }
+}
+
+/**
+ * A hash DAG file being built in place: a growable mapping of the file
+ * being created, allocating the slots of a bundle's node array right after
+ * the file header. The file is resized with ftruncate(2), and the mapping
+ * with mremap(2), as the array changes, so the organized nodes end up in
+ * the file without being copied.
+ */
+struct hdag_file_build {
+    /** The base allocator of the node array slots */
+    struct hdag_darr_allocator  allocator;
+    /** The file pathname. NULL, if there's no backing file */
+    char                       *pathname;
+    /** The descriptor of the file, negative if there's no backing file */
+    int                         fd;
+    /** The mapping of the file, NULL if not mapped */
+    void                       *map;
+    /** The size of the mapping (and of the file, if any), bytes */
+    size_t                      size;
+};
+
+/** An initializer for a file build which wasn't started */
+#define HDAG_FILE_BUILD_NONE (struct hdag_file_build){.fd = -1}
+
+/**
+ * Resize the file being built, and its mapping.
+ *
+ * @param build The file build to resize.
+ * @param size  The new size of the file, bytes. Must not be zero.
+ *
+ * @return True if resizing succeeded, false if it failed (in which case
+ *         errno is set, and the mapping is left intact).
+ */
+static bool
+hdag_file_build_resize(struct hdag_file_build *build, size_t size)
+{
+    void *map;
+
+    assert(build != NULL);
+    assert(size != 0);
+
+    if (build->fd >= 0 && ftruncate(build->fd, size) < 0) {
+        return false;
+    }
+    if (build->map == NULL) {
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                   build->fd < 0 ? MAP_PRIVATE | MAP_ANONYMOUS : MAP_SHARED,
+                   build->fd, 0);
+    } else {
+        map = mremap(build->map, build->size, size, MREMAP_MAYMOVE);
+    }
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    build->map = map;
+    build->size = size;
+    return true;
+}
+
+/**
+ * Reallocate the node array slots following the header of a file being
+ * built.
+ */
+static void *
+hdag_file_build_realloc(struct hdag_darr_allocator *allocator,
+                        void *ptr, size_t size)
+{
+    struct hdag_file_build *build = HDAG_CONTAINER_OF(
+        struct hdag_file_build, allocator, allocator
     );
-    file.unknown_hashes =
-        (uint8_t *)file.extra_edges +
-        sizeof(struct hdag_edge) * file.header->extra_edge_num;
+    const size_t header_size = sizeof(struct hdag_file_header);
+
+    assert(ptr == NULL || build->map == NULL ||
+           ptr == (uint8_t *)build->map + header_size);
+    (void)ptr;
+
+    /* If freeing, keep just the header, if the file wasn't handed over */
+    if (size == 0) {
+        if (build->map != NULL) {
+            (void)hdag_file_build_resize(build, header_size);
+        }
+        return NULL;
+    }
+    if (size > SIZE_MAX - header_size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (!hdag_file_build_resize(build, header_size + size)) {
+        return NULL;
+    }
+    return (uint8_t *)build->map + header_size;
+}
+
+/**
+ * Cleanup a file build, removing the file being built, if it wasn't
+ * handed over. Any bundle using the build's allocator must be cleaned up
+ * first.
+ *
+ * @param build The file build to cleanup. Can be cleaned up already.
+ */
+static void
+hdag_file_build_cleanup(struct hdag_file_build *build)
+{
+    int orig_errno = errno;
+
+    assert(build != NULL);
+
+    if (build->map != NULL) {
+        munmap(build->map, build->size);
+        build->map = NULL;
+        build->size = 0;
+    }
+    if (build->fd >= 0) {
+        close(build->fd);
+        build->fd = -1;
+        unlink(build->pathname);
+    }
+    free(build->pathname);
+    build->pathname = NULL;
+    errno = orig_errno;
+}
+
+/**
+ * Start building a hash DAG file in place: create the file, and have it
+ * allocate the node array of a bundle.
+ *
+ * @param build             The file build to start. Must stay in place
+ *                          until cleaned up.
+ * @param pathname          The file's pathname (template), or NULL to
+ *                          build an in-memory file.
+ * @param template_sfxlen   The (non-negative) number of suffix characters
+ *                          following the "XXXXXX" at the end of "pathname",
+ *                          if it contains the template for a temporary file
+ *                          to be created. Or a negative number to treat
+ *                          "pathname" literally. Ignored, if "pathname" is
+ *                          NULL.
+ * @param open_mode         The mode bitmap to supply to open(2).
+ *                          Ignored, if pathname is NULL.
+ * @param bundle            The bundle to have the node array allocated in
+ *                          the file. Must have the node array clean.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_file_build_start(struct hdag_file_build *build,
+                      const char *pathname,
+                      int template_sfxlen,
+                      mode_t open_mode,
+                      struct hdag_bundle *bundle)
+{
+    hdag_res res = HDAG_RES_INVALID;
+
+    assert(build != NULL);
+    assert(hdag_bundle_is_valid(bundle));
+    assert(hdag_darr_is_clean(&bundle->nodes));
+    assert(bundle->nodes.allocator == NULL);
+
+    *build = HDAG_FILE_BUILD_NONE;
+    build->allocator.realloc_fn = hdag_file_build_realloc;
+
+    if (pathname != NULL) {
+        build->pathname = strdup(pathname);
+        if (build->pathname == NULL) {
+            goto cleanup;
+        }
+        build->fd = hdag_file_open_new(build->pathname,
+                                       template_sfxlen, open_mode);
+        if (build->fd < 0) {
+            goto cleanup;
+        }
+    }
+    if (!hdag_file_build_resize(build, sizeof(struct hdag_file_header))) {
+        goto cleanup;
+    }
+
+    bundle->nodes.allocator = &build->allocator;
+    res = HDAG_RES_OK;
+cleanup:
+    if (res != HDAG_RES_OK) {
+        hdag_file_build_cleanup(build);
+    }
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
+/**
+ * Finish building a hash DAG file in place, from an organized bundle with
+ * the node array allocated by the build. Append the rest of the bundle's
+ * arrays after the nodes, and write the header.
+ *
+ * @param build     The file build to finish.
+ * @param pfile     Location for the built file.
+ *                  Can be NULL to have the file closed after building.
+ *                  Not modified in case of failure.
+ * @param bundle    The organized bundle to finish the file with.
+ *                  Its node array stays allocated in the file, and must
+ *                  only be cleaned up afterwards.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_file_build_finish(struct hdag_file_build *build,
+                       struct hdag_file *pfile,
+                       struct hdag_bundle *bundle)
+{
+    hdag_res res = HDAG_RES_INVALID;
+    struct hdag_file file = HDAG_FILE_CLOSED;
+    struct hdag_file_header header = {
+        .signature = HDAG_FILE_SIGNATURE,
+        .version = {0, 0},
+        .hash_len = bundle->hash_len,
+        .extra_edge_num = bundle->extra_edges.slots_occupied,
+        .unknown_hash_num = bundle->unknown_hashes.slots_occupied,
+    };
+
+    assert(build != NULL);
+    assert(hdag_bundle_is_valid(bundle));
+    assert(hdag_bundle_is_organized(bundle));
+    assert(bundle->nodes.allocator == &build->allocator);
+
+    /* Copy the fanout (and thus node number) from the bundle */
+    memcpy(header.node_fanout, bundle->nodes_fanout,
+           sizeof(header.node_fanout));
+
+    /* Extend the file to fit the rest of the contents after the nodes */
+    file.size = hdag_file_size(header.hash_len,
+                               header.node_num,
+                               header.extra_edge_num,
+                               header.unknown_hash_num);
+    if (!hdag_file_build_resize(build, file.size)) {
+        goto cleanup;
+    }
+    if (bundle->nodes.slots != NULL) {
+        bundle->nodes.slots = (struct hdag_file_header *)build->map + 1;
+    }
+
+    /* Fill in the rest of the contents */
+    file.contents = build->map;
+    *(struct hdag_file_header *)file.contents = header;
+    hdag_file_set_pointers(&file);
+    assert((void *)file.nodes == bundle->nodes.slots ||
+           bundle->nodes.slots == NULL);
+    memcpy(file.extra_edges, bundle->extra_edges.slots,
+           hdag_darr_occupied_size(&bundle->extra_edges));
+    memcpy(file.unknown_hashes, bundle->unknown_hashes.slots,
+           hdag_darr_occupied_size(&bundle->unknown_hashes));
+
+    /* Hand the mapping and the pathname over to the file */
+    if (build->fd >= 0) {
+        close(build->fd);
+        build->fd = -1;
+    }
+    file.pathname = build->pathname;
+    build->pathname = NULL;
+    build->map = NULL;
+    build->size = 0;
+
+    /* The file state should be valid now */
+    assert(hdag_file_is_valid(&file));
+
+    /* Output the opened file, if requested */
+    if (pfile == NULL) {
+        HDAG_RES_TRY(hdag_file_close(&file));
+    } else {
+        *pfile = file;
+        file = HDAG_FILE_CLOSED;
+    }
+
+    res = HDAG_RES_OK;
+
+cleanup:
+    hdag_file_discard(&file);
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
+hdag_res
+hdag_file_from_bundle(struct hdag_file *pfile,
+                      const char *pathname,
+                      int template_sfxlen,
+                      mode_t open_mode,
+                      const struct hdag_bundle *bundle)
+{
+    hdag_res res = HDAG_RES_INVALID;
+    struct hdag_file file = HDAG_FILE_CLOSED;
+    struct hdag_file_header header = {
+        .signature = HDAG_FILE_SIGNATURE,
+        .version = {0, 0},
+        .hash_len = bundle->hash_len,
+        .extra_edge_num = bundle->extra_edges.slots_occupied,
+        .unknown_hash_num = bundle->unknown_hashes.slots_occupied,
+    };
+
+    assert(hdag_bundle_is_valid(bundle));
+    assert(hdag_bundle_is_organized(bundle));
+
+    /* Copy the fanout (and thus node number) from the bundle */
+    memcpy(header.node_fanout, bundle->nodes_fanout,
+           sizeof(header.node_fanout));
+
+    /* Create the file */
+    HDAG_RES_TRY(hdag_file_create(&file, pathname, template_sfxlen,
+                                  open_mode, &header));
 
     /* Copy the bundle data */
     memcpy(file.nodes, bundle->nodes.slots,
@@ -138,8 +689,10 @@ hdag_file_from_bundle(struct hdag_file *pfile,
     /* The file state should be valid now */
     assert(hdag_file_is_valid(&file));
 
-    /* Hand over the opened file, if requested */
-    if (pfile != NULL) {
+    /* Output the opened file, if requested */
+    if (pfile == NULL) {
+        HDAG_RES_TRY(hdag_file_close(&file));
+    } else {
         *pfile = file;
         file = HDAG_FILE_CLOSED;
     }
@@ -147,110 +700,795 @@ hdag_file_from_bundle(struct hdag_file *pfile,
     res = HDAG_RES_OK;
 
 cleanup:
-    orig_errno = errno;
-    if (fd >= 0) {
-        close(fd);
-        unlink(file.pathname);
+    hdag_file_discard(&file);
+    return res;
+}
+
+hdag_res
+hdag_file_to_bundle(struct hdag_bundle *pbundle,
+                    const struct hdag_file *file)
+{
+    assert(hdag_file_is_valid(file));
+
+    struct hdag_bundle bundle = HDAG_BUNDLE_EMPTY(file->header->hash_len);
+
+    bundle.nodes = HDAG_DARR_IMMUTABLE(
+        file->nodes,
+        hdag_node_size(file->header->hash_len),
+        file->header->node_num
+    );
+
+    memcpy(bundle.nodes_fanout, file->header->node_fanout,
+           sizeof(bundle.nodes_fanout));
+
+    if (file->fanout16 != NULL) {
+        bundle.nodes_fanout16 = HDAG_DARR_IMMUTABLE(
+            file->fanout16, sizeof(uint32_t), HDAG_FANOUT16_LEN
+        );
     }
-    if (file.contents != NULL) {
-        munmap(file.contents, file.size);
+
+    if (file->intervals != NULL) {
+        bundle.node_intervals = HDAG_DARR_IMMUTABLE(
+            file->node_intervals,
+            sizeof(struct hdag_interval) * file->intervals->interval_num,
+            file->header->node_num
+        );
+    }
+
+    bundle.unknown_hashes = HDAG_DARR_IMMUTABLE(
+        file->unknown_hashes,
+        file->header->hash_len,
+        file->header->unknown_hash_num
+    );
+
+    bundle.extra_edges = HDAG_DARR_IMMUTABLE(
+        file->extra_edges,
+        sizeof(struct hdag_edge),
+        file->header->extra_edge_num
+    );
+
+    assert(hdag_bundle_is_valid(&bundle));
+    if (pbundle != NULL) {
+        *pbundle = bundle;
+        bundle = HDAG_BUNDLE_EMPTY(bundle.hash_len);
+    }
+
+    hdag_bundle_cleanup(&bundle);
+    return HDAG_RES_OK;
+}
+
+/**
+ * Create a hash DAG file from a node sequence, same as
+ * hdag_file_from_node_seq(), optionally timing and reporting the stages.
+ *
+ * @param pfile             Location for the created file, or NULL to
+ *                          close it after creation.
+ * @param pathname          The file's pathname (template), or NULL to
+ *                          not back the file by the filesystem.
+ * @param template_sfxlen   The number of template suffix characters, or
+ *                          -1 if the pathname is not a template.
+ * @param open_mode         The mode bits of the file, if created.
+ * @param node_seq          The node sequence to load the nodes from.
+ * @param profile           True to time and report the stages to stderr,
+ *                          false to not.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_file_from_node_seq_profiled(struct hdag_file *pfile,
+                                 const char *pathname,
+                                 int template_sfxlen,
+                                 mode_t open_mode,
+                                 struct hdag_node_seq *node_seq,
+                                 bool profile)
+{
+    hdag_res res = HDAG_RES_INVALID;
+    struct hdag_bundle bundle = HDAG_BUNDLE_EMPTY(node_seq->hash_len);
+    struct hdag_file_build build = HDAG_FILE_BUILD_NONE;
+
+    assert(hdag_node_seq_is_valid(node_seq));
+
+    /* Have the nodes collected right in the file */
+    HDAG_RES_TRY(hdag_file_build_start(&build, pathname,
+                                       template_sfxlen, open_mode,
+                                       &bundle));
+    /* Ingest the nodes and their targets into the bundle */
+    HDAG_RES_TRY(hdag_bundle_reserve_node_seq(&bundle, node_seq, 0, true));
+    HDAG_PROFILE_STAGE(
+        profile, "Loading the nodes", bundle.nodes.slots_occupied, "nodes",
+        HDAG_RES_TRY(hdag_bundle_add_node_seq(&bundle, node_seq, 0, true))
+    );
+    /* Organize the bundle, and finish the file with it */
+    HDAG_RES_TRY(hdag_bundle_organize_parallel(&bundle, NULL, 1, profile));
+    HDAG_PROFILE_STAGE(
+        profile, "Finishing the file", bundle.nodes.slots_occupied, "nodes",
+        HDAG_RES_TRY(hdag_file_build_finish(&build, pfile, &bundle))
+    );
+    res = HDAG_RES_OK;
+
+cleanup:
+    hdag_bundle_cleanup(&bundle);
+    hdag_file_build_cleanup(&build);
+    return res;
+}
+
+hdag_res
+hdag_file_from_node_seq(struct hdag_file *pfile,
+                        const char *pathname,
+                        int template_sfxlen,
+                        mode_t open_mode,
+                        struct hdag_node_seq *node_seq)
+{
+    return hdag_file_from_node_seq_profiled(pfile, pathname,
+                                            template_sfxlen, open_mode,
+                                            node_seq, false);
+}
+
+/**
+ * Write a node record to a sorted run file.
+ *
+ * A record consists of the node hash, an LEB128 varint containing zero, if
+ * the node's targets are unknown, or the number of targets plus one
+ * otherwise, followed by the target hashes.
+ *
+ * @param stream        The run file stream to write the record to.
+ * @param hash_len      The length of the node and target hashes.
+ * @param hash          The node hash.
+ * @param known         True if the node's targets are known.
+ * @param target_hashes The target hashes, sorted and deduplicated.
+ *                      Ignored, if "target_num" is zero.
+ * @param target_num    The number of target hashes.
+ *                      Must be zero, if "known" is false.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_file_run_write(FILE *stream, uint16_t hash_len,
+                    const uint8_t *hash, bool known,
+                    const uint8_t *target_hashes, size_t target_num)
+{
+    uint8_t varint[HDAG_BIN_VARINT_MAX_LEN];
+    size_t varint_len;
+
+    assert(stream != NULL);
+    assert(hash != NULL);
+    assert(known || target_num == 0);
+
+    varint_len = hdag_bin_varint_encode(varint,
+                                        known ? target_num + 1 : 0);
+    if (fwrite(hash, hash_len, 1, stream) != 1 ||
+        fwrite(varint, varint_len, 1, stream) != 1 ||
+        (target_num != 0 &&
+         fwrite(target_hashes, hash_len, target_num, stream) != target_num)) {
+        return HDAG_RES_ERRNO;
+    }
+    return HDAG_RES_OK;
+}
+
+/** A reader of a sorted run file */
+struct hdag_file_run {
+    /** The run file stream, or NULL if not created yet */
+    FILE               *stream;
+    /** True if the current node's targets are known */
+    bool                known;
+    /**
+     * The current node's hash, followed by its target hashes,
+     * or empty, if the run has ended.
+     */
+    struct hdag_darr    hashes;
+};
+
+/**
+ * Read the next node record from a sorted run file.
+ *
+ * @param run   The run to read the next node record from.
+ *
+ * @return A universal result:
+ *         0 - the node record was read,
+ *         1 - the run has ended,
+ *         or a failure result.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_file_run_next(struct hdag_file_run *run)
+{
+    uint8_t *hashes;
+    uint64_t tag = 0;
+    unsigned int shift;
+    int c;
+
+    assert(run != NULL);
+    assert(run->stream != NULL);
+
+    /* Read the node hash, or stop at the end */
+    hdag_darr_empty(&run->hashes);
+    hashes = hdag_darr_uappend(&run->hashes, 1);
+    if (hashes == NULL) {
+        return HDAG_RES_ERRNO;
+    }
+    if (fread(hashes, run->hashes.slot_size, 1, run->stream) != 1) {
+        hdag_darr_empty(&run->hashes);
+        return ferror(run->stream) ? HDAG_RES_ERRNO : 1;
+    }
+
+    /* Read the tag */
+    for (shift = 0; shift < 64; shift += 7) {
+        if ((c = getc(run->stream)) == EOF) {
+            return ferror(run->stream) ? HDAG_RES_ERRNO
+                                       : HDAG_RES_INVALID_FORMAT;
+        }
+        tag |= (uint64_t)(c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            break;
+        }
+    }
+    run->known = tag != 0;
+
+    /* Read the target hashes, if any */
+    if (tag > 1) {
+        if (tag - 1 >= INT32_MAX) {
+            return HDAG_RES_INVALID_FORMAT;
+        }
+        hashes = hdag_darr_uappend(&run->hashes, tag - 1);
+        if (hashes == NULL) {
+            return HDAG_RES_ERRNO;
+        }
+        if (fread(hashes, run->hashes.slot_size, tag - 1,
+                  run->stream) != tag - 1) {
+            return ferror(run->stream) ? HDAG_RES_ERRNO
+                                       : HDAG_RES_INVALID_FORMAT;
+        }
+    }
+
+    return HDAG_RES_OK;
+}
+
+/**
+ * Sort and deduplicate the nodes of a bundle, spill them into a new sorted
+ * run file, and empty the bundle.
+ *
+ * @param runs      The dynamic array of runs to append the new run to.
+ * @param bundle    The (unorganized) bundle to spill.
+ *
+ * @return A void universal result, including HDAG_RES_NODE_CONFLICT, if
+ *         nodes with matching hashes but different targets were found.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_file_run_spill(struct hdag_darr *runs, struct hdag_bundle *bundle)
+{
+    hdag_res res = HDAG_RES_INVALID;
+    struct hdag_file_run *run;
+    const struct hdag_node *node;
+    ssize_t idx;
+
+    assert(runs != NULL);
+    assert(hdag_bundle_is_valid(bundle));
+    assert(hdag_bundle_is_unorganized(bundle));
+
+    hdag_bundle_sort(bundle);
+    HDAG_RES_TRY(hdag_bundle_dedup(bundle, NULL));
+
+    run = hdag_darr_cappend_one(runs);
+    if (run == NULL) {
+        goto cleanup;
+    }
+    run->hashes = HDAG_DARR_EMPTY(bundle->hash_len, 16);
+    run->stream = tmpfile();
+    if (run->stream == NULL) {
+        goto cleanup;
+    }
+
+    HDAG_DARR_ITER_FORWARD(&bundle->nodes, idx, node, (void)0, (void)0) {
+        HDAG_RES_TRY(hdag_file_run_write(
+            run->stream, bundle->hash_len, node->hash,
+            hdag_targets_are_known(&node->targets),
+            hdag_node_targets_count(node) == 0 ? NULL
+                : hdag_darr_element_const(&bundle->target_hashes,
+                                          hdag_node_get_first_ind_idx(node)),
+            hdag_node_targets_count(node)
+        ));
+    }
+    if (fflush(run->stream) != 0 || fseek(run->stream, 0, SEEK_SET) != 0) {
+        goto cleanup;
+    }
+
+    hdag_bundle_empty(bundle);
+    res = HDAG_RES_OK;
+cleanup:
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
+/**
+ * Restore the heap property of a heap of run indices, ordered by the hash
+ * of the current node of each run, by sifting an element down.
+ *
+ * @param runs      The array of runs the heap refers to.
+ * @param heap      The heap of indices of the runs.
+ * @param heap_num  The number of indices in the heap.
+ * @param pos       The position of the element to sift down.
+ * @param ops       The operations for the node hashes.
+ * @param hash_len  The length of the node hashes.
+ */
+static void
+hdag_file_run_heap_sift(const struct hdag_file_run *runs,
+                        size_t *heap, size_t heap_num, size_t pos,
+                        const struct hdag_hash_ops *ops, uint16_t hash_len)
+{
+    size_t child;
+    size_t run_idx = heap[pos];
+
+#define HASH(_heap_pos) ((const uint8_t *)runs[heap[_heap_pos]].hashes.slots)
+    while ((child = pos * 2 + 1) < heap_num) {
+        if (child + 1 < heap_num &&
+            ops->cmp(HASH(child + 1), HASH(child), hash_len) < 0) {
+            child++;
+        }
+        if (ops->cmp(runs[run_idx].hashes.slots, HASH(child),
+                     hash_len) <= 0) {
+            break;
+        }
+        heap[pos] = heap[child];
+        pos = child;
+    }
+#undef HASH
+    heap[pos] = run_idx;
+}
+
+/**
+ * Merge sorted run files into a single sorted run file, deduplicating the
+ * nodes, and fill in the header of the file to be created from it.
+ *
+ * @param pmerged   Location for the merged run's stream, positioned at
+ *                  the start. Not modified on failure.
+ * @param header    The header to fill in the node fanout, the number of
+ *                  extra edges, and the number of unknown hashes of.
+ * @param runs      The dynamic array of runs to merge.
+ *
+ * @return A void universal result, including HDAG_RES_NODE_CONFLICT, if
+ *         nodes with matching hashes but different targets were found.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_file_run_merge(FILE **pmerged,
+                    struct hdag_file_header *header,
+                    struct hdag_darr *runs)
+{
+    hdag_res                res = HDAG_RES_INVALID;
+    uint16_t                hash_len = header->hash_len;
+    const struct hdag_hash_ops *ops = hdag_hash_ops_get(hash_len);
+    struct hdag_file_run   *run_list = runs->slots;
+    size_t                  run_num = runs->slots_occupied;
+    struct hdag_file_run   *run;
+    size_t                 *heap = NULL;
+    size_t                  heap_num = 0;
+    FILE                   *merged = NULL;
+    /* The merged node's hash, followed by its target hashes */
+    struct hdag_darr        hashes = HDAG_DARR_EMPTY(hash_len, 16);
+    bool                    known;
+    size_t                  target_num;
+    size_t                  node_num = 0;
+    size_t                  i;
+
+    assert(pmerged != NULL);
+    assert(hdag_hash_len_is_valid(hash_len));
+
+    merged = tmpfile();
+    heap = malloc(sizeof(*heap) * run_num);
+    if (merged == NULL || heap == NULL) {
+        goto cleanup;
+    }
+
+    /* Put the first node of every run onto the heap */
+    for (i = 0; i < run_num; i++) {
+        if (!HDAG_RES_TRY(hdag_file_run_next(&run_list[i]))) {
+            heap[heap_num++] = i;
+        }
+    }
+    for (i = heap_num / 2; i-- > 0;) {
+        hdag_file_run_heap_sift(run_list, heap, heap_num, i,
+                                ops, hash_len);
+    }
+
+    /* While there are nodes left in the runs */
+    while (heap_num > 0) {
+        /* Start a merged node with the smallest hash */
+        run = &run_list[heap[0]];
+        hdag_darr_empty(&hashes);
+        if (hdag_darr_append_one(&hashes, run->hashes.slots) == NULL) {
+            goto cleanup;
+        }
+        known = false;
+
+        /* Merge all the nodes with the same hash */
+        do {
+            /* If these are the first known targets */
+            if (run->known && !known) {
+                known = true;
+                if (run->hashes.slots_occupied > 1 &&
+                    hdag_darr_append(
+                        &hashes,
+                        hdag_darr_element(&run->hashes, 1),
+                        run->hashes.slots_occupied - 1
+                    ) == NULL) {
+                    goto cleanup;
+                }
+            /* Else, if the targets are known and different */
+            } else if (run->known &&
+                       (run->hashes.slots_occupied != hashes.slots_occupied ||
+                        memcmp(run->hashes.slots, hashes.slots,
+                               hdag_darr_occupied_size(&hashes)) != 0)) {
+                res = HDAG_RES_NODE_CONFLICT;
+                goto cleanup;
+            }
+            /* Move onto the run's next node, or drop the run */
+            if (HDAG_RES_TRY(hdag_file_run_next(run))) {
+                heap[0] = heap[--heap_num];
+            }
+            if (heap_num > 0) {
+                hdag_file_run_heap_sift(run_list, heap, heap_num, 0,
+                                        ops, hash_len);
+                run = &run_list[heap[0]];
+            } else {
+                run = NULL;
+            }
+        } while (run != NULL &&
+                 ops->cmp(run->hashes.slots, hashes.slots, hash_len) == 0);
+
+        /* Output the merged node, accounting for it in the header */
+        target_num = hashes.slots_occupied - 1;
+        HDAG_RES_TRY(hdag_file_run_write(
+            merged, hash_len, hashes.slots, known,
+            target_num == 0 ? NULL : hdag_darr_element(&hashes, 1),
+            target_num
+        ));
+        if (++node_num >= INT32_MAX) {
+            errno = EFBIG;
+            goto cleanup;
+        }
+        header->node_fanout[*(uint8_t *)hashes.slots]++;
+        if (!known) {
+            header->unknown_hash_num++;
+        } else if (target_num > 2) {
+            header->extra_edge_num += target_num;
+        }
+    }
+
+    /* Turn the node counts into the fanout */
+    for (i = 1; i < HDAG_ARR_LEN(header->node_fanout); i++) {
+        header->node_fanout[i] += header->node_fanout[i - 1];
+    }
+
+    if (fflush(merged) != 0 || fseek(merged, 0, SEEK_SET) != 0) {
+        goto cleanup;
+    }
+
+    *pmerged = merged;
+    merged = NULL;
+    res = HDAG_RES_OK;
+cleanup:
+    hdag_darr_cleanup(&hashes);
+    if (merged != NULL) {
+        fclose(merged);
+    }
+    free(heap);
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
+/**
+ * Enumerate the generations and components of the (compacted) nodes of a
+ * file being created, in place.
+ *
+ * @param file  The file to enumerate the nodes of.
+ *
+ * @return A void universal result, including HDAG_RES_GRAPH_CYCLE, if the
+ *         graph has a cycle.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_file_enumerate(struct hdag_file *file)
+{
+    const struct hdag_file_header *header = file->header;
+    /* A bundle borrowing the file arrays, which must not be cleaned up */
+    struct hdag_bundle bundle = HDAG_BUNDLE_EMPTY(header->hash_len);
+
+    assert(hdag_file_is_valid(file));
+    assert(hdag_file_is_open(file));
+
+    bundle.nodes.slots = file->nodes;
+    bundle.nodes.slots_allocated = header->node_num;
+    bundle.nodes.slots_occupied = header->node_num;
+    memcpy(bundle.nodes_fanout, header->node_fanout,
+           sizeof(bundle.nodes_fanout));
+    bundle.unknown_hashes.slots = file->unknown_hashes;
+    bundle.unknown_hashes.slots_allocated = header->unknown_hash_num;
+    bundle.unknown_hashes.slots_occupied = header->unknown_hash_num;
+    bundle.extra_edges.slots = file->extra_edges;
+    bundle.extra_edges.slots_allocated = header->extra_edge_num;
+    bundle.extra_edges.slots_occupied = header->extra_edge_num;
+
+    return hdag_bundle_enumerate(&bundle, NULL);
+}
+
+/**
+ * Fill in the nodes, extra edges and unknown hashes of a file being
+ * created, from a merged sorted run file.
+ *
+ * @param file      The file to fill in. Must have the header filled in
+ *                  according to the merged run.
+ * @param merged    The merged run file stream, positioned at the start.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_file_fill_from_run(struct hdag_file *file, FILE *merged)
+{
+    hdag_res                res = HDAG_RES_INVALID;
+    uint16_t                hash_len = file->header->hash_len;
+    struct hdag_file_run    run = {
+        .stream = merged,
+        .hashes = HDAG_DARR_EMPTY(hash_len, 16),
+    };
+    struct hdag_node       *node;
+    uint8_t                *unknown_hash = file->unknown_hashes;
+    struct hdag_edge       *edge = file->extra_edges;
+    uint32_t                target_node_idx[2];
+    size_t                  target_num;
+    size_t                  node_idx;
+    size_t                  i;
+
+    assert(hdag_file_is_valid(file));
+    assert(hdag_file_is_open(file));
+    assert(merged != NULL);
+
+    /* Put the node hashes in place, so the targets could be found */
+    for (node_idx = 0; !HDAG_RES_TRY(hdag_file_run_next(&run)); node_idx++) {
+        assert(node_idx < file->header->node_num);
+        node = hdag_node_off(file->nodes, hash_len, node_idx);
+        memcpy(node->hash, run.hashes.slots, hash_len);
+        if (!run.known) {
+            memcpy(unknown_hash, run.hashes.slots, hash_len);
+            unknown_hash += hash_len;
+        }
+    }
+    assert(node_idx == file->header->node_num);
+    if (fseek(merged, 0, SEEK_SET) != 0) {
+        goto cleanup;
+    }
+
+    /* Convert the target hashes to node indexes, the way compacting does */
+    for (node_idx = 0; !HDAG_RES_TRY(hdag_file_run_next(&run)); node_idx++) {
+        node = hdag_node_off(file->nodes, hash_len, node_idx);
+        target_num = run.hashes.slots_occupied - 1;
+        if (!run.known) {
+            node->targets = HDAG_TARGETS_UNKNOWN;
+        } else if (target_num == 0) {
+            node->targets = HDAG_TARGETS_ABSENT;
+        } else if (target_num > 2) {
+            node->targets.first = hdag_target_from_ind_idx(
+                edge - file->extra_edges
+            );
+            for (i = 1; i <= target_num; i++, edge++) {
+                edge->node_idx = hdag_file_find_node_idx(
+                    file, hdag_darr_element(&run.hashes, i)
+                );
+                /* All hashes must be locatable */
+                assert(edge->node_idx < INT32_MAX);
+            }
+            node->targets.last = hdag_target_from_ind_idx(
+                edge - file->extra_edges - 1
+            );
+        } else {
+            for (i = 0; i < target_num; i++) {
+                target_node_idx[i] = hdag_file_find_node_idx(
+                    file, hdag_darr_element(&run.hashes, i + 1)
+                );
+                /* All hashes must be locatable */
+                assert(target_node_idx[i] < INT32_MAX);
+            }
+            node->targets.first = hdag_target_from_dir_idx(
+                target_node_idx[0]
+            );
+            node->targets.last = target_num > 1
+                ? hdag_target_from_dir_idx(target_node_idx[1])
+                : HDAG_TARGET_ABSENT;
+        }
+        assert(hdag_node_is_valid(node));
     }
-    free(file.pathname);
-    errno = orig_errno;
+
+    res = HDAG_RES_OK;
+cleanup:
+    hdag_darr_cleanup(&run.hashes);
     return HDAG_RES_ERRNO_IF_INVALID(res);
 }
 
 hdag_res
-hdag_file_to_bundle(struct hdag_bundle *pbundle,
-                    const struct hdag_file *file)
+hdag_file_from_node_seq_bounded(struct hdag_file *pfile,
+                                const char *pathname,
+                                int template_sfxlen,
+                                mode_t open_mode,
+                                struct hdag_node_seq *node_seq,
+                                size_t mem_size,
+                                bool profile)
 {
-    assert(hdag_file_is_valid(file));
+    hdag_res                res = HDAG_RES_INVALID;
+    uint16_t                hash_len = node_seq->hash_len;
+    struct hdag_bundle      bundle = HDAG_BUNDLE_EMPTY(hash_len);
+    struct hdag_darr        runs =
+        HDAG_DARR_EMPTY(sizeof(struct hdag_file_run), 16);
+    struct hdag_file_run   *run;
+    FILE                   *merged = NULL;
+    struct hdag_file        file = HDAG_FILE_CLOSED;
+    struct hdag_file_header header = {
+        .signature = HDAG_FILE_SIGNATURE,
+        .version = {0, 0},
+        .hash_len = hash_len,
+    };
+    ssize_t                 idx;
 
-    struct hdag_bundle bundle = HDAG_BUNDLE_EMPTY(file->header->hash_len);
+    assert(hdag_node_seq_is_valid(node_seq));
 
-    bundle.nodes = HDAG_DARR_IMMUTABLE(
-        file->nodes,
-        hdag_node_size(file->header->hash_len),
-        file->header->node_num
-    );
+    /* Build the file in place, if there's no budget */
+    if (mem_size == 0) {
+        return hdag_file_from_node_seq_profiled(pfile, pathname,
+                                                template_sfxlen, open_mode,
+                                                node_seq, profile);
+    }
 
-    memcpy(bundle.nodes_fanout, file->header->node_fanout,
-           sizeof(bundle.nodes_fanout));
+    /* Collect the nodes, spilling them into sorted runs over the budget */
+    HDAG_RES_TRY(hdag_bundle_reserve_node_seq(&bundle, node_seq, mem_size,
+                                              true));
+    while (!HDAG_RES_TRY(
+        hdag_bundle_add_node_seq(&bundle, node_seq, mem_size, true)
+    )) {
+        HDAG_RES_TRY(hdag_file_run_spill(&runs, &bundle));
+    }
 
-    bundle.unknown_hashes = HDAG_DARR_IMMUTABLE(
-        file->unknown_hashes,
-        file->header->hash_len,
-        file->header->unknown_hash_num
+    /* If nothing was spilled, build the file in memory */
+    if (runs.slots_occupied == 0) {
+        HDAG_RES_TRY(hdag_bundle_organize(&bundle, NULL));
+        HDAG_RES_TRY(hdag_file_from_bundle(pfile, pathname,
+                                           template_sfxlen, open_mode,
+                                           &bundle));
+        res = HDAG_RES_OK;
+        goto cleanup;
+    }
+
+    /* Spill the remaining nodes, and merge all the runs */
+    if (bundle.nodes.slots_occupied != 0) {
+        HDAG_RES_TRY(hdag_file_run_spill(&runs, &bundle));
+    }
+    hdag_bundle_cleanup(&bundle);
+    HDAG_PROFILE_STAGE(
+        profile, "Merging the sorted runs", header.node_num, "nodes",
+        HDAG_RES_TRY(hdag_file_run_merge(&merged, &header, &runs))
     );
 
-    bundle.extra_edges = HDAG_DARR_IMMUTABLE(
-        file->extra_edges,
-        sizeof(struct hdag_edge),
-        file->header->extra_edge_num
+    /* Create the file and fill it in from the merged run */
+    HDAG_RES_TRY(hdag_file_create(&file, pathname, template_sfxlen,
+                                  open_mode, &header));
+    HDAG_PROFILE_STAGE(
+        profile, "Filling in the file", header.node_num, "nodes",
+        HDAG_RES_TRY(hdag_file_fill_from_run(&file, merged))
+    );
+    HDAG_PROFILE_STAGE(
+        profile, "Enumerating the file", header.node_num, "nodes",
+        HDAG_RES_TRY(hdag_file_enumerate(&file))
     );
 
-    assert(hdag_bundle_is_valid(&bundle));
-    if (pbundle != NULL) {
-        *pbundle = bundle;
-        bundle = HDAG_BUNDLE_EMPTY(bundle.hash_len);
+    /* Output the opened file, if requested */
+    if (pfile == NULL) {
+        HDAG_RES_TRY(hdag_file_close(&file));
+    } else {
+        *pfile = file;
+        file = HDAG_FILE_CLOSED;
     }
+    res = HDAG_RES_OK;
 
+cleanup:
+    hdag_file_discard(&file);
+    if (merged != NULL) {
+        fclose(merged);
+    }
+    HDAG_DARR_ITER_FORWARD(&runs, idx, run, (void)0, (void)0) {
+        if (run->stream != NULL) {
+            fclose(run->stream);
+        }
+        hdag_darr_cleanup(&run->hashes);
+    }
+    hdag_darr_cleanup(&runs);
     hdag_bundle_cleanup(&bundle);
-    return HDAG_RES_OK;
+    return HDAG_RES_ERRNO_IF_INVALID(res);
 }
 
 hdag_res
-hdag_file_from_node_seq(struct hdag_file *pfile,
-                        const char *pathname,
-                        int template_sfxlen,
-                        mode_t open_mode,
-                        struct hdag_node_seq *node_seq)
+hdag_file_from_txt(struct hdag_file *pfile,
+                   const char *pathname,
+                   int template_sfxlen,
+                   mode_t open_mode,
+                   FILE *stream,
+                   uint16_t hash_len,
+                   unsigned int thread_num,
+                   bool profile)
 {
     hdag_res res = HDAG_RES_INVALID;
-    struct hdag_bundle bundle = HDAG_BUNDLE_EMPTY(node_seq->hash_len);
+    struct hdag_bundle bundle = HDAG_BUNDLE_EMPTY(hash_len);
+    struct hdag_file_build build = HDAG_FILE_BUILD_NONE;
 
-    assert(hdag_node_seq_is_valid(node_seq));
+    assert(stream != NULL);
+    assert(hdag_hash_len_is_valid(hash_len));
 
-    /* Ingest the nodes and their targets into the bundle */
-    HDAG_RES_TRY(hdag_bundle_organized_from_node_seq(&bundle, NULL,
-                                                     node_seq));
-    /* Create the file from the bundle */
-    HDAG_RES_TRY(hdag_file_from_bundle(pfile, pathname,
+    /* Have the nodes collected right in the file */
+    HDAG_RES_TRY(hdag_file_build_start(&build, pathname,
                                        template_sfxlen, open_mode,
                                        &bundle));
+    /*
+     * Ingest the stream into the bundle, sorting it by node fanout
+     * buckets, each partitioned while the other chunks are still parsed
+     */
+    HDAG_RES_TRY(hdag_bundle_add_txt_sorted(&bundle, stream, thread_num,
+                                            true, profile));
+    /* Organize the (sorted) bundle, and finish the file with it */
+    HDAG_RES_TRY(hdag_bundle_organize_parallel(&bundle, NULL, thread_num,
+                                               profile));
+    HDAG_PROFILE_STAGE(
+        profile, "Finishing the file", bundle.nodes.slots_occupied, "nodes",
+        HDAG_RES_TRY(hdag_file_build_finish(&build, pfile, &bundle))
+    );
     res = HDAG_RES_OK;
 
 cleanup:
     hdag_bundle_cleanup(&bundle);
+    hdag_file_build_cleanup(&build);
     return res;
 }
 
 hdag_res
-hdag_file_from_txt(struct hdag_file *pfile,
+hdag_file_from_bin(struct hdag_file *pfile,
                    const char *pathname,
                    int template_sfxlen,
                    mode_t open_mode,
                    FILE *stream,
-                   uint16_t hash_len)
+                   size_t mem_size,
+                   bool profile)
 {
     hdag_res res = HDAG_RES_INVALID;
-    struct hdag_bundle bundle = HDAG_BUNDLE_EMPTY(hash_len);
+    char *map = NULL;
+    size_t map_size = 0;
+    size_t offset = 0;
+    char *buf = NULL;
+    size_t buf_size = 0;
+    const char *data;
+    size_t len = 0;
+    struct hdag_bin_node_seq seq;
 
     assert(stream != NULL);
-    assert(hdag_hash_len_is_valid(hash_len));
 
-    /* Ingest the stream into the bundle */
-    HDAG_RES_TRY(hdag_bundle_organized_from_txt(&bundle, NULL,
-                                                stream, hash_len));
-    /* Create the file from the bundle */
-    HDAG_RES_TRY(hdag_file_from_bundle(pfile, pathname,
-                                       template_sfxlen, open_mode,
-                                       &bundle));
+    /* Get the whole stream into memory, mapping it, if possible */
+    if (hdag_stream_map(stream, &map, &map_size, &offset)) {
+        data = map + offset;
+        len = map_size - offset;
+    } else {
+        HDAG_RES_TRY(hdag_stream_read_all(stream, &buf, &buf_size, &len));
+        data = buf;
+    }
+    /* Ingest the nodes straight from memory */
+    HDAG_RES_TRY(hdag_bin_node_seq_init(&seq, data, len));
+    HDAG_RES_TRY(hdag_file_from_node_seq_bounded(pfile, pathname,
+                                                 template_sfxlen, open_mode,
+                                                 &seq.base, mem_size,
+                                                 profile));
+    /* Position a mapped stream after the whole contents */
+    HDAG_RES_TRY(hdag_stream_unmap(stream, &map, map_size, map_size));
     res = HDAG_RES_OK;
 
 cleanup:
-    hdag_bundle_cleanup(&bundle);
-    return res;
+    (void)hdag_stream_unmap(stream, &map, map_size, offset);
+    free(buf);
+    return HDAG_RES_ERRNO_IF_INVALID(res);
 }
 
 hdag_res
@@ -322,24 +1560,17 @@ hdag_file_open(struct hdag_file *pfile,
     file.header = file.contents;
     if (
         !hdag_file_header_is_valid(file.header) ||
-        file.size != hdag_file_size(
+        file.size < hdag_file_size(
             file.header->hash_len,
             file.header->node_num,
             file.header->extra_edge_num,
             file.header->unknown_hash_num
-        )
+        ) ||
+        !hdag_file_set_pointers(&file)
     ) {
         errno = EINVAL;
         goto cleanup;
     }
-    file.nodes = (struct hdag_node *)(file.header + 1);
-    file.extra_edges = (struct hdag_edge *)(
-        (uint8_t *)file.nodes +
-        hdag_node_size(file.header->hash_len) * file.header->node_num
-    );
-    file.unknown_hashes =
-        (uint8_t *)file.extra_edges +
-        sizeof(struct hdag_edge) * file.header->extra_edge_num;
 
     /* The file state should be valid now */
     assert(hdag_file_is_valid(&file));
@@ -366,6 +1597,254 @@ cleanup:
     return HDAG_RES_ERRNO_IF_INVALID(res);
 }
 
+hdag_res
+hdag_file_add_index(struct hdag_file *file)
+{
+    hdag_res res = HDAG_RES_INVALID;
+    uint16_t hash_len = file->header->hash_len;
+    size_t node_num = file->header->node_num;
+    size_t old_size = file->size;
+    struct hdag_file_section section = {
+        .type = HDAG_FILE_SECTION_INDEX,
+        .size = hdag_file_index_size(node_num),
+    };
+    const struct hdag_node *nodes;
+    uint32_t *prefixes;
+    uint32_t *node_idxs;
+    bool valid;
+    size_t idx;
+    size_t k;
+
+    assert(hdag_file_is_valid(file));
+    assert(hdag_file_is_open(file));
+
+    if (file->index_prefixes != NULL) {
+        return HDAG_RES_OK;
+    }
+    if (hdag_file_index_size(node_num) > UINT32_MAX) {
+        errno = EFBIG;
+        goto cleanup;
+    }
+
+    HDAG_RES_TRY(hdag_file_extend(file, old_size + sizeof(section) +
+                                        section.size));
+    nodes = (const struct hdag_node *)(file->header + 1);
+    memcpy((uint8_t *)file->contents + old_size, &section, sizeof(section));
+    prefixes = (uint32_t *)
+        ((uint8_t *)file->contents + old_size + sizeof(section));
+    node_idxs = prefixes + node_num + 1;
+    prefixes[0] = node_idxs[0] = node_num;
+
+    /*
+     * Walk the implicit tree in order, starting with the leftmost node,
+     * and assign the (sorted) nodes to its elements
+     */
+    for (k = 1; 2 * k <= node_num; k *= 2);
+    for (idx = 0; idx < node_num; idx++) {
+        prefixes[k] = hdag_file_index_prefix(
+            hdag_node_off_const(nodes, hash_len, idx)->hash
+        );
+        node_idxs[k] = idx;
+        /* If there's a right subtree, go to its leftmost element */
+        if (2 * k + 1 <= node_num) {
+            for (k = 2 * k + 1; 2 * k <= node_num; k *= 2);
+        /* Else climb while coming from the right, and then once more */
+        } else {
+            k >>= __builtin_ffsll(~(unsigned long long)k);
+        }
+    }
+
+    valid = hdag_file_set_pointers(file);
+    assert(valid);
+    (void)valid;
+    assert(hdag_file_is_valid(file));
+    res = HDAG_RES_OK;
+cleanup:
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
+hdag_res
+hdag_file_add_fanout16(struct hdag_file *file)
+{
+    hdag_res res = HDAG_RES_INVALID;
+    size_t old_size = file->size;
+    struct hdag_file_section section = {
+        .type = HDAG_FILE_SECTION_FANOUT16,
+        .size = sizeof(uint32_t) * HDAG_FANOUT16_LEN,
+    };
+    uint32_t *fanout16;
+    bool valid;
+
+    assert(hdag_file_is_valid(file));
+    assert(hdag_file_is_open(file));
+
+    if (file->fanout16 != NULL) {
+        return HDAG_RES_OK;
+    }
+
+    HDAG_RES_TRY(hdag_file_extend(file, old_size + sizeof(section) +
+                                        section.size));
+    memcpy((uint8_t *)file->contents + old_size, &section, sizeof(section));
+    fanout16 = (uint32_t *)
+        ((uint8_t *)file->contents + old_size + sizeof(section));
+    hdag_nodes_fanout16_fill(fanout16,
+                             (const struct hdag_node *)(file->header + 1),
+                             file->header->node_num,
+                             file->header->hash_len);
+
+    valid = hdag_file_set_pointers(file);
+    assert(valid);
+    (void)valid;
+    assert(hdag_file_is_valid(file));
+    res = HDAG_RES_OK;
+cleanup:
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
+hdag_res
+hdag_file_add_bloom(struct hdag_file *file, unsigned int bits_per_hash)
+{
+    hdag_res res = HDAG_RES_INVALID;
+    uint16_t hash_len = file->header->hash_len;
+    size_t node_num = file->header->node_num;
+    size_t old_size = file->size;
+    /* The offset of the section contents in the file */
+    size_t off = old_size + sizeof(struct hdag_file_section);
+    struct hdag_file_bloom bloom;
+    struct hdag_file_section section = {
+        .type = HDAG_FILE_SECTION_BLOOM,
+    };
+    const struct hdag_node *nodes;
+    uint32_t *blocks;
+    uint32_t *block;
+    uint64_t mix;
+    size_t block_num;
+    size_t word;
+    size_t idx;
+    bool valid;
+
+    assert(hdag_file_is_valid(file));
+    assert(hdag_file_is_open(file));
+    assert(bits_per_hash > 0);
+
+    if (file->bloom != NULL) {
+        return HDAG_RES_OK;
+    }
+
+    /* Size the filter, aligning the blocks within the file */
+    block_num = (node_num * bits_per_hash +
+                 HDAG_FILE_BLOOM_BLOCK_SIZE * 8 - 1) /
+        (HDAG_FILE_BLOOM_BLOCK_SIZE * 8);
+    if (block_num == 0) {
+        block_num = 1;
+    }
+    bloom.block_off = sizeof(bloom) +
+        (-(off + sizeof(bloom)) & (HDAG_FILE_BLOOM_BLOCK_SIZE - 1));
+    if (block_num > (UINT32_MAX - bloom.block_off) /
+                    HDAG_FILE_BLOOM_BLOCK_SIZE) {
+        errno = EFBIG;
+        goto cleanup;
+    }
+    bloom.block_num = block_num;
+    section.size = bloom.block_off + block_num * HDAG_FILE_BLOOM_BLOCK_SIZE;
+
+    HDAG_RES_TRY(hdag_file_extend(file, off + section.size));
+    nodes = (const struct hdag_node *)(file->header + 1);
+    memcpy((uint8_t *)file->contents + old_size, &section, sizeof(section));
+    memcpy((uint8_t *)file->contents + off, &bloom, sizeof(bloom));
+    blocks = (uint32_t *)((uint8_t *)file->contents + off + bloom.block_off);
+
+    /* Set the bits of every node's hash, the known and the unknown ones */
+    for (idx = 0; idx < node_num; idx++) {
+        mix = hdag_file_bloom_mix(
+            hdag_node_off_const(nodes, hash_len, idx)->hash, hash_len
+        );
+        block = blocks + HDAG_FILE_BLOOM_BLOCK_WORDS *
+            (((mix >> 32) * block_num) >> 32);
+        for (word = 0; word < HDAG_FILE_BLOOM_BLOCK_WORDS; word++) {
+            block[word] |= hdag_file_bloom_bit(mix, word);
+        }
+    }
+
+    valid = hdag_file_set_pointers(file);
+    assert(valid);
+    (void)valid;
+    assert(hdag_file_is_valid(file));
+    res = HDAG_RES_OK;
+cleanup:
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
+hdag_res
+hdag_file_add_intervals(struct hdag_file *file, uint32_t interval_num)
+{
+    hdag_res res = HDAG_RES_INVALID;
+    size_t old_size = file->size;
+    size_t node_num = file->header->node_num;
+    struct hdag_bundle bundle = HDAG_BUNDLE_EMPTY(file->header->hash_len);
+    struct hdag_darr node_intervals =
+        HDAG_DARR_EMPTY(sizeof(struct hdag_interval) * interval_num, 0);
+    struct hdag_file_intervals intervals = {
+        .interval_num = interval_num,
+    };
+    struct hdag_file_section section = {
+        .type = HDAG_FILE_SECTION_INTERVALS,
+    };
+    size_t size;
+    bool valid;
+
+    assert(hdag_file_is_valid(file));
+    assert(hdag_file_is_open(file));
+    assert(interval_num > 0);
+
+    if (file->intervals != NULL) {
+        return HDAG_RES_OK;
+    }
+
+    size = sizeof(intervals);
+    if (node_num != 0 &&
+        interval_num > (UINT32_MAX - size) /
+                       sizeof(struct hdag_interval) / node_num) {
+        errno = EFBIG;
+        goto cleanup;
+    }
+    size += sizeof(struct hdag_interval) * interval_num * node_num;
+    section.size = size;
+
+    /* Build the intervals over the file's nodes */
+    HDAG_RES_TRY(hdag_file_to_bundle(&bundle, file));
+    HDAG_RES_TRY(hdag_bundle_intervals_fill(&bundle, interval_num));
+    /*
+     * Take the intervals and let go of the bundle, as it refers to the
+     * file's contents, which can move when extended
+     */
+    node_intervals = bundle.node_intervals;
+    bundle.node_intervals = HDAG_DARR_EMPTY(node_intervals.slot_size, 0);
+    hdag_bundle_cleanup(&bundle);
+
+    HDAG_RES_TRY(hdag_file_extend(file, old_size + sizeof(section) +
+                                        section.size));
+    memcpy((uint8_t *)file->contents + old_size, &section, sizeof(section));
+    memcpy((uint8_t *)file->contents + old_size + sizeof(section),
+           &intervals, sizeof(intervals));
+    if (node_num != 0) {
+        memcpy((uint8_t *)file->contents + old_size + sizeof(section) +
+               sizeof(intervals),
+               node_intervals.slots,
+               hdag_darr_occupied_size(&node_intervals));
+    }
+
+    valid = hdag_file_set_pointers(file);
+    assert(valid);
+    (void)valid;
+    assert(hdag_file_is_valid(file));
+    res = HDAG_RES_OK;
+cleanup:
+    hdag_darr_cleanup(&node_intervals);
+    hdag_bundle_cleanup(&bundle);
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
 hdag_res
 hdag_file_close(struct hdag_file *pfile)
 {
@@ -385,3 +1864,134 @@ hdag_file_close(struct hdag_file *pfile)
 cleanup:
     return HDAG_RES_ERRNO_IF_INVALID(res);
 }
+
+hdag_res
+hdag_file_is_ancestor_idx(const struct hdag_file *file,
+                          uint32_t from_idx, uint32_t to_idx)
+{
+    hdag_res res = HDAG_RES_INVALID;
+    struct hdag_bundle bundle = HDAG_BUNDLE_EMPTY(file->header->hash_len);
+
+    assert(hdag_file_is_valid(file));
+    assert(hdag_file_is_open(file));
+    assert(from_idx < file->header->node_num);
+    assert(to_idx < file->header->node_num);
+
+    /* Walk the file's nodes through a bundle borrowing them */
+    HDAG_RES_TRY(hdag_file_to_bundle(&bundle, file));
+    res = HDAG_RES_TRY(hdag_bundle_is_ancestor_idx(&bundle,
+                                                   from_idx, to_idx));
+
+cleanup:
+    hdag_bundle_cleanup(&bundle);
+    return res;
+}
+
+hdag_res
+hdag_file_is_ancestor(const struct hdag_file *file,
+                      const uint8_t *from_hash, const uint8_t *to_hash)
+{
+    uint32_t from_idx;
+    uint32_t to_idx;
+
+    assert(hdag_file_is_valid(file));
+    assert(hdag_file_is_open(file));
+    assert(from_hash != NULL);
+    assert(to_hash != NULL);
+
+    from_idx = hdag_file_find_node_idx(file, from_hash);
+    to_idx = hdag_file_find_node_idx(file, to_hash);
+    if (from_idx >= INT32_MAX || to_idx >= INT32_MAX) {
+        return HDAG_RES_ERRNO_ARG(ENOENT);
+    }
+    return hdag_file_is_ancestor_idx(file, from_idx, to_idx);
+}
+
+hdag_res
+hdag_file_merge_bases_idx(const struct hdag_file *file,
+                          const uint32_t *node_idxs, size_t node_num,
+                          struct hdag_darr *bases)
+{
+    hdag_res res = HDAG_RES_INVALID;
+    struct hdag_bundle bundle = HDAG_BUNDLE_EMPTY(file->header->hash_len);
+
+    assert(hdag_file_is_valid(file));
+    assert(hdag_file_is_open(file));
+
+    /* Walk the file's nodes through a bundle borrowing them */
+    HDAG_RES_TRY(hdag_file_to_bundle(&bundle, file));
+    res = HDAG_RES_TRY(hdag_bundle_merge_bases_idx(&bundle,
+                                                   node_idxs, node_num,
+                                                   bases));
+
+cleanup:
+    hdag_bundle_cleanup(&bundle);
+    return res;
+}
+
+hdag_res
+hdag_file_merge_bases(const struct hdag_file *file,
+                      const uint8_t *hashes, size_t hash_num,
+                      struct hdag_darr *bases)
+{
+    hdag_res res = HDAG_RES_INVALID;
+    struct hdag_bundle bundle = HDAG_BUNDLE_EMPTY(file->header->hash_len);
+
+    assert(hdag_file_is_valid(file));
+    assert(hdag_file_is_open(file));
+
+    /* Look the heads up and walk through a bundle borrowing the nodes */
+    HDAG_RES_TRY(hdag_file_to_bundle(&bundle, file));
+    res = HDAG_RES_TRY(hdag_bundle_merge_bases(&bundle, hashes, hash_num,
+                                               bases));
+
+cleanup:
+    hdag_bundle_cleanup(&bundle);
+    return res;
+}
+
+hdag_res
+hdag_file_issue_fixes_idx(const struct hdag_file *file,
+                          const uint8_t *mentions,
+                          const uint32_t *node_idxs, size_t node_num,
+                          enum hdag_fix *fixes)
+{
+    hdag_res res = HDAG_RES_INVALID;
+    struct hdag_bundle bundle = HDAG_BUNDLE_EMPTY(file->header->hash_len);
+
+    assert(hdag_file_is_valid(file));
+    assert(hdag_file_is_open(file));
+
+    /* Walk the file's nodes through a bundle borrowing them */
+    HDAG_RES_TRY(hdag_file_to_bundle(&bundle, file));
+    HDAG_RES_TRY(hdag_bundle_issue_fixes_idx(&bundle, mentions,
+                                             node_idxs, node_num, fixes));
+    res = HDAG_RES_OK;
+
+cleanup:
+    hdag_bundle_cleanup(&bundle);
+    return res;
+}
+
+hdag_res
+hdag_file_issue_fixes(const struct hdag_file *file,
+                      const uint8_t *mentions,
+                      const uint8_t *hashes, size_t hash_num,
+                      enum hdag_fix *fixes)
+{
+    hdag_res res = HDAG_RES_INVALID;
+    struct hdag_bundle bundle = HDAG_BUNDLE_EMPTY(file->header->hash_len);
+
+    assert(hdag_file_is_valid(file));
+    assert(hdag_file_is_open(file));
+
+    /* Look the nodes up and walk through a bundle borrowing them */
+    HDAG_RES_TRY(hdag_file_to_bundle(&bundle, file));
+    HDAG_RES_TRY(hdag_bundle_issue_fixes(&bundle, mentions,
+                                         hashes, hash_num, fixes));
+    res = HDAG_RES_OK;
+
+cleanup:
+    hdag_bundle_cleanup(&bundle);
+    return res;
+}
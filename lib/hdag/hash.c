@@ -3,10 +3,11 @@
  */
 
 #include <hdag/hash.h>
-#include <string.h>
+#include <hdag/hash_ops.h>
 
 int
 hdag_hash_cmp(const void *a, const void *b, void *plen)
 {
-    return memcmp(a, b, *(uint16_t *)plen);
+    uint16_t hash_len = *(uint16_t *)plen;
+    return hdag_hash_ops_get(hash_len)->cmp(a, b, hash_len);
 }
@@ -0,0 +1,511 @@
+/*
+ * Hash DAG hash operations specialized for hash lengths
+ */
+
+#include <hdag/hash_ops.h>
+#include <hdag/fanout.h>
+#include <endian.h>
+#include <string.h>
+
+/**
+ * Compare two hashes lexicographically, word by word, as big-endian
+ * integers. Expected to be inlined with a constant length, to unroll into
+ * a few loads and compares.
+ *
+ * @param a         The first hash to compare.
+ * @param b         The second hash to compare.
+ * @param hash_len  The length of the hashes. Must be a multiple of four.
+ *
+ * @return -1, if a < b
+ *          0, if a == b
+ *          1, if a > b
+ */
+static inline int
+hdag_hash_ops_words_cmp(const uint8_t *a, const uint8_t *b,
+                        uint16_t hash_len)
+{
+    uint64_t    a64, b64;
+    uint32_t    a32, b32;
+    size_t      off;
+
+    for (off = 0; off + sizeof(a64) <= hash_len; off += sizeof(a64)) {
+        memcpy(&a64, a + off, sizeof(a64));
+        memcpy(&b64, b + off, sizeof(b64));
+        if (a64 != b64) {
+            return be64toh(a64) < be64toh(b64) ? -1 : 1;
+        }
+    }
+    if (off < hash_len) {
+        memcpy(&a32, a + off, sizeof(a32));
+        memcpy(&b32, b + off, sizeof(b32));
+        if (a32 != b32) {
+            return be32toh(a32) < be32toh(b32) ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Find a node in a slice of node array, by hash, using a specified hash
+ * comparison function. Expected to be inlined with a constant length and
+ * function. See hdag_nodes_slice_find() for details.
+ */
+static inline uint32_t
+hdag_hash_ops_nodes_slice_find_with(
+    const struct hdag_node *nodes,
+    size_t start_idx, size_t end_idx,
+    uint16_t hash_len,
+    const uint8_t *hash_ptr,
+    int (*cmp)(const uint8_t *a, const uint8_t *b, uint16_t hash_len))
+{
+    int relation;
+    size_t middle_idx;
+
+    assert(start_idx < INT32_MAX);
+    assert(end_idx < INT32_MAX);
+    assert(start_idx <= end_idx);
+    assert(nodes != NULL || end_idx == 0);
+    assert(hdag_hash_len_is_valid(hash_len));
+    assert(hash_ptr != NULL);
+
+    while (start_idx < end_idx) {
+        middle_idx = (start_idx + end_idx) >> 1;
+        relation = cmp(hash_ptr,
+                       hdag_node_off_const(nodes, hash_len,
+                                           middle_idx)->hash,
+                       hash_len);
+        if (relation == 0) {
+            return middle_idx;
+        } if (relation > 0) {
+            start_idx = middle_idx + 1;
+        } else {
+            end_idx = middle_idx;
+        }
+    }
+
+    /* Not found */
+    return INT32_MAX;
+}
+
+/**
+ * The maximum number of interpolation probes to make, before falling back
+ * to the binary search, in case the hashes are not uniformly distributed.
+ */
+#define HDAG_HASH_OPS_INTERP_PROBES_MAX 4
+
+/**
+ * Get the first eight bytes of a hash (zero-padded, if shorter), as a
+ * big-endian number.
+ *
+ * @param hash      The hash to get the key of.
+ * @param hash_len  The length of the hash.
+ *
+ * @return The hash key.
+ */
+static inline uint64_t
+hdag_hash_ops_key(const uint8_t *hash, uint16_t hash_len)
+{
+    uint64_t key = 0;
+    memcpy(&key, hash, hash_len < sizeof(key) ? hash_len : sizeof(key));
+    return be64toh(key);
+}
+
+/**
+ * Find a node in a slice of node array, by hash, with the interpolation
+ * search, using a specified hash comparison function. Expected to be
+ * inlined with a constant length and function. See
+ * hdag_nodes_slice_interp_find() for details.
+ */
+static inline uint32_t
+hdag_hash_ops_nodes_slice_interp_find_with(
+    const struct hdag_node *nodes,
+    size_t start_idx, size_t end_idx,
+    uint16_t hash_len,
+    const uint8_t *hash_ptr,
+    unsigned int common_bits,
+    int (*cmp)(const uint8_t *a, const uint8_t *b, uint16_t hash_len))
+{
+    const struct hdag_node *node;
+    uint64_t key = hdag_hash_ops_key(hash_ptr, hash_len);
+    uint64_t node_key;
+    /* The bits of the keys which can differ in the slice */
+    uint64_t mask = common_bits >= 64 ? 0 : UINT64_MAX >> common_bits;
+    /* The bounds of the keys possible in the slice */
+    uint64_t lo_key = key & ~mask;
+    uint64_t hi_key = key | mask;
+    /* The positions of the bounds, exclusive (lo is off by one) */
+    size_t lo = start_idx;
+    size_t hi = end_idx;
+    size_t idx;
+    unsigned int probe;
+    int relation;
+
+    assert(start_idx < INT32_MAX);
+    assert(end_idx < INT32_MAX);
+    assert(start_idx <= end_idx);
+    assert(nodes != NULL || end_idx == 0);
+    assert(hdag_hash_len_is_valid(hash_len));
+    assert(hash_ptr != NULL);
+    assert(common_bits <= 64);
+
+    /*
+     * Probe where the key would be, if the keys between the bounds were
+     * evenly spread, and narrow the bounds down
+     */
+    for (probe = 0;
+         probe < HDAG_HASH_OPS_INTERP_PROBES_MAX && lo < hi &&
+         lo_key <= key && key <= hi_key;
+         probe++) {
+        /* Floating point is much faster than 128-bit integer division */
+        idx = lo + (size_t)((double)(key - lo_key) /
+                            ((double)(hi_key - lo_key) + 1.0) *
+                            (double)(hi - lo));
+        /* Stay within the bounds despite rounding */
+        if (idx >= hi) {
+            idx = hi - 1;
+        }
+        node = hdag_node_off_const(nodes, hash_len, idx);
+        relation = cmp(hash_ptr, node->hash, hash_len);
+        if (relation == 0) {
+            return idx;
+        }
+        node_key = hdag_hash_ops_key(node->hash, hash_len);
+        if (relation > 0) {
+            lo = idx + 1;
+            lo_key = node_key;
+        } else {
+            hi = idx;
+            hi_key = node_key;
+        }
+    }
+
+    /* Finish with the binary search */
+    return hdag_hash_ops_nodes_slice_find_with(nodes, lo, hi, hash_len,
+                                               hash_ptr, cmp);
+}
+
+/**
+ * The number of hashes to search for at once, in a batch lookup.
+ * Enough to keep the memory busy with their (prefetched) node loads.
+ */
+#define HDAG_HASH_OPS_FIND_BATCH_GROUP  32
+
+/**
+ * Find nodes in a node array, by a batch of hashes, using a specified hash
+ * comparison function. Expected to be inlined with a constant length and
+ * function. See hdag_nodes_find_batch() for details.
+ */
+static inline void
+hdag_hash_ops_nodes_find_batch_with(
+    const struct hdag_node *nodes,
+    const uint32_t *fanout,
+    unsigned int fanout_bits,
+    uint16_t hash_len,
+    const uint8_t *hashes,
+    size_t hash_num,
+    uint32_t *node_idxs,
+    int (*cmp)(const uint8_t *a, const uint8_t *b, uint16_t hash_len))
+{
+    /* The fanout positions, and then the slices, of the group's hashes */
+    size_t start_idxs[HDAG_HASH_OPS_FIND_BATCH_GROUP];
+    size_t end_idxs[HDAG_HASH_OPS_FIND_BATCH_GROUP];
+    const uint8_t *hash;
+    size_t group_start;
+    size_t group_num;
+    size_t middle_idx;
+    size_t searching;
+    size_t i;
+    int relation;
+
+    assert(fanout != NULL);
+    assert(fanout_bits == 8 || fanout_bits == 16);
+    assert(hdag_hash_len_is_valid(hash_len));
+    assert(hashes != NULL || hash_num == 0);
+    assert(node_idxs != NULL || hash_num == 0);
+
+    for (group_start = 0; group_start < hash_num;
+         group_start += group_num) {
+        group_num = hash_num - group_start;
+        if (group_num > HDAG_HASH_OPS_FIND_BATCH_GROUP) {
+            group_num = HDAG_HASH_OPS_FIND_BATCH_GROUP;
+        }
+
+        /* Fetch the fanout elements of all the hashes at once */
+        for (i = 0; i < group_num; i++) {
+            hash = hashes + (group_start + i) * hash_len;
+            start_idxs[i] = fanout_bits == 16 ? hdag_fanout16_pos(hash)
+                                              : hash[0];
+            __builtin_prefetch(fanout + start_idxs[i]);
+        }
+        for (i = 0; i < group_num; i++) {
+            end_idxs[i] = fanout[start_idxs[i]];
+            start_idxs[i] = start_idxs[i] == 0 ? 0
+                                               : fanout[start_idxs[i] - 1];
+            node_idxs[group_start + i] = INT32_MAX;
+        }
+
+        /*
+         * Advance the binary searches in lockstep, prefetching the middle
+         * nodes of all of them, before comparing any
+         */
+        do {
+            for (i = 0; i < group_num; i++) {
+                if (start_idxs[i] < end_idxs[i]) {
+                    middle_idx = (start_idxs[i] + end_idxs[i]) >> 1;
+                    __builtin_prefetch(
+                        hdag_node_off_const(nodes, hash_len,
+                                            middle_idx)->hash
+                    );
+                }
+            }
+            searching = 0;
+            for (i = 0; i < group_num; i++) {
+                if (start_idxs[i] >= end_idxs[i]) {
+                    continue;
+                }
+                middle_idx = (start_idxs[i] + end_idxs[i]) >> 1;
+                relation = cmp(hashes + (group_start + i) * hash_len,
+                               hdag_node_off_const(nodes, hash_len,
+                                                   middle_idx)->hash,
+                               hash_len);
+                if (relation == 0) {
+                    node_idxs[group_start + i] = middle_idx;
+                }
+                /* Narrow down without branches, emptying if found */
+                start_idxs[i] = relation >= 0 ? middle_idx + 1
+                                              : start_idxs[i];
+                end_idxs[i] = relation <= 0 ? middle_idx : end_idxs[i];
+                searching += start_idxs[i] < end_idxs[i];
+            }
+        } while (searching != 0);
+    }
+}
+
+/**
+ * Find a hash in a slice of a hash array, using a specified hash
+ * comparison function. Expected to be inlined with a constant length and
+ * function. See hdag_hashes_slice_find() for details.
+ */
+static inline bool
+hdag_hash_ops_hashes_slice_find_with(
+    const uint8_t *hashes,
+    uint16_t hash_len,
+    size_t start_idx, size_t end_idx,
+    const uint8_t *hash_ptr,
+    size_t *phash_idx,
+    int (*cmp)(const uint8_t *a, const uint8_t *b, uint16_t hash_len))
+{
+    int relation = -1;
+    size_t middle_idx;
+
+    assert(start_idx <= end_idx);
+    assert(hashes != NULL || end_idx == 0);
+    assert(hdag_hash_len_is_valid(hash_len));
+    assert(hash_ptr != NULL);
+
+    while (start_idx < end_idx) {
+        middle_idx = (start_idx + end_idx) >> 1;
+        relation = cmp(hash_ptr, hashes + middle_idx * hash_len, hash_len);
+        if (relation == 0) {
+            start_idx = middle_idx;
+            break;
+        } if (relation > 0) {
+            start_idx = middle_idx + 1;
+        } else {
+            end_idx = middle_idx;
+        }
+    }
+
+    if (phash_idx != NULL) {
+        *phash_idx = start_idx;
+    }
+    return relation == 0;
+}
+
+/** Compare two hashes of any length, with memcmp(3) */
+static int
+hdag_hash_ops_cmp_generic(const uint8_t *a, const uint8_t *b,
+                          uint16_t hash_len)
+{
+    return memcmp(a, b, hash_len);
+}
+
+/** Find a node by a hash of any length */
+static uint32_t
+hdag_hash_ops_nodes_slice_find_generic(const struct hdag_node *nodes,
+                                       size_t start_idx, size_t end_idx,
+                                       uint16_t hash_len,
+                                       const uint8_t *hash_ptr)
+{
+    return hdag_hash_ops_nodes_slice_find_with(
+        nodes, start_idx, end_idx, hash_len, hash_ptr,
+        hdag_hash_ops_cmp_generic
+    );
+}
+
+/** Find a node by a hash of any length, with the interpolation search */
+static uint32_t
+hdag_hash_ops_nodes_slice_interp_find_generic(
+    const struct hdag_node *nodes,
+    size_t start_idx, size_t end_idx,
+    uint16_t hash_len,
+    const uint8_t *hash_ptr,
+    unsigned int common_bits)
+{
+    return hdag_hash_ops_nodes_slice_interp_find_with(
+        nodes, start_idx, end_idx, hash_len, hash_ptr, common_bits,
+        hdag_hash_ops_cmp_generic
+    );
+}
+
+/** Find nodes by a batch of hashes of any length */
+static void
+hdag_hash_ops_nodes_find_batch_generic(const struct hdag_node *nodes,
+                                       const uint32_t *fanout,
+                                       unsigned int fanout_bits,
+                                       uint16_t hash_len,
+                                       const uint8_t *hashes,
+                                       size_t hash_num,
+                                       uint32_t *node_idxs)
+{
+    hdag_hash_ops_nodes_find_batch_with(
+        nodes, fanout, fanout_bits, hash_len, hashes, hash_num, node_idxs,
+        hdag_hash_ops_cmp_generic
+    );
+}
+
+/** Find a hash of any length */
+static bool
+hdag_hash_ops_hashes_slice_find_generic(const uint8_t *hashes,
+                                        uint16_t hash_len,
+                                        size_t start_idx, size_t end_idx,
+                                        const uint8_t *hash_ptr,
+                                        size_t *phash_idx)
+{
+    return hdag_hash_ops_hashes_slice_find_with(
+        hashes, hash_len, start_idx, end_idx, hash_ptr, phash_idx,
+        hdag_hash_ops_cmp_generic
+    );
+}
+
+/** The generic hash operations, for hashes of any length */
+static const struct hdag_hash_ops hdag_hash_ops_generic = {
+    .hash_len = 0,
+    .cmp = hdag_hash_ops_cmp_generic,
+    .nodes_slice_find = hdag_hash_ops_nodes_slice_find_generic,
+    .nodes_slice_interp_find =
+        hdag_hash_ops_nodes_slice_interp_find_generic,
+    .nodes_find_batch = hdag_hash_ops_nodes_find_batch_generic,
+    .hashes_slice_find = hdag_hash_ops_hashes_slice_find_generic,
+};
+
+/**
+ * Define hash operations specialized for a hash length, named
+ * hdag_hash_ops_<_len>.
+ *
+ * @param _len  The hash length to specialize the operations for.
+ *              Must be a valid hash length literal.
+ */
+#define HDAG_HASH_OPS_DEFINE(_len) \
+    static int                                                          \
+    hdag_hash_ops_cmp_##_len(const uint8_t *a, const uint8_t *b,        \
+                             uint16_t hash_len)                         \
+    {                                                                   \
+        assert(hash_len == (_len));                                     \
+        (void)hash_len;                                                 \
+        return hdag_hash_ops_words_cmp(a, b, (_len));                   \
+    }                                                                   \
+                                                                        \
+    static uint32_t                                                     \
+    hdag_hash_ops_nodes_slice_find_##_len(                              \
+        const struct hdag_node *nodes,                                  \
+        size_t start_idx, size_t end_idx,                               \
+        uint16_t hash_len,                                              \
+        const uint8_t *hash_ptr)                                        \
+    {                                                                   \
+        assert(hash_len == (_len));                                     \
+        (void)hash_len;                                                 \
+        return hdag_hash_ops_nodes_slice_find_with(                     \
+            nodes, start_idx, end_idx, (_len), hash_ptr,                \
+            hdag_hash_ops_cmp_##_len                                    \
+        );                                                              \
+    }                                                                   \
+                                                                        \
+    static uint32_t                                                     \
+    hdag_hash_ops_nodes_slice_interp_find_##_len(                       \
+        const struct hdag_node *nodes,                                  \
+        size_t start_idx, size_t end_idx,                               \
+        uint16_t hash_len,                                              \
+        const uint8_t *hash_ptr,                                        \
+        unsigned int common_bits)                                       \
+    {                                                                   \
+        assert(hash_len == (_len));                                     \
+        (void)hash_len;                                                 \
+        return hdag_hash_ops_nodes_slice_interp_find_with(              \
+            nodes, start_idx, end_idx, (_len), hash_ptr, common_bits,   \
+            hdag_hash_ops_cmp_##_len                                    \
+        );                                                              \
+    }                                                                   \
+                                                                        \
+    static void                                                         \
+    hdag_hash_ops_nodes_find_batch_##_len(                              \
+        const struct hdag_node *nodes,                                  \
+        const uint32_t *fanout,                                         \
+        unsigned int fanout_bits,                                       \
+        uint16_t hash_len,                                              \
+        const uint8_t *hashes,                                          \
+        size_t hash_num,                                                \
+        uint32_t *node_idxs)                                            \
+    {                                                                   \
+        assert(hash_len == (_len));                                     \
+        (void)hash_len;                                                 \
+        hdag_hash_ops_nodes_find_batch_with(                            \
+            nodes, fanout, fanout_bits, (_len), hashes, hash_num,       \
+            node_idxs, hdag_hash_ops_cmp_##_len                         \
+        );                                                              \
+    }                                                                   \
+                                                                        \
+    static bool                                                         \
+    hdag_hash_ops_hashes_slice_find_##_len(                             \
+        const uint8_t *hashes,                                          \
+        uint16_t hash_len,                                              \
+        size_t start_idx, size_t end_idx,                               \
+        const uint8_t *hash_ptr,                                        \
+        size_t *phash_idx)                                              \
+    {                                                                   \
+        assert(hash_len == (_len));                                     \
+        (void)hash_len;                                                 \
+        return hdag_hash_ops_hashes_slice_find_with(                    \
+            hashes, (_len), start_idx, end_idx, hash_ptr, phash_idx,    \
+            hdag_hash_ops_cmp_##_len                                    \
+        );                                                              \
+    }                                                                   \
+                                                                        \
+    static const struct hdag_hash_ops hdag_hash_ops_##_len = {          \
+        .hash_len = (_len),                                             \
+        .cmp = hdag_hash_ops_cmp_##_len,                                \
+        .nodes_slice_find = hdag_hash_ops_nodes_slice_find_##_len,      \
+        .nodes_slice_interp_find =                                      \
+            hdag_hash_ops_nodes_slice_interp_find_##_len,               \
+        .nodes_find_batch = hdag_hash_ops_nodes_find_batch_##_len,      \
+        .hashes_slice_find = hdag_hash_ops_hashes_slice_find_##_len,    \
+    }
+
+/* SHA-1 (e.g. Git) */
+HDAG_HASH_OPS_DEFINE(20);
+/* SHA-256 */
+HDAG_HASH_OPS_DEFINE(32);
+
+const struct hdag_hash_ops *
+hdag_hash_ops_get(uint16_t hash_len)
+{
+    assert(hash_len == 0 || hdag_hash_len_is_valid(hash_len));
+    switch (hash_len) {
+    case 20:
+        return &hdag_hash_ops_20;
+    case 32:
+        return &hdag_hash_ops_32;
+    default:
+        return &hdag_hash_ops_generic;
+    }
+}
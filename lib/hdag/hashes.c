@@ -3,6 +3,7 @@
  */
 
 #include <hdag/hashes.h>
+#include <hdag/hash_ops.h>
 #include <hdag/misc.h>
 #include <sys/param.h>
 #include <string.h>
@@ -19,11 +20,12 @@ hdag_hashes_are_valid(const uint8_t *hashes,
     const uint8_t *hash;
     const uint8_t *prev_hash;
     const uint8_t *hashes_end = hashes + hash_len * hash_num;
+    const struct hdag_hash_ops *ops = hdag_hash_ops_get(hash_len);
 
     for (hash = hashes, prev_hash = hash, hash += hash_len;
          hash < hashes_end;
          prev_hash = hash, hash += hash_len) {
-        if (memcmp(prev_hash, hash, hash_len) >= 0) {
+        if (ops->cmp(prev_hash, hash, hash_len) >= 0) {
             return false;
         }
     }
@@ -38,33 +40,9 @@ hdag_hashes_slice_find(const uint8_t *hashes,
                        const uint8_t *hash_ptr,
                        size_t *phash_idx)
 {
-    int relation;
-    size_t middle_idx;
-    const uint8_t *middle_hash;
-
-    assert(start_idx <= end_idx);
-    assert(hashes != NULL || end_idx == 0);
-    assert(hdag_hash_len_is_valid(hash_len));
-    assert(hash_ptr != NULL);
-
-    while (start_idx < end_idx) {
-        middle_idx = (start_idx + end_idx) >> 1;
-        middle_hash = hashes + middle_idx * hash_len;
-        relation = memcmp(hash_ptr, middle_hash, hash_len);
-        if (relation == 0) {
-            start_idx = middle_idx;
-            break;
-        } if (relation > 0) {
-            start_idx = middle_idx + 1;
-        } else {
-            end_idx = middle_idx;
-        }
-    }
-
-    if (phash_idx != NULL) {
-        *phash_idx = start_idx;
-    }
-    return relation == 0;
+    return hdag_hash_ops_get(hash_len)->hashes_slice_find(
+        hashes, hash_len, start_idx, end_idx, hash_ptr, phash_idx
+    );
 }
 
 hdag_res
@@ -4,6 +4,10 @@
 
 #include <hdag/misc.h>
 #include <assert.h>
+#include <stdio.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 char *
 hdag_bytes_to_hex(char *hex_ptr, const void *bytes_ptr, size_t bytes_num)
@@ -24,3 +28,117 @@ hdag_bytes_to_hex(char *hex_ptr, const void *bytes_ptr, size_t bytes_num)
     *o = '\0';
     return hex_ptr;
 }
+
+/**
+ * Character -> hex digit value plus one table.
+ * Zero for characters which are not hex digits.
+ */
+static const uint8_t hdag_hex_digits_inc[256] = {
+    ['0'] = 0x1, ['1'] = 0x2, ['2'] = 0x3, ['3'] = 0x4, ['4'] = 0x5,
+    ['5'] = 0x6, ['6'] = 0x7, ['7'] = 0x8, ['8'] = 0x9, ['9'] = 0xa,
+    ['a'] = 0xb, ['b'] = 0xc, ['c'] = 0xd, ['d'] = 0xe, ['e'] = 0xf,
+    ['f'] = 0x10,
+    ['A'] = 0xb, ['B'] = 0xc, ['C'] = 0xd, ['D'] = 0xe, ['E'] = 0xf,
+    ['F'] = 0x10,
+};
+
+#ifdef __SSE2__
+/**
+ * Convert 16 hexadecimal digits to 8 bytes, using SSE2.
+ *
+ * @param o The buffer to write 8 bytes to.
+ * @param i The 16 hexadecimal digits to convert.
+ *
+ * @return True if all the digits were valid, false otherwise.
+ */
+static inline bool
+hdag_hex_to_bytes_sse2(uint8_t *o, const char *i)
+{
+    const __m128i chars = _mm_loadu_si128((const __m128i *)i);
+    /* Offsets from '0', wrapping around below it */
+    const __m128i dec = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+    /* Offsets from 'a', upper-case letters folded to lower-case */
+    const __m128i alpha = _mm_sub_epi8(
+        _mm_or_si128(chars, _mm_set1_epi8(0x20)),
+        _mm_set1_epi8('a')
+    );
+    const __m128i zero = _mm_setzero_si128();
+    /* Mask the decimal digits and letters with (unsigned) offset checks */
+    const __m128i dec_mask = _mm_cmpeq_epi8(
+        _mm_subs_epu8(dec, _mm_set1_epi8(9)), zero
+    );
+    const __m128i alpha_mask = _mm_cmpeq_epi8(
+        _mm_subs_epu8(alpha, _mm_set1_epi8(5)), zero
+    );
+    __m128i nibbles;
+    __m128i words;
+
+    if (_mm_movemask_epi8(_mm_or_si128(dec_mask, alpha_mask)) != 0xffff) {
+        return false;
+    }
+
+    nibbles = _mm_or_si128(
+        _mm_and_si128(dec_mask, dec),
+        _mm_and_si128(alpha_mask,
+                      _mm_add_epi8(alpha, _mm_set1_epi8(10)))
+    );
+    /* Combine each (high, low) nibble pair into the low byte of a word */
+    words = _mm_or_si128(
+        _mm_slli_epi16(_mm_and_si128(nibbles, _mm_set1_epi16(0xff)), 4),
+        _mm_srli_epi16(nibbles, 8)
+    );
+    _mm_storel_epi64((__m128i *)o, _mm_packus_epi16(words, words));
+    return true;
+}
+#endif
+
+bool
+hdag_hex_to_bytes(void *bytes_ptr, const char *hex_ptr, size_t bytes_num)
+{
+    uint8_t *o = bytes_ptr;
+    const char *i = hex_ptr;
+    uint8_t high;
+    uint8_t low;
+
+    assert(bytes_ptr != NULL || bytes_num == 0);
+    assert(hex_ptr != NULL || bytes_num == 0);
+    assert(bytes_num < SIZE_MAX / 2);
+
+#ifdef __SSE2__
+    for (; bytes_num >= 8; i += 16, o += 8, bytes_num -= 8) {
+        if (!hdag_hex_to_bytes_sse2(o, i)) {
+            return false;
+        }
+    }
+#endif
+
+    for (; bytes_num > 0; i += 2, o++, bytes_num--) {
+        high = hdag_hex_digits_inc[(uint8_t)i[0]];
+        low = hdag_hex_digits_inc[(uint8_t)i[1]];
+        if (high == 0 || low == 0) {
+            return false;
+        }
+        *o = ((high - 1) << 4) | (low - 1);
+    }
+    return true;
+}
+
+void
+hdag_profile_report(const char *action,
+                    size_t num, const char *unit,
+                    struct timespec before)
+{
+    struct timespec after;
+    struct timespec elapsed;
+    double          seconds;
+
+    assert(action != NULL);
+    assert(unit != NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &after);
+    elapsed = HDAG_TIMESPEC_SUB(after, before);
+    seconds = elapsed.tv_sec + elapsed.tv_nsec / 1e9;
+    fprintf(stderr, "%s: %ld.%06lds, %zu %s, %.0f %s/s\n",
+            action, (long)elapsed.tv_sec, elapsed.tv_nsec / 1000,
+            num, unit, seconds > 0 ? num / seconds : 0.0, unit);
+}
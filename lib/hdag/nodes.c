@@ -3,38 +3,81 @@
  */
 
 #include <hdag/nodes.h>
-#include <string.h>
+#include <hdag/hash_ops.h>
+#include <hdag/fanout.h>
 
 uint32_t
 hdag_nodes_slice_find(const struct hdag_node *nodes,
                       size_t start_idx, size_t end_idx,
                       uint16_t hash_len, const uint8_t *hash_ptr)
 {
-    assert(start_idx < INT32_MAX);
-    assert(end_idx < INT32_MAX);
-    assert(start_idx <= end_idx);
-    assert(nodes != NULL || end_idx == 0);
-    assert(hdag_hash_len_is_valid(hash_len));
-    assert(hash_ptr != NULL);
+    return hdag_hash_ops_get(hash_len)->nodes_slice_find(
+        nodes, start_idx, end_idx, hash_len, hash_ptr
+    );
+}
 
-    if (start_idx >= end_idx) {
-        /* Not found */
-        return INT32_MAX;
-    }
+uint32_t
+hdag_nodes_slice_interp_find(const struct hdag_node *nodes,
+                             size_t start_idx, size_t end_idx,
+                             uint16_t hash_len, const uint8_t *hash_ptr,
+                             unsigned int common_bits)
+{
+    return hdag_hash_ops_get(hash_len)->nodes_slice_interp_find(
+        nodes, start_idx, end_idx, hash_len, hash_ptr, common_bits
+    );
+}
 
-    int relation;
-    size_t middle_idx = (start_idx + end_idx) >> 1;
-    const struct hdag_node *middle_node = hdag_node_off_const(
-        nodes, hash_len, middle_idx
+void
+hdag_nodes_find_batch(const struct hdag_node *nodes,
+                      size_t nodes_num,
+                      const uint32_t *fanout,
+                      unsigned int fanout_bits,
+                      uint16_t hash_len,
+                      const uint8_t *hashes,
+                      size_t hash_num,
+                      uint32_t *node_idxs)
+{
+    assert(nodes != NULL || nodes_num == 0);
+    assert(nodes_num < INT32_MAX);
+    assert(fanout != NULL);
+    assert(fanout_bits == 8 || fanout_bits == 16);
+    assert(fanout[(1 << fanout_bits) - 1] == nodes_num);
+    assert(hdag_hash_len_is_valid(hash_len));
+    assert(hashes != NULL || hash_num == 0);
+    assert(node_idxs != NULL || hash_num == 0);
+    (void)nodes_num;
+    hdag_hash_ops_get(hash_len)->nodes_find_batch(
+        nodes, fanout, fanout_bits, hash_len, hashes, hash_num, node_idxs
     );
-    relation = memcmp(hash_ptr, middle_node->hash, hash_len);
-    if (relation == 0) {
-        return middle_idx;
-    } if (relation > 0) {
-        return hdag_nodes_slice_find(nodes, middle_idx + 1, end_idx,
-                                     hash_len, hash_ptr);
-    } else {
-        return hdag_nodes_slice_find(nodes, start_idx, middle_idx,
-                                     hash_len, hash_ptr);
+}
+
+void
+hdag_nodes_fanout16_fill(uint32_t *fanout16,
+                         const struct hdag_node *nodes,
+                         size_t nodes_num,
+                         uint16_t hash_len)
+{
+    /* Position in the fanout array == first two bytes of node hash */
+    size_t pos = 0;
+    size_t node_pos;
+    size_t idx;
+
+    assert(fanout16 != NULL);
+    assert(nodes != NULL || nodes_num == 0);
+    assert(nodes_num < INT32_MAX);
+    assert(hdag_hash_len_is_valid(hash_len));
+
+    for (idx = 0; idx < nodes_num; idx++) {
+        node_pos = hdag_fanout16_pos(
+            hdag_node_off_const(nodes, hash_len, idx)->hash
+        );
+        for (; pos < node_pos; pos++) {
+            fanout16[pos] = idx;
+        }
     }
+    for (; pos < HDAG_FANOUT16_LEN; pos++) {
+        fanout16[pos] = idx;
+    }
+
+    assert(hdag_fanout_is_valid(fanout16, HDAG_FANOUT16_LEN));
 }
@@ -0,0 +1,100 @@
+/*
+ * Hash DAG stream contents in memory
+ */
+
+#include <hdag/stream.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <assert.h>
+
+bool
+hdag_stream_map(FILE *stream, char **pmap, size_t *psize, size_t *poffset)
+{
+    struct stat st;
+    off_t offset;
+    void *map;
+    int fd;
+
+    assert(stream != NULL);
+    assert(pmap != NULL);
+    assert(psize != NULL);
+    assert(poffset != NULL);
+
+    fd = fileno(stream);
+    if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+        (offset = ftello(stream)) < 0 || offset >= st.st_size) {
+        return false;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    (void)madvise(map, st.st_size, MADV_SEQUENTIAL);
+    *pmap = map;
+    *psize = st.st_size;
+    *poffset = offset;
+    return true;
+}
+
+hdag_res
+hdag_stream_unmap(FILE *stream, char **pmap, size_t size, size_t offset)
+{
+    hdag_res res = HDAG_RES_INVALID;
+    int orig_errno;
+
+    assert(stream != NULL);
+    assert(pmap != NULL);
+    assert(offset <= size);
+
+    if (*pmap == NULL) {
+        return HDAG_RES_OK;
+    }
+
+    if (fseeko(stream, offset, SEEK_SET) != 0) {
+        goto cleanup;
+    }
+
+    res = HDAG_RES_OK;
+cleanup:
+    orig_errno = errno;
+    munmap(*pmap, size);
+    *pmap = NULL;
+    errno = orig_errno;
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
+hdag_res
+hdag_stream_read_all(FILE *stream, char **pbuf, size_t *psize, size_t *plen)
+{
+    size_t read_size;
+    size_t read_len;
+    size_t size;
+    char *buf;
+
+    assert(stream != NULL);
+    assert(pbuf != NULL);
+    assert(psize != NULL);
+    assert(plen != NULL);
+    assert(*pbuf != NULL || *psize == 0);
+    assert(*plen <= *psize);
+
+    while (true) {
+        if (*plen == *psize) {
+            size = *psize == 0 ? HDAG_STREAM_BUF_SIZE : *psize * 2;
+            buf = realloc(*pbuf, size);
+            if (buf == NULL) {
+                return HDAG_RES_ERRNO;
+            }
+            *pbuf = buf;
+            *psize = size;
+        }
+        read_size = *psize - *plen;
+        read_len = fread(*pbuf + *plen, 1, read_size, stream);
+        *plen += read_len;
+        if (read_len < read_size) {
+            return ferror(stream) ? HDAG_RES_ERRNO : HDAG_RES_OK;
+        }
+    }
+}
@@ -0,0 +1,325 @@
+/*
+ * Hash DAG adjacency list text reader
+ */
+
+#include <hdag/txt.h>
+#include <hdag/stream.h>
+#include <hdag/misc.h>
+#include <sys/stat.h>
+#include <sys/param.h>
+#include <string.h>
+#include <errno.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * Check if a character is whitespace, the same way isspace() does in the
+ * "C" locale.
+ *
+ * @param c The character to check.
+ *
+ * @return True if the character is whitespace, false otherwise.
+ */
+static inline bool
+hdag_txt_is_space(char c)
+{
+    return c == ' ' || (uint8_t)(c - '\t') <= '\r' - '\t';
+}
+
+/**
+ * Find the end of a token (the first whitespace character) in a text.
+ *
+ * @param p     The pointer to the start of the text to search.
+ * @param lim   The pointer to the end of the text to search.
+ *
+ * @return The pointer to the first whitespace character, or "lim",
+ *         if there was none.
+ */
+static inline const char *
+hdag_txt_span_token(const char *p, const char *lim)
+{
+    assert(p != NULL);
+    assert(lim != NULL);
+    assert(p <= lim);
+
+#ifdef __SSE2__
+    {
+        const __m128i space = _mm_set1_epi8(' ');
+        const __m128i tab = _mm_set1_epi8('\t');
+        const __m128i ctrl_max = _mm_set1_epi8('\r' - '\t');
+        const __m128i zero = _mm_setzero_si128();
+        __m128i chars;
+        int mask;
+
+        for (; lim - p >= 16; p += 16) {
+            chars = _mm_loadu_si128((const __m128i *)p);
+            mask = _mm_movemask_epi8(_mm_or_si128(
+                _mm_cmpeq_epi8(chars, space),
+                _mm_cmpeq_epi8(
+                    _mm_subs_epu8(_mm_sub_epi8(chars, tab), ctrl_max),
+                    zero
+                )
+            ));
+            if (mask != 0) {
+                return p + __builtin_ctz(mask);
+            }
+        }
+    }
+#endif
+
+    for (; p < lim && !hdag_txt_is_space(*p); p++);
+    return p;
+}
+
+hdag_res
+hdag_txt_open(struct hdag_txt *ptxt, FILE *stream, uint16_t hash_len)
+{
+    hdag_res res = HDAG_RES_INVALID;
+    struct hdag_txt txt = HDAG_TXT_CLOSED;
+    size_t offset;
+
+    assert(ptxt != NULL);
+    assert(stream != NULL);
+    assert(hdag_hash_len_is_valid(hash_len));
+
+    txt.stream = stream;
+
+    /* Try to map the stream, if it's a non-empty regular file */
+    if (hdag_stream_map(stream, &txt.map, &txt.map_size, &offset)) {
+        txt.pos = txt.map + offset;
+        txt.end = txt.map + txt.map_size;
+        txt.eof = true;
+    /* Otherwise read it in blocks, fitting at least one maximum hash */
+    } else {
+        txt.buf_size = HDAG_TXT_BUF_SIZE + hash_len * 2;
+        txt.buf = malloc(txt.buf_size);
+        if (txt.buf == NULL) {
+            goto cleanup;
+        }
+        txt.pos = txt.end = txt.buf;
+    }
+
+    assert(hdag_txt_is_valid(&txt));
+    assert(hdag_txt_is_open(&txt));
+    *ptxt = txt;
+    res = HDAG_RES_OK;
+cleanup:
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
+
+void
+hdag_txt_open_mem(struct hdag_txt *ptxt, const char *ptr, size_t len)
+{
+    assert(ptxt != NULL);
+    assert(ptr != NULL);
+
+    *ptxt = HDAG_TXT_CLOSED;
+    ptxt->pos = ptr;
+    ptxt->end = ptr + len;
+    ptxt->eof = true;
+
+    assert(hdag_txt_is_valid(ptxt));
+    assert(hdag_txt_is_open(ptxt));
+}
+
+/**
+ * Make sure the specified number of characters is available in a text
+ * reader, unless the stream ends earlier.
+ *
+ * @param txt   The (open) text reader to refill.
+ * @param min   The minimum number of characters to have available.
+ *              Must not exceed the block buffer size, if any.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+static hdag_res
+hdag_txt_refill(struct hdag_txt *txt, size_t min)
+{
+    size_t avail = txt->end - txt->pos;
+    size_t read_size;
+    size_t read_len;
+
+    assert(hdag_txt_is_valid(txt));
+    assert(hdag_txt_is_open(txt));
+
+    if (txt->eof || avail >= min) {
+        return HDAG_RES_OK;
+    }
+
+    assert(txt->buf != NULL);
+    assert(min <= txt->buf_size);
+
+    /* Move the unprocessed characters to the start of the buffer */
+    memmove(txt->buf, txt->pos, avail);
+    txt->pos = txt->buf;
+
+    /* Fill the rest of the buffer, until we have enough, or the end */
+    while (!txt->eof && avail < min) {
+        read_size = txt->buf_size - avail;
+        read_len = fread(txt->buf + avail, 1, read_size, txt->stream);
+        avail += read_len;
+        if (read_len < read_size) {
+            if (ferror(txt->stream)) {
+                txt->end = txt->buf + avail;
+                return HDAG_RES_ERRNO;
+            }
+            txt->eof = true;
+        }
+    }
+    txt->end = txt->buf + avail;
+
+    return HDAG_RES_OK;
+}
+
+hdag_res
+hdag_txt_fill(struct hdag_txt *txt)
+{
+    hdag_res res;
+    size_t avail;
+
+    assert(hdag_txt_is_valid(txt));
+    assert(hdag_txt_is_open(txt));
+
+    if (txt->eof) {
+        return HDAG_RES_OK;
+    }
+
+    assert(txt->buf != NULL);
+
+    /* Move the unprocessed characters to the start of the buffer */
+    avail = txt->end - txt->pos;
+    memmove(txt->buf, txt->pos, avail);
+    txt->pos = txt->buf;
+    txt->end = txt->buf + avail;
+
+    /* Read the rest of the stream, growing the buffer as needed */
+    res = hdag_stream_read_all(txt->stream, &txt->buf, &txt->buf_size,
+                               &avail);
+    txt->pos = txt->buf;
+    txt->end = txt->buf + avail;
+    txt->eof = hdag_res_is_ok(res);
+    return res;
+}
+
+hdag_res
+hdag_txt_read_hash(struct hdag_txt *txt,
+                   uint8_t *hash_buf, uint16_t hash_len,
+                   bool skip_linebreaks)
+{
+    hdag_res        res = HDAG_RES_INVALID;
+    /* Maximum number of digits in a hash */
+    size_t          max_len = (size_t)hash_len * 2;
+    /* The end of the hash digits */
+    const char     *hash_end;
+    /* Number of the hash digits */
+    size_t          len;
+    /* Number of unfilled hash bytes */
+    uint16_t        rem_hash_len;
+    char            c;
+
+    assert(hdag_txt_is_valid(txt));
+    assert(hdag_txt_is_open(txt));
+    assert(hash_buf != NULL);
+    assert(hdag_hash_len_is_valid(hash_len));
+    assert(txt->buf == NULL || max_len < txt->buf_size);
+
+    /* Skip whitespace */
+    while (true) {
+        if (txt->pos == txt->end) {
+            HDAG_RES_TRY(hdag_txt_refill(txt, 1));
+            if (txt->pos == txt->end) {
+                return hash_len;
+            }
+        }
+        c = *txt->pos;
+        if (!skip_linebreaks && (c == '\r' || c == '\n')) {
+            return hash_len;
+        }
+        if (!hdag_txt_is_space(c)) {
+            break;
+        }
+        txt->pos++;
+    }
+
+    /* Make sure the hash and its terminating whitespace are available */
+    HDAG_RES_TRY(hdag_txt_refill(txt, max_len + 1));
+
+    /* Find the end of the hash, looking one character past maximum */
+    hash_end = hdag_txt_span_token(
+        txt->pos, txt->pos + MIN((size_t)(txt->end - txt->pos), max_len + 1)
+    );
+    len = hash_end - txt->pos;
+
+    /* If the hash is too long, or has an odd number of digits */
+    if (len > max_len || (len & 1) != 0) {
+        return HDAG_RES_INVALID_FORMAT;
+    }
+
+    /* Decode the digits right-aligned, and zero the initial missing bytes */
+    rem_hash_len = hash_len - len / 2;
+    if (!hdag_hex_to_bytes(hash_buf + rem_hash_len, txt->pos, len / 2)) {
+        return HDAG_RES_INVALID_FORMAT;
+    }
+    memset(hash_buf, 0, rem_hash_len);
+
+    /* Leave the terminating whitespace, if any, unprocessed */
+    txt->pos = hash_end;
+
+    res = rem_hash_len;
+cleanup:
+    return res;
+}
+
+size_t
+hdag_txt_hash_num_estimate(const struct hdag_txt *txt, uint16_t hash_len)
+{
+    struct stat st;
+    off_t offset;
+    size_t size = txt->end - txt->pos;
+
+    assert(hdag_txt_is_open(txt));
+    assert(hdag_hash_len_is_valid(hash_len));
+
+    /* Add the size of the stream's unread part, if it's a regular file */
+    if (!txt->eof) {
+        if (txt->stream == NULL ||
+            fstat(fileno(txt->stream), &st) != 0 ||
+            !S_ISREG(st.st_mode) ||
+            (offset = ftello(txt->stream)) < 0 ||
+            offset > st.st_size) {
+            return 0;
+        }
+        size += st.st_size - offset;
+    }
+
+    return size / (hash_len * 2 + 1);
+}
+
+hdag_res
+hdag_txt_close(struct hdag_txt *txt)
+{
+    hdag_res res = HDAG_RES_INVALID;
+    int orig_errno;
+
+    assert(hdag_txt_is_valid(txt));
+
+    if (!hdag_txt_is_open(txt)) {
+        return HDAG_RES_OK;
+    }
+
+    /* Position a mapped stream after the processed text */
+    if (txt->map != NULL) {
+        HDAG_RES_TRY(hdag_stream_unmap(txt->stream, &txt->map,
+                                       txt->map_size, txt->pos - txt->map));
+    }
+
+    res = HDAG_RES_OK;
+cleanup:
+    orig_errno = errno;
+    free(txt->buf);
+    *txt = HDAG_TXT_CLOSED;
+    errno = orig_errno;
+    return HDAG_RES_ERRNO_IF_INVALID(res);
+}
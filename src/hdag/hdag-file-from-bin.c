@@ -0,0 +1,83 @@
+/*
+ * Command-line tool creating a hash DAG database file from a binary
+ * adjacency list
+ */
+#include "hdag-file-opts.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+
+/**
+ * Output command-line usage information to specified stream.
+ *
+ * @param stream    The stream to output the usage information to.
+ */
+void
+usage(FILE *stream)
+{
+    fprintf(stream,
+            "Usage: %s " HDAG_FILE_OPTS_SYNOPSIS " [-m MEM_MIB]\n"
+            "Create an HDAG file from a binary adjacency list file\n"
+            "\n"
+            "Options:\n"
+            HDAG_FILE_OPTS_USAGE
+            "  -m MEM_MIB   Keep the collected nodes within MEM_MIB MiB of\n"
+            "               memory, spilling them to temporary files,\n"
+            "               or don't limit the memory, if zero (default)\n",
+            program_invocation_short_name);
+}
+
+int
+main(int argc, char **argv)
+{
+    hdag_res res = HDAG_RES_INVALID;
+    struct hdag_file file = HDAG_FILE_CLOSED;
+    struct hdag_file_opts opts = HDAG_FILE_OPTS_DEFAULT;
+    unsigned long mem_mib = 0;
+    char *end;
+    int opt;
+
+    while ((opt = getopt(argc, argv, HDAG_FILE_OPTS_GETOPT "m:")) != -1) {
+        switch (opt) {
+        case 'm':
+            if ((mem_mib = strtoul(optarg, &end, 10)) > SIZE_MAX >> 20 ||
+                end == optarg || *end != '\0') {
+                fprintf(stderr, "Invalid MEM_MIB: \"%s\"\n", optarg);
+                usage(stderr);
+                return 1;
+            }
+            break;
+        default:
+            if (!hdag_file_opts_parse(&opts, opt, optarg)) {
+                usage(stderr);
+                return 1;
+            }
+            break;
+        }
+    }
+
+    if (argc != optind) {
+        fprintf(stderr, "Invalid number of arguments\n");
+        usage(stderr);
+        return 1;
+    }
+
+    HDAG_RES_TRY(hdag_file_from_bin(&file, NULL, -1, 0, stdin,
+                                    (size_t)mem_mib << 20, opts.profile));
+    HDAG_RES_TRY(hdag_file_opts_add_sections(&file, &opts));
+    if (fwrite(file.contents, file.size, 1, stdout) != 1) {
+        res = HDAG_RES_ERRNO;
+        goto cleanup;
+    }
+    HDAG_RES_TRY(hdag_file_close(&file));
+
+    res = HDAG_RES_OK;
+cleanup:
+    (void)hdag_file_close(&file);
+    if (hdag_res_is_ok(res)) {
+        return 0;
+    }
+    fprintf(stderr, "ERROR: %s\n", hdag_res_str(res));
+    return 1;
+}
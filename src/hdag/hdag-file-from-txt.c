@@ -2,9 +2,10 @@
  * Command-line tool creating a hash DAG database file from a text adjacency
  * list
  */
-#include <hdag/file.h>
+#include "hdag-file-opts.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include <errno.h>
 
 /**
@@ -16,37 +17,67 @@ void
 usage(FILE *stream)
 {
     fprintf(stream,
-            "Usage: %s HASH_LEN\n"
-            "Create an HDAG file from an adjacency list text file\n",
+            "Usage: %s " HDAG_FILE_OPTS_SYNOPSIS " [-j THREADS]\n"
+            "       HASH_LEN\n"
+            "Create an HDAG file from an adjacency list text file\n"
+            "\n"
+            "Options:\n"
+            HDAG_FILE_OPTS_USAGE
+            "  -j THREADS   Parse the text and organize the nodes with up\n"
+            "               to THREADS threads,\n"
+            "               or one per online CPU, if zero (default)\n",
             program_invocation_short_name);
 }
 
 int
-main(int argc, const char **argv)
+main(int argc, char **argv)
 {
     hdag_res res = HDAG_RES_INVALID;
     struct hdag_file file = HDAG_FILE_CLOSED;
+    struct hdag_file_opts opts = HDAG_FILE_OPTS_DEFAULT;
     unsigned long hash_len;
+    unsigned long thread_num = 0;
     char *end;
+    int opt;
 
-    (void)argv;
+    while ((opt = getopt(argc, argv, HDAG_FILE_OPTS_GETOPT "j:")) != -1) {
+        switch (opt) {
+        case 'j':
+            if ((thread_num = strtoul(optarg, &end, 10)) > UINT16_MAX ||
+                end == optarg || *end != '\0') {
+                fprintf(stderr, "Invalid THREADS: \"%s\"\n", optarg);
+                usage(stderr);
+                return 1;
+            }
+            break;
+        default:
+            if (!hdag_file_opts_parse(&opts, opt, optarg)) {
+                usage(stderr);
+                return 1;
+            }
+            break;
+        }
+    }
 
-    if (argc != 2) {
+    if (argc - optind != 1) {
         fprintf(stderr, "Invalid number of arguments\n");
         usage(stderr);
         return 1;
     }
 
-    if ((hash_len = strtoul(argv[1], &end, 10)) >= UINT16_MAX ||
-        end == argv[1] || *end != '\0' ||
+    if ((hash_len = strtoul(argv[optind], &end, 10)) >= UINT16_MAX ||
+        end == argv[optind] || *end != '\0' ||
         !hdag_hash_len_is_valid((uint16_t)hash_len)) {
-        fprintf(stderr, "Invalid HASH_LEN: \"%s\"\n", argv[1]);
+        fprintf(stderr, "Invalid HASH_LEN: \"%s\"\n", argv[optind]);
         usage(stderr);
         return 1;
     }
 
     HDAG_RES_TRY(hdag_file_from_txt(&file, NULL, -1, 0,
-                                    stdin, (uint16_t)hash_len));
+                                    stdin, (uint16_t)hash_len,
+                                    (unsigned int)thread_num,
+                                    opts.profile));
+    HDAG_RES_TRY(hdag_file_opts_add_sections(&file, &opts));
     if (fwrite(file.contents, file.size, 1, stdout) != 1) {
         res = HDAG_RES_ERRNO;
         goto cleanup;
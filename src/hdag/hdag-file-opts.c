@@ -0,0 +1,81 @@
+/*
+ * Command-line options shared by the tools creating hash DAG database files
+ */
+
+#include "hdag-file-opts.h"
+#include <stdlib.h>
+#include <stdint.h>
+
+bool
+hdag_file_opts_parse(struct hdag_file_opts *opts, int opt, const char *arg)
+{
+    char *end;
+
+    switch (opt) {
+    case 'b':
+        if ((opts->bloom_bits = strtoul(arg, &end, 10)) > UINT8_MAX ||
+            opts->bloom_bits == 0 || end == arg || *end != '\0') {
+            fprintf(stderr, "Invalid BITS: \"%s\"\n", arg);
+            return false;
+        }
+        return true;
+    case 'f':
+        opts->add_fanout16 = true;
+        return true;
+    case 'i':
+        opts->add_index = true;
+        return true;
+    case 'r':
+        if ((opts->interval_num = strtoul(arg, &end, 10)) > UINT8_MAX ||
+            opts->interval_num == 0 || end == arg || *end != '\0') {
+            fprintf(stderr, "Invalid NUM: \"%s\"\n", arg);
+            return false;
+        }
+        return true;
+    case 'v':
+        opts->profile = true;
+        return true;
+    default:
+        return false;
+    }
+}
+
+hdag_res
+hdag_file_opts_add_sections(struct hdag_file *file,
+                            const struct hdag_file_opts *opts)
+{
+    hdag_res res = HDAG_RES_INVALID;
+    size_t old_size;
+
+    if (opts->add_fanout16) {
+        HDAG_RES_TRY(hdag_file_add_fanout16(file));
+    }
+    if (opts->bloom_bits != 0) {
+        HDAG_RES_TRY(hdag_file_add_bloom(file,
+                                         (unsigned int)opts->bloom_bits));
+    }
+    if (opts->add_index) {
+        HDAG_RES_TRY(hdag_file_add_index(file));
+    }
+    if (opts->interval_num != 0) {
+        old_size = file->size;
+        HDAG_PROFILE_STAGE(
+            opts->profile, "Adding the reachability intervals",
+            file->header->node_num, "nodes",
+            HDAG_RES_TRY(hdag_file_add_intervals(
+                file, (uint32_t)opts->interval_num
+            ))
+        );
+        if (opts->profile) {
+            fprintf(stderr,
+                    "Reachability intervals: %lu per node, "
+                    "%zu bytes, %.1f%% of the file\n",
+                    opts->interval_num, file->size - old_size,
+                    100.0 * (file->size - old_size) / file->size);
+        }
+    }
+
+    res = HDAG_RES_OK;
+cleanup:
+    return res;
+}
@@ -0,0 +1,74 @@
+/*
+ * Command-line options shared by the tools creating hash DAG database files
+ */
+
+#ifndef _HDAG_FILE_OPTS_H
+#define _HDAG_FILE_OPTS_H
+
+#include <hdag/file.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+/** The getopt(3) option characters of the shared options */
+#define HDAG_FILE_OPTS_GETOPT "b:fir:v"
+
+/** The synopsis of the shared options, for the usage line */
+#define HDAG_FILE_OPTS_SYNOPSIS "[-b BITS] [-f] [-i] [-r NUM] [-v]"
+
+/** The descriptions of the shared options, for the usage information */
+#define HDAG_FILE_OPTS_USAGE \
+    "  -b BITS      Add the Bloom filter section to the file, with\n"   \
+    "               BITS bits per node, e.g. 10 for about one\n"        \
+    "               percent of false positives\n"                       \
+    "  -f           Add the 16-bit node fanout section to the file\n"   \
+    "  -i           Add the node lookup index section to the file\n"    \
+    "  -r NUM       Add the reachability intervals section to\n"        \
+    "               the file, with NUM intervals per node\n"            \
+    "  -v           Report the time and throughput of each stage\n"     \
+    "               of building the file to stderr\n"
+
+/** The values of the shared options */
+struct hdag_file_opts {
+    /** The number of Bloom filter bits per node, or zero for no filter */
+    unsigned long   bloom_bits;
+    /** The number of reachability intervals per node, or zero for none */
+    unsigned long   interval_num;
+    /** True if the 16-bit node fanout section should be added */
+    bool            add_fanout16;
+    /** True if the node lookup index section should be added */
+    bool            add_index;
+    /** True if building stages should be timed and reported to stderr */
+    bool            profile;
+};
+
+/** The initializer of the shared options' default values */
+#define HDAG_FILE_OPTS_DEFAULT (struct hdag_file_opts){0, }
+
+/**
+ * Parse a shared command-line option.
+ *
+ * @param opts  The option values to update.
+ * @param opt   The option character returned by getopt(3).
+ * @param arg   The option argument (optarg), if any.
+ *
+ * @return True if the option was parsed successfully, false if it's not
+ *         a shared option, or its argument is invalid (reported to
+ *         stderr).
+ */
+extern bool hdag_file_opts_parse(struct hdag_file_opts *opts,
+                                 int opt, const char *arg);
+
+/**
+ * Add the optional sections requested by the shared options to a file.
+ *
+ * @param file  The file to add the sections to.
+ * @param opts  The option values requesting the sections.
+ *
+ * @return A void universal result.
+ */
+[[nodiscard]]
+extern hdag_res hdag_file_opts_add_sections(struct hdag_file *file,
+                                            const struct hdag_file_opts
+                                                *opts);
+
+#endif /* _HDAG_FILE_OPTS_H */
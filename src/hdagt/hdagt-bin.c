@@ -0,0 +1,290 @@
+/*
+ * Hash DAG binary adjacency list test
+ */
+
+#include <hdag/bin.h>
+#include <hdag/bundle.h>
+#include <hdag/file.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TEST(_expr) \
+    do {                                                \
+        if (!(_expr)) {                                 \
+            fprintf(stderr, "%s:%u: Test failed: %s\n", \
+                    __FILE__, __LINE__, #_expr);        \
+            failed++;                                   \
+        }                                               \
+    } while(0)
+
+static size_t
+test_varint(void)
+{
+    size_t failed = 0;
+    const uint64_t values[] = {
+        0, 1, 0x7f, 0x80, 0x3fff, 0x4000, UINT32_MAX, UINT64_MAX
+    };
+    const size_t lens[] = {1, 1, 1, 2, 2, 3, 5, 10};
+    uint8_t buf[HDAG_BIN_VARINT_MAX_LEN + 1];
+    const uint8_t *pos;
+    uint64_t value = 0;
+    size_t len;
+    size_t i;
+
+    for (i = 0; i < HDAG_ARR_LEN(values); i++) {
+        len = hdag_bin_varint_encode(buf, values[i]);
+        TEST(len == lens[i]);
+        pos = buf;
+        TEST(hdag_bin_varint_decode(&pos, buf + len, &value));
+        TEST(pos == buf + len);
+        TEST(value == values[i]);
+        /* Check truncation is detected */
+        pos = buf;
+        TEST(!hdag_bin_varint_decode(&pos, buf + len - 1, &value));
+        TEST(pos == buf);
+    }
+
+    /* Check values overflowing 64 bits are rejected */
+    memset(buf, 0xff, sizeof(buf));
+    buf[HDAG_BIN_VARINT_MAX_LEN - 1] = 0x02;
+    pos = buf;
+    TEST(!hdag_bin_varint_decode(&pos, buf + sizeof(buf), &value));
+    buf[HDAG_BIN_VARINT_MAX_LEN - 1] = 0x81;
+    buf[HDAG_BIN_VARINT_MAX_LEN] = 0x00;
+    pos = buf;
+    TEST(!hdag_bin_varint_decode(&pos, buf + sizeof(buf), &value));
+
+    return failed;
+}
+
+static size_t
+test(uint16_t hash_len)
+{
+    size_t failed = 0;
+    /* The text equivalent of the binary adjacency list below */
+    const char text[] = "01 02 03\n03 04\n05\n";
+    /* The node hash bytes and target hash bytes, zero-terminated */
+    const uint8_t nodes[][4] = {{1, 2, 3, 0}, {3, 4, 0}, {5, 0}};
+    struct hdag_bin_header header = {
+        .signature = HDAG_BIN_SIGNATURE,
+        .version = {0, 0},
+        .hash_len = hash_len,
+    };
+    uint8_t bin[sizeof(header) + (hash_len + 1) * 6];
+    size_t bin_len = 0;
+    /* Lengths of the binary adjacency list after each node */
+    size_t bin_node_lens[HDAG_ARR_LEN(nodes) + 1];
+    struct hdag_bin_node_seq seq;
+    struct hdag_bundle txt_bundle = HDAG_BUNDLE_EMPTY(hash_len);
+    struct hdag_bundle bin_bundle = HDAG_BUNDLE_EMPTY(hash_len);
+    struct hdag_bundle item_bundle = HDAG_BUNDLE_EMPTY(hash_len);
+    struct hdag_bundle dedup_bundle = HDAG_BUNDLE_EMPTY(hash_len);
+    struct hdag_file file = HDAG_FILE_CLOSED;
+    const char prefix[] = "prefix";
+    FILE *stream;
+    char *out_buf = NULL;
+    size_t out_len = 0;
+    size_t i, j, len;
+
+    /* Build the binary adjacency list */
+    memcpy(bin, &header, sizeof(header));
+    bin_len = sizeof(header);
+    bin_node_lens[0] = bin_len;
+    for (i = 0; i < HDAG_ARR_LEN(nodes); i++) {
+        for (j = 0; nodes[i][j] != 0; j++) {
+            memset(bin + bin_len, 0, hash_len);
+            bin[bin_len + hash_len - 1] = nodes[i][j];
+            bin_len += hash_len;
+            if (j == 0) {
+                bin_len += hdag_bin_varint_encode(
+                    bin + bin_len, strlen((const char *)nodes[i]) - 1
+                );
+            }
+        }
+        bin_node_lens[i + 1] = bin_len;
+    }
+
+    /* Check invalid headers are rejected */
+    TEST(hdag_bin_node_seq_init(&seq, bin, sizeof(header) - 1) ==
+         HDAG_RES_INVALID_FORMAT);
+    bin[0]++;
+    TEST(hdag_bin_node_seq_init(&seq, bin, bin_len) ==
+         HDAG_RES_INVALID_FORMAT);
+    bin[0]--;
+    ((struct hdag_bin_header *)bin)->hash_len = hash_len + 1;
+    TEST(hdag_bin_node_seq_init(&seq, bin, bin_len) ==
+         HDAG_RES_INVALID_FORMAT);
+    ((struct hdag_bin_header *)bin)->hash_len = hash_len;
+
+    /* Check loading matches the text equivalent */
+    stream = fmemopen((char *)text, strlen(text), "r");
+    TEST(stream != NULL);
+    if (stream != NULL) {
+        TEST(hdag_bundle_from_txt(&txt_bundle, stream, hash_len) ==
+             HDAG_RES_OK);
+        fclose(stream);
+    }
+    TEST(hdag_bin_node_seq_init(&seq, bin, bin_len) == HDAG_RES_OK);
+    TEST(seq.base.hash_len == hash_len);
+    TEST(hdag_bundle_from_node_seq(&bin_bundle, &seq.base) == HDAG_RES_OK);
+    TEST(hdag_darr_occupied_size(&bin_bundle.nodes) ==
+         hdag_darr_occupied_size(&txt_bundle.nodes));
+    TEST(memcmp(bin_bundle.nodes.slots, txt_bundle.nodes.slots,
+                hdag_darr_occupied_size(&txt_bundle.nodes)) == 0);
+    TEST(hdag_darr_occupied_size(&bin_bundle.target_hashes) ==
+         hdag_darr_occupied_size(&txt_bundle.target_hashes));
+    TEST(memcmp(bin_bundle.target_hashes.slots,
+                txt_bundle.target_hashes.slots,
+                hdag_darr_occupied_size(&txt_bundle.target_hashes)) == 0);
+
+    /* Check loading one node and one target at a time matches batches */
+    TEST(hdag_bin_node_seq_init(&seq, bin, bin_len) == HDAG_RES_OK);
+    TEST(hdag_node_seq_is_batched(&seq.base));
+    seq.base.next_batch_fn = NULL;
+    seq.target_hash_seq.next_batch_fn = NULL;
+    TEST(!hdag_node_seq_is_batched(&seq.base));
+    TEST(hdag_bundle_from_node_seq(&item_bundle, &seq.base) == HDAG_RES_OK);
+    TEST(hdag_darr_occupied_size(&item_bundle.nodes) ==
+         hdag_darr_occupied_size(&bin_bundle.nodes));
+    TEST(memcmp(item_bundle.nodes.slots, bin_bundle.nodes.slots,
+                hdag_darr_occupied_size(&bin_bundle.nodes)) == 0);
+    TEST(hdag_darr_occupied_size(&item_bundle.target_hashes) ==
+         hdag_darr_occupied_size(&bin_bundle.target_hashes));
+    TEST(memcmp(item_bundle.target_hashes.slots,
+                bin_bundle.target_hashes.slots,
+                hdag_darr_occupied_size(&bin_bundle.target_hashes)) == 0);
+
+    /*
+     * Check deduplicating targets only adds placeholders for the ones never
+     * seen as nodes (02 and 04), and produces the same organized bundle
+     */
+    for (i = 0; i < 2; i++) {
+        TEST(hdag_bin_node_seq_init(&seq, bin, bin_len) == HDAG_RES_OK);
+        if (i != 0) {
+            seq.base.next_batch_fn = NULL;
+            seq.target_hash_seq.next_batch_fn = NULL;
+        }
+        hdag_bundle_empty(&dedup_bundle);
+        TEST(hdag_bundle_add_node_seq(&dedup_bundle, &seq.base,
+                                      0, true) > 0);
+        TEST(dedup_bundle.nodes.slots_occupied == 5);
+        TEST(hdag_darr_occupied_size(&dedup_bundle.target_hashes) ==
+             hdag_darr_occupied_size(&bin_bundle.target_hashes));
+        TEST(hdag_bundle_organize(&dedup_bundle, NULL) == HDAG_RES_OK);
+    }
+    TEST(hdag_bundle_organize(&item_bundle, NULL) == HDAG_RES_OK);
+    TEST(hdag_darr_occupied_size(&dedup_bundle.nodes) ==
+         hdag_darr_occupied_size(&item_bundle.nodes));
+    TEST(memcmp(dedup_bundle.nodes.slots, item_bundle.nodes.slots,
+                hdag_darr_occupied_size(&item_bundle.nodes)) == 0);
+    TEST(hdag_darr_occupied_size(&dedup_bundle.extra_edges) ==
+         hdag_darr_occupied_size(&item_bundle.extra_edges));
+    TEST(hdag_darr_occupied_size(&dedup_bundle.unknown_hashes) ==
+         hdag_darr_occupied_size(&item_bundle.unknown_hashes));
+    TEST(memcmp(dedup_bundle.unknown_hashes.slots,
+                item_bundle.unknown_hashes.slots,
+                hdag_darr_occupied_size(&item_bundle.unknown_hashes)) == 0);
+
+    /* Check a batch returns all the nodes, pointing into the memory */
+    TEST(hdag_bin_node_seq_init(&seq, bin, bin_len) == HDAG_RES_OK);
+    {
+        const struct hdag_node_seq_item *items;
+        size_t item_num;
+        TEST(hdag_node_seq_next_batch(&seq.base, &items, &item_num) ==
+             HDAG_RES_OK);
+        TEST(item_num == HDAG_ARR_LEN(nodes));
+        for (i = 0; i < item_num && i < HDAG_ARR_LEN(nodes); i++) {
+            TEST(items[i].hash == bin + bin_node_lens[i]);
+            TEST(items[i].target_hash_num ==
+                 strlen((const char *)nodes[i]) - 1);
+            TEST(items[i].target_hashes == bin + bin_node_lens[i] +
+                                           hash_len + 1);
+        }
+        TEST(hdag_node_seq_next_batch(&seq.base, &items, &item_num) > 0);
+    }
+
+    /* Check the hashes are not copied */
+    hdag_node_seq_reset(&seq.base);
+    {
+        const uint8_t *hash;
+        struct hdag_hash_seq *target_hash_seq;
+        TEST(hdag_node_seq_next(&seq.base, &hash, &target_hash_seq) ==
+             HDAG_RES_OK);
+        TEST(hash == bin + sizeof(header));
+        TEST(hdag_hash_seq_next(target_hash_seq, &hash) == HDAG_RES_OK);
+        TEST(hash == bin + sizeof(header) + hash_len + 1);
+    }
+
+    /* Check writing reproduces the binary adjacency list */
+    hdag_node_seq_reset(&seq.base);
+    stream = open_memstream(&out_buf, &out_len);
+    TEST(stream != NULL);
+    if (stream != NULL) {
+        TEST(hdag_bin_from_node_seq(stream, &seq.base) == HDAG_RES_OK);
+        fclose(stream);
+        TEST(out_len == bin_len);
+        TEST(out_buf != NULL && memcmp(out_buf, bin, bin_len) == 0);
+        free(out_buf);
+    }
+
+    /*
+     * Check a file is created the same from a read and a mapped stream,
+     * and the mapped stream is left after the list
+     */
+    for (i = 0; i < 2; i++) {
+        if (i == 0) {
+            stream = fmemopen(bin, bin_len, "r");
+        } else {
+            stream = tmpfile();
+            if (stream != NULL) {
+                TEST(fwrite(prefix, strlen(prefix), 1, stream) == 1);
+                TEST(fwrite(bin, bin_len, 1, stream) == 1);
+                TEST(fseek(stream, strlen(prefix), SEEK_SET) == 0);
+            }
+        }
+        TEST(stream != NULL);
+        if (stream == NULL) {
+            continue;
+        }
+        TEST(hdag_file_from_bin(&file, NULL, -1, 0, stream, 0, false) ==
+             HDAG_RES_OK);
+        TEST(ftell(stream) ==
+             (long)(bin_len + (i == 0 ? 0 : strlen(prefix))));
+        fclose(stream);
+        TEST(file.header != NULL &&
+             file.header->node_num == item_bundle.nodes.slots_occupied);
+        TEST(!hdag_file_close(&file));
+    }
+
+    /* Check truncated node records are rejected, and complete accepted */
+    for (len = sizeof(header), i = 0; len <= bin_len; len++) {
+        hdag_res expected_res;
+        if (len == bin_node_lens[i]) {
+            expected_res = HDAG_RES_OK;
+            i++;
+        } else {
+            expected_res = HDAG_RES_INVALID_FORMAT;
+        }
+        TEST(hdag_bin_node_seq_init(&seq, bin, len) == HDAG_RES_OK);
+        TEST(hdag_bundle_from_node_seq(NULL, &seq.base) == expected_res);
+        TEST(hdag_bin_node_seq_init(&seq, bin, len) == HDAG_RES_OK);
+        seq.base.next_batch_fn = NULL;
+        TEST(hdag_bundle_from_node_seq(NULL, &seq.base) == expected_res);
+    }
+
+    hdag_bundle_cleanup(&dedup_bundle);
+    hdag_bundle_cleanup(&item_bundle);
+    hdag_bundle_cleanup(&bin_bundle);
+    hdag_bundle_cleanup(&txt_bundle);
+    return failed;
+}
+
+int
+main(void)
+{
+    size_t failed = test_varint() + test(4) + test(32);
+    if (failed) {
+        fprintf(stderr, "%zu tests failed.\n", failed);
+    }
+    return failed != 0;
+}
@@ -3,6 +3,7 @@
  */
 
 #include <hdag/bundle.h>
+#include <hdag/txt.h>
 #include <hdag/misc.h>
 #include <stdio.h>
 #include <unistd.h>
@@ -1277,6 +1278,353 @@ test_txt_buggy_case(void)
 
 #undef WITH_BUNDLES_AND_FILES
 
+/**
+ * Check that texts larger than the reader's block buffer are loaded the same
+ * from a block-read memory stream, from a memory-mapped regular file,
+ * including one read from a non-zero offset, and by multiple threads.
+ */
+static size_t
+test_txt_blocks(uint16_t hash_len)
+{
+    size_t failed = 0;
+    /* Enough nodes to span several block buffers, and parallel chunks */
+    const size_t node_num = HDAG_TXT_BUF_SIZE * 16 / (hash_len * 4) + 3;
+    const char prefix[] = "not a hash\n";
+    /* Two hashes, two separators, and an optional '\r' per node */
+    const size_t text_size = node_num * (hash_len * 4 + 3);
+    const unsigned int thread_nums[] = {0, 1, 2, 3, 7};
+    const unsigned int sorted_thread_nums[] = {1, 3};
+    char *text = malloc(text_size + 1);
+    char *hex_buf = malloc(hash_len * 2 + 1);
+    uint8_t *hash = calloc(hash_len, 1);
+    struct hdag_bundle mem_bundle = HDAG_BUNDLE_EMPTY(hash_len);
+    struct hdag_bundle map_bundle = HDAG_BUNDLE_EMPTY(hash_len);
+    struct hdag_bundle par_bundle = HDAG_BUNDLE_EMPTY(hash_len);
+    struct hdag_bundle sorted_bundle = HDAG_BUNDLE_EMPTY(hash_len);
+    FILE *input_file = NULL;
+    size_t text_len = 0;
+    size_t i;
+
+    TEST(text != NULL && hex_buf != NULL && hash != NULL);
+    if (text == NULL || hex_buf == NULL || hash == NULL) {
+        goto cleanup;
+    }
+
+#define SET_HASH(_i) \
+    do {                                            \
+        hash[hash_len - 3] = ((_i) >> 16) & 0xff;   \
+        hash[hash_len - 2] = ((_i) >> 8) & 0xff;    \
+        hash[hash_len - 1] = (_i) & 0xff;           \
+        hdag_bytes_to_hex(hex_buf, hash, hash_len); \
+    } while (0)
+
+    /* Each node points to the previous one */
+    for (i = 0; i < node_num; i++) {
+        SET_HASH(i);
+        text_len += sprintf(text + text_len, "%s", hex_buf);
+        if (i > 0) {
+            SET_HASH(i - 1);
+            text_len += sprintf(text + text_len, "%c%s",
+                                i & 1 ? ' ' : '\t', hex_buf);
+        }
+        text_len += sprintf(text + text_len, "%s", i & 2 ? "\r\n" : "\n");
+    }
+    assert(text_len <= text_size);
+
+#undef SET_HASH
+
+    /* Load through the block buffer */
+    input_file = fmemopen(text, text_len, "r");
+    TEST(input_file != NULL);
+    if (input_file != NULL) {
+        TEST(hdag_bundle_from_txt(
+                &mem_bundle, input_file, hash_len
+             ) == HDAG_RES_OK);
+        fclose(input_file);
+    }
+    TEST(mem_bundle.nodes.slots_occupied == node_num * 2 - 1);
+
+    /* Load with various numbers of threads, and compare */
+    for (i = 0; i < HDAG_ARR_LEN(thread_nums); i++) {
+        input_file = fmemopen(text, text_len, "r");
+        TEST(input_file != NULL);
+        if (input_file == NULL) {
+            continue;
+        }
+        TEST(hdag_bundle_from_txt_parallel(
+                &par_bundle, input_file, hash_len, thread_nums[i]
+             ) == HDAG_RES_OK);
+        fclose(input_file);
+        TEST(hdag_darr_occupied_size(&par_bundle.nodes) ==
+             hdag_darr_occupied_size(&mem_bundle.nodes));
+        TEST(memcmp(par_bundle.nodes.slots, mem_bundle.nodes.slots,
+                    hdag_darr_occupied_size(&mem_bundle.nodes)) == 0);
+        TEST(hdag_darr_occupied_size(&par_bundle.target_hashes) ==
+             hdag_darr_occupied_size(&mem_bundle.target_hashes));
+        TEST(memcmp(par_bundle.target_hashes.slots,
+                    mem_bundle.target_hashes.slots,
+                    hdag_darr_occupied_size(&mem_bundle.target_hashes)) ==
+             0);
+        hdag_bundle_cleanup(&par_bundle);
+    }
+
+    TEST(hdag_bundle_organize(&mem_bundle, NULL) == HDAG_RES_OK);
+    TEST(mem_bundle.nodes.slots_occupied == node_num);
+    TEST(mem_bundle.extra_edges.slots_occupied == 0);
+
+    /*
+     * Check loading with chunks gathered and sorted by buckets, with and
+     * without deduplicating targets, produces a sorted bundle, and the
+     * (slower) organizing of the deduplicated one produces the same bundle
+     */
+    for (i = 0; i < HDAG_ARR_LEN(sorted_thread_nums) * 2; i++) {
+        input_file = fmemopen(text, text_len, "r");
+        TEST(input_file != NULL);
+        if (input_file == NULL) {
+            continue;
+        }
+        TEST(hdag_bundle_add_txt_sorted(
+                &sorted_bundle, input_file, sorted_thread_nums[i / 2], i & 1,
+                false
+             ) == HDAG_RES_OK);
+        fclose(input_file);
+        TEST(hdag_bundle_is_sorted(&sorted_bundle));
+        /* Only the targets crossing chunk boundaries can get placeholders */
+        if (i & 1) {
+            TEST(sorted_bundle.nodes.slots_occupied >= node_num);
+            TEST(sorted_bundle.nodes.slots_occupied < node_num + 16);
+        } else {
+            TEST(sorted_bundle.nodes.slots_occupied == node_num * 2 - 1);
+        }
+        if (i == HDAG_ARR_LEN(sorted_thread_nums) * 2 - 1) {
+            TEST(hdag_bundle_organize(&sorted_bundle, NULL) == HDAG_RES_OK);
+            TEST(hdag_darr_occupied_size(&sorted_bundle.nodes) ==
+                 hdag_darr_occupied_size(&mem_bundle.nodes));
+            TEST(memcmp(sorted_bundle.nodes.slots, mem_bundle.nodes.slots,
+                        hdag_darr_occupied_size(&mem_bundle.nodes)) == 0);
+        }
+        hdag_bundle_cleanup(&sorted_bundle);
+    }
+
+    /*
+     * Check sorted loading keeps the bundle's existing nodes, both when
+     * sorting them together with the new ones, and on a failure
+     */
+    for (i = 0; i < 3; i++) {
+        input_file = i < 2 ? fmemopen(text, text_len, "r")
+                           : fmemopen("x\n", 2, "r");
+        TEST(input_file != NULL);
+        if (input_file == NULL) {
+            continue;
+        }
+        TEST(hdag_bundle_add_txt_sorted(
+                &sorted_bundle, input_file, 4, true, false
+             ) == (i < 2 ? HDAG_RES_OK : HDAG_RES_INVALID_FORMAT));
+        fclose(input_file);
+        TEST(hdag_bundle_is_valid(&sorted_bundle));
+        TEST(sorted_bundle.nodes.slots_occupied >=
+             node_num * (i == 0 ? 1 : 2));
+        if (i < 2) {
+            TEST(hdag_bundle_is_sorted(&sorted_bundle));
+        }
+    }
+    hdag_bundle_cleanup(&sorted_bundle);
+
+    /* Load through a mapping, skipping a prefix */
+    input_file = tmpfile();
+    TEST(input_file != NULL);
+    if (input_file != NULL) {
+        TEST(fwrite(prefix, strlen(prefix), 1, input_file) == 1);
+        TEST(fwrite(text, text_len, 1, input_file) == 1);
+        TEST(fseek(input_file, strlen(prefix), SEEK_SET) == 0);
+        TEST(hdag_bundle_organized_from_txt(
+                &map_bundle, NULL, input_file, hash_len
+             ) == HDAG_RES_OK);
+        TEST(ftell(input_file) == (long)(strlen(prefix) + text_len));
+        fclose(input_file);
+    }
+    TEST(map_bundle.nodes.slots_occupied == node_num);
+    TEST(hdag_darr_occupied_size(&map_bundle.nodes) ==
+         hdag_darr_occupied_size(&mem_bundle.nodes));
+    TEST(memcmp(map_bundle.nodes.slots, mem_bundle.nodes.slots,
+                hdag_darr_occupied_size(&mem_bundle.nodes)) == 0);
+
+    /* Check the number of hashes is estimated, where the size is known */
+    {
+        struct hdag_txt txt;
+        const size_t hash_num = text_len / (hash_len * 2 + 1);
+
+        hdag_txt_open_mem(&txt, text, text_len);
+        TEST(hdag_txt_hash_num_estimate(&txt, hash_len) == hash_num);
+        TEST(hdag_txt_close(&txt) == HDAG_RES_OK);
+
+        input_file = tmpfile();
+        TEST(input_file != NULL);
+        if (input_file != NULL) {
+            TEST(fwrite(text, text_len, 1, input_file) == 1);
+            rewind(input_file);
+            TEST(hdag_txt_open(&txt, input_file, hash_len) == HDAG_RES_OK);
+            TEST(hdag_txt_hash_num_estimate(&txt, hash_len) == hash_num);
+            TEST(hdag_txt_close(&txt) == HDAG_RES_OK);
+            fclose(input_file);
+        }
+
+        input_file = fmemopen(text, text_len, "r");
+        TEST(input_file != NULL);
+        if (input_file != NULL) {
+            TEST(hdag_txt_open(&txt, input_file, hash_len) == HDAG_RES_OK);
+            TEST(hdag_txt_hash_num_estimate(&txt, hash_len) == 0);
+            TEST(hdag_txt_close(&txt) == HDAG_RES_OK);
+            fclose(input_file);
+        }
+    }
+
+    /* Check an invalid hash in the middle of the text is caught */
+    text[text_len / 2] = 'x';
+    input_file = fmemopen(text, text_len, "r");
+    TEST(input_file != NULL);
+    if (input_file != NULL) {
+        TEST(hdag_bundle_from_txt(NULL, input_file, hash_len) ==
+             HDAG_RES_INVALID_FORMAT);
+        rewind(input_file);
+        TEST(hdag_bundle_from_txt_parallel(NULL, input_file, hash_len, 4) ==
+             HDAG_RES_INVALID_FORMAT);
+        fclose(input_file);
+    }
+
+cleanup:
+    hdag_bundle_cleanup(&sorted_bundle);
+    hdag_bundle_cleanup(&par_bundle);
+    hdag_bundle_cleanup(&map_bundle);
+    hdag_bundle_cleanup(&mem_bundle);
+    free(hash);
+    free(hex_buf);
+    free(text);
+    return failed;
+}
+
+static size_t
+test_organizing_parallel(uint16_t hash_len)
+{
+    size_t failed = 0;
+    /* Enough nodes to be split between threads */
+    const size_t node_num = 33000;
+    /* Up to four hashes, four separators, per node, and a conflict */
+    const size_t text_size = (node_num * 9 / 8 + 1) * (hash_len * 8 + 4);
+    const unsigned int thread_nums[] = {2, 3};
+    char *text = malloc(text_size + 1);
+    char *hex_buf = malloc(hash_len * 2 + 1);
+    uint8_t *hash = calloc(hash_len, 1);
+    struct hdag_bundle ser_bundle = HDAG_BUNDLE_EMPTY(hash_len);
+    struct hdag_bundle par_bundle = HDAG_BUNDLE_EMPTY(hash_len);
+    FILE *input_file = NULL;
+    size_t text_len = 0;
+    size_t i, j;
+
+    TEST(text != NULL && hex_buf != NULL && hash != NULL);
+    if (text == NULL || hex_buf == NULL || hash == NULL) {
+        goto cleanup;
+    }
+
+/* Output a hash spreading the nodes over all the first-byte values */
+#define PRINT_HASH(_fmt, _i)     do {                                                                \
+        hash[0] = ((_i) * 167) & 0xff;                                  \
+        hash[hash_len - 3] = ((_i) >> 16) & 0xff;                       \
+        hash[hash_len - 2] = ((_i) >> 8) & 0xff;                        \
+        hash[hash_len - 1] = (_i) & 0xff;                               \
+        hdag_bytes_to_hex(hex_buf, hash, hash_len);                     \
+        text_len += sprintf(text + text_len, _fmt, hex_buf);            \
+    } while (0)
+
+    /*
+     * Each node points to the previous one, and to the one at half its
+     * index, with every eighth node repeated, every fifth pointing to an
+     * unknown node, and the second pointing to the first twice
+     */
+    for (j = 0; j < node_num * 9 / 8; j++) {
+        i = j < node_num ? j : (j - node_num) * 8;
+        PRINT_HASH("%s", i);
+        if (i > 0) {
+            PRINT_HASH(" %s", i - 1);
+            PRINT_HASH(" %s", i / 2);
+        }
+        if (i % 5 == 0) {
+            PRINT_HASH(" %s", node_num + i);
+        }
+        text_len += sprintf(text + text_len, "\n");
+    }
+    assert(text_len <= text_size);
+
+    /* Organize with one thread */
+    input_file = fmemopen(text, text_len, "r");
+    TEST(input_file != NULL);
+    if (input_file != NULL) {
+        TEST(hdag_bundle_from_txt(&ser_bundle, input_file, hash_len) ==
+             HDAG_RES_OK);
+        fclose(input_file);
+    }
+    TEST(hdag_bundle_organize(&ser_bundle, NULL) == HDAG_RES_OK);
+    TEST(ser_bundle.nodes.slots_occupied == node_num + node_num / 5);
+    TEST(ser_bundle.unknown_hashes.slots_occupied == node_num / 5);
+
+    /* Organize with various numbers of threads, and compare */
+    for (i = 0; i < HDAG_ARR_LEN(thread_nums); i++) {
+        input_file = fmemopen(text, text_len, "r");
+        TEST(input_file != NULL);
+        if (input_file == NULL) {
+            continue;
+        }
+        TEST(hdag_bundle_from_txt(&par_bundle, input_file, hash_len) ==
+             HDAG_RES_OK);
+        fclose(input_file);
+        TEST(hdag_bundle_organize_parallel(&par_bundle, NULL,
+                                           thread_nums[i], false) ==
+             HDAG_RES_OK);
+        TEST(hdag_darr_occupied_size(&par_bundle.nodes) ==
+             hdag_darr_occupied_size(&ser_bundle.nodes));
+        TEST(memcmp(par_bundle.nodes.slots, ser_bundle.nodes.slots,
+                    hdag_darr_occupied_size(&ser_bundle.nodes)) == 0);
+        TEST(memcmp(par_bundle.nodes_fanout, ser_bundle.nodes_fanout,
+                    sizeof(ser_bundle.nodes_fanout)) == 0);
+        TEST(hdag_darr_occupied_size(&par_bundle.extra_edges) ==
+             hdag_darr_occupied_size(&ser_bundle.extra_edges));
+        TEST(memcmp(par_bundle.extra_edges.slots,
+                    ser_bundle.extra_edges.slots,
+                    hdag_darr_occupied_size(&ser_bundle.extra_edges)) == 0);
+        TEST(hdag_darr_occupied_size(&par_bundle.unknown_hashes) ==
+             hdag_darr_occupied_size(&ser_bundle.unknown_hashes));
+        TEST(memcmp(par_bundle.unknown_hashes.slots,
+                    ser_bundle.unknown_hashes.slots,
+                    hdag_darr_occupied_size(&ser_bundle.unknown_hashes)) ==
+             0);
+        hdag_bundle_cleanup(&par_bundle);
+    }
+
+    /* Check a conflicting node is detected with multiple threads */
+    PRINT_HASH("%s", node_num / 2);
+    text_len += sprintf(text + text_len, "\n");
+    assert(text_len <= text_size);
+    input_file = fmemopen(text, text_len, "r");
+    TEST(input_file != NULL);
+    if (input_file != NULL) {
+        TEST(hdag_bundle_from_txt(&par_bundle, input_file, hash_len) ==
+             HDAG_RES_OK);
+        fclose(input_file);
+        TEST(hdag_bundle_organize_parallel(&par_bundle, NULL, 3, false) ==
+             HDAG_RES_NODE_CONFLICT);
+    }
+
+#undef PRINT_HASH
+
+cleanup:
+    hdag_bundle_cleanup(&par_bundle);
+    hdag_bundle_cleanup(&ser_bundle);
+    free(hash);
+    free(hex_buf);
+    free(text);
+    return failed;
+}
+
 static size_t
 test_fanout(uint16_t hash_len)
 {
@@ -1435,6 +1783,7 @@ test(uint16_t hash_len)
      * Check adjacency list text file processing works.
      */
     failed += test_txt(hash_len);
+    failed += test_txt_blocks(hash_len);
 
     /* Cleanup the bundle */
     hdag_bundle_cleanup(&bundle);
@@ -1447,6 +1796,7 @@ main(void)
 {
     size_t failed = test(4) + test(32) + test(256) + test(1024);
     failed += test_txt_buggy_case();
+    failed += test_organizing_parallel(4);
     if (failed) {
         fprintf(stderr, "%zu tests failed.\n", failed);
     }
@@ -0,0 +1,355 @@
+/*
+ * Hash DAG git commit-graph reader test
+ */
+
+#include <hdag/commit_graph.h>
+#include <hdag/bundle.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#define TEST(_expr) \
+    do {                                                \
+        if (!(_expr)) {                                 \
+            fprintf(stderr, "%s:%u: Test failed: %s\n", \
+                    __FILE__, __LINE__, #_expr);        \
+            failed++;                                   \
+        }                                               \
+    } while(0)
+
+/** The maximum size of a test commit-graph file */
+#define TEST_GRAPH_MAX_SIZE 4096
+
+/** The position signifying there's no parent */
+#define TEST_PARENT_NONE    0x70000000
+
+/** A test commit-graph layer */
+struct test_layer {
+    /** The number of base layers */
+    uint8_t         base_num;
+    /** The number of commits */
+    size_t          commit_num;
+    /** The last byte of each commit OID, ascending */
+    uint8_t         ids[8];
+    /** The two parent values of each commit */
+    uint32_t        parents[8][2];
+    /** The number of extra edges */
+    size_t          edge_num;
+    /** The extra edges */
+    uint32_t        edges[8];
+};
+
+static void
+test_put_be32(uint8_t *ptr, uint32_t value)
+{
+    ptr[0] = value >> 24;
+    ptr[1] = value >> 16;
+    ptr[2] = value >> 8;
+    ptr[3] = value;
+}
+
+static void
+test_put_be64(uint8_t *ptr, uint64_t value)
+{
+    test_put_be32(ptr, value >> 32);
+    test_put_be32(ptr + 4, value);
+}
+
+/**
+ * Build a commit-graph file from a test layer.
+ *
+ * @param buf       The buffer to build the file in,
+ *                  TEST_GRAPH_MAX_SIZE bytes long.
+ * @param hash_len  The length of the commit OIDs (20 or 32).
+ * @param layer     The layer to build the file from.
+ *
+ * @return The length of the built file.
+ */
+static size_t
+test_build(uint8_t *buf, uint16_t hash_len, const struct test_layer *layer)
+{
+    size_t chunk_num = layer->edge_num != 0 ? 4 : 3;
+    const uint32_t ids[] = {0x4f494446, 0x4f49444c, 0x43444154, 0x45444745};
+    size_t sizes[] = {
+        256 * 4,
+        layer->commit_num * hash_len,
+        layer->commit_num * (hash_len + 16),
+        layer->edge_num * 4,
+    };
+    size_t offset = 8 + (chunk_num + 1) * 12;
+    uint8_t *pos;
+    size_t i;
+
+    memset(buf, 0, TEST_GRAPH_MAX_SIZE);
+    memcpy(buf, "CGPH", 4);
+    buf[4] = 1;
+    buf[5] = hash_len == 20 ? 1 : 2;
+    buf[6] = chunk_num;
+    buf[7] = layer->base_num;
+
+    /* Write the chunk lookup table */
+    for (i = 0; i <= chunk_num; i++) {
+        test_put_be32(buf + 8 + i * 12, i < chunk_num ? ids[i] : 0);
+        test_put_be64(buf + 8 + i * 12 + 4, offset);
+        if (i < chunk_num) {
+            offset += sizes[i];
+        }
+    }
+    assert(offset <= TEST_GRAPH_MAX_SIZE);
+
+    /* Write the fanout (all OIDs start with a zero byte) */
+    pos = buf + 8 + (chunk_num + 1) * 12;
+    for (i = 0; i < 256; i++, pos += 4) {
+        test_put_be32(pos, layer->commit_num);
+    }
+    /* Write the OIDs */
+    for (i = 0; i < layer->commit_num; i++, pos += hash_len) {
+        pos[hash_len - 1] = layer->ids[i];
+    }
+    /* Write the commit data (with zero tree OIDs and dates) */
+    for (i = 0; i < layer->commit_num; i++, pos += hash_len + 16) {
+        test_put_be32(pos + hash_len, layer->parents[i][0]);
+        test_put_be32(pos + hash_len + 4, layer->parents[i][1]);
+    }
+    /* Write the extra edges */
+    for (i = 0; i < layer->edge_num; i++, pos += 4) {
+        test_put_be32(pos, layer->edges[i]);
+    }
+
+    return offset;
+}
+
+/**
+ * Check two bundles have identical nodes and target hashes.
+ */
+static bool
+test_bundles_equal(const struct hdag_bundle *a, const struct hdag_bundle *b)
+{
+    return hdag_darr_occupied_size(&a->nodes) ==
+                hdag_darr_occupied_size(&b->nodes) &&
+           memcmp(a->nodes.slots, b->nodes.slots,
+                  hdag_darr_occupied_size(&a->nodes)) == 0 &&
+           hdag_darr_occupied_size(&a->target_hashes) ==
+                hdag_darr_occupied_size(&b->target_hashes) &&
+           memcmp(a->target_hashes.slots, b->target_hashes.slots,
+                  hdag_darr_occupied_size(&a->target_hashes)) == 0;
+}
+
+/**
+ * Write a buffer to a file.
+ */
+static bool
+test_write_file(const char *pathname, const void *buf, size_t len)
+{
+    FILE *stream = fopen(pathname, "w");
+    bool ok = stream != NULL && fwrite(buf, len, 1, stream) == 1;
+    return (stream == NULL || fclose(stream) == 0) && ok;
+}
+
+static size_t
+test(uint16_t hash_len)
+{
+    size_t failed = 0;
+    /* The base layer: 1, 2 -> 1, 3 -> 1 2 */
+    const struct test_layer base = {
+        .base_num = 0,
+        .commit_num = 3,
+        .ids = {1, 2, 3},
+        .parents = {
+            {TEST_PARENT_NONE, TEST_PARENT_NONE},
+            {0, TEST_PARENT_NONE},
+            {0, 1},
+        },
+    };
+    /* The top layer: 4 -> 1 2 3 (octopus), 5 -> 4 */
+    struct test_layer top = {
+        .base_num = 1,
+        .commit_num = 2,
+        .ids = {4, 5},
+        .parents = {
+            {0, 0x80000000},
+            {3, TEST_PARENT_NONE},
+        },
+        .edge_num = 2,
+        .edges = {1, 0x80000000 | 2},
+    };
+    /* The text equivalent of the two layers above */
+    const char text[] = "01\n02 01\n03 01 02\n04 01 02 03\n05 04\n";
+    uint8_t base_buf[TEST_GRAPH_MAX_SIZE];
+    size_t base_len = test_build(base_buf, hash_len, &base);
+    uint8_t top_buf[TEST_GRAPH_MAX_SIZE];
+    size_t top_len = test_build(top_buf, hash_len, &top);
+    uint8_t bad_buf[TEST_GRAPH_MAX_SIZE];
+    struct hdag_commit_graph graph = HDAG_COMMIT_GRAPH_EMPTY;
+    struct hdag_commit_graph_node_seq seq;
+    struct hdag_bundle txt_bundle = HDAG_BUNDLE_EMPTY(hash_len);
+    struct hdag_bundle cg_bundle = HDAG_BUNDLE_EMPTY(hash_len);
+    char dir[] = "hdagt-commit-graph.XXXXXX";
+    char pathname[256];
+    FILE *stream;
+    size_t i;
+
+    /* Load the text equivalent */
+    stream = fmemopen((char *)text, strlen(text), "r");
+    TEST(stream != NULL);
+    if (stream != NULL) {
+        TEST(hdag_bundle_from_txt(&txt_bundle, stream, hash_len) ==
+             HDAG_RES_OK);
+        fclose(stream);
+    }
+
+    /* Check the layers are accepted, and positions are resolved */
+    TEST(hdag_commit_graph_add_mem(&graph, base_buf, base_len) ==
+         HDAG_RES_OK);
+    TEST(graph.hash_len == hash_len);
+    TEST(hdag_commit_graph_add_mem(&graph, top_buf, top_len) == HDAG_RES_OK);
+    TEST(graph.layers.slots_occupied == 2);
+    TEST(hdag_commit_graph_oid(&graph, 0) == base_buf + 8 + 4 * 12 + 1024);
+    TEST(hdag_commit_graph_oid(&graph, 4) != NULL &&
+         hdag_commit_graph_oid(&graph, 4)[hash_len - 1] == 5);
+    TEST(hdag_commit_graph_oid(&graph, 5) == NULL);
+
+    /* Check loading matches the text equivalent, and can be repeated */
+    for (i = 0; i < 2; i++) {
+        if (i == 0) {
+            hdag_commit_graph_node_seq_init(&seq, &graph);
+        } else {
+            hdag_node_seq_reset(&seq.base);
+        }
+        TEST(hdag_bundle_from_node_seq(&cg_bundle, &seq.base) ==
+             HDAG_RES_OK);
+        TEST(test_bundles_equal(&cg_bundle, &txt_bundle));
+        hdag_bundle_cleanup(&cg_bundle);
+    }
+    hdag_commit_graph_close(&graph);
+    TEST(graph.hash_len == 0);
+
+    /* Check invalid parents are detected when traversing */
+    top.parents[1][0] = 5;
+    top_len = test_build(top_buf, hash_len, &top);
+    TEST(hdag_commit_graph_add_mem(&graph, base_buf, base_len) ==
+         HDAG_RES_OK);
+    TEST(hdag_commit_graph_add_mem(&graph, top_buf, top_len) == HDAG_RES_OK);
+    TEST(hdag_bundle_from_node_seq(
+        NULL, hdag_commit_graph_node_seq_init(&seq, &graph)
+    ) == HDAG_RES_INVALID_FORMAT);
+    hdag_commit_graph_close(&graph);
+    top.parents[1][0] = 3;
+    top.edges[1] = 2;
+    top_len = test_build(top_buf, hash_len, &top);
+    TEST(hdag_commit_graph_add_mem(&graph, base_buf, base_len) ==
+         HDAG_RES_OK);
+    TEST(hdag_commit_graph_add_mem(&graph, top_buf, top_len) == HDAG_RES_OK);
+    TEST(hdag_bundle_from_node_seq(
+        NULL, hdag_commit_graph_node_seq_init(&seq, &graph)
+    ) == HDAG_RES_INVALID_FORMAT);
+    hdag_commit_graph_close(&graph);
+    top.edges[1] = 0x80000000 | 2;
+    top_len = test_build(top_buf, hash_len, &top);
+
+    /* Check a layer with a wrong number of bases is rejected */
+    TEST(hdag_commit_graph_add_mem(&graph, top_buf, top_len) ==
+         HDAG_RES_INVALID_FORMAT);
+    TEST(hdag_commit_graph_add_mem(&graph, base_buf, base_len) ==
+         HDAG_RES_OK);
+    TEST(hdag_commit_graph_add_mem(&graph, base_buf, base_len) ==
+         HDAG_RES_INVALID_FORMAT);
+    /* Check a layer with a different hash length is rejected */
+    memcpy(bad_buf, top_buf, top_len);
+    bad_buf[5] = hash_len == 20 ? 2 : 1;
+    TEST(hdag_commit_graph_add_mem(&graph, bad_buf, top_len) ==
+         HDAG_RES_INVALID_FORMAT);
+    hdag_commit_graph_close(&graph);
+
+    /* Check invalid headers and truncated files are rejected */
+    memcpy(bad_buf, base_buf, base_len);
+    bad_buf[0]++;
+    TEST(hdag_commit_graph_add_mem(&graph, bad_buf, base_len) ==
+         HDAG_RES_INVALID_FORMAT);
+    bad_buf[0]--;
+    bad_buf[4]++;
+    TEST(hdag_commit_graph_add_mem(&graph, bad_buf, base_len) ==
+         HDAG_RES_INVALID_FORMAT);
+    for (i = 0; i < base_len; i++) {
+        TEST(hdag_commit_graph_add_mem(&graph, base_buf, i) ==
+             HDAG_RES_INVALID_FORMAT);
+    }
+    TEST(graph.layers.slots_occupied == 0);
+
+    /* Check opening a single commit-graph file, and a split chain */
+    TEST(mkdtemp(dir) != NULL);
+    snprintf(pathname, sizeof(pathname), "%s/info", dir);
+    TEST(mkdir(pathname, 0700) == 0);
+    TEST(hdag_commit_graph_open(&graph, dir) == HDAG_RES_ERRNO &&
+         errno == ENOENT);
+    snprintf(pathname, sizeof(pathname), "%s/info/commit-graphs", dir);
+    TEST(mkdir(pathname, 0700) == 0);
+    snprintf(pathname, sizeof(pathname),
+             "%s/info/commit-graphs/commit-graph-chain", dir);
+    TEST(test_write_file(pathname,
+                         "00000000000000000000000000000000000000aa\n"
+                         "00000000000000000000000000000000000000bb\n",
+                         82));
+    snprintf(pathname, sizeof(pathname),
+             "%s/info/commit-graphs/graph-"
+             "00000000000000000000000000000000000000aa.graph", dir);
+    TEST(test_write_file(pathname, base_buf, base_len));
+    /* Check a missing chain layer is reported */
+    TEST(hdag_commit_graph_open(&graph, dir) == HDAG_RES_ERRNO &&
+         errno == ENOENT);
+    snprintf(pathname, sizeof(pathname),
+             "%s/info/commit-graphs/graph-"
+             "00000000000000000000000000000000000000bb.graph", dir);
+    TEST(test_write_file(pathname, top_buf, top_len));
+    TEST(hdag_commit_graph_open(&graph, dir) == HDAG_RES_OK);
+    TEST(graph.layers.slots_occupied == 2);
+    if (graph.layers.slots_occupied == 2) {
+        TEST(hdag_bundle_from_node_seq(
+            &cg_bundle, hdag_commit_graph_node_seq_init(&seq, &graph)
+        ) == HDAG_RES_OK);
+        TEST(test_bundles_equal(&cg_bundle, &txt_bundle));
+        hdag_bundle_cleanup(&cg_bundle);
+    }
+    hdag_commit_graph_close(&graph);
+    /* Check the single file takes precedence */
+    snprintf(pathname, sizeof(pathname), "%s/info/commit-graph", dir);
+    TEST(test_write_file(pathname, base_buf, base_len));
+    TEST(hdag_commit_graph_open(&graph, dir) == HDAG_RES_OK);
+    TEST(graph.layers.slots_occupied == 1);
+    hdag_commit_graph_close(&graph);
+    TEST(unlink(pathname) == 0);
+
+    /* Clean up the directory */
+    snprintf(pathname, sizeof(pathname),
+             "%s/info/commit-graphs/graph-"
+             "00000000000000000000000000000000000000aa.graph", dir);
+    TEST(unlink(pathname) == 0);
+    snprintf(pathname, sizeof(pathname),
+             "%s/info/commit-graphs/graph-"
+             "00000000000000000000000000000000000000bb.graph", dir);
+    TEST(unlink(pathname) == 0);
+    snprintf(pathname, sizeof(pathname),
+             "%s/info/commit-graphs/commit-graph-chain", dir);
+    TEST(unlink(pathname) == 0);
+    snprintf(pathname, sizeof(pathname), "%s/info/commit-graphs", dir);
+    TEST(rmdir(pathname) == 0);
+    snprintf(pathname, sizeof(pathname), "%s/info", dir);
+    TEST(rmdir(pathname) == 0);
+    TEST(rmdir(dir) == 0);
+
+    hdag_bundle_cleanup(&txt_bundle);
+    return failed;
+}
+
+int
+main(void)
+{
+    size_t failed = test(20) + test(32);
+    if (failed) {
+        fprintf(stderr, "%zu tests failed.\n", failed);
+    }
+    return failed != 0;
+}
@@ -425,6 +425,1398 @@ test_basic(void)
     return failed;
 }
 
+/**
+ * Check building a file from a graph within various memory budgets
+ * produces the same result as building it in memory.
+ *
+ * @param graph The graph to build the files from.
+ *
+ * @return The number of failed tests.
+ */
+static size_t
+test_bounded_graph(const struct test_graph *graph)
+{
+    size_t failed = 0;
+    struct hdag_file expected_file = HDAG_FILE_CLOSED;
+    struct hdag_file file = HDAG_FILE_CLOSED;
+    struct test_node_seq seq = {
+        .base = {
+            .hash_len = TEST_HASH_LEN,
+            .next_fn = test_node_seq_next,
+        },
+        .graph = graph,
+        .target_hash_seq = {
+            .hash_len = TEST_HASH_LEN,
+            .next_fn = test_hash_seq_next,
+        },
+    };
+    /* Budgets spilling every node, every few nodes, and nothing */
+    const size_t mem_sizes[] = {
+        1, hdag_node_size(TEST_HASH_LEN) * 3, SIZE_MAX / 2, 0
+    };
+    size_t i;
+
+    TEST(!hdag_file_from_node_seq(&expected_file, NULL, -1, 0, &seq.base));
+    for (i = 0; i < HDAG_ARR_LEN(mem_sizes); i++) {
+        seq.node_idx = 0;
+        seq.target_idx = 0;
+        TEST(!hdag_file_from_node_seq_bounded(&file, NULL, -1, 0,
+                                              &seq.base, mem_sizes[i],
+                                              false));
+        TEST(file.size == expected_file.size);
+        TEST(file.contents != NULL && expected_file.contents != NULL &&
+             memcmp(file.contents, expected_file.contents, file.size) == 0);
+        TEST(!hdag_file_close(&file));
+    }
+    TEST(!hdag_file_close(&expected_file));
+
+    return failed;
+}
+
+static size_t
+test_bounded(void)
+{
+    size_t failed = 0;
+    struct hdag_file file = HDAG_FILE_CLOSED;
+    char pathname[256];
+
+    failed += test_bounded_graph(&TEST_GRAPH(TEST_NODE(1)));
+    failed += test_bounded_graph(&TEST_GRAPH(TEST_NODE(2, 1)));
+    failed += test_bounded_graph(&TEST_GRAPH(
+        TEST_NODE(5, 4, 3, 2, 1),
+        TEST_NODE(3, 1, 2),
+        TEST_NODE(9, 8),
+        TEST_NODE(2, 1, 1),
+        TEST_NODE(3, 2, 1),
+        TEST_NODE(7),
+        TEST_NODE(4, 2, 3, 1)
+    ));
+
+    /* Check conflicting nodes are detected when merging the runs */
+    TEST(hdag_file_from_node_seq_bounded(
+        &file, NULL, -1, 0,
+        TEST_NODE_SEQ(TEST_NODE(1, 2), TEST_NODE(1, 3)), 1, false
+    ) == HDAG_RES_NODE_CONFLICT);
+    TEST(!hdag_file_is_open(&file));
+
+    /* Check cycles are detected, and the failed file is removed */
+    strcpy(pathname, "test.XXXXXX.hdag");
+    TEST(hdag_file_from_node_seq_bounded(
+        &file, pathname, 5, S_IRUSR | S_IWUSR,
+        TEST_NODE_SEQ(TEST_NODE(1, 2), TEST_NODE(2, 1)), 1, false
+    ) == HDAG_RES_GRAPH_CYCLE);
+    TEST(!hdag_file_is_open(&file));
+
+    /* Check an on-disk file can be created and reopened */
+    TEST(!hdag_file_from_node_seq_bounded(
+        &file, pathname, 5, S_IRUSR | S_IWUSR,
+        TEST_NODE_SEQ(TEST_NODE(1, 2), TEST_NODE(2)), 1, false
+    ));
+    TEST(hdag_file_is_open(&file));
+    if (hdag_file_is_open(&file)) {
+        assert(strlen(file.pathname) < sizeof(pathname));
+        strncpy(pathname, file.pathname, sizeof(pathname));
+        TEST(file.header->node_num == 2);
+        TEST(hdag_node_off(file.nodes, TEST_HASH_LEN, 0)->generation == 2);
+        TEST(!hdag_file_close(&file));
+        TEST(!hdag_file_open(&file, pathname));
+        TEST(file.header->node_num == 2);
+        TEST(!hdag_file_close(&file));
+        TEST(unlink(pathname) == 0);
+    }
+
+    return failed;
+}
+
+static size_t
+test_in_place(void)
+{
+    size_t failed = 0;
+    struct hdag_bundle bundle = HDAG_BUNDLE_EMPTY(TEST_HASH_LEN);
+    struct hdag_file expected_file = HDAG_FILE_CLOSED;
+    struct hdag_file file = HDAG_FILE_CLOSED;
+    const char *pathname = "test-in-place.hdag";
+    const struct test_graph *graph = &TEST_GRAPH(
+        TEST_NODE(5, 4, 3, 2, 1),
+        TEST_NODE(3, 1, 2),
+        TEST_NODE(9, 8),
+        TEST_NODE(7),
+        TEST_NODE(4, 2, 3, 1)
+    );
+    struct test_node_seq seq = {
+        .base = {
+            .hash_len = TEST_HASH_LEN,
+            .next_fn = test_node_seq_next,
+        },
+        .graph = graph,
+        .target_hash_seq = {
+            .hash_len = TEST_HASH_LEN,
+            .next_fn = test_hash_seq_next,
+        },
+    };
+
+    /* Build the expected file via a separate bundle */
+    TEST(!hdag_bundle_organized_from_node_seq(&bundle, NULL, &seq.base));
+    TEST(!hdag_file_from_bundle(&expected_file, NULL, -1, 0, &bundle));
+
+    /* Check the file built in place on disk matches it */
+    unlink(pathname);
+    seq.node_idx = 0;
+    seq.target_idx = 0;
+    TEST(!hdag_file_from_node_seq(NULL, pathname, -1, S_IRUSR | S_IWUSR,
+                                  &seq.base));
+    TEST(!hdag_file_open(&file, pathname));
+    TEST(file.size == expected_file.size);
+    TEST(file.contents != NULL && expected_file.contents != NULL &&
+         memcmp(file.contents, expected_file.contents, file.size) == 0);
+    TEST(!hdag_file_close(&file));
+
+    /* Check an existing file is not overwritten */
+    TEST(hdag_file_from_node_seq(&file, pathname, -1, S_IRUSR | S_IWUSR,
+                                 TEST_NODE_SEQ(TEST_NODE(1))) ==
+         HDAG_RES_ERRNO_ARG(EEXIST));
+    TEST(!hdag_file_is_open(&file));
+    TEST(!hdag_file_open(&file, pathname));
+    TEST(file.size == expected_file.size);
+    TEST(!hdag_file_close(&file));
+    TEST(unlink(pathname) == 0);
+
+    /* Check a failed in-place build leaves no file behind */
+    TEST(hdag_file_from_node_seq(
+        &file, pathname, -1, S_IRUSR | S_IWUSR,
+        TEST_NODE_SEQ(TEST_NODE(1, 2), TEST_NODE(2, 1))
+    ) == HDAG_RES_GRAPH_CYCLE);
+    TEST(!hdag_file_is_open(&file));
+    TEST(access(pathname, F_OK) != 0 && errno == ENOENT);
+
+    TEST(!hdag_file_close(&expected_file));
+    hdag_bundle_cleanup(&bundle);
+    return failed;
+}
+
+static size_t
+test_index(void)
+{
+    size_t failed = 0;
+    const char *pathname = "test-index.hdag";
+    /* Enough nodes for some to share the index prefixes */
+    const size_t node_num = 1000;
+    const size_t line_size = TEST_HASH_LEN * 4 + 3;
+    char *text = malloc(node_num * line_size + 1);
+    char *hex_buf = malloc(TEST_HASH_LEN * 2 + 1);
+    uint8_t *batch_hashes = malloc(TEST_HASH_LEN * (node_num * 2 + 1));
+    uint32_t *batch_idxs = malloc(sizeof(uint32_t) * (node_num * 2 + 1));
+    uint8_t hash[TEST_HASH_LEN] = {0, };
+    struct hdag_file file = HDAG_FILE_CLOSED;
+    struct hdag_file indexed_file = HDAG_FILE_CLOSED;
+    struct hdag_bundle bundle = HDAG_BUNDLE_EMPTY(TEST_HASH_LEN);
+    const struct hdag_file_section unknown_section = {
+        .type = (uint32_t)('T' | 'E' << 8 | 'S' << 16 | 'T' << 24),
+    };
+    size_t text_len = 0;
+    size_t size;
+    size_t false_positives;
+    size_t i;
+    FILE *stream;
+
+    TEST(text != NULL && hex_buf != NULL &&
+         batch_hashes != NULL && batch_idxs != NULL);
+    if (text == NULL || hex_buf == NULL ||
+        batch_hashes == NULL || batch_idxs == NULL) {
+        goto cleanup;
+    }
+
+/* Fill in a node hash, with every 768th sharing the first four bytes */
+#define FILL_HASH(_i) \
+    do {                                            \
+        hash[0] = ((_i) * 37) & 0xff;               \
+        hash[1] = (_i) % 3;                         \
+        hash[TEST_HASH_LEN - 2] = ((_i) >> 8) & 0xff; \
+        hash[TEST_HASH_LEN - 1] = (_i) & 0xff;      \
+    } while (0)
+
+    /* Build a chain of nodes */
+    for (i = 0; i < node_num; i++) {
+        FILL_HASH(i);
+        text_len += sprintf(text + text_len, "%s",
+                            hdag_bytes_to_hex(hex_buf, hash,
+                                              TEST_HASH_LEN));
+        if (i > 0) {
+            FILL_HASH(i - 1);
+            text_len += sprintf(text + text_len, " %s",
+                                hdag_bytes_to_hex(hex_buf, hash,
+                                                  TEST_HASH_LEN));
+        }
+        text_len += sprintf(text + text_len, "\n");
+    }
+    stream = fmemopen(text, text_len, "r");
+    TEST(stream != NULL);
+    if (stream == NULL) {
+        goto cleanup;
+    }
+    TEST(!hdag_file_from_txt(&file, NULL, -1, 0, stream,
+                             TEST_HASH_LEN, 1, false));
+    fclose(stream);
+
+    /* Check an indexed file finds the same nodes */
+    unlink(pathname);
+    stream = fmemopen(text, text_len, "r");
+    TEST(stream != NULL);
+    if (stream == NULL) {
+        goto cleanup;
+    }
+    TEST(!hdag_file_from_txt(&indexed_file, pathname, -1,
+                             S_IRUSR | S_IWUSR, stream,
+                             TEST_HASH_LEN, 1, false));
+    fclose(stream);
+    TEST(indexed_file.index_prefixes == NULL);
+    size = indexed_file.size;
+    TEST(size == file.size);
+    TEST(!hdag_file_add_index(&indexed_file));
+    TEST(indexed_file.index_prefixes != NULL);
+    TEST(indexed_file.size == size + sizeof(struct hdag_file_section) +
+                              hdag_file_index_size(node_num));
+    TEST(memcmp(indexed_file.contents, file.contents, size) == 0);
+    /* Check adding the index again does nothing */
+    TEST(!hdag_file_add_index(&indexed_file));
+    TEST(indexed_file.size == size + sizeof(struct hdag_file_section) +
+                              hdag_file_index_size(node_num));
+    TEST(!hdag_file_close(&indexed_file));
+    TEST(!hdag_file_open(&indexed_file, pathname));
+    TEST(indexed_file.index_prefixes != NULL);
+    for (i = 0; i < node_num; i++) {
+        FILL_HASH(i);
+        TEST(hdag_file_find_node_idx(&indexed_file, hash) ==
+             hdag_file_find_node_idx(&file, hash));
+        TEST(hdag_file_find_node_idx(&indexed_file, hash) < INT32_MAX);
+        /* Check hashes just above the node's are not found */
+        hash[TEST_HASH_LEN - 3] = 1;
+        TEST(hdag_file_find_node_idx(&indexed_file, hash) == INT32_MAX);
+        hash[TEST_HASH_LEN - 3] = 0;
+    }
+    memset(hash, 0xff, sizeof(hash));
+    TEST(hdag_file_find_node_idx(&indexed_file, hash) == INT32_MAX);
+    memset(hash, 0, sizeof(hash));
+    TEST(hdag_file_find_node_idx(&indexed_file, hash) == 0);
+
+    /* Check the 16-bit fanout is added next to the index, and agrees */
+    size = indexed_file.size;
+    TEST(indexed_file.fanout16 == NULL);
+    TEST(!hdag_file_add_fanout16(&indexed_file));
+    TEST(indexed_file.fanout16 != NULL);
+    TEST(indexed_file.index_prefixes != NULL);
+    TEST(indexed_file.size == size + sizeof(struct hdag_file_section) +
+                              sizeof(uint32_t) * HDAG_FANOUT16_LEN);
+    TEST(!hdag_file_add_fanout16(&indexed_file));
+    TEST(!hdag_file_close(&indexed_file));
+    TEST(!hdag_file_open(&indexed_file, pathname));
+    TEST(indexed_file.fanout16 != NULL);
+    TEST(indexed_file.index_prefixes != NULL);
+    TEST(!hdag_file_to_bundle(&bundle, &file));
+    TEST(hdag_darr_is_empty(&bundle.nodes_fanout16));
+    TEST(!hdag_bundle_fanout16_fill(&bundle));
+    TEST(indexed_file.fanout16 != NULL &&
+         memcmp(bundle.nodes_fanout16.slots, indexed_file.fanout16,
+                sizeof(uint32_t) * HDAG_FANOUT16_LEN) == 0);
+    for (i = 0; i < node_num; i++) {
+        FILL_HASH(i);
+        TEST(hdag_file_find_node_idx(&indexed_file, hash) ==
+             hdag_file_find_node_idx(&file, hash));
+        TEST(hdag_bundle_find_node_idx(&bundle, hash) ==
+             hdag_file_find_node_idx(&file, hash));
+        hash[TEST_HASH_LEN - 3] = 1;
+        TEST(hdag_file_find_node_idx(&indexed_file, hash) == INT32_MAX);
+        TEST(hdag_bundle_find_node_idx(&bundle, hash) == INT32_MAX);
+        hash[TEST_HASH_LEN - 3] = 0;
+    }
+    /* Check batch lookups agree, with and without the 16-bit fanout */
+    for (i = 0; i < node_num * 2 + 1; i++) {
+        FILL_HASH(i / 2);
+        hash[TEST_HASH_LEN - 3] = i & 1;
+        memcpy(batch_hashes + i * TEST_HASH_LEN, hash, TEST_HASH_LEN);
+    }
+    hdag_file_find_node_idx_batch(&file, batch_hashes, node_num * 2 + 1,
+                                  batch_idxs);
+    for (i = 0; i < node_num * 2 + 1; i++) {
+        TEST(batch_idxs[i] ==
+             hdag_file_find_node_idx(&file,
+                                     batch_hashes + i * TEST_HASH_LEN));
+    }
+    memset(batch_idxs, 0, sizeof(uint32_t) * (node_num * 2 + 1));
+    hdag_file_find_node_idx_batch(&indexed_file, batch_hashes,
+                                  node_num * 2 + 1, batch_idxs);
+    for (i = 0; i < node_num * 2 + 1; i++) {
+        TEST(batch_idxs[i] ==
+             ((i & 1) || i == node_num * 2 ? INT32_MAX :
+              hdag_file_find_node_idx(&file,
+                                      batch_hashes + i * TEST_HASH_LEN)));
+    }
+    memset(batch_idxs, 0, sizeof(uint32_t) * (node_num * 2 + 1));
+    hdag_bundle_find_node_idx_batch(&bundle, batch_hashes,
+                                    node_num * 2 + 1, batch_idxs);
+    for (i = 0; i < node_num * 2 + 1; i++) {
+        TEST(batch_idxs[i] ==
+             hdag_file_find_node_idx(&file,
+                                     batch_hashes + i * TEST_HASH_LEN));
+    }
+    hdag_bundle_cleanup(&bundle);
+    /* Check a bundle borrows the file's 16-bit fanout */
+    TEST(!hdag_file_to_bundle(&bundle, &indexed_file));
+    TEST(hdag_darr_occupied_slots(&bundle.nodes_fanout16) ==
+         HDAG_FANOUT16_LEN);
+    TEST(bundle.nodes_fanout16.slots == indexed_file.fanout16);
+    hdag_bundle_cleanup(&bundle);
+
+    /* Check the Bloom filter passes all nodes, and rejects most others */
+    TEST(indexed_file.bloom == NULL);
+    TEST(!hdag_file_add_bloom(&indexed_file, 16));
+    TEST(!hdag_file_add_bloom(&indexed_file, 16));
+    TEST(!hdag_file_close(&indexed_file));
+    TEST(!hdag_file_open(&indexed_file, pathname));
+    TEST(indexed_file.bloom != NULL);
+    TEST(indexed_file.fanout16 != NULL);
+    TEST(indexed_file.index_prefixes != NULL);
+    TEST((uintptr_t)indexed_file.bloom_blocks %
+         HDAG_FILE_BLOOM_BLOCK_SIZE == 0);
+    false_positives = 0;
+    for (i = 0; i < node_num; i++) {
+        FILL_HASH(i);
+        TEST(indexed_file.bloom == NULL ||
+             hdag_file_bloom_may_contain(&indexed_file, hash));
+        TEST(hdag_file_find_node_idx(&indexed_file, hash) ==
+             hdag_file_find_node_idx(&file, hash));
+        hash[TEST_HASH_LEN - 3] = 1;
+        false_positives += indexed_file.bloom != NULL &&
+            hdag_file_bloom_may_contain(&indexed_file, hash);
+        TEST(hdag_file_find_node_idx(&indexed_file, hash) == INT32_MAX);
+        hash[TEST_HASH_LEN - 3] = 0;
+    }
+    /* Expect under a percent of false positives */
+    TEST(false_positives < node_num / 100);
+    TEST(!hdag_file_close(&indexed_file));
+
+#undef FILL_HASH
+
+    /* Check unknown sections are skipped, and invalid ones rejected */
+    stream = fopen(pathname, "ab");
+    TEST(stream != NULL);
+    if (stream != NULL) {
+        TEST(fwrite(&unknown_section, sizeof(unknown_section), 1,
+                    stream) == 1);
+        TEST(fclose(stream) == 0);
+    }
+    TEST(!hdag_file_open(&indexed_file, pathname));
+    TEST(indexed_file.index_prefixes != NULL);
+    TEST(!hdag_file_close(&indexed_file));
+    stream = fopen(pathname, "ab");
+    TEST(stream != NULL);
+    if (stream != NULL) {
+        TEST(fwrite(&unknown_section, sizeof(unknown_section) / 2, 1,
+                    stream) == 1);
+        TEST(fclose(stream) == 0);
+    }
+    TEST(hdag_file_open(&indexed_file, pathname) ==
+         HDAG_RES_ERRNO_ARG(EINVAL));
+    TEST(unlink(pathname) == 0);
+
+cleanup:
+    hdag_bundle_cleanup(&bundle);
+    (void)hdag_file_close(&indexed_file);
+    (void)hdag_file_close(&file);
+    free(batch_idxs);
+    free(batch_hashes);
+    free(hex_buf);
+    free(text);
+    return failed;
+}
+
+static size_t
+test_bloom(void)
+{
+    size_t failed = 0;
+    struct hdag_file file = HDAG_FILE_CLOSED;
+    uint8_t hash[TEST_HASH_LEN] = {0, };
+
+    /* Nodes 1 and 3, pointing to unknown nodes 2 and 4 */
+    TEST(!hdag_file_from_node_seq(
+        &file, NULL, -1, 0,
+        TEST_NODE_SEQ(TEST_NODE(1, 2), TEST_NODE(3, 4))
+    ));
+    TEST(file.header->unknown_hash_num == 2);
+    TEST(file.bloom == NULL);
+
+    /* Check the unknown hashes are found the same with and without it */
+    for (size_t pass = 0; pass < 2; pass++) {
+        if (pass != 0) {
+            TEST(!hdag_file_add_bloom(&file, 10));
+            TEST(file.bloom != NULL);
+            TEST(file.bloom == NULL || file.bloom->block_num == 1);
+        }
+        for (hash[0] = 1; hash[0] <= 5; hash[0]++) {
+            TEST(hdag_file_has_unknown_hash(&file, hash) ==
+                 (hash[0] == 2 || hash[0] == 4));
+            TEST((hdag_file_find_node_idx(&file, hash) < INT32_MAX) ==
+                 (hash[0] < 5));
+        }
+    }
+
+    TEST(!hdag_file_close(&file));
+    return failed;
+}
+
+static size_t
+test_ancestor(void)
+{
+    size_t failed = 0;
+    struct hdag_file file = HDAG_FILE_CLOSED;
+    struct hdag_bundle bundle = HDAG_BUNDLE_EMPTY(TEST_HASH_LEN);
+    uint8_t from_hash[TEST_HASH_LEN] = {0, };
+    uint8_t to_hash[TEST_HASH_LEN] = {0, };
+    /* The reachable nodes, a bit per node 1-9, for each node 1-9 */
+    const uint16_t reachable[] = {
+        [1] = 0x03e, [2] = 0x034, [3] = 0x038, [4] = 0x030, [5] = 0x020,
+        [6] = 0x060, [7] = 0x180, [8] = 0x100, [9] = 0x200,
+    };
+    uint32_t from_idx;
+    uint32_t to_idx;
+
+    /*
+     * A diamond 1-2/3-4 over 5, shared with 6, a separate 7 over unknown 8,
+     * and a lone 9
+     */
+    TEST(!hdag_file_from_node_seq(
+        &file, NULL, -1, 0,
+        TEST_NODE_SEQ(TEST_NODE(1, 2, 3), TEST_NODE(2, 4), TEST_NODE(3, 4),
+                      TEST_NODE(4, 5), TEST_NODE(5), TEST_NODE(6, 5),
+                      TEST_NODE(7, 8), TEST_NODE(9))
+    ));
+    TEST(file.header->node_num == 9);
+
+    /*
+     * Check every pair of nodes, both by hashes and indexes, first without
+     * the reachability intervals, then with the bundle's, then with the
+     * file's ones
+     */
+    for (size_t pass = 0; pass < 3; pass++) {
+        hdag_bundle_cleanup(&bundle);
+        if (pass == 2) {
+            TEST(!hdag_file_add_intervals(&file, 3));
+            TEST(file.intervals != NULL);
+            TEST(file.intervals == NULL ||
+                 file.intervals->interval_num == 3);
+        }
+        TEST(!hdag_file_to_bundle(&bundle, &file));
+        if (pass == 1) {
+            TEST(!hdag_bundle_intervals_fill(&bundle, 3));
+        }
+        TEST(hdag_darr_is_empty(&bundle.node_intervals) == (pass == 0));
+        for (from_hash[0] = 1; from_hash[0] <= 9; from_hash[0]++) {
+            for (to_hash[0] = 1; to_hash[0] <= 9; to_hash[0]++) {
+                bool expected = (reachable[from_hash[0]] >> to_hash[0]) & 1;
+                TEST(hdag_file_is_ancestor(&file, from_hash, to_hash) ==
+                     expected);
+                TEST(hdag_bundle_is_ancestor(&bundle, from_hash, to_hash) ==
+                     expected);
+                from_idx = hdag_file_find_node_idx(&file, from_hash);
+                to_idx = hdag_file_find_node_idx(&file, to_hash);
+                TEST(from_idx < INT32_MAX && to_idx < INT32_MAX);
+                if (from_idx < INT32_MAX && to_idx < INT32_MAX) {
+                    TEST(hdag_file_is_ancestor_idx(&file,
+                                                   from_idx, to_idx) ==
+                         expected);
+                    TEST(hdag_bundle_is_ancestor_idx(&bundle,
+                                                     from_idx, to_idx) ==
+                         expected);
+                }
+            }
+        }
+    }
+
+    /* Check missing nodes are reported */
+    from_hash[0] = 1;
+    to_hash[0] = 10;
+    TEST(hdag_file_is_ancestor(&file, from_hash, to_hash) ==
+         HDAG_RES_ERRNO_ARG(ENOENT));
+    TEST(hdag_file_is_ancestor(&file, to_hash, from_hash) ==
+         HDAG_RES_ERRNO_ARG(ENOENT));
+    TEST(hdag_bundle_is_ancestor(&bundle, from_hash, to_hash) ==
+         HDAG_RES_ERRNO_ARG(ENOENT));
+
+    hdag_bundle_cleanup(&bundle);
+    TEST(!hdag_file_close(&file));
+    return failed;
+}
+
+/**
+ * Remove the parentheses around a list of arguments.
+ */
+#define TEST_UNPAREN(...) __VA_ARGS__
+
+/**
+ * The number of variants of each node query: over a file or a bundle,
+ * with node hashes or indexes.
+ */
+#define TEST_VARIANT_NUM    4
+
+/**
+ * Call one variant of a node query, which has the hdag_file_<name>(),
+ * hdag_file_<name>_idx(), hdag_bundle_<name>(), and
+ * hdag_bundle_<name>_idx() functions.
+ *
+ * @param _variant      The number of the variant to call, less than
+ *                      TEST_VARIANT_NUM.
+ * @param _name         The name of the query.
+ * @param _file         The file to query.
+ * @param _bundle       The bundle of the file to query.
+ * @param _hash_args    The parenthesized arguments following the file or
+ *                      the bundle, for querying with hashes.
+ * @param _idx_args     The parenthesized arguments following the file or
+ *                      the bundle, for querying with indexes.
+ *
+ * @return The result of the query.
+ */
+#define TEST_VARIANT_CALL(_variant, _name, _file, _bundle, \
+                          _hash_args, _idx_args)                        \
+    ((_variant) == 0                                                    \
+        ? hdag_file_##_name(_file, TEST_UNPAREN _hash_args)             \
+        : (_variant) == 1                                               \
+            ? hdag_file_##_name##_idx(_file, TEST_UNPAREN _idx_args)    \
+            : (_variant) == 2                                           \
+                ? hdag_bundle_##_name(_bundle, TEST_UNPAREN _hash_args) \
+                : hdag_bundle_##_name##_idx(_bundle,                    \
+                                            TEST_UNPAREN _idx_args))
+
+/**
+ * Create an in-memory file with a criss-cross merge of 1 and 2 over 3 and
+ * 4, going down to 7 on separate paths, with 11 over both 1 and 2, 8 over
+ * 7, and a separate component of 9 over 10.
+ *
+ * @param pfile Location for the opened file.
+ *
+ * @return The number of failed tests.
+ */
+static size_t
+test_criss_cross_file(struct hdag_file *pfile)
+{
+    size_t failed = 0;
+
+    TEST(!hdag_file_from_node_seq(
+        pfile, NULL, -1, 0,
+        TEST_NODE_SEQ(TEST_NODE(1, 3, 4), TEST_NODE(2, 3, 4),
+                      TEST_NODE(3, 5), TEST_NODE(4, 6), TEST_NODE(5, 7),
+                      TEST_NODE(6, 7), TEST_NODE(7), TEST_NODE(8, 7),
+                      TEST_NODE(9, 10), TEST_NODE(10), TEST_NODE(11, 1, 2))
+    ));
+    TEST(pfile->header->node_num == 11);
+    return failed;
+}
+
+/**
+ * Create an in-memory file with a random DAG, using random(). Each node
+ * targets up to a number of randomly-picked nodes among the few created
+ * right before it, making long paths, and some nodes start new
+ * components.
+ *
+ * @param pfile             Location for the opened file.
+ * @param node_num          The number of nodes to create, up to 65536.
+ * @param max_target_num    The maximum number of targets of each node.
+ *
+ * @return The number of failed tests.
+ */
+static size_t
+test_random_file(struct hdag_file *pfile,
+                 size_t node_num, size_t max_target_num)
+{
+    size_t failed = 0;
+    const size_t line_size = (TEST_HASH_LEN * 2 + 1) * (max_target_num + 1);
+    char *text = malloc(node_num * line_size + 1);
+    char hex_buf[TEST_HASH_LEN * 2 + 1];
+    uint8_t hash[TEST_HASH_LEN] = {0, };
+    size_t text_len = 0;
+    size_t target_num;
+    size_t target_idx;
+    size_t i, j;
+    FILE *stream;
+
+    assert(node_num <= 0x10000);
+
+    TEST(text != NULL);
+    if (text == NULL) {
+        return failed;
+    }
+
+/* Fill in the hash of a node, scattering them over the fanout */
+#define FILL_HASH(_i) \
+    do {                                    \
+        hash[0] = ((_i) * 37) & 0xff;       \
+        hash[1] = ((_i) >> 8) & 0xff;       \
+        hash[2] = (_i) & 0xff;              \
+    } while (0)
+
+    for (i = 0; i < node_num; i++) {
+        FILL_HASH(i);
+        text_len += sprintf(text + text_len, "%s",
+                            hdag_bytes_to_hex(hex_buf, hash,
+                                              TEST_HASH_LEN));
+        target_num = (i == 0 || random() % 32 == 0)
+            ? 0 : 1 + (size_t)random() % max_target_num;
+        for (j = 0; j < target_num; j++) {
+            target_idx = i - 1 - (size_t)random() % (i < 16 ? i : 16);
+            FILL_HASH(target_idx);
+            text_len += sprintf(text + text_len, " %s",
+                                hdag_bytes_to_hex(hex_buf, hash,
+                                                  TEST_HASH_LEN));
+        }
+        text_len += sprintf(text + text_len, "\n");
+    }
+
+#undef FILL_HASH
+
+    stream = fmemopen(text, text_len, "r");
+    TEST(stream != NULL);
+    if (stream != NULL) {
+        TEST(!hdag_file_from_txt(pfile, NULL, -1, 0, stream,
+                                 TEST_HASH_LEN, 1, false));
+        fclose(stream);
+        TEST(pfile->header->node_num == node_num);
+    }
+    free(text);
+    return failed;
+}
+
+/**
+ * Compute the reachability of every node from every other node in a
+ * bundle, using hdag_bundle_is_ancestor_idx().
+ *
+ * @param bundle    The bundle to compute the reachability in.
+ *
+ * @return The matrix of reachability, a byte per node pair, the index of
+ *         the node reachable from, times the number of nodes, plus the
+ *         index of the reachable one. Or NULL, if failed. Must be freed.
+ */
+static uint8_t *
+test_reachable(const struct hdag_bundle *bundle)
+{
+    size_t node_num = bundle->nodes.slots_occupied;
+    uint8_t *reachable = malloc(node_num * node_num + 1);
+    hdag_res res;
+    size_t from_idx;
+    size_t to_idx;
+
+    if (reachable == NULL) {
+        return NULL;
+    }
+    for (from_idx = 0; from_idx < node_num; from_idx++) {
+        for (to_idx = 0; to_idx < node_num; to_idx++) {
+            res = hdag_bundle_is_ancestor_idx(bundle, from_idx, to_idx);
+            if (hdag_res_is_failure(res)) {
+                free(reachable);
+                return NULL;
+            }
+            reachable[from_idx * node_num + to_idx] = res;
+        }
+    }
+    return reachable;
+}
+
+static size_t
+test_ancestor_random(void)
+{
+    size_t failed = 0;
+    struct hdag_file file = HDAG_FILE_CLOSED;
+    struct hdag_bundle bundle = HDAG_BUNDLE_EMPTY(TEST_HASH_LEN);
+    const size_t node_num = 128;
+    uint8_t *expected = NULL;
+    uint8_t *reachable = NULL;
+    uint32_t interval_num;
+    uint32_t from_idx;
+    uint32_t to_idx;
+
+    /* Get the reachability without the intervals */
+    srandom(1);
+    failed += test_random_file(&file, node_num, 3);
+    TEST(!hdag_file_to_bundle(&bundle, &file));
+    expected = test_reachable(&bundle);
+    TEST(expected != NULL);
+    if (expected == NULL) {
+        goto cleanup;
+    }
+
+    /* Check the bundle gets the same with any number of intervals */
+    for (interval_num = 1; interval_num <= 4; interval_num++) {
+        hdag_bundle_cleanup(&bundle);
+        TEST(!hdag_file_to_bundle(&bundle, &file));
+        TEST(!hdag_bundle_intervals_fill(&bundle, interval_num));
+        reachable = test_reachable(&bundle);
+        TEST(reachable != NULL && memcmp(reachable, expected,
+                                         node_num * node_num) == 0);
+        free(reachable);
+    }
+
+    /*
+     * Check the file gets the same with its own intervals, added after
+     * another section, as the file can move while they're added
+     */
+    TEST(!hdag_file_add_fanout16(&file));
+    TEST(!hdag_file_add_intervals(&file, 2));
+    TEST(file.intervals != NULL);
+    for (from_idx = 0; from_idx < node_num; from_idx++) {
+        for (to_idx = 0; to_idx < node_num; to_idx++) {
+            TEST(hdag_file_is_ancestor_idx(&file, from_idx, to_idx) ==
+                 expected[from_idx * node_num + to_idx]);
+        }
+    }
+
+cleanup:
+    free(expected);
+    hdag_bundle_cleanup(&bundle);
+    TEST(!hdag_file_close(&file));
+    return failed;
+}
+
+/**
+ * Check the merge bases of heads in a file and a bundle borrowing from it.
+ *
+ * @param file  The file to check the merge bases in.
+ * @param heads The first bytes of the head hashes, zero-terminated.
+ * @param bases The first bytes of the expected base hashes,
+ *              zero-terminated.
+ *
+ * @return The number of failed tests.
+ */
+static size_t
+test_merge_bases_check(const struct hdag_file *file,
+                       const uint8_t *heads, const uint8_t *bases)
+{
+    size_t failed = 0;
+    struct hdag_bundle bundle = HDAG_BUNDLE_EMPTY(TEST_HASH_LEN);
+    struct hdag_darr found = HDAG_DARR_EMPTY(sizeof(uint32_t), 0);
+    uint8_t hashes[TEST_OBJ_NUM][TEST_HASH_LEN] = {{0, }, };
+    uint32_t node_idxs[TEST_OBJ_NUM];
+    uint8_t hash[TEST_HASH_LEN] = {0, };
+    size_t head_num;
+    size_t base_num;
+    uint32_t node_idx;
+    size_t variant;
+    size_t i, j;
+
+    for (head_num = 0; heads[head_num] != 0; head_num++) {
+        hashes[head_num][0] = heads[head_num];
+        node_idxs[head_num] = hdag_file_find_node_idx(file,
+                                                      hashes[head_num]);
+    }
+    for (base_num = 0; bases[base_num] != 0; base_num++);
+    TEST(!hdag_file_to_bundle(&bundle, file));
+
+    /* Check each variant finds exactly the expected bases */
+    for (variant = 0; variant < TEST_VARIANT_NUM; variant++) {
+        hdag_darr_empty(&found);
+        TEST(TEST_VARIANT_CALL(variant, merge_bases, file, &bundle,
+                               (hashes[0], head_num, &found),
+                               (node_idxs, head_num, &found)) ==
+             (hdag_res)base_num);
+        TEST(hdag_darr_occupied_slots(&found) == base_num);
+        for (i = 0; i < base_num; i++) {
+            hash[0] = bases[i];
+            node_idx = hdag_file_find_node_idx(file, hash);
+            for (j = 0; j < hdag_darr_occupied_slots(&found) &&
+                        ((uint32_t *)found.slots)[j] != node_idx; j++);
+            TEST(j < hdag_darr_occupied_slots(&found));
+        }
+    }
+
+    hdag_darr_cleanup(&found);
+    hdag_bundle_cleanup(&bundle);
+    return failed;
+}
+
+static size_t
+test_merge_bases(void)
+{
+    size_t failed = 0;
+    struct hdag_file file = HDAG_FILE_CLOSED;
+    struct hdag_darr found = HDAG_DARR_EMPTY(sizeof(uint32_t), 0);
+    uint8_t hashes[2][TEST_HASH_LEN] = {{1, }, {12, }};
+
+    failed += test_criss_cross_file(&file);
+
+    /* Both sides of a criss-cross merge are the best */
+    failed += test_merge_bases_check(&file, (uint8_t []){1, 2, 0},
+                                     (uint8_t []){3, 4, 0});
+    failed += test_merge_bases_check(&file, (uint8_t []){3, 4, 0},
+                                     (uint8_t []){7, 0});
+    /* A head reachable from the other is the base */
+    failed += test_merge_bases_check(&file, (uint8_t []){1, 3, 0},
+                                     (uint8_t []){3, 0});
+    failed += test_merge_bases_check(&file, (uint8_t []){11, 1, 0},
+                                     (uint8_t []){1, 0});
+    failed += test_merge_bases_check(&file, (uint8_t []){1, 1, 0},
+                                     (uint8_t []){1, 0});
+    failed += test_merge_bases_check(&file, (uint8_t []){5, 0},
+                                     (uint8_t []){5, 0});
+    /* Octopus merges */
+    failed += test_merge_bases_check(&file, (uint8_t []){5, 6, 8, 0},
+                                     (uint8_t []){7, 0});
+    failed += test_merge_bases_check(&file, (uint8_t []){1, 2, 5, 0},
+                                     (uint8_t []){5, 0});
+    failed += test_merge_bases_check(&file, (uint8_t []){1, 2, 11, 0},
+                                     (uint8_t []){3, 4, 0});
+    /* Separate components have no common ancestors */
+    failed += test_merge_bases_check(&file, (uint8_t []){1, 9, 0},
+                                     (uint8_t []){0});
+    failed += test_merge_bases_check(&file, (uint8_t []){9, 10, 0},
+                                     (uint8_t []){10, 0});
+
+    /* Check missing heads are reported */
+    TEST(hdag_file_merge_bases(&file, hashes[0], 2, &found) ==
+         HDAG_RES_ERRNO_ARG(ENOENT));
+    TEST(hdag_darr_is_empty(&found));
+
+    hdag_darr_cleanup(&found);
+    TEST(!hdag_file_close(&file));
+    return failed;
+}
+
+static size_t
+test_merge_bases_random(void)
+{
+    size_t failed = 0;
+    struct hdag_file file = HDAG_FILE_CLOSED;
+    struct hdag_bundle bundle = HDAG_BUNDLE_EMPTY(TEST_HASH_LEN);
+    struct hdag_darr found = HDAG_DARR_EMPTY(sizeof(uint32_t), 0);
+    /* Enough heads for the bitmaps to take more than one word */
+    uint8_t hashes[100][TEST_HASH_LEN];
+    uint32_t heads[HDAG_ARR_LEN(hashes)];
+    const size_t max_head_num = HDAG_ARR_LEN(heads);
+    bool common[128];
+    uint32_t candidates[HDAG_ARR_LEN(common)];
+    const size_t node_num = HDAG_ARR_LEN(common);
+    uint8_t *reachable = NULL;
+    size_t candidate_num;
+    size_t head_num;
+    size_t base_num;
+    size_t variant;
+    size_t trial;
+    uint32_t root;
+    size_t i, j;
+
+    srandom(1);
+    failed += test_random_file(&file, node_num, 3);
+    TEST(!hdag_file_to_bundle(&bundle, &file));
+    reachable = test_reachable(&bundle);
+    TEST(reachable != NULL);
+    if (reachable == NULL) {
+        goto cleanup;
+    }
+
+    for (trial = 0; trial < 200; trial++) {
+        if (trial % 4 == 0) {
+            /* Pick many heads reaching a random node, repeating some */
+            do {
+                root = (size_t)random() % node_num;
+                for (candidate_num = 0, i = 0; i < node_num; i++) {
+                    if (reachable[i * node_num + root]) {
+                        candidates[candidate_num++] = i;
+                    }
+                }
+            } while (candidate_num < 16);
+            head_num = 65 + (size_t)random() % (max_head_num - 64);
+            for (i = 0; i < head_num; i++) {
+                heads[i] = candidates[(size_t)random() % candidate_num];
+            }
+        } else {
+            /* Pick a few heads anywhere, possibly in separate components */
+            head_num = 1 + (size_t)random() % 4;
+            for (i = 0; i < head_num; i++) {
+                heads[i] = (size_t)random() % node_num;
+            }
+        }
+        for (i = 0; i < head_num; i++) {
+            memcpy(hashes[i],
+                   hdag_node_off_const(file.nodes, TEST_HASH_LEN,
+                                       heads[i])->hash,
+                   TEST_HASH_LEN);
+        }
+
+        /* The best common ancestors are not reachable from other ones */
+        for (i = 0; i < node_num; i++) {
+            common[i] = true;
+            for (j = 0; j < head_num && common[i]; j++) {
+                common[i] = reachable[heads[j] * node_num + i];
+            }
+        }
+        for (base_num = 0, i = 0; i < node_num; i++) {
+            for (j = 0; j < node_num && common[i]; j++) {
+                if (j != i && common[j] && reachable[j * node_num + i]) {
+                    break;
+                }
+            }
+            base_num += common[i] && j == node_num;
+        }
+
+        for (variant = 0; variant < TEST_VARIANT_NUM; variant++) {
+            hdag_darr_empty(&found);
+            TEST(TEST_VARIANT_CALL(variant, merge_bases, &file, &bundle,
+                                   (hashes[0], head_num, &found),
+                                   (heads, head_num, &found)) ==
+                 (hdag_res)base_num);
+            TEST(hdag_darr_occupied_slots(&found) == base_num);
+            for (i = 0; i < hdag_darr_occupied_slots(&found); i++) {
+                j = ((uint32_t *)found.slots)[i];
+                TEST(j < node_num && common[j]);
+                for (root = 0; root < node_num && j < node_num; root++) {
+                    TEST(root == j || !common[root] ||
+                         !reachable[root * node_num + j]);
+                }
+            }
+        }
+    }
+
+cleanup:
+    free(reachable);
+    hdag_darr_cleanup(&found);
+    hdag_bundle_cleanup(&bundle);
+    TEST(!hdag_file_close(&file));
+    return failed;
+}
+
+/**
+ * Check an ancestor sequence yields the expected nodes, in the order of
+ * descending generation, both after starting and after resetting.
+ *
+ * @param seq       The ancestor sequence to check, over a bundle of
+ *                  "file".
+ * @param file      The file containing the nodes.
+ * @param includes  The first bytes of the hashes of the nodes to walk the
+ *                  ancestors of, zero-terminated.
+ * @param excludes  The first bytes of the hashes of the nodes to exclude
+ *                  the ancestors of, zero-terminated.
+ * @param expected  The first bytes of the hashes of the expected nodes,
+ *                  in any order, zero-terminated.
+ *
+ * @return The number of failed tests.
+ */
+static size_t
+test_ancestor_seq_check(struct hdag_bundle_ancestor_seq *seq,
+                        const struct hdag_file *file,
+                        const uint8_t *includes, const uint8_t *excludes,
+                        const uint8_t *expected)
+{
+    size_t failed = 0;
+    uint32_t include_idxs[TEST_OBJ_NUM];
+    uint32_t exclude_idxs[TEST_OBJ_NUM];
+    uint8_t hash[TEST_HASH_LEN] = {0, };
+    const uint8_t *node_hash;
+    struct hdag_hash_seq *target_hash_seq;
+    const struct hdag_node *node;
+    size_t include_num;
+    size_t exclude_num;
+    size_t expected_num;
+    uint32_t node_idx;
+    uint32_t generation;
+    /* The bitmap of nodes yielded so far, by the first hash byte */
+    uint64_t yielded;
+    size_t yielded_num;
+    size_t pass;
+    size_t i;
+
+    for (include_num = 0; includes[include_num] != 0; include_num++) {
+        hash[0] = includes[include_num];
+        include_idxs[include_num] = hdag_file_find_node_idx(file, hash);
+    }
+    for (exclude_num = 0; excludes[exclude_num] != 0; exclude_num++) {
+        hash[0] = excludes[exclude_num];
+        exclude_idxs[exclude_num] = hdag_file_find_node_idx(file, hash);
+    }
+    for (expected_num = 0; expected[expected_num] != 0; expected_num++);
+
+    TEST(!hdag_bundle_ancestor_seq_start(seq, include_idxs, include_num,
+                                         exclude_idxs, exclude_num));
+    for (pass = 0; pass < 2; pass++) {
+        if (pass != 0) {
+            hdag_node_seq_reset(&seq->base);
+        }
+        yielded = 0;
+        yielded_num = 0;
+        generation = UINT32_MAX;
+        while (hdag_node_seq_next(&seq->base, &node_hash,
+                                  &target_hash_seq) == HDAG_RES_OK) {
+            node_idx = hdag_file_find_node_idx(file, node_hash);
+            TEST(node_idx < file->header->node_num);
+            if (node_idx >= file->header->node_num) {
+                break;
+            }
+            /* Check the generations go down, and nothing repeats */
+            node = hdag_node_off_const(file->nodes, TEST_HASH_LEN, node_idx);
+            TEST(node->generation <= generation);
+            generation = node->generation;
+            TEST(!(yielded >> node_hash[0] & 1));
+            yielded |= UINT64_C(1) << node_hash[0];
+            yielded_num++;
+        }
+        TEST(yielded_num == expected_num);
+        for (i = 0; i < expected_num; i++) {
+            TEST(yielded >> expected[i] & 1);
+        }
+    }
+    return failed;
+}
+
+static size_t
+test_ancestor_seq(void)
+{
+    size_t failed = 0;
+    struct hdag_file file = HDAG_FILE_CLOSED;
+    struct hdag_bundle bundle = HDAG_BUNDLE_EMPTY(TEST_HASH_LEN);
+    struct hdag_bundle ancestors = HDAG_BUNDLE_EMPTY(TEST_HASH_LEN);
+    struct hdag_bundle_ancestor_seq seq;
+    uint32_t node_idx;
+    uint8_t hash[TEST_HASH_LEN] = {1, };
+
+    failed += test_criss_cross_file(&file);
+    TEST(!hdag_file_to_bundle(&bundle, &file));
+    hdag_bundle_ancestor_seq_init(&seq, &bundle);
+
+    /* An unstarted sequence is empty */
+    TEST(hdag_node_seq_next(&seq.base, NULL, NULL) > 0);
+
+    /* Reuse the same sequence for every walk */
+    failed += test_ancestor_seq_check(&seq, &file, (uint8_t []){1, 0},
+                                      (uint8_t []){0},
+                                      (uint8_t []){1, 3, 4, 5, 6, 7, 0});
+    failed += test_ancestor_seq_check(&seq, &file, (uint8_t []){9, 1, 0},
+                                      (uint8_t []){0},
+                                      (uint8_t []){9, 10, 1, 3, 4, 5, 6,
+                                                   7, 0});
+    failed += test_ancestor_seq_check(&seq, &file, (uint8_t []){11, 0},
+                                      (uint8_t []){2, 0},
+                                      (uint8_t []){11, 1, 0});
+    failed += test_ancestor_seq_check(&seq, &file, (uint8_t []){1, 8, 0},
+                                      (uint8_t []){5, 0},
+                                      (uint8_t []){1, 3, 4, 6, 8, 0});
+    failed += test_ancestor_seq_check(&seq, &file, (uint8_t []){11, 9, 0},
+                                      (uint8_t []){1, 10, 0},
+                                      (uint8_t []){11, 2, 9, 0});
+    /* Excluding wins over including */
+    failed += test_ancestor_seq_check(&seq, &file, (uint8_t []){3, 0},
+                                      (uint8_t []){3, 0},
+                                      (uint8_t []){0});
+    failed += test_ancestor_seq_check(&seq, &file, (uint8_t []){7, 0},
+                                      (uint8_t []){11, 0},
+                                      (uint8_t []){0});
+    failed += test_ancestor_seq_check(&seq, &file, (uint8_t []){0},
+                                      (uint8_t []){0},
+                                      (uint8_t []){0});
+
+    /* Check existing consumers can take the sequence */
+    node_idx = hdag_file_find_node_idx(&file, hash);
+    TEST(!hdag_bundle_ancestor_seq_start(&seq, &node_idx, 1, NULL, 0));
+    TEST(!hdag_bundle_from_node_seq(&ancestors, &seq.base));
+    TEST(!hdag_bundle_organize(&ancestors, NULL));
+    TEST(ancestors.nodes.slots_occupied == 6);
+
+    hdag_bundle_ancestor_seq_cleanup(&seq);
+    hdag_bundle_cleanup(&ancestors);
+    hdag_bundle_cleanup(&bundle);
+    TEST(!hdag_file_close(&file));
+    return failed;
+}
+
+/**
+ * Check the status of an issue's fix is deduced as expected, for a batch
+ * of nodes at once, with every variant, and for every node separately.
+ *
+ * @param file      The file containing the nodes.
+ * @param mentions  The first bytes of the hashes of the mentioned nodes,
+ *                  each followed by the mention (enum hdag_mention),
+ *                  zero-terminated.
+ * @param expected  The first bytes of the hashes of the nodes to check,
+ *                  each followed by the expected fix status
+ *                  (enum hdag_fix), zero-terminated.
+ *
+ * @return The number of failed tests.
+ */
+static size_t
+test_issue_fixes_check(const struct hdag_file *file,
+                       const uint8_t *mentions, const uint8_t *expected)
+{
+    size_t failed = 0;
+    struct hdag_bundle bundle = HDAG_BUNDLE_EMPTY(TEST_HASH_LEN);
+    uint8_t node_mentions[TEST_OBJ_NUM] = {0, };
+    uint8_t hashes[TEST_OBJ_NUM][TEST_HASH_LEN] = {{0, }, };
+    uint32_t node_idxs[TEST_OBJ_NUM];
+    enum hdag_fix fixes[TEST_OBJ_NUM];
+    enum hdag_fix all_fixes[TEST_OBJ_NUM];
+    enum hdag_fix fix;
+    uint8_t hash[TEST_HASH_LEN] = {0, };
+    uint32_t node_num = file->header->node_num;
+    size_t num;
+    size_t variant;
+    size_t i;
+
+    TEST(node_num <= TEST_OBJ_NUM);
+    for (i = 0; mentions[i] != 0; i += 2) {
+        hash[0] = mentions[i];
+        node_mentions[hdag_file_find_node_idx(file, hash)] = mentions[i + 1];
+    }
+    for (num = 0; expected[num * 2] != 0; num++) {
+        hashes[num][0] = expected[num * 2];
+        node_idxs[num] = hdag_file_find_node_idx(file, hashes[num]);
+    }
+    TEST(!hdag_file_to_bundle(&bundle, file));
+
+    /* Check each variant deduces the expected statuses */
+    for (variant = 0; variant < TEST_VARIANT_NUM; variant++) {
+        memset(fixes, 0xff, sizeof(fixes));
+        TEST(!TEST_VARIANT_CALL(variant, issue_fixes, file, &bundle,
+                                (node_mentions, hashes[0], num, fixes),
+                                (node_mentions, node_idxs, num, fixes)));
+        for (i = 0; i < num; i++) {
+            TEST(fixes[i] == expected[i * 2 + 1]);
+        }
+    }
+
+    /* Check a batch of all the nodes matches the nodes taken separately */
+    for (i = 0; i < node_num; i++) {
+        node_idxs[i] = i;
+    }
+    TEST(!hdag_bundle_issue_fixes_idx(&bundle, node_mentions,
+                                      node_idxs, node_num, all_fixes));
+    for (i = 0; i < node_num; i++) {
+        TEST(!hdag_bundle_issue_fixes_idx(&bundle, node_mentions,
+                                          node_idxs + i, 1, &fix));
+        TEST(all_fixes[i] == fix);
+    }
+
+    hdag_bundle_cleanup(&bundle);
+    return failed;
+}
+
+static size_t
+test_issue_fixes(void)
+{
+    size_t failed = 0;
+    struct hdag_file file = HDAG_FILE_CLOSED;
+    uint8_t node_mentions[TEST_OBJ_NUM] = {0, };
+    uint8_t hashes[2][TEST_HASH_LEN] = {{9, }, {14, }};
+    enum hdag_fix fixes[2];
+
+    /*
+     * A history of 1 to 9 (a to i in the notes), with patchset versions
+     * 11, 12 and 13 of a change based on 2, 4 and 6, merged as 8
+     */
+    TEST(!hdag_file_from_node_seq(
+        &file, NULL, -1, 0,
+        TEST_NODE_SEQ(TEST_NODE(1), TEST_NODE(2, 1), TEST_NODE(3, 2),
+                      TEST_NODE(4, 3), TEST_NODE(5, 4), TEST_NODE(6, 5),
+                      TEST_NODE(7, 6), TEST_NODE(8, 7, 13), TEST_NODE(9, 8),
+                      TEST_NODE(11, 2), TEST_NODE(12, 4, 11),
+                      TEST_NODE(13, 6, 12))
+    ));
+    TEST(file.header->node_num == 12);
+
+    /* Nothing is known without mentions */
+    failed += test_issue_fixes_check(
+        &file, (uint8_t []){0},
+        (uint8_t []){9, HDAG_FIX_UNKNOWN, 1, HDAG_FIX_UNKNOWN, 0}
+    );
+    /* A mention at the node itself is definite */
+    failed += test_issue_fixes_check(
+        &file, (uint8_t []){1, HDAG_MENTION_PRESENT,
+                            9, HDAG_MENTION_ABSENT, 0},
+        (uint8_t []){9, HDAG_FIX_DEFINITE, 1, HDAG_FIX_NOT,
+                     8, HDAG_FIX_NOT, 0}
+    );
+    failed += test_issue_fixes_check(
+        &file, (uint8_t []){9, HDAG_MENTION_PRESENT, 0},
+        (uint8_t []){9, HDAG_FIX_NOT, 8, HDAG_FIX_UNKNOWN, 0}
+    );
+    /* The "present" mention at 5 is not masked by the "absent" one at 12 */
+    failed += test_issue_fixes_check(
+        &file, (uint8_t []){5, HDAG_MENTION_PRESENT,
+                            12, HDAG_MENTION_ABSENT, 0},
+        (uint8_t []){9, HDAG_FIX_NOT, 13, HDAG_FIX_NOT,
+                     12, HDAG_FIX_DEFINITE, 4, HDAG_FIX_UNKNOWN,
+                     1, HDAG_FIX_UNKNOWN, 0}
+    );
+    /* The "present" mention at 5 is masked by the "absent" one at 13 */
+    failed += test_issue_fixes_check(
+        &file, (uint8_t []){5, HDAG_MENTION_PRESENT,
+                            13, HDAG_MENTION_ABSENT, 0},
+        (uint8_t []){9, HDAG_FIX_LIKELY, 8, HDAG_FIX_LIKELY,
+                     7, HDAG_FIX_NOT, 6, HDAG_FIX_NOT, 0}
+    );
+    /* Masking goes through other mentions */
+    failed += test_issue_fixes_check(
+        &file, (uint8_t []){5, HDAG_MENTION_PRESENT,
+                            6, HDAG_MENTION_PRESENT,
+                            13, HDAG_MENTION_ABSENT, 0},
+        (uint8_t []){9, HDAG_FIX_LIKELY, 7, HDAG_FIX_NOT, 0}
+    );
+    /* Mentions hide the mentions behind them */
+    failed += test_issue_fixes_check(
+        &file, (uint8_t []){13, HDAG_MENTION_PRESENT,
+                            8, HDAG_MENTION_ABSENT, 0},
+        (uint8_t []){9, HDAG_FIX_LIKELY, 8, HDAG_FIX_DEFINITE,
+                     13, HDAG_FIX_NOT, 7, HDAG_FIX_UNKNOWN, 0}
+    );
+    /* A regression after a fix is not masked */
+    failed += test_issue_fixes_check(
+        &file, (uint8_t []){2, HDAG_MENTION_PRESENT,
+                            11, HDAG_MENTION_ABSENT,
+                            6, HDAG_MENTION_PRESENT, 0},
+        (uint8_t []){9, HDAG_FIX_NOT, 12, HDAG_FIX_LIKELY,
+                     5, HDAG_FIX_NOT, 0}
+    );
+
+    /* Check missing nodes are reported */
+    TEST(hdag_file_issue_fixes(&file, node_mentions, hashes[0], 2, fixes) ==
+         HDAG_RES_ERRNO_ARG(ENOENT));
+
+    TEST(!hdag_file_close(&file));
+    return failed;
+}
+
+/**
+ * Deduce the status of an issue's fix at a node by brute force: find the
+ * closest mentions with a depth-first search stopping at mentions, and
+ * check if the "present" ones are reachable from the "absent" ones.
+ *
+ * @param bundle    The bundle containing the nodes.
+ * @param mentions  The mention of the issue at each node of the bundle.
+ * @param reachable The reachability matrix of the bundle, as returned by
+ *                  test_reachable().
+ * @param node_idx  The index of the node to deduce the status at.
+ * @param seen      The buffer for a byte per node of the bundle.
+ * @param stack     The buffer for an index per node of the bundle.
+ *
+ * @return The status of the issue's fix at the node.
+ */
+static enum hdag_fix
+test_issue_fix_brute(const struct hdag_bundle *bundle,
+                     const uint8_t *mentions, const uint8_t *reachable,
+                     uint32_t node_idx, uint8_t *seen, uint32_t *stack)
+{
+    size_t node_num = bundle->nodes.slots_occupied;
+    enum hdag_fix fix = HDAG_FIX_UNKNOWN;
+    size_t stack_num = 0;
+    uint32_t target_num;
+    uint32_t target_idx;
+    uint32_t idx;
+    size_t i, j;
+
+    if (mentions[node_idx] != HDAG_MENTION_NONE) {
+        return mentions[node_idx] == HDAG_MENTION_ABSENT
+            ? HDAG_FIX_DEFINITE : HDAG_FIX_NOT;
+    }
+
+    /* Mark the node's ancestors, down to the closest mentions */
+    memset(seen, 0, node_num);
+    seen[node_idx] = 1;
+    stack[stack_num++] = node_idx;
+    while (stack_num > 0) {
+        idx = stack[--stack_num];
+        if (mentions[idx] != HDAG_MENTION_NONE) {
+            continue;
+        }
+        target_num = hdag_bundle_targets_count(bundle, idx);
+        for (target_idx = 0; target_idx < target_num; target_idx++) {
+            i = hdag_bundle_targets_node_idx(bundle, idx, target_idx);
+            if (!seen[i]) {
+                seen[i] = 1;
+                stack[stack_num++] = i;
+            }
+        }
+    }
+
+    /* Not fixed, if a "present" one isn't reachable from "absent" ones */
+    for (i = 0; i < node_num; i++) {
+        if (!seen[i] || mentions[i] == HDAG_MENTION_NONE) {
+            continue;
+        }
+        fix = fix == HDAG_FIX_UNKNOWN ? HDAG_FIX_LIKELY : fix;
+        if (mentions[i] != HDAG_MENTION_PRESENT) {
+            continue;
+        }
+        for (j = 0; j < node_num; j++) {
+            if (seen[j] && mentions[j] == HDAG_MENTION_ABSENT &&
+                reachable[j * node_num + i]) {
+                break;
+            }
+        }
+        if (j == node_num) {
+            return HDAG_FIX_NOT;
+        }
+    }
+    return fix;
+}
+
+static size_t
+test_issue_fixes_random(void)
+{
+    size_t failed = 0;
+    struct hdag_file file = HDAG_FILE_CLOSED;
+    struct hdag_bundle bundle = HDAG_BUNDLE_EMPTY(TEST_HASH_LEN);
+    uint8_t mentions[128];
+    const size_t node_num = HDAG_ARR_LEN(mentions);
+    uint8_t seen[HDAG_ARR_LEN(mentions)];
+    uint32_t stack[HDAG_ARR_LEN(mentions)];
+    /* Enough nodes for the bitmaps to take more than one word */
+    uint8_t hashes[200][TEST_HASH_LEN];
+    uint32_t node_idxs[HDAG_ARR_LEN(hashes)];
+    enum hdag_fix fixes[HDAG_ARR_LEN(hashes)];
+    enum hdag_fix expected[HDAG_ARR_LEN(hashes)];
+    uint8_t *reachable = NULL;
+    size_t num;
+    size_t variant;
+    size_t trial;
+    size_t i;
+
+    srandom(1);
+    failed += test_random_file(&file, node_num, 3);
+    TEST(!hdag_file_to_bundle(&bundle, &file));
+    reachable = test_reachable(&bundle);
+    TEST(reachable != NULL);
+    if (reachable == NULL) {
+        goto cleanup;
+    }
+
+    for (trial = 0; trial < 100; trial++) {
+        /* Mention the issue at more nodes in later trials */
+        for (i = 0; i < node_num; i++) {
+            mentions[i] = (size_t)random() % 64 >= 1 + trial / 4
+                ? HDAG_MENTION_NONE
+                : 1 + (size_t)random() % (HDAG_MENTION_NUM - 1);
+        }
+        /* Check a batch of random nodes, repeating some */
+        num = 65 + (size_t)random() % (HDAG_ARR_LEN(hashes) - 64);
+        for (i = 0; i < num; i++) {
+            node_idxs[i] = (size_t)random() % node_num;
+            memcpy(hashes[i],
+                   hdag_node_off_const(file.nodes, TEST_HASH_LEN,
+                                       node_idxs[i])->hash,
+                   TEST_HASH_LEN);
+            expected[i] = test_issue_fix_brute(&bundle, mentions, reachable,
+                                               node_idxs[i], seen, stack);
+        }
+        for (variant = 0; variant < TEST_VARIANT_NUM; variant++) {
+            memset(fixes, 0xff, sizeof(fixes));
+            TEST(!TEST_VARIANT_CALL(variant, issue_fixes, &file, &bundle,
+                                    (mentions, hashes[0], num, fixes),
+                                    (mentions, node_idxs, num, fixes)));
+            for (i = 0; i < num; i++) {
+                TEST(fixes[i] == expected[i]);
+            }
+        }
+    }
+
+cleanup:
+    free(reachable);
+    hdag_bundle_cleanup(&bundle);
+    TEST(!hdag_file_close(&file));
+    return failed;
+}
+
 static size_t
 test(void)
 {
@@ -432,6 +1824,17 @@ test(void)
 
     failed += test_empty();
     failed += test_basic();
+    failed += test_bounded();
+    failed += test_in_place();
+    failed += test_index();
+    failed += test_bloom();
+    failed += test_ancestor();
+    failed += test_ancestor_random();
+    failed += test_merge_bases();
+    failed += test_merge_bases_random();
+    failed += test_ancestor_seq();
+    failed += test_issue_fixes();
+    failed += test_issue_fixes_random();
 
     return failed;
 }
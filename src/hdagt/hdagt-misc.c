@@ -4,6 +4,9 @@
 
 #include <hdag/misc.h>
 #include <hdag/darr.h>
+#include <hdag/hash_ops.h>
+#include <hdag/nodes.h>
+#include <hdag/hashes.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <string.h>
@@ -18,6 +21,14 @@
         }                                               \
     } while(0)
 
+/** Compare the keys at offset 2 of test records */
+static int
+test_key_cmp(const void *a, const void *b, void *plen)
+{
+    return memcmp((const uint8_t *)a + 2, (const uint8_t *)b + 2,
+                  *(size_t *)plen);
+}
+
 static size_t
 test(void)
 {
@@ -29,6 +40,29 @@ test(void)
     TEST(hdag_bytes_to_hex(hex_buf, hash, sizeof(hash)) == hex_buf);
     TEST(strcmp(hex_buf, "0123456789abcdef") == 0);
 
+    {
+        uint8_t bytes[sizeof(hash)];
+        /* Long enough to exercise both vectorized and scalar decoding */
+        const char hex[] = "0123456789abcdef0123456789ABCDEF0123456789aBcDeF";
+        uint8_t long_bytes[(sizeof(hex) - 1) / 2];
+        char bad_hex[sizeof(hex)];
+        size_t i;
+
+        TEST(hdag_hex_to_bytes(bytes, hex_buf, sizeof(bytes)));
+        TEST(memcmp(bytes, hash, sizeof(hash)) == 0);
+        TEST(hdag_hex_to_bytes(bytes, "", 0));
+        TEST(hdag_hex_to_bytes(long_bytes, hex, sizeof(long_bytes)));
+        for (i = 0; i < sizeof(long_bytes); i++) {
+            TEST(long_bytes[i] == hash[i % sizeof(hash)]);
+        }
+        /* Check every position detects invalid characters */
+        for (i = 0; i < sizeof(hex) - 1; i++) {
+            memcpy(bad_hex, hex, sizeof(hex));
+            bad_hex[i] = "g/:@G`\x10 "[i % 8];
+            TEST(!hdag_hex_to_bytes(long_bytes, bad_hex, sizeof(long_bytes)));
+        }
+    }
+
     {
         struct hdag_darr darr = HDAG_DARR_EMPTY(1, 1);
 
@@ -38,6 +72,39 @@ test(void)
         hdag_darr_cleanup(&darr);
     }
 
+    {
+        struct hdag_darr darr = HDAG_DARR_EMPTY(1, 64);
+        void *slots;
+
+        /* Check reserving allocates exactly, and appending fits it */
+        TEST(hdag_darr_reserve(&darr, 0));
+        TEST(hdag_darr_allocated_slots(&darr) == 0);
+        TEST(hdag_darr_reserve(&darr, 100));
+        TEST(hdag_darr_allocated_slots(&darr) == 100);
+        slots = darr.slots;
+        TEST(hdag_darr_cappend(&darr, 60) != NULL);
+        TEST(hdag_darr_reserve(&darr, 40));
+        TEST(hdag_darr_cappend(&darr, 40) != NULL);
+        TEST(darr.slots == slots);
+        TEST(hdag_darr_allocated_slots(&darr) == 100);
+        TEST(hdag_darr_reserve(&darr, 1));
+        TEST(hdag_darr_allocated_slots(&darr) == 101);
+        hdag_darr_cleanup(&darr);
+    }
+
+    {
+        struct hdag_darr darr = HDAG_DARR_EMPTY(1, 1);
+        const char ace[] = "ace";
+
+        /* Check inserting in the middle moves the following elements */
+        TEST(hdag_darr_append(&darr, ace, 3) != NULL);
+        TEST(hdag_darr_insert_one(&darr, 1, "b") != NULL);
+        TEST(hdag_darr_insert_one(&darr, 3, "d") != NULL);
+        TEST(hdag_darr_occupied_slots(&darr) == 5);
+        TEST(memcmp(darr.slots, "abcde", 5) == 0);
+        hdag_darr_cleanup(&darr);
+    }
+
     {
         struct hdag_darr darr = HDAG_DARR_EMPTY(0, 16);
 
@@ -97,6 +164,188 @@ test(void)
 #endif
     }
 
+    {
+        /* Records with a 20-byte key after a 2-byte head, and padding */
+        const size_t size = 32, key_off = 2, key_len = 20;
+        const size_t num = 5000;
+        struct hdag_darr radix = HDAG_DARR_EMPTY(size, 0);
+        struct hdag_darr keyed = HDAG_DARR_EMPTY(size, 0);
+        struct hdag_darr ref = HDAG_DARR_EMPTY(size, 0);
+        uint8_t *record;
+        size_t i, j;
+        size_t len = key_len;
+
+        TEST(hdag_darr_cappend(&radix, num) != NULL);
+        /*
+         * Generate keys with long common prefixes and duplicates, to
+         * exercise both deep scattering and the small-bucket sort, and
+         * comparing past the first eight bytes, deriving the rest of each
+         * record from its key
+         */
+        srandom(1);
+        for (i = 0; i < num && radix.slots != NULL; i++) {
+            record = hdag_darr_element(&radix, i);
+            for (j = 0; j < key_len; j++) {
+                record[key_off + j] = j < 5 ? (size_t)random() % (j + 2) :
+                                      j < 12 ? 0 : (size_t)random();
+            }
+            if (i % 7 == 0 && i > 0) {
+                memcpy(record + key_off,
+                       (uint8_t *)hdag_darr_element(&radix, i / 2) + key_off,
+                       key_len);
+            }
+            record[0] = record[key_off + 7];
+            record[1] = record[key_off];
+            memcpy(record + key_off + key_len, record + key_off, 6);
+        }
+        TEST(hdag_darr_append(&ref, radix.slots, num) != NULL);
+        TEST(hdag_darr_append(&keyed, radix.slots, num) != NULL);
+
+        hdag_darr_radix_sort(&radix, 0, num, key_off, key_len);
+        hdag_darr_key_sort(&keyed, 0, num, key_off, key_len);
+        hdag_darr_qsort_all(&ref, test_key_cmp, &len);
+        TEST(radix.slots_occupied == num);
+        TEST(radix.slots != NULL && ref.slots != NULL &&
+             memcmp(radix.slots, ref.slots, num * size) == 0);
+        TEST(keyed.slots_occupied == num);
+        TEST(keyed.slots != NULL && ref.slots != NULL &&
+             memcmp(keyed.slots, ref.slots, num * size) == 0);
+
+        /* Check sorting a reversed slice restores it, and nothing else */
+        for (i = 0; i < 50 && radix.slots != NULL; i++) {
+            memcpy(hdag_darr_element(&radix, 100 + i),
+                   hdag_darr_element(&ref, 199 - i), size);
+            memcpy(hdag_darr_element(&radix, 199 - i),
+                   hdag_darr_element(&ref, 100 + i), size);
+        }
+        hdag_darr_radix_sort(&radix, 100, 200, key_off, key_len);
+        TEST(radix.slots != NULL && ref.slots != NULL &&
+             memcmp(radix.slots, ref.slots, num * size) == 0);
+
+        hdag_darr_cleanup(&ref);
+        hdag_darr_cleanup(&keyed);
+        hdag_darr_cleanup(&radix);
+    }
+
+    {
+        /* Specialized and generic hash lengths */
+        const uint16_t hash_lens[] = {4, 20, 32, 36};
+        const size_t hash_num = 64;
+        const struct hdag_hash_ops *ops;
+        uint8_t hashes[64 * 36];
+        _Alignas(struct hdag_node)
+            uint8_t nodes[64 * (sizeof(struct hdag_node) + 36)];
+        uint8_t a[36], b[36];
+        uint64_t seed;
+        uint32_t fanout[256];
+        uint8_t batch_hashes[64 * 2 * 36];
+        uint32_t batch_idxs[64 * 2];
+        uint32_t batch_found_idxs[64 * 2];
+        uint16_t hash_len;
+        size_t i, j, idx;
+        int rel;
+
+        for (i = 0; i < HDAG_ARR_LEN(hash_lens); i++) {
+            hash_len = hash_lens[i];
+            ops = hdag_hash_ops_get(hash_len);
+            TEST(hdag_hash_ops_is_valid(ops));
+            TEST(ops->hash_len == ((hash_len == 20 || hash_len == 32) ?
+                                   hash_len : 0));
+
+            /* Check differences at each byte compare like memcmp(3) */
+            for (j = 0; j < hash_len; j++) {
+                memset(a, 0x5a, sizeof(a));
+                memcpy(b, a, sizeof(b));
+                TEST(ops->cmp(a, b, hash_len) == 0);
+                b[j] = 0x5b;
+                a[hash_len - 1 - j] = 0xa5;
+                rel = memcmp(a, b, hash_len);
+                TEST((ops->cmp(a, b, hash_len) < 0) == (rel < 0));
+                TEST((ops->cmp(a, b, hash_len) > 0) == (rel > 0));
+                TEST((ops->cmp(b, a, hash_len) > 0) == (rel < 0));
+            }
+
+            /* Check sorted hashes are found, and ones between them aren't */
+            memset(hashes, 0, sizeof(hashes));
+            memset(nodes, 0, sizeof(nodes));
+            for (j = 0; j < hash_num; j++) {
+                hashes[j * hash_len + j % (hash_len - 1)] = 1;
+                hashes[j * hash_len + hash_len - 1] = j << 1;
+            }
+            qsort_r(hashes, hash_num, hash_len, hdag_hash_cmp, &hash_len);
+            for (j = 0; j < hash_num; j++) {
+                memcpy(((struct hdag_node *)
+                        (nodes + j * hdag_node_size(hash_len)))->hash,
+                       hashes + j * hash_len, hash_len);
+            }
+            for (j = 0; j < hash_num; j++) {
+                memcpy(a, hashes + j * hash_len, hash_len);
+                TEST(ops->hashes_slice_find(hashes, hash_len, 0, hash_num,
+                                            a, &idx));
+                TEST(idx == j);
+                TEST(ops->nodes_slice_find((struct hdag_node *)nodes,
+                                           0, hash_num, hash_len, a) == j);
+                a[hash_len - 1] |= 1;
+                TEST(!ops->hashes_slice_find(hashes, hash_len, 0, hash_num,
+                                             a, &idx));
+                TEST(idx == j + 1);
+                TEST(ops->nodes_slice_find((struct hdag_node *)nodes,
+                                           0, hash_num, hash_len, a) ==
+                     INT32_MAX);
+                TEST(ops->nodes_slice_interp_find((struct hdag_node *)nodes,
+                                                  0, hash_num, hash_len,
+                                                  a, 0) == INT32_MAX);
+                a[hash_len - 1] &= ~1;
+                TEST(ops->nodes_slice_interp_find((struct hdag_node *)nodes,
+                                                  0, hash_num, hash_len,
+                                                  a, 0) == j);
+            }
+
+            /*
+             * Check the interpolation search agrees with the binary one on
+             * evenly-spread hashes, all sharing the first byte
+             */
+            for (j = 0, seed = 1; j < hash_num * hash_len; j++) {
+                seed = seed * 6364136223846793005u + 1442695040888963407u;
+                hashes[j] = seed >> 56;
+            }
+            for (j = 0; j < hash_num; j++) {
+                hashes[j * hash_len] = 0x5a;
+            }
+            qsort_r(hashes, hash_num, hash_len, hdag_hash_cmp, &hash_len);
+            for (j = 0; j < hash_num; j++) {
+                memcpy(((struct hdag_node *)
+                        (nodes + j * hdag_node_size(hash_len)))->hash,
+                       hashes + j * hash_len, hash_len);
+            }
+            for (j = 0; j < hash_num * 2; j++) {
+                memcpy(a, hashes + j / 2 * hash_len, hash_len);
+                a[hash_len - 1] ^= j & 1;
+                idx = ops->nodes_slice_find((struct hdag_node *)nodes,
+                                            0, hash_num, hash_len, a);
+                TEST((j & 1) || idx == j / 2);
+                TEST(ops->nodes_slice_interp_find((struct hdag_node *)nodes,
+                                                  0, hash_num, hash_len,
+                                                  a, 8) == idx);
+                TEST(hdag_nodes_slice_interp_find((struct hdag_node *)nodes,
+                                                  0, hash_num, hash_len,
+                                                  a, 0) == idx);
+                memcpy(batch_hashes + j * hash_len, a, hash_len);
+                batch_idxs[j] = idx;
+            }
+
+            /* Check the batch lookup agrees with the single ones */
+            for (j = 0; j < HDAG_ARR_LEN(fanout); j++) {
+                fanout[j] = j < 0x5a ? 0 : hash_num;
+            }
+            ops->nodes_find_batch((struct hdag_node *)nodes, fanout, 8,
+                                  hash_len, batch_hashes, hash_num * 2,
+                                  batch_found_idxs);
+            TEST(memcmp(batch_found_idxs, batch_idxs,
+                        sizeof(batch_idxs)) == 0);
+        }
+    }
+
     return failed;
 }
 